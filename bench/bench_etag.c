@@ -0,0 +1,96 @@
+/*
+ * ETag hash throughput: the byte-at-a-time DJB2 loop the library used before
+ * against each cHTTPX_Hash64 implementation, over a range of body sizes.
+ *
+ *   make bench
+ */
+
+#include "hash.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Bytes hashed per measurement, split into bodies of the measured size */
+#define BENCH_BYTES (256u << 20)
+
+static uint64_t djb2(const void* data, size_t len)
+{
+    const unsigned char* p = data;
+    uint64_t hash = 5381;
+    for (size_t i = 0; i < len; i++)
+        hash = ((hash << 5) + hash) + p[i];
+
+    return hash;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Throughput in MB/s */
+static double measure(chttpx_hash_fn_t fn, const unsigned char* buf, size_t size, uint64_t* sink)
+{
+    size_t rounds = BENCH_BYTES / size;
+    if (rounds < 16)
+        rounds = 16;
+
+    double start = now();
+    for (size_t i = 0; i < rounds; i++)
+        *sink += fn(buf + (i & 7), size);
+    double elapsed = now() - start;
+
+    return (double)rounds * size / elapsed / 1e6;
+}
+
+int main(void)
+{
+    static const size_t sizes[] = {16, 64, 256, 1024, 4096, 16384, 65536, 1 << 20, 8 << 20};
+    static const char* impls[] = {"scalar", "sse2", "avx2"};
+    size_t max = 8 << 20;
+
+    unsigned char* buf = malloc(max + 8);
+    if (!buf)
+    {
+        perror("malloc failed");
+        return 1;
+    }
+
+    for (size_t i = 0; i < max + 8; i++)
+        buf[i] = (unsigned char)(i * 2654435761u >> 13);
+
+    uint64_t sink = 0;
+
+    printf("%10s %10s", "size", "djb2");
+    for (size_t j = 0; j < 3; j++)
+        printf(" %10s", impls[j]);
+    printf("   (MB/s)\n");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        printf("%10zu %10.0f", sizes[s], measure(djb2, buf, sizes[s], &sink));
+
+        for (size_t j = 0; j < 3; j++)
+        {
+            if (_hash64_select(impls[j]) != 0)
+            {
+                printf(" %10s", "-");
+                continue;
+            }
+
+            printf(" %10.0f", measure(cHTTPX_Hash64, buf, sizes[s], &sink));
+        }
+
+        printf("\n");
+    }
+
+    _hash64_select(NULL);
+    printf("default: %s (%llx)\n", _hash64_impl(), (unsigned long long)sink);
+
+    free(buf);
+    return 0;
+}
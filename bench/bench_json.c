@@ -0,0 +1,278 @@
+/*
+ * JSON body decoding: the cJSON tree cHTTPX_Parse used to build (parse,
+ * look every field up, copy the values out) against cHTTPX_Parse without a
+ * structural index and with each _json_index implementation, on payloads
+ * shaped like the bodies our endpoints receive.
+ *
+ *   make bench
+ */
+
+#include "libchttpx.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+#include "../lib/cjson/cJSON.h"
+#else
+#include <cjson/cJSON.h>
+#endif
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Bytes decoded per measurement */
+#define BENCH_BYTES (64u << 20)
+#define BENCH_RUNS 8
+
+typedef struct
+{
+    char* name;
+    char* email;
+    char* text;
+    int count;
+    uint8_t active;
+    chttpx_string_array_t tags;
+    chttpx_number_array_t ids;
+} payload_t;
+
+typedef struct
+{
+    const char* name;
+    char* body;
+    size_t size;
+} bench_body_t;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t schema(payload_t* p, chttpx_validation_t* fields)
+{
+    chttpx_validation_t f[] = {
+        chttpx_validation_string("name", &p->name, false, 0, 0, VALIDATOR_NONE),
+        chttpx_validation_string("email", &p->email, false, 0, 0, VALIDATOR_NONE),
+        chttpx_validation_string("text", &p->text, false, 0, 0, VALIDATOR_NONE),
+        chttpx_validation_integer("count", &p->count, false),
+        chttpx_validation_boolean("active", &p->active, false),
+        {"tags", &p->tags, false, 0, 0, FIELD_STRING_ARRAY, VALIDATOR_NONE, 0},
+        {"ids", &p->ids, false, 0, 0, FIELD_NUMBER_ARRAY, VALIDATOR_NONE, 0},
+    };
+
+    memcpy(fields, f, sizeof(f));
+    return sizeof(f) / sizeof(f[0]);
+}
+
+static void payload_free(payload_t* p)
+{
+    free(p->name);
+    free(p->email);
+    free(p->text);
+    for (size_t i = 0; i < p->tags.count; i++)
+        free(p->tags.items[i]);
+    free(p->tags.items);
+    free(p->ids.items);
+    memset(p, 0, sizeof(*p));
+}
+
+/* What cHTTPX_Parse did before: a whole tree, then one lookup and copy per field */
+static int decode_cjson(chttpx_request_t* req, chttpx_validation_t* fields, size_t count)
+{
+    cJSON* json = cJSON_ParseWithLength((const char*)req->body, req->body_size);
+    if (!json)
+        return 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        chttpx_validation_t* f = &fields[i];
+        cJSON* item = cJSON_GetObjectItem(json, f->name);
+        if (!item)
+            continue;
+
+        f->present = 1;
+
+        if (f->type == FIELD_STRING && cJSON_IsString(item))
+            *(char**)f->target = strdup(item->valuestring);
+        else if (f->type == FIELD_NUMBER && cJSON_IsNumber(item))
+            *(int*)f->target = item->valueint;
+        else if (f->type == FIELD_BOOL && cJSON_IsBool(item))
+            *(uint8_t*)f->target = cJSON_IsTrue(item);
+        else if (f->type == FIELD_STRING_ARRAY && cJSON_IsArray(item))
+        {
+            chttpx_string_array_t* arr = f->target;
+            arr->count = cJSON_GetArraySize(item);
+            arr->items = malloc(sizeof(char*) * arr->count);
+
+            size_t j = 0;
+            cJSON* el;
+            cJSON_ArrayForEach(el, item) arr->items[j++] = cJSON_IsString(el) ? strdup(el->valuestring) : NULL;
+        }
+        else if (f->type == FIELD_NUMBER_ARRAY && cJSON_IsArray(item))
+        {
+            chttpx_number_array_t* arr = f->target;
+            arr->count = cJSON_GetArraySize(item);
+            arr->items = malloc(sizeof(int) * arr->count);
+
+            size_t j = 0;
+            cJSON* el;
+            cJSON_ArrayForEach(el, item) arr->items[j++] = cJSON_IsNumber(el) ? el->valueint : 0;
+        }
+    }
+
+    cJSON_Delete(json);
+    return 1;
+}
+
+static int decode_chttpx(chttpx_request_t* req, chttpx_validation_t* fields, size_t count)
+{
+    return cHTTPX_Parse(req, fields, count);
+}
+
+/* Throughput in MB/s, the best of BENCH_RUNS runs */
+static double measure(int (*decode)(chttpx_request_t*, chttpx_validation_t*, size_t), const bench_body_t* b)
+{
+    chttpx_arena_t arena = {0};
+    chttpx_request_t req = {.arena = &arena, .body = (unsigned char*)b->body, .body_size = b->size};
+    chttpx_validation_t fields[8];
+    payload_t p = {0};
+    double best = 0;
+
+    size_t rounds = BENCH_BYTES / BENCH_RUNS / b->size;
+    if (rounds < 4)
+        rounds = 4;
+
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        double start = now();
+        for (size_t i = 0; i < rounds; i++)
+        {
+            size_t count = schema(&p, fields);
+            if (!decode(&req, fields, count))
+            {
+                fprintf(stderr, "%s: %s\n", b->name, req.error_msg);
+                exit(1);
+            }
+
+            payload_free(&p);
+        }
+
+        double rate = (double)rounds * b->size / (now() - start) / 1e6;
+        if (rate > best)
+            best = rate;
+    }
+
+    _arena_free(&arena);
+    return best;
+}
+
+/* Append to a buffer that is large enough */
+static size_t put(char* buf, size_t len, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    len += (size_t)vsprintf(buf + len, fmt, ap);
+    va_end(ap);
+    return len;
+}
+
+static const char* words[] = {"alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel", "india", "juliet"};
+
+/* A sign-up form */
+static size_t body_user(char* buf)
+{
+    return put(buf, 0,
+               "{\"name\": \"netcorelink\", \"email\": \"user@example.com\", \"count\": 31, \"active\": true,"
+               " \"profile\": {\"bio\": \"Lorem ipsum dolor sit amet, consectetur adipiscing elit\","
+               " \"links\": [\"https://a.example\", \"https://b.example\"]}, \"tags\": [\"x\", \"y\", \"z\"]}");
+}
+
+/* Bulk import: ids and tags arrays */
+static size_t body_bulk(char* buf)
+{
+    size_t len = put(buf, 0, "{\"name\": \"import-2026-10\", \"count\": 100000, \"ids\": [");
+    for (int i = 0; i < 100000; i++)
+        len = put(buf, len, "%s%d", i ? ", " : "", 1000000 + i * 37);
+
+    len = put(buf, len, "], \"tags\": [");
+    for (int i = 0; i < 50000; i++)
+        len = put(buf, len, "%s\"%s-%s %d%s\"", i ? ", " : "", words[i % 10], words[i / 10 % 10], i, i % 50 ? "" : " \\\"q\\\"");
+
+    return put(buf, len, "], \"active\": true}");
+}
+
+/* A batch whose records the handler leaves alone: only the header fields are read */
+static size_t body_records(char* buf)
+{
+    size_t len = put(buf, 0, "{\"name\": \"batch-17\", \"records\": [");
+    for (int i = 0; i < 8000; i++)
+        len = put(buf, len,
+                  "%s{\"id\": %d, \"user\": \"%s.%s@example.com\", \"score\": %d.%02d, \"verified\": %s,"
+                  " \"address\": {\"city\": \"%s\", \"zip\": \"%05d\"}, \"roles\": [\"%s\", \"%s\"]}",
+                  i ? ", " : "", i, words[i % 10], words[i / 10 % 10], i % 100, i % 97, i % 3 ? "true" : "false", words[i / 7 % 10],
+                  i * 7 % 100000, words[i % 10], words[(i + 3) % 10]);
+
+    return put(buf, len, "], \"count\": 8000}");
+}
+
+/* A document upload: one long escaped text */
+static size_t body_text(char* buf)
+{
+    size_t len = put(buf, 0, "{\"name\": \"README.md\", \"text\": \"");
+    for (int i = 0; i < 12000; i++)
+        len = put(buf, len, "Line %d of the \\\"%s\\\" section: %s %s %s.\\n", i, words[i % 10], words[(i + 1) % 10], words[(i + 2) % 10],
+                  words[(i + 5) % 10]);
+
+    return put(buf, len, "\", \"count\": 12000}");
+}
+
+int main(void)
+{
+    static const char* impls[] = {"none", "scalar", "sse2", "avx2"};
+    size_t (*build[])(char*) = {body_user, body_bulk, body_records, body_text};
+    const char* names[] = {"user", "bulk", "records", "text"};
+    bench_body_t bodies[4];
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        char* buf = malloc(4 << 20);
+        if (!buf)
+        {
+            perror("malloc failed");
+            return 1;
+        }
+
+        bodies[i] = (bench_body_t){names[i], buf, build[i](buf)};
+    }
+
+    printf("%10s %10s %10s", "body", "size", "cjson");
+    for (size_t j = 0; j < 4; j++)
+        printf(" %10s", impls[j]);
+    printf("   (MB/s)\n");
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        printf("%10s %10zu %10.0f", bodies[i].name, bodies[i].size, measure(decode_cjson, &bodies[i]));
+
+        for (size_t j = 0; j < 4; j++)
+        {
+            if (_json_index_select(impls[j]) != 0)
+            {
+                printf(" %10s", "-");
+                continue;
+            }
+
+            printf(" %10.0f", measure(decode_chttpx, &bodies[i]));
+        }
+
+        printf("\n");
+        free(bodies[i].body);
+    }
+
+    _json_index_select(NULL);
+    printf("default: %s, index from %d bytes\n", _json_index_impl(), CHTTPX_JSON_INDEX_MIN);
+    return 0;
+}
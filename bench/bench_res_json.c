@@ -0,0 +1,177 @@
+/*
+ * JSON response bodies: printf-style cHTTPX_ResJson, a cJSON tree printed
+ * and copied into the response, and the cHTTPX_Json* writer, building the
+ * same list of users.
+ *
+ *   make bench
+ */
+
+#include "libchttpx.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+#include "../lib/cjson/cJSON.h"
+#else
+#include <cjson/cJSON.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Bytes built per measurement */
+#define BENCH_BYTES (64u << 20)
+#define BENCH_RUNS 8
+
+typedef struct
+{
+    int id;
+    const char* name;
+    const char* email;
+    double score;
+    int active;
+} user_t;
+
+static user_t users[2000];
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* A format string per document, as handlers write them today (no escaping) */
+static chttpx_response_t build_printf(size_t count)
+{
+    if (count == 1)
+    {
+        const user_t* u = &users[0];
+        return cHTTPX_ResJson(cHTTPX_StatusOK, "{\"id\": %d, \"name\": \"%s\", \"email\": \"%s\", \"score\": %g, \"active\": %s}", u->id,
+                              u->name, u->email, u->score, u->active ? "true" : "false");
+    }
+
+    /* Lists go through a buffer of their own, the format cannot loop */
+    size_t cap = count * 128, len = 0;
+    char* list = malloc(cap);
+    len += (size_t)snprintf(list, cap, "[");
+    for (size_t i = 0; i < count; i++)
+    {
+        const user_t* u = &users[i];
+        len += (size_t)snprintf(list + len, cap - len, "%s{\"id\": %d, \"name\": \"%s\", \"email\": \"%s\", \"score\": %g, \"active\": %s}",
+                                i ? ", " : "", u->id, u->name, u->email, u->score, u->active ? "true" : "false");
+    }
+    snprintf(list + len, cap - len, "]");
+
+    chttpx_response_t res = cHTTPX_ResJson(cHTTPX_StatusOK, "%s", list);
+    free(list);
+    return res;
+}
+
+static chttpx_response_t build_cjson(size_t count)
+{
+    cJSON* root = count == 1 ? NULL : cJSON_CreateArray();
+    cJSON* obj = NULL;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const user_t* u = &users[i];
+        obj = cJSON_CreateObject();
+        cJSON_AddNumberToObject(obj, "id", u->id);
+        cJSON_AddStringToObject(obj, "name", u->name);
+        cJSON_AddStringToObject(obj, "email", u->email);
+        cJSON_AddNumberToObject(obj, "score", u->score);
+        cJSON_AddBoolToObject(obj, "active", u->active);
+        if (root)
+            cJSON_AddItemToArray(root, obj);
+    }
+
+    if (!root)
+        root = obj;
+
+    char* text = cJSON_PrintUnformatted(root);
+    chttpx_response_t res = cHTTPX_ResBinary(cHTTPX_StatusOK, cHTTPX_CTYPE_JSON, (unsigned char*)text, strlen(text));
+    free(text);
+    cJSON_Delete(root);
+    return res;
+}
+
+static chttpx_response_t build_writer(size_t count)
+{
+    chttpx_json_t json;
+    cHTTPX_JsonInit(&json, NULL);
+
+    if (count > 1)
+        cHTTPX_JsonArray(&json);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const user_t* u = &users[i];
+        cHTTPX_JsonObject(&json);
+        cHTTPX_JsonKey(&json, "id");
+        cHTTPX_JsonInt(&json, u->id);
+        cHTTPX_JsonKey(&json, "name");
+        cHTTPX_JsonString(&json, u->name);
+        cHTTPX_JsonKey(&json, "email");
+        cHTTPX_JsonString(&json, u->email);
+        cHTTPX_JsonKey(&json, "score");
+        cHTTPX_JsonDouble(&json, u->score);
+        cHTTPX_JsonKey(&json, "active");
+        cHTTPX_JsonBool(&json, u->active);
+        cHTTPX_JsonObjectEnd(&json);
+    }
+
+    if (count > 1)
+        cHTTPX_JsonArrayEnd(&json);
+
+    return cHTTPX_ResJsonWriter(cHTTPX_StatusOK, &json);
+}
+
+/* Body MB/s, the best of BENCH_RUNS runs */
+static double measure(chttpx_response_t (*build)(size_t), size_t count)
+{
+    chttpx_response_t res = build(count);
+    size_t size = res.body_size;
+    free((void*)res.body);
+
+    size_t rounds = BENCH_BYTES / BENCH_RUNS / size;
+    if (rounds < 4)
+        rounds = 4;
+
+    double best = 0;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        double start = now();
+        for (size_t i = 0; i < rounds; i++)
+        {
+            res = build(count);
+            free((void*)res.body);
+        }
+
+        double rate = (double)rounds * size / (now() - start) / 1e6;
+        if (rate > best)
+            best = rate;
+    }
+
+    return best;
+}
+
+int main(void)
+{
+    static char names[2000][32], emails[2000][48];
+    static const size_t counts[] = {1, 20, 2000};
+
+    for (int i = 0; i < 2000; i++)
+    {
+        snprintf(names[i], sizeof(names[i]), "user %d", i);
+        snprintf(emails[i], sizeof(emails[i]), "user.%d@example.com", i);
+        users[i] = (user_t){1000 + i, names[i], emails[i], i * 0.25, i % 3 != 0};
+    }
+
+    printf("%10s %10s %10s %10s   (MB/s)\n", "users", "printf", "cjson", "writer");
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+        printf("%10zu %10.0f %10.0f %10.0f\n", counts[i], measure(build_printf, counts[i]), measure(build_cjson, counts[i]),
+               measure(build_writer, counts[i]));
+
+    return 0;
+}
@@ -74,7 +74,22 @@ void array(chttpx_request_t* req, chttpx_response_t* res)
     if (!cHTTPX_Parse(req, fields, ARRAY_LEN(fields)))
         goto error;
 
-    *res = cHTTPX_ResJson(cHTTPX_StatusOK, "{\"message\": \"%s\"}", tags.items[0]);
+    /* Echo the tags back, escaped by the writer */
+    chttpx_json_t json;
+    cHTTPX_JsonInit(&json, req);
+    cHTTPX_JsonObject(&json);
+    cHTTPX_JsonKey(&json, "tags");
+    cHTTPX_JsonArray(&json);
+    for (size_t i = 0; i < tags.count; i++)
+    {
+        cHTTPX_JsonString(&json, tags.items[i]);
+        free(tags.items[i]);
+    }
+    cHTTPX_JsonArrayEnd(&json);
+    cHTTPX_JsonObjectEnd(&json);
+    free(tags.items);
+
+    *res = cHTTPX_ResJsonWriter(cHTTPX_StatusOK, &json);
     return;
 
 error:
@@ -92,10 +107,7 @@ void create_user(chttpx_request_t* req, chttpx_response_t* res)
         chttpx_validation_boolean("is_admin", &user.is_admin, false),
     };
 
-    if (!cHTTPX_Parse(req, fields, ARRAY_LEN(fields)))
-        goto error;
-
-    if (!cHTTPX_Validate(req, fields, ARRAY_LEN(fields), "ru"))
+    if (!cHTTPX_ParseValidate(req, fields, ARRAY_LEN(fields), "ru"))
         goto error;
 
     printf("%s", user.uuid);
@@ -104,9 +116,6 @@ void create_user(chttpx_request_t* req, chttpx_response_t* res)
     return;
 
 error:
-    free(user.uuid);
-    free(user.password);
-
     *res = cHTTPX_ResJson(cHTTPX_StatusBadRequest, "{\"error\": \"%s\"}", req->error_msg);
     return;
 }
@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2026 netcorelink
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `libchttpx.c` for details.
+ */
+
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "crosspltm.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+    /* Retry period of CHTTPX_OVERLOAD_SHED_IDLE while no connection is idle */
+#define ADMISSION_SHED_RETRY_MS 100
+
+    /* What the server does with new connections while max_clients are open */
+    typedef enum
+    {
+        /* Stop accepting until a connection closes, new clients wait in the listen backlog */
+        CHTTPX_OVERLOAD_QUEUE = 0,
+        /* Accept and answer 503 Service Unavailable right away */
+        CHTTPX_OVERLOAD_REJECT,
+        /* Close the oldest idle keep-alive connection to make room, queue if there is none */
+        CHTTPX_OVERLOAD_SHED_IDLE,
+    } chttpx_overload_t;
+
+    /* Admission counters, see cHTTPX_AdmissionStats */
+    typedef struct
+    {
+        /* Open connections and the limit */
+        size_t current;
+        size_t max;
+
+        /* Times the server stopped accepting because it was full */
+        uint64_t waits;
+        /* Connections answered with 503 */
+        uint64_t rejected;
+        /* Idle keep-alive connections closed to make room */
+        uint64_t shed;
+    } chttpx_admission_stats_t;
+
+    /* Idle keep-alive connection of a blocking connection thread */
+    typedef struct chttpx_idle_conn
+    {
+        chttpx_socket_t fd;
+        struct chttpx_idle_conn* prev;
+        struct chttpx_idle_conn* next;
+    } chttpx_idle_conn_t;
+
+    /* Initialize the admission state, called by cHTTPX_Init */
+    void _admission_init(void);
+
+    /**
+     * Take a connection slot.
+     * @return 1 if the connection is admitted, 0 if max_clients are open.
+     */
+    int _admission_try_acquire(void);
+
+    /* Give back a connection slot, waking the accept loop if it waits for one */
+    void _admission_release(void);
+
+    /**
+     * Block until a connection slot is free (no busy wait).
+     * @param timeout_ms Give up after this long, 0 - wait indefinitely.
+     */
+    void _admission_wait(unsigned timeout_ms);
+
+    /* Count an overload pause of the accept loop */
+    void _admission_note_wait(void);
+
+    /* Count an idle connection shed by the event loop */
+    void _admission_note_shed(void);
+
+    /**
+     * Answer 503 on a connection that was not admitted and close it.
+     * @param fd Freshly accepted client socket.
+     */
+    void _admission_reject(chttpx_socket_t fd);
+
+    /**
+     * Register a blocking connection waiting for its next keep-alive REQuest.
+     * @param idle Entry owned by the caller, valid until _admission_idle_leave.
+     * @param fd Client socket.
+     */
+    void _admission_idle_enter(chttpx_idle_conn_t* idle, chttpx_socket_t fd);
+
+    /* Unregister an idle connection, before its socket is read or closed */
+    void _admission_idle_leave(chttpx_idle_conn_t* idle);
+
+    /**
+     * Shut down the oldest registered idle connection, its thread then closes it.
+     * @return 1 if a connection was shed, 0 if none is idle.
+     */
+    int _admission_shed_idle(void);
+
+    /**
+     * Snapshot the admission counters.
+     * @param stats Output structure.
+     */
+    void cHTTPX_AdmissionStats(chttpx_admission_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
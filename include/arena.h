@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2026 netcorelink
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `libchttpx.c` for details.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE 4096
+
+    /* Arena block, allocations are carved from data[] */
+    typedef struct chttpx_arena_block
+    {
+        struct chttpx_arena_block* next;
+        size_t size;
+        size_t used;
+        unsigned char data[];
+    } chttpx_arena_block_t;
+
+    /* Bump-pointer arena, everything is released at once */
+    typedef struct
+    {
+        chttpx_arena_block_t* head;
+    } chttpx_arena_t;
+
+    /**
+     * Allocate from the arena.
+     * @param arena Arena, zero-initialized before first use.
+     * @param size Number of bytes.
+     * @return Pointer aligned for any type, NULL if out of memory.
+     */
+    void* _arena_alloc(chttpx_arena_t* arena, size_t size);
+
+    /* Copy len bytes of s into the arena and NUL-terminate them */
+    char* _arena_strndup(chttpx_arena_t* arena, const char* s, size_t len);
+
+    /**
+     * Double the capacity of an array, the new storage is taken from the arena.
+     * The old storage (inline or arena) is left as is.
+     * @param items Current array, may be NULL when cap is 0.
+     * @param count Number of used elements, copied to the new array.
+     * @param cap In/out capacity in elements.
+     * @param elem_size Size of one element.
+     * @return New array, NULL if out of memory (items is unchanged).
+     */
+    void* _arena_grow(chttpx_arena_t* arena, void* items, size_t count, size_t* cap, size_t elem_size);
+
+    /* Drop every allocation, one block is kept for reuse */
+    void _arena_reset(chttpx_arena_t* arena);
+
+    /* Release every block of the arena */
+    void _arena_free(chttpx_arena_t* arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -16,9 +16,55 @@ extern "C"
 #include "request.h"
 
 #define MAX_BODY_IN_MEMORY 1048576 // 1 MB
+/* Smallest body rest worth a pipe for splice(2), smaller ones are read and written */
+#define BODY_SPLICE_MIN 65536
 
-    /* Parse body in request */
-    void _parse_req_body(chttpx_request_t* req, chttpx_socket_t client_fd, char* buffer, size_t buffer_len);
+    /**
+     * Content-Length of a complete REQuest head, read from the header fields
+     * the way _parse_req_headers reads them.
+     * @param head REQuest head, up to and including the empty line.
+     * @param head_len Size of the head.
+     * @param content_length Declared body size, 0 if absent.
+     * @return 0, or -1 if the body cannot be framed safely: a line that is not a
+     *         field (e.g. whitespace before the colon), an invalid or repeated Content-Length.
+     */
+    int _req_head_content_length(const char* head, size_t head_len, size_t* content_length);
+
+    /* Answer 400 to a REQuest rejected by the framing, the caller closes the connection */
+    void _req_head_reject(chttpx_socket_t fd);
+
+    /**
+     * Whether a complete REQuest head has a Transfer-Encoding field (its body is
+     * framed by chunks), read the way _parse_req_headers reads the fields.
+     * @return 1 or 0, -1 for a line that is not a field (answered 400 like _req_head_content_length).
+     */
+    int _req_head_chunked(const char* head, size_t head_len);
+
+    /**
+     * Set up the body reader of a parsed REQuest and its content_length.
+     * @param body Part of the body already received (after the head).
+     * @param body_len Size of that part.
+     */
+    void _body_reader_init(chttpx_request_t* req, const char* body, size_t body_len);
+
+    /* Whether the body was read to its end, so the connection can carry the next REQuest */
+    bool _body_complete(const chttpx_request_t* req);
+
+    /* Read a JSON or text body into memory (req->body), see MAX_BODY_IN_MEMORY */
+    void _parse_req_body(chttpx_request_t* req);
+
+#ifdef CHTTPX_PLATFORM_LINUX
+    /* Whether the rest of the body can be spliced: a plain Content-Length body of at least BODY_SPLICE_MIN bytes */
+    bool _body_can_splice(const chttpx_request_t* req);
+
+    /**
+     * Move the rest of the body into a file with splice(2), socket to pipe to
+     * file, without copying it through user space.
+     * @param fd File written at its current position.
+     * @return Bytes written, -1 on error.
+     */
+    long _body_splice(chttpx_request_t* req, int fd);
+#endif
 
 #ifdef __cplusplus
     extern
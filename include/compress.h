@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) 2026 netcorelink
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `libchttpx.c` for details.
+ */
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "request.h"
+#include "response.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Content codings accepted by a client (bits of _compress_accepts) */
+#define CHTTPX_ENC_GZIP 0x1
+#define CHTTPX_ENC_DEFLATE 0x2
+#define CHTTPX_ENC_BR 0x4
+
+/* Bodies smaller than this are sent as they are (default of cHTTPX_Compress) */
+#define CHTTPX_COMPRESS_MIN_SIZE 1024
+/* Files up to this size get a compressed copy cached in memory, larger ones go out as they are */
+#define CHTTPX_COMPRESS_FILE_MAX (4 * 1024 * 1024)
+/* Memory held by the compressed copies of files, least recently used ones go first */
+#define CHTTPX_COMPRESS_CACHE_SIZE (32 * 1024 * 1024)
+#define CHTTPX_COMPRESS_BUCKETS 1024
+/* Brotli quality of bodies compressed per response (brotli builds, see CHTTPX_BROTLI) */
+#define CHTTPX_BROTLI_QUALITY 5
+/* Size a compressed REQuest body may inflate to (default of cHTTPX_DecompressLimit) */
+#define CHTTPX_INFLATE_MAX (16 * 1024 * 1024)
+
+    typedef struct
+    {
+        uint8_t enabled;
+        /* Smallest body worth compressing */
+        size_t min_size;
+        /* zlib level of bodies compressed per response, cached file copies use the best one */
+        int level;
+        /* Compressible Content-Type prefixes */
+        const char** types;
+        size_t types_count;
+    } chttpx_compress_t;
+
+    /* Compression counters, see cHTTPX_CompressStats */
+    typedef struct
+    {
+        /* Responses sent compressed */
+        uint64_t responses;
+        /* Memory bodies: bytes before and after compression */
+        uint64_t bytes_in;
+        uint64_t bytes_out;
+        /* Compressed file copies served from the cache / compressed on a miss */
+        uint64_t cache_hits;
+        uint64_t cache_misses;
+        /* Files answered with their ".br" / ".gz" sibling */
+        uint64_t precompressed;
+        /* Compressed file copies in the cache and their size */
+        size_t cache_entries;
+        size_t cache_bytes;
+    } chttpx_compress_stats_t;
+
+    /**
+     * Enable response compression (gzip, deflate, and br in brotli builds).
+     *
+     * Responses of a compressible type are compressed for clients whose
+     * Accept-Encoding allows it: memory bodies of at least min_size bytes,
+     * streamed bodies chunk by chunk, files through a cache of compressed copies.
+     * Static files with a ".br" or ".gz" sibling are answered with the sibling.
+     * Compressed responses carry "Vary: Accept-Encoding" and a weak ETag.
+     *
+     * @param min_size Smallest body to compress, 0 for CHTTPX_COMPRESS_MIN_SIZE.
+     * @param level zlib level 1..9, 0 for the zlib default (6).
+     * @param types Compressible Content-Type prefixes (e.g. "text/"). If NULL,
+     *              defaults to text, JSON, JavaScript, XML and SVG.
+     * @param types_count Number of elements in the types array.
+     */
+    void cHTTPX_Compress(size_t min_size, int level, const char** types, size_t types_count);
+
+    /**
+     * Limit the size REQuest bodies sent with "Content-Encoding: gzip" or "deflate"
+     * may inflate to. Such bodies are decoded as they are read (req->body, temp
+     * files, cHTTPX_BodyRead); one that decodes to more is refused with 413
+     * instead of being inflated to the end, so a small zip bomb costs nothing.
+     * @param max_size Decoded bytes, 0 for CHTTPX_INFLATE_MAX.
+     */
+    void cHTTPX_DecompressLimit(size_t max_size);
+
+    /**
+     * Codings a REQuest's Accept-Encoding allows (CHTTPX_ENC_* bits), q=0 excluded.
+     * @return 0 if compression is disabled or the client accepts none.
+     */
+    unsigned _compress_accepts(chttpx_request_t* req);
+
+    /* Whether responses of this Content-Type are compressed */
+    int _compress_type(const char* content_type);
+
+    /**
+     * Compress a 200 response for the client when it is worth it: memory body,
+     * stream or file. Adds "Vary: Accept-Encoding" to compressible responses.
+     */
+    void _res_apply_compression(chttpx_request_t* req, chttpx_response_t* res);
+
+    /* Count a static file answered with its precompressed sibling */
+    void _compress_note_precompressed(void);
+
+    /* Drop the cached file copies (cHTTPX_Shutdown) */
+    void _compress_shutdown(void);
+
+    /**
+     * Snapshot the compression counters.
+     * @param stats Output structure.
+     */
+    void cHTTPX_CompressStats(chttpx_compress_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
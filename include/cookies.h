@@ -9,7 +9,7 @@ extern "C"
 #include "request.h"
 #include "response.h"
 
-    /* Parse cookie in request */
+    /* Parse cookie in request: one copy of the Cookie header, split in place */
     void _parse_req_cookies(chttpx_request_t* req);
 
     /* Free cookies before response */
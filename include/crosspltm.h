@@ -14,6 +14,10 @@ extern "C"
 #define CHTTPX_PLATFORM_POSIX
 #endif
 
+#if defined(__linux__)
+#define CHTTPX_PLATFORM_LINUX
+#endif
+
 #ifdef CHTTPX_PLATFORM_WINDOWS
 #define strdup _strdup
 #else
@@ -35,8 +39,10 @@ extern "C"
 
 #ifdef _WIN32
     typedef SOCKET chttpx_socket_t;
+#define CHTTPX_INVALID_SOCKET INVALID_SOCKET
 #else
 typedef int chttpx_socket_t;
+#define CHTTPX_INVALID_SOCKET (-1)
 #endif
 
 #ifdef CHTTPX_PLATFORM_WINDOWS
@@ -66,6 +72,17 @@ typedef int chttpx_socket_t;
 #define strcasecmp _stricmp
 #endif
 
+/* Atomic size_t counters shared between connection threads */
+#if defined(_MSC_VER)
+#define chttpx_atomic_add(p, v) ((size_t)InterlockedExchangeAdd64((volatile LONG64*)(p), (LONG64)(v)) + (v))
+#define chttpx_atomic_sub(p, v) ((size_t)InterlockedExchangeAdd64((volatile LONG64*)(p), -(LONG64)(v)) - (v))
+#define chttpx_atomic_load(p) ((size_t)InterlockedOr64((volatile LONG64*)(p), 0))
+#else
+#define chttpx_atomic_add(p, v) __atomic_add_fetch((p), (v), __ATOMIC_SEQ_CST)
+#define chttpx_atomic_sub(p, v) __atomic_sub_fetch((p), (v), __ATOMIC_SEQ_CST)
+#define chttpx_atomic_load(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#endif
+
 #ifdef CHTTPX_PLATFORM_WINDOWS
     static void* memmem_win(const void* haystack, size_t haystacklen, const void* needle, size_t needlelen)
     {
@@ -0,0 +1,45 @@
+/**
+ * Copyright (c) 2026 netcorelink
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `libchttpx.c` for details.
+ */
+
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "crosspltm.h"
+
+/* Max events returned by one epoll_wait call */
+#define EVLOOP_MAX_EVENTS 256
+/* Timer resolution for connection timeouts */
+#define EVLOOP_TICK_MS 1000
+
+    /**
+     * Run the epoll reactor on the server listening socket (CHTTPX_MODE_EPOLL).
+     *
+     * Starts serv->loop_threads event loops (one per CPU by default), each with
+     * its own epoll instance sharing the listening socket (or with its own
+     * SO_REUSEPORT listener when serv->reuseport is set). Connections are read,
+     * parsed and answered as non-blocking state machines; requests whose body
+     * does not fit in memory are handed off to a blocking thread.
+     * This function blocks indefinitely.
+     */
+    void _eventloop_run(void);
+
+    /**
+     * Wake event loops that stopped accepting because max_clients were open,
+     * called whenever a connection slot is released.
+     */
+    void _eventloop_wake_paused(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) 2026 netcorelink
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `libchttpx.c` for details.
+ */
+
+#ifndef HASH_H
+#define HASH_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+    /* 64-bit hash of a buffer, see cHTTPX_ETagHash */
+    typedef uint64_t (*chttpx_hash_fn_t)(const void* data, size_t len);
+
+    /**
+     * Hash a buffer with the library's 64-bit hash (used for ETags).
+     * Inputs over 128 bytes are hashed 64 bytes at a time in eight independent
+     * lanes, using SSE2 or AVX2 when the CPU has them (selected at run time);
+     * every path returns the same value on every platform.
+     * @param data Buffer to hash.
+     * @param len Number of bytes.
+     * @return Hash value.
+     */
+    uint64_t cHTTPX_Hash64(const void* data, size_t len);
+
+    /**
+     * Select the implementation of cHTTPX_Hash64 ("scalar", "sse2" or "avx2"),
+     * NULL for the best one the CPU supports. For tests and benchmarks.
+     * @return 0 on success, -1 if the implementation is not available.
+     */
+    int _hash64_select(const char* impl);
+
+    /* Name of the implementation in use */
+    const char* _hash64_impl(void);
+
+    /**
+     * Set the hash behind generated ETags (cHTTPX_Hash64 by default).
+     * Call before cHTTPX_Listen; ETags change with the hash.
+     * @param fn Hash function, NULL to restore the default.
+     */
+    void cHTTPX_ETagHash(chttpx_hash_fn_t fn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -34,9 +34,37 @@ extern "C"
      * @param res   Pointer to HTTP request/response structure.
      * @param name  Header name.
      * @param value Header value.
+     * @return 0 on success, -1 past MAX_HEADERS headers, or past MAX_RES_HEADERS /
+     *         RES_HEADERS_POOL bytes outside a handler (no REQuest arena to spill into).
      */
     int cHTTPX_HeaderAdd(chttpx_response_t* res, const char* name, const char* value);
 
+    /* Undo the last cHTTPX_HeaderAdd on a response */
+    void _res_header_pop(chttpx_response_t* res);
+
+    /* Name and value of the i-th response header, NUL-terminated */
+    void _res_header_at(const chttpx_response_t* res, size_t i, const char** name, const char** value);
+
+    /**
+     * Get a response header by name.
+     * @param res Pointer to the HTTP response.
+     * @param name Header name (case-insensitive).
+     * @return Pointer to the first header value if found, otherwise NULL.
+     */
+    const char* cHTTPX_ResHeaderGet(const chttpx_response_t* res, const char* name);
+
+    /**
+     * Set or add a response header.
+     * The first header with this name (case-insensitive) gets the new value,
+     * otherwise the header is added.
+     *
+     * @param res Pointer to the HTTP response.
+     * @param name Header name.
+     * @param value Header value.
+     * @return 0 on success, -1 when the header cannot be stored (see cHTTPX_HeaderAdd).
+     */
+    int cHTTPX_ResHeaderSet(chttpx_response_t* res, const char* name, const char* value);
+
     /**
      * Set or add a request header.
      * If header exists (case-insensitive), its value will be replaced.
@@ -57,7 +85,17 @@ extern "C"
      */
     const char* cHTTPX_ClientIP(chttpx_request_t* req);
 
-    /* Parse headers in request */
+    /**
+     * Next header field of a REQuest head, without writing to it.
+     * @param cursor Start of a header line, moved past it.
+     * @param end End of the head.
+     * @param field Name (up to the colon) and value (blanks trimmed), not NUL-terminated.
+     * @return 1 for a field, 0 at the end of the head, -1 for a line that is not
+     *         a field (no colon, no name, or whitespace before the colon).
+     */
+    int _req_head_field(const char** cursor, const char* end, chttpx_header_view_t* field);
+
+    /* Parse headers in request: views into the buffer, NUL-terminated in place */
     void _parse_req_headers(chttpx_request_t* req, char* buffer, size_t buffer_len);
 
 #ifdef __cplusplus
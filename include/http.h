@@ -32,6 +32,8 @@ extern "C"
 #define cHTTPX_CTYPE_MULTI "multipart/form-data"
 /* Raw binary stream. Use when content type is unknown. */
 #define cHTTPX_CTYPE_OCTET "application/octet-stream"
+/* Server-Sent Events stream. Use with cHTTPX_ResSSE. */
+#define cHTTPX_CTYPE_EVENTS "text/event-stream"
 /* JavaScript script file. Used for web applications. */
 #define cHTTPX_CTYPE_JS "application/javascript"
 /* PNG image format. Lossless compressed image. */
@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2026 netcorelink
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `libchttpx.c` for details.
+ */
+
+#ifndef JSON_H
+#define JSON_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "request.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Nesting of arrays and objects a decoded body may have */
+#define CHTTPX_JSON_DEPTH_MAX 256
+/* Fields of one schema (cHTTPX_Parse, cHTTPX_ParseValidate) */
+#define CHTTPX_JSON_FIELDS_MAX 128
+/* Slots of the schema's perfect hash table: up to 4 per field */
+#define JSON_SCHEMA_SLOTS (4 * CHTTPX_JSON_FIELDS_MAX)
+/* Schemas whose hash seed is remembered per thread */
+#define JSON_SCHEMA_MEMO 16
+/* Bodies of at least this size get a structural index (_json_index) before they are decoded */
+#define CHTTPX_JSON_INDEX_MIN 16384
+
+/* _json_decode flags */
+/* Strings and arrays come from the REQuest arena instead of malloc */
+#define JSON_DECODE_ARENA 0x1
+/* Check every field as it is decoded, then the required ones (see cHTTPX_Validate) */
+#define JSON_DECODE_VALIDATE 0x2
+
+    /**
+     * Decode the JSON body of a REQuest into the targets of a schema in one pass.
+     *
+     * Object keys of the top level are looked up in a perfect hash of the field
+     * names (ASCII case-insensitive, the first of duplicate keys wins); values of
+     * other keys are checked and skipped without being stored. Strings are copied
+     * once, unescaped on the way, numbers and booleans are written as they are read.
+     * Without JSON_DECODE_ARENA a body that turns out to be invalid leaves no
+     * allocation behind: the strings and arrays already stored are freed.
+     *
+     * @param flags JSON_DECODE_* bits.
+     * @param lang Language of the validation messages, NULL for English.
+     * @return 1 on success, 0 with req->error_msg set otherwise.
+     */
+    int _json_decode(chttpx_request_t* req, chttpx_validation_t* fields, size_t field_count, unsigned flags, const char* lang);
+
+    /**
+     * Let JSON bodies up to max_size bytes be read into memory for cHTTPX_Parse
+     * (bulk endpoints); larger ones, like other bodies over MAX_BODY_IN_MEMORY,
+     * never reach req->body.
+     * @param max_size Bytes, 0 for MAX_BODY_IN_MEMORY.
+     */
+    void cHTTPX_JsonLimit(size_t max_size);
+
+    /**
+     * Index the structure of a JSON document: the positions of every quote that
+     * opens or closes a string and of every {, }, [, ], : and , outside strings,
+     * in order. Escapes are resolved, so the mark after an opening quote is its
+     * closing one. The input is classified 64 bytes at a time with SSE2 or AVX2
+     * when the CPU has them (selected at run time), every path gives the same marks.
+     * @param buf Document.
+     * @param len Bytes in buf, less than 4 GB.
+     * @param out Room for len marks.
+     * Every escape is checked on the way (stage 1), so the decoder need not.
+     * @return Number of marks, (size_t)-1 if the document ends inside a string
+     *         or has an invalid escape.
+     */
+    size_t _json_index(const unsigned char* buf, size_t len, uint32_t* out);
+
+    /**
+     * Select the implementation of _json_index ("scalar", "sse2" or "avx2"),
+     * NULL for the best one the CPU supports ("none" without SIMD, the scalar
+     * index does not pay for itself), "none" to decode every body byte by byte
+     * without an index. For tests and benchmarks.
+     * @return 0 on success, -1 if the implementation is not available.
+     */
+    int _json_index_select(const char* impl);
+
+    /* Name of the implementation in use */
+    const char* _json_index_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
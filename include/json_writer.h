@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2026 netcorelink
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `libchttpx.c` for details.
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "json.h"
+#include "request.h"
+#include "response.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* First buffer of a writer, it doubles as the document grows */
+#define CHTTPX_JSON_WRITER_SIZE 1024
+
+    /**
+     * JSON document built by calls (cHTTPX_JsonObject, cHTTPX_JsonKey,
+     * cHTTPX_JsonString, ...), see cHTTPX_JsonInit. Nothing is formatted from
+     * a pattern: strings are escaped and copied once, numbers converted in place.
+     */
+    typedef struct
+    {
+        /* Document so far */
+        char* buf;
+        size_t len;
+        size_t cap;
+        /* Storage of buf: the REQuest arena, the heap when NULL */
+        chttpx_arena_t* arena;
+
+        /* Open containers, bit set for an object */
+        uint8_t object[CHTTPX_JSON_DEPTH_MAX / 8];
+        uint32_t depth;
+        /* The next value needs a comma before it */
+        bool comma;
+        /* A key was written, its value comes next */
+        bool after_key;
+        /* Out of memory or a call out of order: the document is dropped */
+        bool failed;
+
+        /* Streamed (cHTTPX_ResJsonStream): buf is the frame being filled, what does
+         * not fit goes to spill and leads the next frame
+         */
+        bool frame;
+        char* spill;
+        size_t spill_len;
+        size_t spill_cap;
+        size_t spill_sent;
+    } chttpx_json_t;
+
+    /**
+     * Producer of a streamed JSON body, see cHTTPX_ResJsonStream.
+     * Writes the next few values (e.g. one row) with the cHTTPX_Json* calls.
+     * @param ctx Context given to cHTTPX_ResJsonStream.
+     * @return 1 if there is more to write, 0 once the document is complete,
+     *         -1 to abort (the connection is closed).
+     */
+    typedef int (*chttpx_json_stream_fn_t)(void* ctx, chttpx_json_t* json);
+
+    /**
+     * Start a JSON document.
+     * @param req REQuest whose arena holds the document (freed with it), NULL for
+     *            the heap (release with cHTTPX_JsonFree unless handed to a response).
+     */
+    void cHTTPX_JsonInit(chttpx_json_t* json, chttpx_request_t* req);
+
+    /* Release a heap document that was not handed to cHTTPX_ResJsonWriter */
+    void cHTTPX_JsonFree(chttpx_json_t* json);
+
+    /* Open / close an object */
+    void cHTTPX_JsonObject(chttpx_json_t* json);
+    void cHTTPX_JsonObjectEnd(chttpx_json_t* json);
+
+    /* Open / close an array */
+    void cHTTPX_JsonArray(chttpx_json_t* json);
+    void cHTTPX_JsonArrayEnd(chttpx_json_t* json);
+
+    /* Key of the next member of the open object, escaped like a string */
+    void cHTTPX_JsonKey(chttpx_json_t* json, const char* key);
+
+    /* String value, escaped; NULL writes null */
+    void cHTTPX_JsonString(chttpx_json_t* json, const char* s);
+
+    /* String value of len bytes, may hold NUL bytes (written as \u0000) */
+    void cHTTPX_JsonStringLen(chttpx_json_t* json, const char* s, size_t len);
+
+    void cHTTPX_JsonInt(chttpx_json_t* json, long long value);
+
+    /* Number value, shortest form that reads back the same; NaN and infinities write null */
+    void cHTTPX_JsonDouble(chttpx_json_t* json, double value);
+
+    void cHTTPX_JsonBool(chttpx_json_t* json, bool value);
+
+    void cHTTPX_JsonNull(chttpx_json_t* json);
+
+    /* Value that is already JSON (e.g. a cached fragment), copied as it is */
+    void cHTTPX_JsonRaw(chttpx_json_t* json, const char* text, size_t len);
+
+    /**
+     * Answer with the document of a writer, without copying it.
+     * An unfinished document (open containers) or one that failed gives 500.
+     * @param status HTTP status code (e.g. 200).
+     */
+    chttpx_response_t cHTTPX_ResJsonWriter(uint16_t status, chttpx_json_t* json);
+
+    /**
+     * Answer with a JSON document produced while it is sent (cHTTPX_ResStream).
+     * fn writes straight into the chunk that goes out next, so a large array
+     * costs one chunk of memory; a value that does not fit is carried over to
+     * the next chunk. In epoll mode fn runs on the event loop and must not block.
+     * @param status HTTP status code (e.g. 200).
+     * @param fn Producer of the document.
+     * @param ctx Passed to fn and free_ctx.
+     * @param free_ctx Called with ctx once the response is sent or dropped, may be NULL.
+     */
+    chttpx_response_t cHTTPX_ResJsonStream(uint16_t status, chttpx_json_stream_fn_t fn, void* ctx, void (*free_ctx)(void* ctx));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
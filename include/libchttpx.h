@@ -16,16 +16,25 @@ extern "C"
 #include "http.h"
 
 #include "request.h"
+#include "json.h"
 
 #include "inet.h"
 
 #include "response.h"
+#include "json_writer.h"
 
 #include "cors.h"
+#include "compress.h"
 
 #include "middlewares.h"
 
+#include "router.h"
 #include "serv.h"
+#include "workers.h"
+#include "admission.h"
+#include "static.h"
+#include "hash.h"
+#include "sse.h"
 
 #include "params.h"
 
@@ -35,6 +44,8 @@ extern "C"
 
 #include "cookies.h"
 
+#include "multipart.h"
+
 #include "i18n.h"
 
 #include "websocket.h"
@@ -15,8 +15,15 @@ extern "C"
 
 #include "http.h"
 #include "request.h"
+#include "crosspltm.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 #define FILE_BUFFER 65536
+/* Directory of upload temp files */
+#define MEDIA_TMP_DIR "/tmp"
 
     typedef struct
     {
@@ -24,8 +31,44 @@ extern "C"
         const char* ext;
     } content_type_map_t;
 
-    /* Parse media in request */
-    void _parse_media(chttpx_request_t* req, char* buffer, size_t buffer_len);
+    /* Save a body that is not JSON to a temp file (req->filename), split multipart/form-data into parts */
+    void _parse_media(chttpx_request_t* req);
+
+    /* Upload being written to a temp file, see _spool_open */
+    typedef struct
+    {
+#ifdef CHTTPX_PLATFORM_LINUX
+        int fd;
+        /* O_TMPFILE: the file gets its name on _spool_commit */
+        bool anonymous;
+        const char* ext;
+#else
+        FILE* file;
+#endif
+        char path[256];
+    } media_spool_t;
+
+    /**
+     * Create the temp file of an upload. On Linux it is an O_TMPFILE without a
+     * name, so a failed upload is reclaimed by the kernel however it ends.
+     * @param content_type Content-Type of the upload, picks the file extension.
+     * @param size Expected size to preallocate, 0 if unknown.
+     * @return 0 on success, -1 on error.
+     */
+    int _spool_open(media_spool_t* s, const char* content_type, uint64_t size);
+
+    /* Append to the upload, -1 on error */
+    int _spool_write(media_spool_t* s, const void* data, size_t len);
+
+    /**
+     * Give a complete upload its name ("/tmp/upload_<random><ext>") and close it.
+     * @param path Output, the file's path.
+     * @return 0 on success, -1 on error (nothing is left behind).
+     */
+    int _spool_commit(media_spool_t* s, char* path, size_t path_size);
+
+    /* Close a failed upload and drop its file */
+    void _spool_abort(media_spool_t* s);
 
 #ifdef __cplusplus
 }
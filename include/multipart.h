@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2026 netcorelink
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `libchttpx.c` for details.
+ */
+
+#ifndef MULTIPART_H
+#define MULTIPART_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "request.h"
+
+#include <stddef.h>
+
+/* Longest boundary RFC 2046 allows */
+#define MULTIPART_BOUNDARY_MAX 70
+/* Header section of a single part */
+#define MULTIPART_HEADERS_MAX 8192
+/* Parts of a body read before the handler, more is a broken body */
+#define MULTIPART_MAX_PARTS 128
+/* Fields larger than this are saved to a temp file like file parts */
+#define MULTIPART_FIELD_MAX 65536
+
+    /**
+     * Receives the parts of a multipart/form-data body as they arrive, see cHTTPX_Multipart.
+     * @param part Part the bytes belong to: name, filename, content_type, and size
+     *             (bytes of the part before data). Valid until the response is sent.
+     * @param data Next bytes of the part, NULL once the part is complete.
+     * @param len Number of bytes in data, 0 at the end of the part.
+     * @param userdata Pointer passed to cHTTPX_Multipart.
+     * @return 0 to go on, non-zero to stop reading the body.
+     */
+    typedef int (*chttpx_part_fn)(const chttpx_part_t* part, const char* data, size_t len, void* userdata);
+
+    /**
+     * Split the multipart/form-data body of a REQuest into parts in a single pass,
+     * as it is read from the connection. Every part is handed to on_part piece by
+     * piece, so a file can be written to its destination while it is uploaded.
+     * Use it on routes registered with cHTTPX_RouteBodyStream; on other routes the
+     * body is already split into req->parts (see cHTTPX_FormValue).
+     * @param req Pointer to the HTTP request.
+     * @param on_part Callback receiving the parts.
+     * @param userdata Passed to on_part.
+     * @return 0 once the closing boundary is read, -1 on a malformed or truncated
+     *         body, a connection error, or when on_part stops.
+     */
+    int cHTTPX_Multipart(chttpx_request_t* req, chttpx_part_fn on_part, void* userdata);
+
+    /**
+     * Get a field of a multipart/form-data REQuest.
+     * @param req Pointer to the HTTP request.
+     * @param name Field name.
+     * @return Value of the first field with that name, NULL if there is none, or it
+     *         is a file or a field saved to a temp file (see cHTTPX_FormPart).
+     */
+    const char* cHTTPX_FormValue(chttpx_request_t* req, const char* name);
+
+    /**
+     * Get a part of a multipart/form-data REQuest, e.g. an uploaded file.
+     * File parts are saved to temp files of their own (part->path) that the
+     * handler moves or removes.
+     * @param req Pointer to the HTTP request.
+     * @param name Field name.
+     * @return First part with that name, NULL if there is none.
+     */
+    const chttpx_part_t* cHTTPX_FormPart(chttpx_request_t* req, const char* name);
+
+    /**
+     * Split a multipart/form-data body into req->parts before the handler runs:
+     * fields are kept in memory, files go to temp files. A broken body leaves no
+     * parts and no files behind.
+     */
+    void _parse_multipart(chttpx_request_t* req);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
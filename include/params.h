@@ -26,10 +26,20 @@ extern "C"
 
     /**
      * Match a URL path against a route template (supports {param} segments).
+     * Params are views into template and path, delimited by name_len/value_len.
      * @return 1 if matched, 0 otherwise.
      */
     int cHTTPX_MatchPath(const char* template, const char* path, chttpx_param_t* params, int* param_count);
 
+    /**
+     * Store matched params on a REQuest as NUL-terminated copies in its arena.
+     * @param req Parsed request.
+     * @param params Params from cHTTPX_MatchPath or the router.
+     * @param count Number of params.
+     * @return 0 on success, -1 if out of memory.
+     */
+    int _req_set_params(chttpx_request_t* req, const chttpx_param_t* params, size_t count);
+
 #ifdef __cplusplus
     extern
 }
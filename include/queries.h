@@ -27,7 +27,7 @@ extern "C"
      */
     const char* cHTTPX_Query(chttpx_request_t* req, const char* name);
 
-    /* Parse queries in request */
+    /* Parse queries in request: split the query string in place */
     void _parse_req_query(chttpx_request_t* req, char* query);
 
 #ifdef __cplusplus
@@ -14,6 +14,7 @@ extern "C"
 #endif
 
 #include "crosspltm.h"
+#include "arena.h"
 
 #include <stdlib.h>
 #include <stdint.h>
@@ -23,32 +24,50 @@ extern "C"
 #define BUFFER_SIZE 16384
 
 #define MAX_HEADERS 128
-#define MAX_HEADER_NAME 128
-#define MAX_HEADER_VALUE 4096
 
-    /* Header structure */
+/* Entries kept inside chttpx_request_t, more spill into the REQuest arena */
+#define REQ_INLINE_HEADERS 16
+#define REQ_INLINE_QUERIES 8
+#define REQ_INLINE_PARAMS 4
+#define REQ_INLINE_COOKIES 4
+
+#define REQ_ERROR_MSG_SIZE 256
+
+    /* REQuest header, a view into the receive buffer */
     typedef struct
     {
-        char name[MAX_HEADER_NAME];
-        char value[MAX_HEADER_VALUE];
-    } chttpx_header_t;
+        const char* name;
+        size_t name_len;
 
-    /* Query structure */
+        const char* value;
+        size_t value_len;
+    } chttpx_header_view_t;
+
+#define MAX_QUERIES 64
+
+    /* Query structure, a view into the receive buffer */
     typedef struct
     {
-        char* name;
-        char* value;
+        const char* name;
+        size_t name_len;
+
+        const char* value;
+        size_t value_len;
     } chttpx_query_t;
 
 #define MAX_PARAMS 64
-#define MAX_PARAM_NAME 128
-#define MAX_PARAM_VALUE 1024
 
-    /* Param structure */
+    /* Param structure
+     * cHTTPX_MatchPath fills views into the template and the path, use the
+     * lengths; REQuest and WebSocket params are also NUL-terminated.
+     */
     typedef struct
     {
-        char name[MAX_PARAM_NAME];
-        char value[MAX_PARAM_VALUE];
+        const char* name;
+        size_t name_len;
+
+        const char* value;
+        size_t value_len;
     } chttpx_param_t;
 
 #define MAX_COOKIES 64
@@ -56,11 +75,11 @@ extern "C"
     /* Cookie structure */
     typedef struct
     {
-        char* name;
-        char* value;
+        const char* name;
+        const char* value;
 
-        char* path;
-        char* domain;
+        const char* path;
+        const char* domain;
 
         time_t expires;
 
@@ -128,77 +147,164 @@ extern "C"
     /* Function for free REQuest context */
     typedef void (*chttpx_context_free_fn)(void*);
 
-    // REQuest
+    /* Part of a multipart/form-data body, see cHTTPX_FormValue and cHTTPX_Multipart */
     typedef struct
     {
-        char* method;
-        char* path;
+        /* Field name, file name (NULL for a plain field) and Content-Type ("" if absent) */
+        const char* name;
+        const char* filename;
+        const char* content_type;
+
+        /* Value of a field kept in memory, NUL-terminated; NULL for a part saved to path */
+        const char* value;
+        /* Temp file holding a file part, or a field too large to keep in memory, "" if none */
+        const char* path;
+        /* Bytes of the part (so far, while it is streamed) */
+        size_t size;
+    } chttpx_part_t;
+
+    /* Body of a REQuest as it is read from the connection, see cHTTPX_BodyRead */
+    typedef struct
+    {
+        /* Received bytes not consumed yet: the rest of the receive buffer, then refills */
+        const char* data;
+        size_t len;
+        /* Refill buffer (REQuest arena), data points into it once the socket was read;
+         * what is left there after the last chunk is the start of the next REQuest
+         */
+        char* fill;
+        bool filled;
+
+        /* Body bytes left (Content-Length), or left in the current chunk */
+        uint64_t left;
+        /* Transfer-Encoding: chunked */
+        bool chunked;
+        /* Position in the body, see body.c */
+        uint8_t state;
+
+        /* Inflate state of a "Content-Encoding: gzip" or "deflate" body (REQuest arena),
+         * NULL if the body is read as it was sent
+         */
+        void* inflate;
+        /* The decoded body outgrew cHTTPX_DecompressLimit or MAX_BODY_IN_MEMORY (cHTTPX_JsonLimit), answered with 413 */
+        bool too_large;
+    } chttpx_body_reader_t;
+
+    /* REQuest
+     * method, path, protocol, headers and query are views into the
+     * connection's receive buffer, NUL-terminated in place: they are valid
+     * until the handler returns and must be copied to be kept longer.
+     */
+    typedef struct
+    {
+        const char* method;
+        size_t method_len;
+
+        const char* path;
+        size_t path_len;
 
         /* Body */
         unsigned char* body;
         size_t body_size;
 
-        /* Content len. REQuest */
+        /* Content len. REQuest, the decoded size once a chunked or compressed body is read */
         size_t content_length;
 
-        /* Content type REQuest */
-        char content_type[512];
+        /* Content type REQuest, "" if absent */
+        const char* content_type;
 
         /* Client socket */
         chttpx_socket_t client_fd;
 
-        /* User-Agent */
-        char user_agent[512];
+        /* User-Agent, "" if absent */
+        const char* user_agent;
 
         /* HTTP/1.1 HTTP/2 ... */
-        char protocol[16];
+        const char* protocol;
 
         /* Client IP REQuest */
         char client_ip[46];
 
         /* Error REQuest message */
-        char error_msg[BUFFER_SIZE];
+        char error_msg[REQ_ERROR_MSG_SIZE];
 
         /* Headers in REQuest */
-        chttpx_header_t headers[MAX_HEADERS];
+        chttpx_header_view_t* headers;
         size_t headers_count;
+        size_t headers_cap;
 
         /* Query params in URL
          * exmaple: ?name=netcorelink
          */
         chttpx_query_t* query;
         size_t query_count;
+        size_t query_cap;
 
         /* Params in URL
          * exmaple: /{uuid}
          */
-        chttpx_param_t params[MAX_PARAMS];
+        chttpx_param_t* params;
         size_t params_count;
 
         /* Cookies */
-        chttpx_cookie_t cookies[MAX_COOKIES];
+        chttpx_cookie_t* cookies;
         size_t cookies_count;
+        size_t cookies_cap;
 
         /* Media
-         * @filename - File name
+         * @filename - Temp file holding a body that is not JSON, the first file part of a multipart one
          */
         char filename[384];
 
+        /* Parts of a multipart/form-data body, fields and files (REQuest arena) */
+        chttpx_part_t* parts;
+        size_t parts_count;
+        size_t parts_cap;
+
+        /* Part of the body the library has not read */
+        chttpx_body_reader_t body_reader;
+
         /* Context REQuest */
         void* context;
         chttpx_context_free_fn context_free;
+
+        /* Connection arena holding the REQuest itself, its body, copies
+         * (HeaderSet, cookies, params), the arrays above once they outgrow
+         * their inline storage and the response. Reset after every response.
+         */
+        chttpx_arena_t* arena;
+
+        chttpx_header_view_t headers_inline[REQ_INLINE_HEADERS];
+        chttpx_query_t query_inline[REQ_INLINE_QUERIES];
+        chttpx_param_t params_inline[REQ_INLINE_PARAMS];
+        chttpx_cookie_t cookies_inline[REQ_INLINE_COOKIES];
     } chttpx_request_t;
 
     /**
-     * Parse a JSON body and validate fields according to the provided definitions.
+     * Parse a JSON body into the fields (ASCII case-insensitive names).
+     * Strings and arrays are malloc'ed, the caller frees them. A value of
+     * another type marks the field present and leaves its target as it was.
      * @param req Pointer to the HTTP request.
      * @param fields Array of field validation definitions (cHTTPX_FieldValidation).
-     * @param field_count Number of fields in the array.
-     * @return 1 if parsing and validation succeed, 0 if there is an error.
-     * This function automatically checks required fields, string length, boolean types, etc.
+     * @param field_count Number of fields in the array (up to CHTTPX_JSON_FIELDS_MAX).
+     * @return 1 if the body is valid JSON, 0 if there is an error (nothing is left allocated).
+     * Validation is left to cHTTPX_Validate, see cHTTPX_ParseValidate for both in one pass.
      */
     int cHTTPX_Parse(chttpx_request_t* req, chttpx_validation_t* fields, size_t field_count);
 
+    /**
+     * Parse a JSON body into the fields and validate them in the same pass.
+     * Every field is checked as soon as its value is read (type, string length,
+     * validator), the first failure stops parsing; required fields are checked
+     * at the end. Strings and arrays live in the REQuest arena, nothing has to be freed.
+     * @param req Pointer to the HTTP request.
+     * @param fields Array of field validation definitions.
+     * @param field_count Number of fields in the array (up to CHTTPX_JSON_FIELDS_MAX).
+     * @param l Language of the error messages ("en", "ru"), NULL for English.
+     * @return 1 if parsing and validation succeed, 0 with req->error_msg set otherwise.
+     */
+    int cHTTPX_ParseValidate(chttpx_request_t* req, chttpx_validation_t* fields, size_t field_count, const char* l);
+
     /*
      * Validates an array of cHTTPX_FieldValidation structures.
      * This function ensures that required fields are present, string lengths are within limits,
@@ -206,6 +312,45 @@ extern "C"
      */
     int cHTTPX_Validate(chttpx_request_t* req, chttpx_validation_t* fields, size_t field_count, const char* l);
 
+    /* Check one field the way cHTTPX_Validate does (lang is an i18n_language_t), 0 with req->error_msg set if it fails */
+    int _validate_field(chttpx_request_t* req, const chttpx_validation_t* f, int lang);
+
+    /* Report a field whose JSON value has another type */
+    void _validate_type_error(chttpx_request_t* req, const chttpx_validation_t* f, int lang);
+
+    /**
+     * Allocate memory that lives until the response to the REQuest is sent.
+     * Nothing has to be freed: the arena is reset for the next REQuest.
+     * @param req Pointer to the HTTP request.
+     * @param size Number of bytes.
+     * @return Pointer aligned for any type, NULL if out of memory.
+     */
+    void* cHTTPX_Alloc(chttpx_request_t* req, size_t size);
+
+    /**
+     * Copy a string into the REQuest arena, see cHTTPX_Alloc.
+     * @param req Pointer to the HTTP request.
+     * @param s String to copy.
+     * @return Copy of s, NULL if out of memory.
+     */
+    char* cHTTPX_Strdup(chttpx_request_t* req, const char* s);
+
+    /**
+     * Read the next bytes of the REQuest body, de-chunked when it is sent with
+     * "Transfer-Encoding: chunked" and inflated when it is sent with
+     * "Content-Encoding: gzip" or "deflate". Bodies are normally read before the handler
+     * runs (req->body, req->filename); on a route registered with
+     * cHTTPX_RouteBodyStream they are left to the handler, which reads them
+     * piece by piece with this function.
+     * @param req Pointer to the HTTP request.
+     * @param buf Output buffer.
+     * @param n Room in buf.
+     * @return Bytes read, 0 at the end of the body, -1 on error (malformed
+     *         chunk or compressed data, decoded body over its limit, timeout
+     *         or closed connection).
+     */
+    long cHTTPX_BodyRead(chttpx_request_t* req, void* buf, size_t n);
+
 /**
  * Macro to define a string field for JSON request validation.
  *
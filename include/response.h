@@ -17,6 +17,48 @@ extern "C"
 
 #include <time.h>
 
+#define MAX_RES_HEADERS 32
+#define RES_HEADERS_POOL 2048
+
+    /* RESponse header: offsets of NUL-terminated strings in headers_pool.
+     * Offsets, not pointers, so the RESponse can be returned by value.
+     */
+    typedef struct
+    {
+        uint16_t name;
+        uint16_t name_len;
+
+        uint16_t value;
+        uint16_t value_len;
+    } chttpx_res_header_t;
+
+    /* Ranges of one multi-range REQuest, more are answered with the full file */
+#define CHTTPX_MAX_RANGES 16
+
+    /* Part of a multipart/byteranges body: its header, then len bytes of the file from offset */
+    typedef struct
+    {
+        const char* head;
+        size_t head_len;
+        uint64_t offset;
+        size_t len;
+    } chttpx_res_range_t;
+
+    /* Room handed to a stream producer per call, the largest chunk of a streamed body */
+#define CHTTPX_STREAM_CHUNK 16384
+    /* Chunk with its framing: size line before, CRLF after */
+#define CHTTPX_STREAM_FRAME (CHTTPX_STREAM_CHUNK + 16)
+
+    /**
+     * Producer of a streamed body, see cHTTPX_ResStream.
+     * @param ctx Context given to cHTTPX_ResStream.
+     * @param buf Where to write the next piece of the body.
+     * @param size Room in buf.
+     * @return Bytes written (1..size), 0 at the end of the body,
+     *         -1 to abort (the connection is closed).
+     */
+    typedef long (*chttpx_stream_fn_t)(void* ctx, char* buf, size_t size);
+
     // RESponse
     typedef struct
     {
@@ -26,15 +68,54 @@ extern "C"
         /* Response content type */
         const char* content_type;
 
-        /* Headers in REQuest */
-        chttpx_header_t headers[MAX_HEADERS];
+        /* Headers in RESponse, see cHTTPX_ResHeaderGet */
+        chttpx_res_header_t headers[MAX_RES_HEADERS];
         size_t headers_count;
 
+        /* Header names and values */
+        char headers_pool[RES_HEADERS_POOL];
+        size_t headers_pool_used;
+
+        /* Once headers or headers_pool are full, all headers (up to MAX_HEADERS)
+         * with their names and values live in the REQuest arena instead
+         */
+        chttpx_header_view_t* headers_spilled;
+        size_t headers_spilled_cap;
+
         /* Response body */
         const unsigned char* body;
         /* Response body size */
         size_t body_size;
 
+        /* File body (cHTTPX_ResFile): body_size bytes of file_fd from
+         * file_offset, sent with sendfile and closed after the response
+         */
+        bool file;
+        int file_fd;
+        uint64_t file_offset;
+        /* Multipart byteranges of the file (206 to a multi-range REQuest),
+         * the last entry only carries the closing boundary
+         */
+        chttpx_res_range_t* ranges;
+        size_t ranges_count;
+
+        /* Streamed body (cHTTPX_ResStream): pulled from stream while it is sent,
+         * stream_free(stream_ctx) runs once the response is done with
+         */
+        chttpx_stream_fn_t stream;
+        void* stream_ctx;
+        void (*stream_free)(void* ctx);
+        /* Chunked framing (HTTP/1.1), otherwise the body ends with the connection */
+        bool stream_chunked;
+        /* Nothing left to produce (end of body, or a HEAD REQuest) */
+        bool stream_done;
+
+        /* HEAD REQuest: only the head is sent, its Content-Length still tells the body size */
+        bool head_only;
+
+        /* Event stream topic (cHTTPX_ResSSE): the connection is handed to the SSE engine */
+        const char* sse_topic;
+
         /* Times for logging */
         struct timespec start_ts;
         struct timespec end_ts;
@@ -46,17 +127,149 @@ extern "C"
     /**
      * Handle a single client connection.
      * @param arg The file descriptor of the accepted client socket.
-     * This function reads the request, parses it, calls the matching route handler,
-     * and sends the response back to the client.
+     * This function reads requests, parses them, calls the matching route handlers
+     * and sends the responses back, keeping the connection alive between requests.
      */
     void* chttpx_handle(void* arg);
 
+    /**
+     * Handle a single accepted client connection on the calling thread.
+     * @param client_sock The accepted client socket, closed by this function
+     *                    unless it is taken over by WebSocket.
+     */
+    void chttpx_handle_client(chttpx_socket_t client_sock);
+
+    /**
+     * Handle a client connection whose request head has already been read
+     * (e.g. by the event loop) on a blocking socket.
+     * @param client_sock Client socket in blocking mode.
+     * @param buf Bytes received so far, copied by this function.
+     * @param received Number of bytes in buf, less than BUFFER_SIZE.
+     */
+    void chttpx_handle_buffered(chttpx_socket_t client_sock, const char* buf, size_t received);
+
+/* Results of _process_req */
+#define CHTTPX_REQ_RESPOND 0
+#define CHTTPX_REQ_DETACHED 1
+
+    /* Parse a received REQuest into the connection arena, buffer must have room for a NUL at buffer[received] */
+    chttpx_request_t* _parse_req_buffer(chttpx_socket_t client_fd, char* buffer, size_t received, chttpx_arena_t* arena);
+
+    /* Run a parsed REQuest through OPTIONS, WebSocket upgrade, middlewares and handler */
+    int _process_req(chttpx_request_t* req, chttpx_response_t* res);
+
+    /* Whether the connection stays open after answering req with res */
+    int _conn_keep_alive(chttpx_request_t* req, chttpx_response_t* res);
+
+    /* Format the status line and headers, returns the number of bytes written */
+    size_t _build_response_head(chttpx_request_t* req, chttpx_response_t* res, int keep_alive, char* buffer, size_t buffer_size);
+
+    /* Piece of an outgoing response for _send_parts: memory, or a file range when data is NULL */
+    typedef struct
+    {
+        const void* data;
+        size_t len;
+        int fd;
+        uint64_t offset;
+    } chttpx_send_part_t;
+
+    /* Memory pieces gathered into one sendmsg call */
+#define CHTTPX_SEND_PARTS 16
+
+    /**
+     * Write response pieces, handling short writes. Consecutive memory pieces go out
+     * with one vectored call (sendmsg), file ranges with sendfile (read/send where
+     * sendfile is unavailable).
+     * @param fd Client socket, blocking or non-blocking.
+     * @param parts Pieces in order, e.g. head then body.
+     * @param count Number of pieces.
+     * @param offset In/out, bytes of the pieces already sent.
+     * @return 1 when everything is sent, 0 if the socket would block (or the send timeout
+     *         expired), -1 on error.
+     */
+    int _send_parts(chttpx_socket_t fd, const chttpx_send_part_t* parts, size_t count, size_t* offset);
+
+    /* Pieces of a response: the head, then the body, the file or its ranges */
+#define CHTTPX_RES_PARTS (2 + 2 * CHTTPX_MAX_RANGES)
+
+    /**
+     * List what has to be sent for a response.
+     * @param head Serialized head from _build_response_head.
+     * @param parts Output, room for CHTTPX_RES_PARTS pieces.
+     * @return Number of pieces.
+     */
+    size_t _res_parts(const chttpx_response_t* res, const char* head, size_t head_len, chttpx_send_part_t* parts);
+
+    /**
+     * Answer the Range (and If-Range) header of a REQuest on a 200 file response:
+     * one range becomes a 206 over that part of the file, several a 206
+     * multipart/byteranges body, unsatisfiable ranges a 416.
+     * Part headers are allocated from the REQuest's arena.
+     */
+    void _res_apply_range(chttpx_request_t* req, chttpx_response_t* res);
+
+    /**
+     * Produce the next piece of a streamed body, framed as a chunk when stream_chunked.
+     * @param frame Buffer of CHTTPX_STREAM_FRAME bytes.
+     * @param data Output, start of the bytes to send (inside frame).
+     * @return Number of bytes to send, 0 once the body (and its last chunk) is out,
+     *         -1 if the producer failed.
+     */
+    long _res_stream_next(chttpx_response_t* res, char* frame, const char** data);
+
+    /* Release what a response holds besides memory (the file of cHTTPX_ResFile, a stream producer) */
+    void _res_release(chttpx_response_t* res);
+
+    /* Arena of the REQuest whose handler runs on this thread, NULL outside a handler */
+    chttpx_arena_t* _res_arena(void);
+
+    /* Room for a file ETag built by _file_etag */
+#define CHTTPX_FILE_ETAG_SIZE 48
+
+    /* ETag of a file from its metadata: "<mtime hex>-<size hex>" */
+    void _file_etag(uint64_t mtime, uint64_t size, char* etag, size_t etag_size);
+
+    /**
+     * Build a file-backed response over an open file.
+     * @param fd Open regular file, owned (and closed) by the response.
+     * @param size Number of bytes to send from offset 0.
+     * @param etag ETag header value, may be NULL.
+     * @param last_modified Last-Modified header value, may be NULL.
+     */
+    chttpx_response_t _res_file_fd(uint16_t status, const char* content_type, int fd, size_t size, const char* etag,
+                                   const char* last_modified);
+
+    /* Room for an HTTP date built by _http_date */
+#define CHTTPX_HTTP_DATE_SIZE 32
+
+    /* HTTP date (IMF-fixdate), e.g. "Sun, 06 Nov 1994 08:49:37 GMT" */
+    void _http_date(time_t t, char* buf, size_t size);
+
+    /* Parse an IMF-fixdate, 0 on success, -1 if s is NULL or not such a date */
+    int _http_date_parse(const char* s, time_t* t);
+
+    /**
+     * Add the ETag of a 200 memory body (unless etag is 0 or the handler set one) and
+     * answer a GET whose If-None-Match / If-Modified-Since still matches with
+     * 304 Not Modified and no body.
+     * @param etag 0 when ETag generation is disabled for the route.
+     */
+    void _res_apply_conditional(chttpx_request_t* req, chttpx_response_t* res, int etag);
+
+    /* Print the access log line to stdout */
+    void _log_response(chttpx_request_t* req, chttpx_response_t* res);
+
+    /* Release a REQuest created by _parse_req_buffer (context), the arena keeps its memory */
+    void _free_req(chttpx_request_t* req);
+
     /**
      * Create a JSON HTTP response with formatted content.
      *
      * Formats a JSON response body using printf-style arguments,
-     * allocates memory for the response body, and returns a
-     * fully initialized chttpx_response_t structure.
+     * allocates the response body (REQuest arena inside a handler,
+     * malloc outside one), and returns a fully initialized
+     * chttpx_response_t structure. Values are not escaped; documents
+     * built from data are better written with cHTTPX_JsonInit.
      *
      * @param status HTTP status code (e.g. 200, 400, 404).
      * @param fmt    printf-style format string for the JSON body.
@@ -69,8 +282,9 @@ extern "C"
      *
      * This function generates a chttpx_response_t structure with the specified
      * HTTP status code and HTML body. The body is created using a printf-style
-     * format string (fmt) and additional arguments. Memory for the body is
-     * dynamically allocated and must be freed after sending the response.
+     * format string (fmt) and additional arguments. Inside a handler the body
+     * lives in the REQuest arena (see cHTTPX_Alloc), outside one it is malloc'd
+     * and must be freed by the caller.
      *
      * @param status HTTP status code (e.g., 200, 404, 500).
      * @param fmt Format string containing the HTML content (like printf).
@@ -81,8 +295,8 @@ extern "C"
     /**
      * Create a binary HTTP response (file, media, etc.).
      *
-     * Allocates memory for the response body and returns a fully initialized
-     * chttpx_response_t structure.
+     * Copies the body (REQuest arena inside a handler, malloc outside one)
+     * and returns a fully initialized chttpx_response_t structure.
      *
      * @param status HTTP status code (e.g. 200, 400, 404)
      * @param content_type MIME type of the response (e.g. "image/png")
@@ -102,6 +316,25 @@ extern "C"
      */
     chttpx_response_t cHTTPX_ResFile(uint16_t status, const char* content_type, const char* path);
 
+    /**
+     * Create a response whose body is produced while it is sent.
+     *
+     * The head goes out with "Transfer-Encoding: chunked" (HTTP/1.0 clients get
+     * the raw body and the connection is closed), then fn is called for the
+     * next piece each time the socket has room for it, so memory stays at one
+     * chunk whatever the size of the body. In epoll mode fn runs on the event
+     * loop and must not block.
+     *
+     * @param status HTTP status code (e.g. 200)
+     * @param content_type MIME type of the body
+     * @param fn Producer of the body
+     * @param ctx Passed to fn and free_ctx
+     * @param free_ctx Called with ctx once the response is sent or dropped, may be NULL
+     * @return Initialized chttpx_response_t
+     */
+    chttpx_response_t cHTTPX_ResStream(uint16_t status, const char* content_type, chttpx_stream_fn_t fn, void* ctx,
+                                       void (*free_ctx)(void* ctx));
+
 #ifdef __cplusplus
     extern
 }
@@ -0,0 +1,56 @@
+/**
+ * Copyright (c) 2026 netcorelink
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `libchttpx.c` for details.
+ */
+
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "request.h"
+
+#include <stddef.h>
+
+    /* Compiled route tree (radix tree over path templates) */
+    typedef struct chttpx_route_node chttpx_route_node_t;
+
+    /**
+     * Add a route template to the tree.
+     * Static runs are stored with shared prefixes, "{name}" matches one
+     * non-empty path segment; every node keeps a per-method leaf table.
+     * @param root Tree root, created on first insert.
+     * @param method HTTP method of the route.
+     * @param path Route template, e.g. "/users/{id}".
+     * @param route Index of the route in serv->routes.
+     * @return 0 on success, 1 if the route is skipped (already registered or
+     *         invalid template), -1 if out of memory.
+     */
+    int _router_insert(chttpx_route_node_t** root, const char* method, const char* path, size_t route);
+
+    /**
+     * Find the route for a REQuest path in O(path length).
+     * Static segments take priority over {param} segments, with backtracking.
+     * @param root Tree root, may be NULL.
+     * @param method HTTP method of the request.
+     * @param path Request path without the query string.
+     * @param params Output, captured parameters (MAX_PARAMS entries): names are
+     *               owned by the tree, values are views into path.
+     * @param param_count Output, number of captured parameters.
+     * @return Index of the route in serv->routes, -1 if nothing matches.
+     */
+    long _router_find(const chttpx_route_node_t* root, const char* method, const char* path, chttpx_param_t* params, int* param_count);
+
+    /* Release the tree */
+    void _router_free(chttpx_route_node_t* root);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -14,9 +14,14 @@ extern "C"
 #endif
 
 #include "cors.h"
+#include "compress.h"
+#include "router.h"
 #include "response.h"
+#include "workers.h"
+#include "admission.h"
 #include "middlewares.h"
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stddef.h>
@@ -36,6 +41,10 @@ extern "C"
         const char* method;
         const char* path;
         chttpx_handler_t handler;
+        /* Skip hashing the body for an ETag, see cHTTPX_RouteETag */
+        bool etag_disabled;
+        /* The handler reads the body itself, see cHTTPX_RouteBodyStream */
+        bool body_stream;
     } chttpx_route_t;
 
     typedef struct
@@ -47,14 +56,43 @@ extern "C"
         void* userdata;
     } chttpx_wsocket_route_entry_t;
 
+    /* Connection handling model, selected before cHTTPX_Init */
+    typedef enum
+    {
+        /* One detached thread per accepted connection */
+        CHTTPX_MODE_THREADS = 0,
+        /* Edge-triggered epoll reactor with a fixed set of loop threads (Linux) */
+        CHTTPX_MODE_EPOLL = 1,
+    } chttpx_serv_mode_t;
+
     typedef struct
     {
         uint16_t port;
 
         size_t server_fd;
 
+        /* Connection handling model */
+        chttpx_serv_mode_t mode;
+        /* Event loop threads for CHTTPX_MODE_EPOLL, accept threads with reuseport, 0 - one per CPU */
+        size_t loop_threads;
+
+        /* Listen backlog, 0 - SOMAXCONN */
+        int backlog;
+        /* One SO_REUSEPORT listener per loop/accept thread instead of a shared socket */
+        uint8_t reuseport;
+        /* Pin loop/accept threads to CPUs (Linux) */
+        uint8_t pin_cpus;
+
+        /* Worker pool threads serving connections, 0 - one thread per connection */
+        size_t workers;
+        /* Max connections waiting for a worker, 0 - workers * WORKERS_QUEUE_PER_THREAD */
+        size_t workers_queue;
+
         size_t max_clients;
+        /* Open connections, updated atomically */
         size_t current_clients;
+        /* What to do with new connections while max_clients are open */
+        chttpx_overload_t overload;
 
         /* Server timeout params */
         uint16_t read_timeout_sec;  // 2b
@@ -65,6 +103,8 @@ extern "C"
         chttpx_route_t* routes;
         size_t routes_count;
         size_t routes_capacity;
+        /* Radix tree over routes, used for dispatch */
+        chttpx_route_node_t* route_tree;
 
         /* WebSocket routes */
         chttpx_wsocket_route_entry_t* ws_routes;
@@ -76,6 +116,13 @@ extern "C"
 
         /* Cors */
         chttpx_cors_t cors;
+
+        /* Response compression, see cHTTPX_Compress */
+        chttpx_compress_t compress;
+        /* Decoded size cap of compressed REQuest bodies, 0 - CHTTPX_INFLATE_MAX, see cHTTPX_DecompressLimit */
+        size_t inflate_max;
+        /* Largest JSON body read into memory, 0 - MAX_BODY_IN_MEMORY, see cHTTPX_JsonLimit */
+        size_t json_max;
     } chttpx_serv_t;
 
     /* Structure for register routes */
@@ -92,9 +139,22 @@ extern "C"
      * @param serv_p The basic structure for working with a server.
      * @param port The TCP port on which the server will listen (e.g., 80, 8080).
      * This function must be called before registering routes or starting the server.
+     *
+     * Set serv_p->mode (and optionally serv_p->loop_threads) before the call to
+     * select the epoll event loop instead of a thread per connection.
+     * Set serv_p->workers (and optionally serv_p->workers_queue) to serve
+     * connections from a fixed worker pool instead.
+     * Set serv_p->reuseport to give every loop (or accept) thread its own
+     * SO_REUSEPORT listening socket, serv_p->backlog for the listen backlog.
      */
     int cHTTPX_Init(chttpx_serv_t* serv_p, uint16_t port, void* max_clients);
 
+    /* Open a listening socket on the server port, CHTTPX_INVALID_SOCKET on error */
+    chttpx_socket_t _serv_listen_socket(void);
+
+    /* Pin the calling loop/accept thread to a CPU when serv->pin_cpus is set */
+    void _serv_pin_cpu(size_t index);
+
     /**
      * Create a router bound to the server with a fixed path prefix.
      *
@@ -121,6 +181,32 @@ extern "C"
      */
     void cHTTPX_RegisterRoute(chttpx_router_t* r, const char* method, const char* path, chttpx_handler_t handler);
 
+    /**
+     * Enable or disable the ETag computed from the response body of a registered route.
+     * Responses of a disabled route carry only an ETag the handler sets itself,
+     * e.g. for bodies that change on every request or are too large to hash.
+     * @param r router struct the route was registered with.
+     * @param method HTTP method of the route.
+     * @param path Path of the route, as passed to cHTTPX_RegisterRoute.
+     * @param enabled false to skip ETag generation.
+     * @return 0 on success, -1 if no such route is registered.
+     */
+    int cHTTPX_RouteETag(chttpx_router_t* r, const char* method, const char* path, bool enabled);
+
+    /**
+     * Leave the body of a registered route's REQuests to its handler.
+     * The library does not read it into req->body or a temp file; the handler
+     * pulls it with cHTTPX_BodyRead (chunked bodies are decoded), e.g. to
+     * process a large upload as it arrives. A body the handler does not read
+     * to the end closes the connection after the response.
+     * @param r router struct the route was registered with.
+     * @param method HTTP method of the route.
+     * @param path Path of the route, as passed to cHTTPX_RegisterRoute.
+     * @param enabled true to stream the body to the handler.
+     * @return 0 on success, -1 if no such route is registered.
+     */
+    int cHTTPX_RouteBodyStream(chttpx_router_t* r, const char* method, const char* path, bool enabled);
+
     /**
      * Start the server loop to listen for incoming connections.
      * This function blocks indefinitely, accepting new client connections
@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2026 netcorelink
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `libchttpx.c` for details.
+ */
+
+#ifndef SSE_H
+#define SSE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "request.h"
+#include "response.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Events kept per topic for Last-Event-ID replay; subscribers further behind are dropped */
+#define CHTTPX_SSE_REPLAY 256
+/* Topic hash buckets */
+#define CHTTPX_SSE_BUCKETS 256
+/* Default seconds of silence before a subscriber gets a heartbeat comment */
+#define CHTTPX_SSE_HEARTBEAT_SEC 15
+/* Events gathered into one write to a subscriber */
+#define CHTTPX_SSE_BATCH 64
+
+    /* Event stream counters, see cHTTPX_SSEStats */
+    typedef struct
+    {
+        /* Topics with a replay buffer / connections subscribed to one */
+        size_t topics;
+        size_t subscribers;
+
+        /* Events published */
+        uint64_t published;
+        /* Subscribers closed because they fell more than CHTTPX_SSE_REPLAY events behind */
+        uint64_t dropped;
+        /* Heartbeat comments sent */
+        uint64_t heartbeats;
+    } chttpx_sse_stats_t;
+
+    /**
+     * Answer a REQuest with an event stream (text/event-stream) subscribed to a topic.
+     * Once the handler returns, the connection is handed to the event stream engine:
+     * it holds no thread, and every cHTTPX_SSEPublish on the topic is written to it.
+     * A "Last-Event-ID" header replays the newer events still in the topic's buffer.
+     * @param topic Topic name, copied.
+     * @return Initialized chttpx_response_t
+     */
+    chttpx_response_t cHTTPX_ResSSE(const char* topic);
+
+    /**
+     * Publish an event to every subscriber of a topic.
+     * The event is serialized once and shared by all subscribers; writes happen on
+     * the engine thread, so a slow client never blocks the publisher.
+     * @param topic Topic name, created on first use.
+     * @param event Event name ("event:" field), NULL for the default "message".
+     * @param data Event data, split into "data:" lines on '\n'.
+     * @return Id of the event (1, 2, ... per topic), 0 on error.
+     */
+    uint64_t cHTTPX_SSEPublish(const char* topic, const char* event, const char* data);
+
+    /**
+     * Set the heartbeat of idle subscribers: a ":" comment after this many seconds
+     * without a write keeps proxies from timing the stream out.
+     * @param sec Seconds, 0 to disable.
+     */
+    void cHTTPX_SSEHeartbeat(unsigned sec);
+
+    /**
+     * Snapshot the event stream counters.
+     * @param stats Output structure.
+     */
+    void cHTTPX_SSEStats(chttpx_sse_stats_t* stats);
+
+    /**
+     * Hand the connection of a REQuest answered with cHTTPX_ResSSE to the engine.
+     * @return 0 if the socket was taken over, -1 on error (the caller answers).
+     */
+    int _sse_attach(chttpx_request_t* req, chttpx_response_t* res);
+
+    /* Close the subscribers, stop the engine and drop the topics (cHTTPX_Shutdown) */
+    void _sse_shutdown(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
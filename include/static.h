@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) 2026 netcorelink
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `libchttpx.c` for details.
+ */
+
+#ifndef STATIC_H
+#define STATIC_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "request.h"
+#include "response.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Directories served with cHTTPX_Static */
+#define STATIC_MAX_MOUNTS 16
+/* Open files kept by the cache, misses past the limit are served uncached */
+#define STATIC_MAX_ENTRIES 4096
+/* Hash buckets of the cache and the locks striped over them */
+#define STATIC_BUCKETS 4096
+#define STATIC_LOCKS 64
+/* Longest file path (directory + request path) */
+#define STATIC_PATH_MAX 1024
+/* Without inotify, cached entries are checked against the file system this often */
+#define STATIC_REVALIDATE_SEC 1
+
+    /* Static file cache counters, see cHTTPX_StaticStats */
+    typedef struct
+    {
+        /* Open files in the cache */
+        size_t entries;
+
+        /* Requests served from the cache / that had to open the file or found none */
+        uint64_t hits;
+        uint64_t misses;
+        /* Entries dropped because their file changed */
+        uint64_t invalidations;
+    } chttpx_static_stats_t;
+
+    /**
+     * Serve the files of a directory under a URL prefix (GET and HEAD).
+     * "/assets/app.js" with cHTTPX_Static("/assets", "./public") is answered with
+     * "./public/app.js"; a path ending in "/" serves its index.html. Open files,
+     * sizes, mtimes and ETags are cached and dropped when the file changes.
+     * Registered routes take precedence, mounts are tried in registration order.
+     * @param prefix URL prefix, "" or "/" for the whole site.
+     * @param dir Directory to serve.
+     * @return 0 on success, -1 on error.
+     */
+    int cHTTPX_Static(const char* prefix, const char* dir);
+
+    /**
+     * Find the static mount serving a REQuest.
+     * @return Mount index or -1 if no mount matches (or the method is not GET or HEAD).
+     */
+    long _static_find(const chttpx_request_t* req);
+
+    /* Answer a REQuest from the mount found by _static_find */
+    void _static_serve(long mount, chttpx_request_t* req, chttpx_response_t* res);
+
+    /* Close cached files, stop the watcher and forget the mounts (cHTTPX_Shutdown) */
+    void _static_shutdown(void);
+
+    /**
+     * Snapshot the static file cache counters.
+     * @param stats Output structure.
+     */
+    void cHTTPX_StaticStats(chttpx_static_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
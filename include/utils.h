@@ -40,6 +40,144 @@ inline int _thread_join(thread_t thread)
 }
 #endif
 
+/* Online CPUs, at least 1 */
+#if defined(_WIN32) || defined(_WIN64)
+    static inline size_t _cpu_count(void)
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwNumberOfProcessors > 0 ? (size_t)info.dwNumberOfProcessors : 1;
+    }
+#else
+#include <unistd.h>
+
+static inline size_t _cpu_count(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (size_t)cpus : 1;
+}
+#endif
+
+/* Mutex and condition variable */
+#if defined(_WIN32) || defined(_WIN64)
+    typedef CRITICAL_SECTION chttpx_mutex_t;
+    typedef CONDITION_VARIABLE chttpx_cond_t;
+
+    static inline void _mutex_init(chttpx_mutex_t* m)
+    {
+        InitializeCriticalSection(m);
+    }
+
+    static inline void _mutex_destroy(chttpx_mutex_t* m)
+    {
+        DeleteCriticalSection(m);
+    }
+
+    static inline void _mutex_lock(chttpx_mutex_t* m)
+    {
+        EnterCriticalSection(m);
+    }
+
+    static inline void _mutex_unlock(chttpx_mutex_t* m)
+    {
+        LeaveCriticalSection(m);
+    }
+
+    static inline void _cond_init(chttpx_cond_t* c)
+    {
+        InitializeConditionVariable(c);
+    }
+
+    static inline void _cond_destroy(chttpx_cond_t* c)
+    {
+        (void)c;
+    }
+
+    static inline void _cond_wait(chttpx_cond_t* c, chttpx_mutex_t* m)
+    {
+        SleepConditionVariableCS(c, m, INFINITE);
+    }
+
+    static inline void _cond_timedwait(chttpx_cond_t* c, chttpx_mutex_t* m, unsigned timeout_ms)
+    {
+        SleepConditionVariableCS(c, m, timeout_ms);
+    }
+
+    static inline void _cond_signal(chttpx_cond_t* c)
+    {
+        WakeConditionVariable(c);
+    }
+
+    static inline void _cond_broadcast(chttpx_cond_t* c)
+    {
+        WakeAllConditionVariable(c);
+    }
+#else
+typedef pthread_mutex_t chttpx_mutex_t;
+typedef pthread_cond_t chttpx_cond_t;
+
+static inline void _mutex_init(chttpx_mutex_t* m)
+{
+    pthread_mutex_init(m, NULL);
+}
+
+static inline void _mutex_destroy(chttpx_mutex_t* m)
+{
+    pthread_mutex_destroy(m);
+}
+
+static inline void _mutex_lock(chttpx_mutex_t* m)
+{
+    pthread_mutex_lock(m);
+}
+
+static inline void _mutex_unlock(chttpx_mutex_t* m)
+{
+    pthread_mutex_unlock(m);
+}
+
+static inline void _cond_init(chttpx_cond_t* c)
+{
+    pthread_cond_init(c, NULL);
+}
+
+static inline void _cond_destroy(chttpx_cond_t* c)
+{
+    pthread_cond_destroy(c);
+}
+
+static inline void _cond_wait(chttpx_cond_t* c, chttpx_mutex_t* m)
+{
+    pthread_cond_wait(c, m);
+}
+
+static inline void _cond_timedwait(chttpx_cond_t* c, chttpx_mutex_t* m, unsigned timeout_ms)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+
+    pthread_cond_timedwait(c, m, &ts);
+}
+
+static inline void _cond_signal(chttpx_cond_t* c)
+{
+    pthread_cond_signal(c);
+}
+
+static inline void _cond_broadcast(chttpx_cond_t* c)
+{
+    pthread_cond_broadcast(c);
+}
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,7 +33,8 @@ extern "C"
         int connected;
         /** Full request path, e.g. /api/v1/ws/chat/lobby-42 */
         char path[MAX_PATH];
-        chttpx_param_t params[MAX_PARAMS];
+        /** Route params, NUL-terminated copies owned by the connection */
+        chttpx_param_t* params;
         size_t params_count;
         void* userdata;
     };
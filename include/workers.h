@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2026 netcorelink
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `libchttpx.c` for details.
+ */
+
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "crosspltm.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Queued connections per worker when serv->workers_queue is 0 */
+#define WORKERS_QUEUE_PER_THREAD 64
+
+    /* Worker pool counters, see cHTTPX_WorkersStats */
+    typedef struct
+    {
+        /* Worker threads, 0 when the pool is not running */
+        size_t threads;
+        /* Workers currently serving a connection */
+        size_t busy;
+
+        /* Queue capacity and current / highest depth */
+        size_t queue_capacity;
+        size_t queue_depth;
+        size_t queue_peak;
+
+        /* Connections accepted into the queue and fully served */
+        uint64_t submitted;
+        uint64_t completed;
+        /* Submits that had to wait for a free slot (back-pressure) */
+        uint64_t full_waits;
+        /* Submits refused because the queue was full */
+        uint64_t rejected;
+
+        /* Time connections spent in the queue before a worker took them */
+        uint64_t wait_total_us;
+        uint64_t wait_max_us;
+    } chttpx_workers_stats_t;
+
+    /**
+     * Start the worker pool.
+     * @param threads Number of worker threads (> 0).
+     * @param capacity Maximum number of queued connections, 0 - threads * WORKERS_QUEUE_PER_THREAD.
+     * @return 0 on success, -1 on error or if the pool is already running.
+     */
+    int _workers_start(size_t threads, size_t capacity);
+
+    /**
+     * Queue an accepted connection for a worker, waiting while the queue is full.
+     * @param fd Client socket in blocking mode, owned by the pool on success.
+     * @param buf Request bytes already read from fd (malloc'd, freed by the pool)
+     *            or NULL to let the worker read the request itself.
+     * @param len Number of bytes in buf, less than BUFFER_SIZE.
+     * @return 0 on success, -1 if the pool is not running.
+     */
+    int _workers_submit(chttpx_socket_t fd, char* buf, size_t len);
+
+    /**
+     * Same as _workers_submit, but fails instead of waiting for a free slot.
+     * @return 0 on success, -1 if the queue is full or the pool is not running.
+     */
+    int _workers_try_submit(chttpx_socket_t fd, char* buf, size_t len);
+
+    /**
+     * Stop the worker pool: wakes all workers, waits for in-flight connections
+     * to finish and closes connections still waiting in the queue.
+     */
+    void _workers_stop(void);
+
+    /**
+     * Snapshot the worker pool counters.
+     * @param stats Output structure, zeroed when the pool is not running.
+     */
+    void cHTTPX_WorkersStats(chttpx_workers_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,237 @@
+#define _GNU_SOURCE
+
+/*
+ * Copyright (c) 2026 netcorelink
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "admission.h"
+
+#include "serv.h"
+#include "utils.h"
+#include "eventloop.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define ADMISSION_REJECT_BODY "{\"error\": \"server is overloaded\"}"
+
+static const char reject_response[] = "HTTP/1.1 503 Service Unavailable\r\n"
+                                      "Content-Type: application/json\r\n"
+                                      "Content-Length: 33\r\n"
+                                      "Retry-After: 1\r\n"
+                                      "Connection: close\r\n"
+                                      "\r\n" ADMISSION_REJECT_BODY;
+
+typedef struct
+{
+    chttpx_mutex_t lock;
+    /* Signalled when a slot frees while the accept loop waits */
+    chttpx_cond_t freed;
+    size_t waiters;
+    int initialized;
+
+    /* Idle keep-alive connections of blocking threads, oldest first */
+    chttpx_idle_conn_t* idle_head;
+    chttpx_idle_conn_t* idle_tail;
+
+    /* Counters */
+    size_t waits;
+    size_t rejected;
+    size_t shed;
+} admission_t;
+
+static admission_t adm;
+
+void _admission_init(void)
+{
+    if (adm.initialized)
+        return;
+
+    _mutex_init(&adm.lock);
+    _cond_init(&adm.freed);
+    adm.initialized = 1;
+}
+
+int _admission_try_acquire(void)
+{
+    if (chttpx_atomic_add(&serv->current_clients, 1) > serv->max_clients)
+    {
+        chttpx_atomic_sub(&serv->current_clients, 1);
+        return 0;
+    }
+
+    return 1;
+}
+
+void _admission_release(void)
+{
+    if (!serv)
+        return;
+
+    chttpx_atomic_sub(&serv->current_clients, 1);
+
+    /* Pairs with the waiter registering before it re-checks the counter */
+    if (chttpx_atomic_load(&adm.waiters) > 0)
+    {
+        _mutex_lock(&adm.lock);
+        _cond_broadcast(&adm.freed);
+        _mutex_unlock(&adm.lock);
+    }
+
+    _eventloop_wake_paused();
+}
+
+void _admission_wait(unsigned timeout_ms)
+{
+    _mutex_lock(&adm.lock);
+    chttpx_atomic_add(&adm.waiters, 1);
+
+    if (timeout_ms == 0)
+    {
+        while (serv && chttpx_atomic_load(&serv->current_clients) >= serv->max_clients)
+            _cond_wait(&adm.freed, &adm.lock);
+    }
+    else if (serv && chttpx_atomic_load(&serv->current_clients) >= serv->max_clients)
+    {
+        _cond_timedwait(&adm.freed, &adm.lock, timeout_ms);
+    }
+
+    chttpx_atomic_sub(&adm.waiters, 1);
+    _mutex_unlock(&adm.lock);
+}
+
+void _admission_note_wait(void)
+{
+    chttpx_atomic_add(&adm.waits, 1);
+}
+
+void _admission_note_shed(void)
+{
+    chttpx_atomic_add(&adm.shed, 1);
+}
+
+void _admission_reject(chttpx_socket_t fd)
+{
+    chttpx_atomic_add(&adm.rejected, 1);
+
+#ifdef _WIN32
+    send(fd, reject_response, (int)sizeof(reject_response) - 1, 0);
+    shutdown(fd, SD_SEND);
+#else
+    send(fd, reject_response, sizeof(reject_response) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+    shutdown(fd, SHUT_WR);
+
+    /* Closing with an unread REQuest resets the connection and may drop the 503 */
+    char drain[1024];
+    while (recv(fd, drain, sizeof(drain), MSG_DONTWAIT) > 0)
+        ;
+#endif
+
+    chttpx_close(fd);
+}
+
+void _admission_idle_enter(chttpx_idle_conn_t* idle, chttpx_socket_t fd)
+{
+    idle->fd = fd;
+    idle->next = NULL;
+
+    _mutex_lock(&adm.lock);
+
+    idle->prev = adm.idle_tail;
+    if (adm.idle_tail)
+        adm.idle_tail->next = idle;
+    else
+        adm.idle_head = idle;
+    adm.idle_tail = idle;
+
+    _mutex_unlock(&adm.lock);
+}
+
+void _admission_idle_leave(chttpx_idle_conn_t* idle)
+{
+    _mutex_lock(&adm.lock);
+
+    /* Already unlinked when shed */
+    if (idle->prev || adm.idle_head == idle)
+    {
+        if (idle->prev)
+            idle->prev->next = idle->next;
+        else
+            adm.idle_head = idle->next;
+
+        if (idle->next)
+            idle->next->prev = idle->prev;
+        else
+            adm.idle_tail = idle->prev;
+    }
+
+    idle->prev = idle->next = NULL;
+    _mutex_unlock(&adm.lock);
+}
+
+int _admission_shed_idle(void)
+{
+    _mutex_lock(&adm.lock);
+
+    chttpx_idle_conn_t* idle = adm.idle_head;
+    if (idle)
+    {
+        adm.idle_head = idle->next;
+        if (adm.idle_head)
+            adm.idle_head->prev = NULL;
+        else
+            adm.idle_tail = NULL;
+
+        idle->prev = idle->next = NULL;
+
+        /* The owner thread is blocked in poll and closes the socket once woken,
+           the fd stays valid while it is registered */
+#ifdef _WIN32
+        shutdown(idle->fd, SD_BOTH);
+#else
+        shutdown(idle->fd, SHUT_RDWR);
+#endif
+    }
+
+    _mutex_unlock(&adm.lock);
+
+    if (!idle)
+        return 0;
+
+    _admission_note_shed();
+    return 1;
+}
+
+void cHTTPX_AdmissionStats(chttpx_admission_stats_t* stats)
+{
+    if (!stats)
+        return;
+
+    memset(stats, 0, sizeof(*stats));
+    if (!serv)
+        return;
+
+    stats->current = chttpx_atomic_load(&serv->current_clients);
+    stats->max = serv->max_clients;
+    stats->waits = chttpx_atomic_load(&adm.waits);
+    stats->rejected = chttpx_atomic_load(&adm.rejected);
+    stats->shed = chttpx_atomic_load(&adm.shed);
+}
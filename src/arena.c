@@ -0,0 +1,154 @@
+#define _GNU_SOURCE
+
+/*
+ * Copyright (c) 2026 netcorelink
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN (2 * sizeof(void*))
+
+static size_t align_up(size_t n)
+{
+    return (n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+void* _arena_alloc(chttpx_arena_t* arena, size_t size)
+{
+    if (!arena)
+        return NULL;
+
+    size = align_up(size ? size : 1);
+
+    chttpx_arena_block_t* b = arena->head;
+    if (b)
+    {
+        size_t off = align_up((uintptr_t)(b->data + b->used)) - (uintptr_t)b->data;
+        if (off + size <= b->size)
+        {
+            b->used = off + size;
+            return b->data + off;
+        }
+    }
+
+    /* New block; oversized requests get a block of their own */
+    size_t block_size = size + ARENA_ALIGN > ARENA_BLOCK_SIZE ? size + ARENA_ALIGN : ARENA_BLOCK_SIZE;
+
+    b = malloc(sizeof(chttpx_arena_block_t) + block_size);
+    if (!b)
+        return NULL;
+
+    b->size = block_size;
+
+    /* Oversized blocks go behind the current one, which keeps its free space */
+    if (block_size > ARENA_BLOCK_SIZE && arena->head)
+    {
+        b->next = arena->head->next;
+        arena->head->next = b;
+    }
+    else
+    {
+        b->next = arena->head;
+        arena->head = b;
+    }
+
+    size_t off = align_up((uintptr_t)b->data) - (uintptr_t)b->data;
+    b->used = off + size;
+
+    return b->data + off;
+}
+
+char* _arena_strndup(chttpx_arena_t* arena, const char* s, size_t len)
+{
+    char* copy = _arena_alloc(arena, len + 1);
+    if (!copy)
+        return NULL;
+
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+
+    return copy;
+}
+
+void* _arena_grow(chttpx_arena_t* arena, void* items, size_t count, size_t* cap, size_t elem_size)
+{
+    size_t new_cap = *cap ? *cap * 2 : 8;
+
+    void* grown = _arena_alloc(arena, new_cap * elem_size);
+    if (!grown)
+        return NULL;
+
+    if (count > 0)
+        memcpy(grown, items, count * elem_size);
+
+    *cap = new_cap;
+    return grown;
+}
+
+void _arena_reset(chttpx_arena_t* arena)
+{
+    if (!arena)
+        return;
+
+    /* Keep one standard block, oversized ones go back to the heap */
+    chttpx_arena_block_t* keep = NULL;
+    chttpx_arena_block_t* b = arena->head;
+
+    while (b)
+    {
+        chttpx_arena_block_t* next = b->next;
+
+        if (!keep && b->size == ARENA_BLOCK_SIZE)
+            keep = b;
+        else
+            free(b);
+
+        b = next;
+    }
+
+    if (keep)
+    {
+        keep->next = NULL;
+        keep->used = 0;
+    }
+
+    arena->head = keep;
+}
+
+void _arena_free(chttpx_arena_t* arena)
+{
+    if (!arena)
+        return;
+
+    chttpx_arena_block_t* b = arena->head;
+    while (b)
+    {
+        chttpx_arena_block_t* next = b->next;
+        free(b);
+        b = next;
+    }
+
+    arena->head = NULL;
+}
@@ -1,3 +1,5 @@
+#define _GNU_SOURCE
+
 /*
  * Copyright (c) 2026 netcorelink
  *
@@ -22,83 +24,729 @@
 
 #include "body.h"
 
+#include "serv.h"
 #include "utils.h"
 #include "headers.h"
+#include "compress.h"
 #include "crosspltm.h"
 
+#include <errno.h>
 #include <stdio.h>
+#include <limits.h>
+#include <strings.h>
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+#ifdef CHTTPX_PLATFORM_LINUX
+#include <zlib.h>
+#include <fcntl.h>
+#endif
+
+/* Longest chunk size line (with extensions) and trailer section */
+#define BODY_LINE_MAX 4096
+#define BODY_TRAILERS_MAX BUFFER_SIZE
+/* Seconds to wait for the next bytes of a body */
+#define BODY_READ_TIMEOUT_SEC 5
 
-/* Parse body in request */
-void _parse_req_body(chttpx_request_t* req, chttpx_socket_t client_fd, char* buffer, size_t buffer_len)
+/* Body reader states */
+enum
 {
-    req->client_fd = client_fd;
+    /* Content-Length bytes, or the data of a chunk */
+    BODY_DATA = 0,
+    BODY_CHUNK_SIZE,
+    /* CRLF after the data of a chunk */
+    BODY_CHUNK_END,
+    BODY_TRAILERS,
+    BODY_DONE,
+    BODY_ERROR,
+};
 
-    size_t content_length = 0;
-    const char* cl_header = memmem_case(buffer, buffer_len, "Content-Length:", strlen("Content-Length:"));
-    if (cl_header && sscanf(cl_header, "%*[^0-9]%zu", &content_length) == 1)
+#define BODY_BAD_REQUEST_BODY "{\"error\": \"bad request\"}"
+
+static const char bad_request_response[] = "HTTP/1.1 400 Bad Request\r\n"
+                                           "Content-Type: application/json\r\n"
+                                           "Content-Length: 24\r\n"
+                                           "Connection: close\r\n"
+                                           "\r\n" BODY_BAD_REQUEST_BODY;
+
+/* Content-Length of a complete REQuest head, from the fields the parser reads */
+int _req_head_content_length(const char* head, size_t head_len, size_t* content_length)
+{
+    const char* end = head + head_len;
+    const char* cursor = memchr(head, '\n', head_len);
+    chttpx_header_view_t field;
+    int found = 0;
+    int r;
+
+    *content_length = 0;
+    if (!cursor)
+        return 0;
+    cursor++;
+
+    while ((r = _req_head_field(&cursor, end, &field)) != 0)
     {
-        req->content_length = content_length;
+        if (r < 0)
+            return -1;
+
+        if (field.name_len != strlen("Content-Length") || strncasecmp(field.name, "Content-Length", field.name_len) != 0)
+            continue;
+
+        /* A second Content-Length, even an equal one, frames the body twice */
+        if (found || field.value_len == 0)
+            return -1;
+
+        size_t value = 0;
+        for (size_t i = 0; i < field.value_len; i++)
+        {
+            if (field.value[i] < '0' || field.value[i] > '9' || value > (SIZE_MAX - 9) / 10)
+                return -1;
+
+            value = value * 10 + (size_t)(field.value[i] - '0');
+        }
+
+        *content_length = value;
+        found = 1;
     }
-    else
+
+    return 0;
+}
+
+void _req_head_reject(chttpx_socket_t fd)
+{
+#ifdef _WIN32
+    send(fd, bad_request_response, (int)sizeof(bad_request_response) - 1, 0);
+    shutdown(fd, SD_SEND);
+#else
+    send(fd, bad_request_response, sizeof(bad_request_response) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+    shutdown(fd, SHUT_WR);
+
+    /* Closing with unread bytes resets the connection and may drop the 400 */
+    char drain[1024];
+    while (recv(fd, drain, sizeof(drain), MSG_DONTWAIT) > 0)
+        ;
+#endif
+}
+
+int _req_head_chunked(const char* head, size_t head_len)
+{
+    const char* end = head + head_len;
+    const char* cursor = memchr(head, '\n', head_len);
+    chttpx_header_view_t field;
+    int r;
+
+    if (!cursor)
+        return 0;
+    cursor++;
+
+    while ((r = _req_head_field(&cursor, end, &field)) != 0)
     {
-        req->content_length = 0;
+        if (r < 0)
+            return -1;
+
+        /* The body reader decides on the codings, any Transfer-Encoding takes the framing from Content-Length */
+        if (field.name_len == strlen("Transfer-Encoding") && strncasecmp(field.name, "Transfer-Encoding", field.name_len) == 0)
+            return 1;
     }
 
-    int is_json_or_text = req->content_type && (strstr(req->content_type, "application/json") || strstr(req->content_type, "text/"));
+    return 0;
+}
+
+/* Whether the last coding of a Transfer-Encoding value is chunked */
+static int last_coding_chunked(const char* value)
+{
+    const char* last = strrchr(value, ',');
+    last = last ? last + 1 : value;
+
+    while (*last == ' ' || *last == '\t')
+        last++;
+
+    size_t len = strlen(last);
+    while (len > 0 && (last[len - 1] == ' ' || last[len - 1] == '\t'))
+        len--;
+
+    return len == 7 && strncasecmp(last, "chunked", 7) == 0;
+}
+
+#ifdef CHTTPX_PLATFORM_LINUX
+/* Inflate state of a compressed body, allocated from the REQuest arena */
+typedef struct
+{
+    z_stream z;
+    /* Decoded bytes handed out, and the most the body may decode to */
+    uint64_t out;
+    uint64_t max;
+    /* gzip bodies may hold several members, one after the other */
+    bool gzip;
+    /* The current member is complete */
+    bool end;
+    unsigned char in[BUFFER_SIZE];
+} body_inflate_t;
+
+/* zlib allocates from the REQuest arena, its state goes with the arena reset */
+static voidpf body_zalloc(voidpf opaque, uInt items, uInt size)
+{
+    return _arena_alloc(opaque, (size_t)items * size);
+}
+
+static void body_zfree(voidpf opaque, voidpf address)
+{
+    (void)opaque;
+    (void)address;
+}
+
+/* Inflate a "Content-Encoding: gzip" or "deflate" body, other codings are handed over as they are */
+static void body_inflate_init(chttpx_request_t* req)
+{
+    const char* coding = cHTTPX_HeaderGet(req, "Content-Encoding");
+    if (!coding)
+        return;
+
+    bool gzip = strcasecmp(coding, "gzip") == 0 || strcasecmp(coding, "x-gzip") == 0;
+    if (!gzip && strcasecmp(coding, "deflate") != 0)
+        return;
 
-    const char* body_start = memmem(buffer, buffer_len, "\r\n\r\n", 4);
-    if (!body_start || req->content_length == 0)
+    body_inflate_t* s = _arena_alloc(req->arena, sizeof(*s));
+    if (!s)
     {
-        req->body = NULL;
-        req->body_size = 0;
+        req->body_reader.state = BODY_ERROR;
         return;
     }
 
-    body_start += 4;
-    size_t body_in_buffer = buffer_len - (body_start - buffer);
+    memset(&s->z, 0, sizeof(s->z));
+    s->z.zalloc = body_zalloc;
+    s->z.zfree = body_zfree;
+    s->z.opaque = req->arena;
 
-    if (!is_json_or_text || req->content_length > MAX_BODY_IN_MEMORY)
+    /* Detect the zlib or gzip header: "deflate" senders do not agree on the framing */
+    if (inflateInit2(&s->z, 15 + 32) != Z_OK)
     {
-        req->body = NULL;
-        req->body_size = 0;
+        req->body_reader.state = BODY_ERROR;
         return;
     }
 
-    req->body = malloc(req->content_length + 1);
-    if (!req->body)
+    s->out = 0;
+    s->max = serv && serv->inflate_max ? serv->inflate_max : CHTTPX_INFLATE_MAX;
+    s->gzip = gzip;
+    s->end = false;
+
+    req->body_reader.inflate = s;
+}
+#endif
+
+void _body_reader_init(chttpx_request_t* req, const char* body, size_t body_len)
+{
+    chttpx_body_reader_t* r = &req->body_reader;
+    memset(r, 0, sizeof(*r));
+
+    r->data = body;
+    r->len = body_len;
+
+    req->content_length = 0;
+
+    /* Transfer-Encoding overrides Content-Length, anything but chunked cannot be framed */
+    const char* te = cHTTPX_HeaderGet(req, "Transfer-Encoding");
+    if (te)
     {
-        perror("malloc failed");
-        req->body_size = 0;
-        return;
+        r->chunked = true;
+        r->state = last_coding_chunked(te) ? BODY_CHUNK_SIZE : BODY_ERROR;
     }
+    else
+    {
+        size_t content_length = 0;
+        const char* cl_header = cHTTPX_HeaderGet(req, "Content-Length");
+        if (cl_header && sscanf(cl_header, "%zu", &content_length) == 1)
+            req->content_length = content_length;
+
+        /* The receive buffer never holds more than the body, pipelined bytes stay out of it */
+        if (r->len > req->content_length)
+            r->len = req->content_length;
+
+        r->left = req->content_length;
+        r->state = r->left ? BODY_DATA : BODY_DONE;
+    }
+
+#ifdef CHTTPX_PLATFORM_LINUX
+    if (r->state != BODY_DONE && r->state != BODY_ERROR)
+        body_inflate_init(req);
+#endif
+}
 
-    memcpy(req->body, body_start, body_in_buffer);
+bool _body_complete(const chttpx_request_t* req)
+{
+    return req->body_reader.state == BODY_DONE;
+}
 
-    size_t remaining = req->content_length - body_in_buffer;
-    size_t total_read = body_in_buffer;
+/* Receive from the client, waiting up to BODY_READ_TIMEOUT_SEC, -1 on error or timeout */
+static long body_recv(chttpx_socket_t fd, void* buf, size_t n)
+{
+    if (fd == CHTTPX_INVALID_SOCKET)
+        return -1;
 
-    while (remaining > 0)
+    for (;;)
     {
-        fd_set fds;
-        FD_ZERO(&fds);
-        FD_SET(client_fd, &fds);
+        /* poll, not select: connections of the event loop go far past FD_SETSIZE */
+#ifdef _WIN32
+        WSAPOLLFD pfd = {0};
+        pfd.fd = fd;
+        pfd.events = POLLRDNORM;
+
+        int r = WSAPoll(&pfd, 1, BODY_READ_TIMEOUT_SEC * 1000);
+#else
+        struct pollfd pfd = {0};
+        pfd.fd = fd;
+        pfd.events = POLLIN;
 
-        struct timeval tv;
-        tv.tv_sec = 5;
-        tv.tv_usec = 0;
+        int r = poll(&pfd, 1, BODY_READ_TIMEOUT_SEC * 1000);
+        if (r < 0 && errno == EINTR)
+            continue;
+#endif
 
-        int r = select(client_fd + 1, &fds, NULL, NULL, &tv);
         if (r <= 0)
+            return -1;
+
+        ssize_t got = recv(fd, buf, n, 0);
+        if (got < 0 && errno == EINTR)
+            continue;
+
+        return got > 0 ? (long)got : -1;
+    }
+}
+
+/* Next byte of the chunk framing, refilling from the socket, -1 on error */
+static int body_byte(chttpx_request_t* req)
+{
+    chttpx_body_reader_t* r = &req->body_reader;
+
+    if (r->len == 0)
+    {
+        if (!r->fill)
+        {
+            r->fill = _arena_alloc(req->arena, BUFFER_SIZE);
+            if (!r->fill)
+                return -1;
+        }
+
+        /* Bytes past the body are handed back to the connection, keep room for its NUL */
+        long got = body_recv(req->client_fd, r->fill, BUFFER_SIZE - 1);
+        if (got <= 0)
+            return -1;
+
+        r->data = r->fill;
+        r->len = (size_t)got;
+        r->filled = true;
+    }
+
+    r->len--;
+    return (unsigned char)*r->data++;
+}
+
+/* Read a CRLF (or LF) terminated line, dropping the terminator. Returns its length, -1 on error */
+static long body_line(chttpx_request_t* req, char* line, size_t size)
+{
+    size_t len = 0;
+
+    for (;;)
+    {
+        int c = body_byte(req);
+        if (c < 0)
+            return -1;
+
+        if (c == '\n')
             break;
 
-        ssize_t n = recv(client_fd, (char*)req->body + total_read, remaining, 0);
-        if (n <= 0)
+        if (len + 1 >= size)
+            return -1;
+
+        line[len++] = (char)c;
+    }
+
+    if (len > 0 && line[len - 1] == '\r')
+        len--;
+
+    line[len] = '\0';
+    return (long)len;
+}
+
+/* Parse a chunk size line, "1a2b" with optional ";extensions" */
+static int chunk_size(const char* line, uint64_t* size)
+{
+    uint64_t v = 0;
+    size_t digits = 0;
+
+    for (; *line; line++, digits++)
+    {
+        int d;
+        if (*line >= '0' && *line <= '9')
+            d = *line - '0';
+        else if (*line >= 'a' && *line <= 'f')
+            d = *line - 'a' + 10;
+        else if (*line >= 'A' && *line <= 'F')
+            d = *line - 'A' + 10;
+        else
             break;
 
-        total_read += n;
-        remaining -= n;
+        if (v >> 60)
+            return -1;
+
+        v = v << 4 | (uint64_t)d;
     }
 
-    req->body_size = total_read;
-    ((char*)req->body)[req->body_size] = '\0';
+    while (*line == ' ' || *line == '\t')
+        line++;
+
+    if (digits == 0 || (*line && *line != ';'))
+        return -1;
+
+    *size = v;
+    return 0;
+}
+
+/* Read the body as it was sent, de-chunked */
+static long body_read_raw(chttpx_request_t* req, void* buf, size_t n)
+{
+    chttpx_body_reader_t* r = &req->body_reader;
+    char line[BODY_LINE_MAX];
+
+    for (;;)
+    {
+        switch (r->state)
+        {
+        case BODY_DATA:
+        {
+            if (r->left == 0)
+            {
+                r->state = r->chunked ? BODY_CHUNK_END : BODY_DONE;
+                continue;
+            }
+
+            if (n == 0)
+                return 0;
+
+            size_t want = n < r->left ? n : (size_t)r->left;
+            long got;
+
+            if (r->len > 0)
+            {
+                got = (long)(want < r->len ? want : r->len);
+                memcpy(buf, r->data, (size_t)got);
+                r->data += got;
+                r->len -= (size_t)got;
+            }
+            else
+            {
+                /* Straight into the caller's buffer, never past the body or chunk */
+                got = body_recv(req->client_fd, buf, want);
+                if (got <= 0)
+                {
+                    r->state = BODY_ERROR;
+                    return -1;
+                }
+            }
+
+            r->left -= (uint64_t)got;
+            return got;
+        }
+
+        case BODY_CHUNK_END:
+        {
+            long len = body_line(req, line, sizeof(line));
+            if (len != 0)
+            {
+                r->state = BODY_ERROR;
+                return -1;
+            }
+
+            r->state = BODY_CHUNK_SIZE;
+            continue;
+        }
+
+        case BODY_CHUNK_SIZE:
+        {
+            if (body_line(req, line, sizeof(line)) < 0 || chunk_size(line, &r->left) != 0)
+            {
+                r->state = BODY_ERROR;
+                return -1;
+            }
+
+            r->state = r->left ? BODY_DATA : BODY_TRAILERS;
+            continue;
+        }
+
+        case BODY_TRAILERS:
+        {
+            /* Trailer fields are read and dropped up to the empty line */
+            size_t total = 0;
+            long len;
+            while ((len = body_line(req, line, sizeof(line))) > 0 && (total += (size_t)len) <= BODY_TRAILERS_MAX)
+                ;
+
+            if (len != 0)
+            {
+                r->state = BODY_ERROR;
+                return -1;
+            }
+
+            r->state = BODY_DONE;
+            return 0;
+        }
+
+        case BODY_DONE:
+            return 0;
+
+        default:
+            return -1;
+        }
+    }
+}
+
+#ifdef CHTTPX_PLATFORM_LINUX
+/* Decode the next bytes of a compressed body, straight into the caller's buffer */
+static long body_inflate_read(chttpx_request_t* req, void* buf, size_t n)
+{
+    chttpx_body_reader_t* r = &req->body_reader;
+    body_inflate_t* s = r->inflate;
+
+    if (r->state == BODY_ERROR)
+        return -1;
+
+    if (n == 0)
+        return 0;
+
+    /* One byte past the limit tells the body is too large, without inflating more */
+    uint64_t room = s->max - s->out + 1;
+    size_t want = n < room ? n : (size_t)room;
+    if (want > UINT_MAX)
+        want = UINT_MAX;
+
+    s->z.next_out = buf;
+    s->z.avail_out = (uInt)want;
+
+    while (s->z.avail_out == want)
+    {
+        if (s->z.avail_in == 0)
+        {
+            long got = body_read_raw(req, s->in, sizeof(s->in));
+
+            /* The body may only end after a complete member */
+            if (got == 0 && s->end)
+                return 0;
+
+            if (got <= 0)
+            {
+                r->state = BODY_ERROR;
+                return -1;
+            }
+
+            s->z.next_in = s->in;
+            s->z.avail_in = (uInt)got;
+        }
+
+        /* Bytes after a member: the next one of a gzip body, junk otherwise */
+        if (s->end)
+        {
+            if (!s->gzip || inflateReset(&s->z) != Z_OK)
+            {
+                r->state = BODY_ERROR;
+                return -1;
+            }
+
+            s->end = false;
+        }
+
+        int rc = inflate(&s->z, Z_NO_FLUSH);
+        if (rc == Z_STREAM_END)
+        {
+            s->end = true;
+        }
+        else if (rc != Z_OK)
+        {
+            r->state = BODY_ERROR;
+            return -1;
+        }
+    }
+
+    size_t produced = want - s->z.avail_out;
+    s->out += produced;
+
+    if (s->out > s->max)
+    {
+        r->too_large = true;
+        r->state = BODY_ERROR;
+        return -1;
+    }
+
+    return (long)produced;
+}
+#endif
+
+long cHTTPX_BodyRead(chttpx_request_t* req, void* buf, size_t n)
+{
+#ifdef CHTTPX_PLATFORM_LINUX
+    if (req->body_reader.inflate)
+        return body_inflate_read(req, buf, n);
+#endif
+
+    return body_read_raw(req, buf, n);
+}
+
+#ifdef CHTTPX_PLATFORM_LINUX
+/* Pipe between the socket and the file */
+#define BODY_SPLICE_PIPE (1024 * 1024)
+
+bool _body_can_splice(const chttpx_request_t* req)
+{
+    const chttpx_body_reader_t* r = &req->body_reader;
+
+    return !r->chunked && !r->inflate && r->state == BODY_DATA && req->client_fd != CHTTPX_INVALID_SOCKET &&
+           r->left - r->len >= BODY_SPLICE_MIN;
+}
+
+long _body_splice(chttpx_request_t* req, int fd)
+{
+    chttpx_body_reader_t* r = &req->body_reader;
+    long total = 0;
+
+    /* What the receive buffer holds goes first */
+    while (r->len > 0)
+    {
+        ssize_t n = write(fd, r->data, r->len);
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            goto fail;
+
+        r->data += n;
+        r->len -= (size_t)n;
+        r->left -= (uint64_t)n;
+        total += n;
+    }
+
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) != 0)
+        goto fail;
+
+    /* Larger pipe, fewer round trips; the default 64KB if the system refuses */
+    fcntl(pipefd[1], F_SETPIPE_SZ, BODY_SPLICE_PIPE);
+
+    while (r->left > 0)
+    {
+        size_t want = r->left < BODY_SPLICE_PIPE ? (size_t)r->left : BODY_SPLICE_PIPE;
+
+        ssize_t in = splice(req->client_fd, NULL, pipefd[1], NULL, want, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (in < 0 && errno == EINTR)
+            continue;
+
+        /* Nothing to read yet, wait as body_recv does */
+        if (in < 0 && errno == EAGAIN)
+        {
+            struct pollfd pfd = {.fd = req->client_fd, .events = POLLIN};
+            int ready = poll(&pfd, 1, BODY_READ_TIMEOUT_SEC * 1000);
+            if (ready > 0 || (ready < 0 && errno == EINTR))
+                continue;
+        }
+
+        if (in <= 0)
+            goto fail_pipe;
+
+        /* Empty the pipe into the file */
+        for (ssize_t left = in; left > 0;)
+        {
+            ssize_t out = splice(pipefd[0], NULL, fd, NULL, (size_t)left, SPLICE_F_MOVE);
+            if (out < 0 && errno == EINTR)
+                continue;
+
+            if (out <= 0)
+                goto fail_pipe;
+
+            left -= out;
+        }
+
+        r->left -= (uint64_t)in;
+        total += in;
+    }
+
+    close(pipefd[0]);
+    close(pipefd[1]);
+
+    r->state = BODY_DONE;
+    return total;
+
+fail_pipe:
+    close(pipefd[0]);
+    close(pipefd[1]);
+fail:
+    r->state = BODY_ERROR;
+    return -1;
+}
+#endif
+
+/* Read a JSON or text body into memory */
+void _parse_req_body(chttpx_request_t* req)
+{
+    req->body = NULL;
+    req->body_size = 0;
+
+    int is_json = strstr(req->content_type, "application/json") != NULL;
+    int is_json_or_text = is_json || strstr(req->content_type, "text/");
+
+    /* JSON bodies may be allowed more for cHTTPX_Parse, see cHTTPX_JsonLimit */
+    size_t limit = is_json && serv && serv->json_max ? serv->json_max : MAX_BODY_IN_MEMORY;
+
+    if (!is_json_or_text || req->content_length > limit || req->body_reader.state == BODY_DONE)
+        return;
+
+    /* The size of a chunked or compressed body is only known at its end */
+    bool sized = !req->body_reader.chunked && !req->body_reader.inflate;
+
+    /* Unsized bodies grow to their size, at most limit */
+    size_t cap = sized ? req->content_length : BUFFER_SIZE;
+    unsigned char* body = _arena_alloc(req->arena, cap + 1);
+    if (!body)
+    {
+        perror("malloc failed");
+        return;
+    }
+
+    size_t size = 0;
+    long n;
+    while ((n = cHTTPX_BodyRead(req, body + size, cap - size)) > 0)
+    {
+        size += (size_t)n;
+        if (size < cap || sized)
+            continue;
+
+        /* Too large to keep in memory, what was read is lost: fail the rest too */
+        if (cap >= limit)
+        {
+            req->body_reader.too_large = true;
+            req->body_reader.state = BODY_ERROR;
+            return;
+        }
+
+        size_t grown = cap * 2 < limit ? cap * 2 : limit;
+        unsigned char* bigger = _arena_alloc(req->arena, grown + 1);
+        if (!bigger)
+        {
+            perror("malloc failed");
+            return;
+        }
+
+        memcpy(bigger, body, size);
+        body = bigger;
+        cap = grown;
+    }
+
+    /* A body cut short is not handed to the handler */
+    if (n < 0)
+        return;
+
+    if (!sized)
+        req->content_length = size;
+
+    body[size] = '\0';
+    req->body = body;
+    req->body_size = size;
 }
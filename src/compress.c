@@ -0,0 +1,922 @@
+#define _GNU_SOURCE
+
+/*
+ * Copyright (c) 2026 netcorelink
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "compress.h"
+
+#include "serv.h"
+#include "http.h"
+#include "utils.h"
+#include "headers.h"
+#include "crosspltm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* Compressible types unless cHTTPX_Compress lists others */
+static const char* const compress_default_types[] = {"text/", "application/json", "application/javascript", "application/xml",
+                                                     "image/svg+xml"};
+
+void cHTTPX_Compress(size_t min_size, int level, const char** types, size_t types_count)
+{
+    if (!serv)
+    {
+        fprintf(stderr, "Error: server is not initialized\n");
+        return;
+    }
+
+    serv->compress.enabled = 1;
+    serv->compress.min_size = min_size ? min_size : CHTTPX_COMPRESS_MIN_SIZE;
+    serv->compress.level = level > 0 && level <= 9 ? level : 6;
+    serv->compress.types = types;
+    serv->compress.types_count = types ? types_count : 0;
+}
+
+void cHTTPX_DecompressLimit(size_t max_size)
+{
+    if (!serv)
+    {
+        fprintf(stderr, "Error: server is not initialized\n");
+        return;
+    }
+
+    serv->inflate_max = max_size ? max_size : CHTTPX_INFLATE_MAX;
+}
+
+int _compress_type(const char* content_type)
+{
+    if (!content_type)
+        return 0;
+
+    const char* const* types = serv->compress.types ? serv->compress.types : compress_default_types;
+    size_t count = serv->compress.types ? serv->compress.types_count
+                                        : sizeof(compress_default_types) / sizeof(compress_default_types[0]);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (strncasecmp(content_type, types[i], strlen(types[i])) == 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+unsigned _compress_accepts(chttpx_request_t* req)
+{
+    if (!serv || !serv->compress.enabled)
+        return 0;
+
+    const char* p = cHTTPX_HeaderGet(req, "Accept-Encoding");
+    if (!p)
+        return 0;
+
+    unsigned accepted = 0, refused = 0;
+    int any = 0;
+
+    /* "gzip, deflate;q=0.5, br;q=0, *" */
+    while (*p)
+    {
+        while (*p == ' ' || *p == '\t' || *p == ',')
+            p++;
+
+        const char* name = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ' && *p != '\t')
+            p++;
+        size_t len = (size_t)(p - name);
+
+        /* q=0 (with any number of zeros) refuses the coding */
+        int zero = 0;
+        while (*p && *p != ',')
+        {
+            if (*p == ';')
+            {
+                const char* q = p + 1;
+                while (*q == ' ')
+                    q++;
+                if ((q[0] == 'q' || q[0] == 'Q') && q[1] == '=')
+                {
+                    q += 2;
+                    zero = *q == '0';
+                    if (zero && q[1] == '.')
+                    {
+                        for (q += 2; *q >= '0' && *q <= '9'; q++)
+                            zero &= *q == '0';
+                    }
+                }
+            }
+            p++;
+        }
+
+        unsigned coding = 0;
+        if ((len == 4 && strncasecmp(name, "gzip", 4) == 0) || (len == 6 && strncasecmp(name, "x-gzip", 6) == 0))
+            coding = CHTTPX_ENC_GZIP;
+        else if (len == 7 && strncasecmp(name, "deflate", 7) == 0)
+            coding = CHTTPX_ENC_DEFLATE;
+        else if (len == 2 && strncasecmp(name, "br", 2) == 0)
+            coding = CHTTPX_ENC_BR;
+        else if (len == 1 && name[0] == '*')
+            any = !zero;
+
+        if (zero)
+            refused |= coding;
+        else
+            accepted |= coding;
+    }
+
+    /* "*" stands for the codings not listed */
+    if (any)
+        accepted |= CHTTPX_ENC_GZIP | CHTTPX_ENC_DEFLATE | CHTTPX_ENC_BR;
+
+    return accepted & ~refused;
+}
+
+#ifdef CHTTPX_PLATFORM_LINUX
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <zlib.h>
+
+#ifdef CHTTPX_BROTLI
+#include <brotli/encode.h>
+#endif
+
+/* Compressed copy of a file version, sent with sendfile from a memfd */
+typedef struct compress_entry
+{
+    struct compress_entry* next;
+    /* Least recently used list */
+    struct compress_entry* lru_prev;
+    struct compress_entry* lru_next;
+
+    /* File identity and version */
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_ns;
+    unsigned coding;
+
+    int fd;
+    size_t len;
+} compress_entry_t;
+
+/* File being compressed by a thread, on the stack of that thread */
+typedef struct compress_loading
+{
+    struct compress_loading* next;
+    uint64_t dev;
+    uint64_t ino;
+    unsigned coding;
+} compress_loading_t;
+
+typedef struct
+{
+    chttpx_mutex_t lock;
+
+    compress_entry_t* buckets[CHTTPX_COMPRESS_BUCKETS];
+    compress_entry_t* lru_head;
+    compress_entry_t* lru_tail;
+    size_t entries;
+    size_t bytes;
+    /* Misses being compressed: other misses on the same file do not compress it again */
+    compress_loading_t* loading;
+
+    /* Counters */
+    uint64_t responses;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    uint64_t precompressed;
+} compress_cache_t;
+
+static compress_cache_t cache = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+/* Deflate states kept per thread, a state costs ~256 KB to set up */
+typedef struct
+{
+    z_stream gzip;
+    z_stream deflate;
+    /* Level of a ready state, 0 until it is set up */
+    int gzip_level;
+    int deflate_level;
+} compress_zstreams_t;
+
+static pthread_key_t zstreams_key;
+static pthread_once_t zstreams_once = PTHREAD_ONCE_INIT;
+
+static void zstreams_free(void* arg)
+{
+    compress_zstreams_t* z = arg;
+
+    if (z->gzip_level)
+        deflateEnd(&z->gzip);
+    if (z->deflate_level)
+        deflateEnd(&z->deflate);
+
+    free(z);
+}
+
+static void zstreams_key_create(void)
+{
+    pthread_key_create(&zstreams_key, zstreams_free);
+}
+
+/* The calling thread's deflate state for a coding, reset for a new body */
+static z_stream* zstream_get(unsigned coding, int level)
+{
+    pthread_once(&zstreams_once, zstreams_key_create);
+
+    compress_zstreams_t* z = pthread_getspecific(zstreams_key);
+    if (!z)
+    {
+        z = calloc(1, sizeof(*z));
+        if (!z || pthread_setspecific(zstreams_key, z) != 0)
+        {
+            free(z);
+            return NULL;
+        }
+    }
+
+    z_stream* strm = coding == CHTTPX_ENC_GZIP ? &z->gzip : &z->deflate;
+    int* ready = coding == CHTTPX_ENC_GZIP ? &z->gzip_level : &z->deflate_level;
+
+    if (*ready)
+    {
+        /* Nothing is compressed since the reset, so the level changes without a flush */
+        if (deflateReset(strm) != Z_OK || (*ready != level && deflateParams(strm, level, Z_DEFAULT_STRATEGY) != Z_OK))
+            return NULL;
+
+        *ready = level;
+        return strm;
+    }
+
+    /* gzip is deflate with a gzip header and trailer (window bits + 16), "deflate" the zlib format */
+    memset(strm, 0, sizeof(*strm));
+    if (deflateInit2(strm, level, Z_DEFLATED, coding == CHTTPX_ENC_GZIP ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return NULL;
+
+    *ready = level;
+    return strm;
+}
+
+/* Best coding we can produce among those accepted */
+static unsigned compress_pick(unsigned accepted)
+{
+#ifdef CHTTPX_BROTLI
+    if (accepted & CHTTPX_ENC_BR)
+        return CHTTPX_ENC_BR;
+#endif
+    if (accepted & CHTTPX_ENC_GZIP)
+        return CHTTPX_ENC_GZIP;
+    if (accepted & CHTTPX_ENC_DEFLATE)
+        return CHTTPX_ENC_DEFLATE;
+
+    return 0;
+}
+
+static const char* compress_name(unsigned coding)
+{
+    return coding == CHTTPX_ENC_BR ? "br" : coding == CHTTPX_ENC_GZIP ? "gzip" : "deflate";
+}
+
+/* Largest output of compressing len bytes */
+static size_t compress_bound(unsigned coding, size_t len)
+{
+#ifdef CHTTPX_BROTLI
+    if (coding == CHTTPX_ENC_BR)
+        return BrotliEncoderMaxCompressedSize(len);
+#endif
+    (void)coding;
+    /* deflateBound plus the gzip header and trailer */
+    return len + (len >> 12) + (len >> 14) + (len >> 25) + 13 + 18 + 64;
+}
+
+/**
+ * Compress a buffer in one go.
+ * @param best Best ratio (cached copies) instead of the configured level.
+ * @return Compressed size, 0 on error or if out is too small.
+ */
+static size_t compress_buffer(unsigned coding, int best, const void* in, size_t in_len, void* out, size_t out_cap)
+{
+#ifdef CHTTPX_BROTLI
+    if (coding == CHTTPX_ENC_BR)
+    {
+        size_t out_len = out_cap;
+        int quality = best ? BROTLI_MAX_QUALITY : CHTTPX_BROTLI_QUALITY;
+        if (!BrotliEncoderCompress(quality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC, in_len, in, &out_len, out))
+            return 0;
+
+        return out_len;
+    }
+#endif
+
+    z_stream* strm = zstream_get(coding, best ? Z_BEST_COMPRESSION : serv->compress.level);
+    if (!strm)
+        return 0;
+
+    strm->next_in = (Bytef*)in;
+    strm->avail_in = (uInt)in_len;
+    strm->next_out = out;
+    strm->avail_out = (uInt)out_cap;
+
+    if (deflate(strm, Z_FINISH) != Z_STREAM_END)
+        return 0;
+
+    return out_cap - strm->avail_out;
+}
+
+/* Memory body: compressed into the REQuest arena, kept only if it got smaller */
+static int compress_body(chttpx_request_t* req, chttpx_response_t* res, unsigned coding)
+{
+    size_t cap = compress_bound(coding, res->body_size);
+    unsigned char* out = _arena_alloc(req->arena, cap);
+    if (!out)
+        return 0;
+
+    size_t len = compress_buffer(coding, 0, res->body, res->body_size, out, cap);
+    if (len == 0 || len >= res->body_size)
+        return 0;
+
+    chttpx_atomic_add(&cache.bytes_in, res->body_size);
+    chttpx_atomic_add(&cache.bytes_out, len);
+
+    res->body = out;
+    res->body_size = len;
+    return 1;
+}
+
+/* Streamed body: the producer's output goes through the compressor, one flushed piece per chunk */
+typedef struct
+{
+    chttpx_stream_fn_t fn;
+    void* ctx;
+    void (*free_ctx)(void* ctx);
+
+    unsigned coding;
+    z_stream strm;
+#ifdef CHTTPX_BROTLI
+    BrotliEncoderState* br;
+    const uint8_t* br_next;
+    size_t br_avail;
+#endif
+
+    /* Producer output not yet consumed */
+    char in[CHTTPX_STREAM_CHUNK];
+    /* The producer is done / the compressor wrote its trailer */
+    bool eof;
+    bool finished;
+    /* The last call filled the buffer, the compressor may hold more output */
+    bool full;
+} compress_stream_t;
+
+static void compress_stream_free(void* arg)
+{
+    compress_stream_t* s = arg;
+
+#ifdef CHTTPX_BROTLI
+    if (s->br)
+        BrotliEncoderDestroyInstance(s->br);
+    else
+#endif
+        deflateEnd(&s->strm);
+
+    if (s->free_ctx)
+        s->free_ctx(s->ctx);
+
+    free(s);
+}
+
+/* Run the compressor over what is pending, returns the bytes written to buf or -1 */
+static long compress_stream_step(compress_stream_t* s, char* buf, size_t size)
+{
+#ifdef CHTTPX_BROTLI
+    if (s->br)
+    {
+        uint8_t* next_out = (uint8_t*)buf;
+        size_t avail_out = size;
+        BrotliEncoderOperation op = s->eof ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_FLUSH;
+
+        if (!BrotliEncoderCompressStream(s->br, op, &s->br_avail, &s->br_next, &avail_out, &next_out, NULL))
+            return -1;
+
+        s->finished = BrotliEncoderIsFinished(s->br);
+        s->full = BrotliEncoderHasMoreOutput(s->br);
+        return (long)(size - avail_out);
+    }
+#endif
+
+    s->strm.next_out = (Bytef*)buf;
+    s->strm.avail_out = (uInt)size;
+
+    int r = deflate(&s->strm, s->eof ? Z_FINISH : Z_SYNC_FLUSH);
+    if (r == Z_STREAM_ERROR)
+        return -1;
+
+    s->finished = r == Z_STREAM_END;
+    s->full = s->strm.avail_out == 0;
+    return (long)(size - s->strm.avail_out);
+}
+
+static size_t compress_stream_pending(const compress_stream_t* s)
+{
+#ifdef CHTTPX_BROTLI
+    if (s->br)
+        return s->br_avail;
+#endif
+    return s->strm.avail_in;
+}
+
+static long compress_stream_next(void* arg, char* buf, size_t size)
+{
+    compress_stream_t* s = arg;
+
+    while (!s->finished)
+    {
+        /* Next piece of the body once the compressor has taken the last one and flushed it */
+        if (!s->eof && !s->full && compress_stream_pending(s) == 0)
+        {
+            long n = s->fn(s->ctx, s->in, sizeof(s->in));
+            if (n < 0)
+                return -1;
+
+            if (n == 0)
+                s->eof = true;
+
+#ifdef CHTTPX_BROTLI
+            s->br_next = (const uint8_t*)s->in;
+            s->br_avail = (size_t)n;
+#endif
+            s->strm.next_in = (Bytef*)s->in;
+            s->strm.avail_in = (uInt)n;
+        }
+
+        long out = compress_stream_step(s, buf, size);
+        if (out != 0)
+            return out;
+    }
+
+    return 0;
+}
+
+static int compress_stream(chttpx_response_t* res, unsigned coding)
+{
+    compress_stream_t* s = calloc(1, sizeof(*s));
+    if (!s)
+    {
+        perror("malloc failed");
+        return 0;
+    }
+
+#ifdef CHTTPX_BROTLI
+    if (coding == CHTTPX_ENC_BR)
+    {
+        s->br = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+        if (!s->br || !BrotliEncoderSetParameter(s->br, BROTLI_PARAM_QUALITY, CHTTPX_BROTLI_QUALITY))
+        {
+            if (s->br)
+                BrotliEncoderDestroyInstance(s->br);
+            free(s);
+            return 0;
+        }
+    }
+    else
+#endif
+        if (deflateInit2(&s->strm, serv->compress.level, Z_DEFLATED, coding == CHTTPX_ENC_GZIP ? 15 + 16 : 15, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        free(s);
+        return 0;
+    }
+
+    s->coding = coding;
+    s->fn = res->stream;
+    s->ctx = res->stream_ctx;
+    s->free_ctx = res->stream_free;
+
+    res->stream = compress_stream_next;
+    res->stream_ctx = s;
+    res->stream_free = compress_stream_free;
+    return 1;
+}
+
+static void compress_lru_unlink(compress_entry_t* e)
+{
+    if (e->lru_prev)
+        e->lru_prev->lru_next = e->lru_next;
+    else
+        cache.lru_head = e->lru_next;
+
+    if (e->lru_next)
+        e->lru_next->lru_prev = e->lru_prev;
+    else
+        cache.lru_tail = e->lru_prev;
+}
+
+static void compress_lru_push(compress_entry_t* e)
+{
+    e->lru_prev = NULL;
+    e->lru_next = cache.lru_head;
+    if (cache.lru_head)
+        cache.lru_head->lru_prev = e;
+    else
+        cache.lru_tail = e;
+    cache.lru_head = e;
+}
+
+static size_t compress_bucket(uint64_t dev, uint64_t ino, unsigned coding)
+{
+    uint64_t h = (dev * 0x9e3779b97f4a7c15ULL) ^ (ino * 0xc2b2ae3d27d4eb4fULL) ^ coding;
+    return (size_t)((h ^ (h >> 29)) % CHTTPX_COMPRESS_BUCKETS);
+}
+
+/* Unlink an entry from its bucket and the LRU list and free it; cache lock held */
+static void compress_entry_drop(compress_entry_t* e)
+{
+    compress_entry_t** link = &cache.buckets[compress_bucket(e->dev, e->ino, e->coding)];
+    while (*link != e)
+        link = &(*link)->next;
+    *link = e->next;
+
+    compress_lru_unlink(e);
+    cache.entries--;
+    cache.bytes -= e->len;
+
+    close(e->fd);
+    free(e);
+}
+
+/* Cached copy of a file version, a new descriptor of it or -1; cache lock held */
+static int compress_cache_find(const struct stat* st, unsigned coding, size_t* len)
+{
+    int64_t mtime_ns = (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+
+    for (compress_entry_t* e = cache.buckets[compress_bucket(st->st_dev, st->st_ino, coding)]; e; e = e->next)
+    {
+        if (e->dev == (uint64_t)st->st_dev && e->ino == (uint64_t)st->st_ino && e->coding == coding &&
+            e->size == (uint64_t)st->st_size && e->mtime_ns == mtime_ns)
+        {
+            compress_lru_unlink(e);
+            compress_lru_push(e);
+
+            *len = e->len;
+            return fcntl(e->fd, F_DUPFD_CLOEXEC, 0);
+        }
+    }
+
+    return -1;
+}
+
+/* Compress a file into a memfd and cache it, returns a new descriptor of it or -1 */
+static int compress_cache_load(int file_fd, const struct stat* st, unsigned coding, size_t* len)
+{
+    size_t size = (size_t)st->st_size;
+    size_t cap = compress_bound(coding, size);
+
+    char* in = malloc(size);
+    char* out = malloc(cap);
+    if (!in || !out)
+    {
+        perror("malloc failed");
+        free(in);
+        free(out);
+        return -1;
+    }
+
+    size_t got = 0;
+    while (got < size)
+    {
+        ssize_t n = pread(file_fd, in + got, size - got, (off_t)got);
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR)
+                continue;
+            break;
+        }
+        got += (size_t)n;
+    }
+
+    size_t out_len = got == size ? compress_buffer(coding, 1, in, size, out, cap) : 0;
+    free(in);
+
+    /* Not smaller: not worth a copy */
+    int fd = out_len > 0 && out_len < size ? memfd_create("chttpx-compressed", MFD_CLOEXEC) : -1;
+    if (fd >= 0)
+    {
+        size_t written = 0;
+        while (written < out_len)
+        {
+            ssize_t n = write(fd, out + written, out_len - written);
+            if (n <= 0)
+            {
+                if (n < 0 && errno == EINTR)
+                    continue;
+                break;
+            }
+            written += (size_t)n;
+        }
+
+        if (written != out_len)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    free(out);
+
+    if (fd < 0)
+        return -1;
+
+    /* Larger than the whole cache: sent without being kept */
+    if (out_len > CHTTPX_COMPRESS_CACHE_SIZE)
+    {
+        *len = out_len;
+        return fd;
+    }
+
+    compress_entry_t* e = malloc(sizeof(*e));
+    int res_fd = e ? fcntl(fd, F_DUPFD_CLOEXEC, 0) : -1;
+    if (res_fd < 0)
+    {
+        free(e);
+        close(fd);
+        return -1;
+    }
+
+    e->dev = (uint64_t)st->st_dev;
+    e->ino = (uint64_t)st->st_ino;
+    e->size = (uint64_t)st->st_size;
+    e->mtime_ns = (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+    e->coding = coding;
+    e->fd = fd;
+    e->len = out_len;
+
+    _mutex_lock(&cache.lock);
+
+    /* Another thread may have compressed it meanwhile, keep the first copy */
+    size_t other_len;
+    int other = compress_cache_find(st, coding, &other_len);
+    if (other >= 0)
+    {
+        close(other);
+        close(fd);
+        free(e);
+    }
+    else
+    {
+        /* Oldest copies make room (the response's descriptor keeps its copy alive) */
+        while (cache.lru_tail && cache.bytes + out_len > CHTTPX_COMPRESS_CACHE_SIZE)
+            compress_entry_drop(cache.lru_tail);
+
+        size_t b = compress_bucket(e->dev, e->ino, coding);
+        e->next = cache.buckets[b];
+        cache.buckets[b] = e;
+        compress_lru_push(e);
+        cache.entries++;
+        cache.bytes += out_len;
+    }
+
+    _mutex_unlock(&cache.lock);
+
+    *len = out_len;
+    return res_fd;
+}
+
+/* File body: swapped for the cached compressed copy of its current version */
+static int compress_file(chttpx_response_t* res, unsigned coding)
+{
+    struct stat st;
+    if (res->file_offset != 0 || fstat(res->file_fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+        (uint64_t)st.st_size != res->body_size || res->body_size > CHTTPX_COMPRESS_FILE_MAX)
+        return 0;
+
+    size_t len = 0;
+    compress_loading_t self = {.dev = (uint64_t)st.st_dev, .ino = (uint64_t)st.st_ino, .coding = coding};
+    int busy = 0;
+
+    _mutex_lock(&cache.lock);
+    int fd = compress_cache_find(&st, coding, &len);
+    if (fd < 0)
+    {
+        for (compress_loading_t* l = cache.loading; l && !busy; l = l->next)
+            busy = l->dev == self.dev && l->ino == self.ino && l->coding == coding;
+
+        if (!busy)
+        {
+            self.next = cache.loading;
+            cache.loading = &self;
+        }
+    }
+    _mutex_unlock(&cache.lock);
+
+    if (fd >= 0)
+    {
+        chttpx_atomic_add(&cache.cache_hits, 1);
+    }
+    else
+    {
+        chttpx_atomic_add(&cache.cache_misses, 1);
+
+        /* Another thread is compressing this file: this response goes out as it is */
+        if (busy)
+            return 0;
+
+        fd = compress_cache_load(res->file_fd, &st, coding, &len);
+
+        _mutex_lock(&cache.lock);
+        compress_loading_t** link = &cache.loading;
+        while (*link != &self)
+            link = &(*link)->next;
+        *link = self.next;
+        _mutex_unlock(&cache.lock);
+
+        if (fd < 0)
+            return 0;
+    }
+
+    close(res->file_fd);
+    res->file_fd = fd;
+    res->body_size = len;
+    return 1;
+}
+
+/* Whether a token is in a comma-separated header value */
+static int compress_has_token(const char* value, const char* token)
+{
+    size_t len = strlen(token);
+
+    for (const char* p = value; p && *p;)
+    {
+        while (*p == ' ' || *p == '\t' || *p == ',')
+            p++;
+
+        if (strncasecmp(p, token, len) == 0 && (p[len] == '\0' || p[len] == ',' || p[len] == ' ' || p[len] == '\t'))
+            return 1;
+
+        p = strchr(p, ',');
+    }
+
+    return 0;
+}
+
+static void compress_weaken_etag(chttpx_response_t* res)
+{
+    const char* etag = cHTTPX_ResHeaderGet(res, "ETag");
+    if (!etag || strncmp(etag, "W/", 2) == 0)
+        return;
+
+    char weak[128];
+    snprintf(weak, sizeof(weak), "W/%s", etag);
+    cHTTPX_ResHeaderSet(res, "ETag", weak);
+}
+
+void _res_apply_compression(chttpx_request_t* req, chttpx_response_t* res)
+{
+    if (!serv || !serv->compress.enabled || !_compress_type(res->content_type))
+        return;
+
+    if (res->status != cHTTPX_StatusOK && res->status != cHTTPX_StatusNotModified)
+        return;
+
+    /* The representation depends on Accept-Encoding, for caches too */
+    const char* vary = cHTTPX_ResHeaderGet(res, "Vary");
+    if (!vary)
+    {
+        cHTTPX_HeaderAdd(res, "Vary", "Accept-Encoding");
+    }
+    else if (!compress_has_token(vary, "Accept-Encoding") && !compress_has_token(vary, "*"))
+    {
+        char value[256];
+        snprintf(value, sizeof(value), "%s, Accept-Encoding", vary);
+        cHTTPX_ResHeaderSet(res, "Vary", value);
+    }
+
+    /* A 304 repeats the validator of the copy the client holds: weak if it was compressed */
+    if (res->status == cHTTPX_StatusNotModified)
+    {
+        const char* inm = cHTTPX_HeaderGet(req, "If-None-Match");
+        if (inm && strncmp(inm, "W/", 2) == 0)
+            compress_weaken_etag(res);
+        return;
+    }
+
+    /* Already encoded (e.g. a precompressed static file), or partial content */
+    if (cHTTPX_ResHeaderGet(res, "Content-Encoding") || res->ranges)
+        return;
+
+    unsigned coding = compress_pick(_compress_accepts(req));
+    if (!coding)
+        return;
+
+    /* Added before the body is swapped: without room for it the response goes out as it is */
+    if (cHTTPX_HeaderAdd(res, "Content-Encoding", compress_name(coding)) != 0)
+        return;
+
+    int done = 0;
+    if (res->stream)
+        done = compress_stream(res, coding);
+    else if (res->file)
+        done = res->body_size >= serv->compress.min_size && compress_file(res, coding);
+    else if (res->body)
+        done = res->body_size >= serv->compress.min_size && compress_body(req, res, coding);
+
+    if (!done)
+    {
+        _res_header_pop(res);
+        return;
+    }
+
+    chttpx_atomic_add(&cache.responses, 1);
+
+    /* Same content, other bytes: the validator becomes weak */
+    compress_weaken_etag(res);
+}
+
+void _compress_note_precompressed(void)
+{
+    chttpx_atomic_add(&cache.precompressed, 1);
+}
+
+void _compress_shutdown(void)
+{
+    _mutex_lock(&cache.lock);
+
+    while (cache.lru_tail)
+        compress_entry_drop(cache.lru_tail);
+
+    cache.responses = cache.bytes_in = cache.bytes_out = 0;
+    cache.cache_hits = cache.cache_misses = cache.precompressed = 0;
+
+    _mutex_unlock(&cache.lock);
+}
+
+void cHTTPX_CompressStats(chttpx_compress_stats_t* stats)
+{
+    _mutex_lock(&cache.lock);
+
+    stats->responses = cache.responses;
+    stats->bytes_in = cache.bytes_in;
+    stats->bytes_out = cache.bytes_out;
+    stats->cache_hits = cache.cache_hits;
+    stats->cache_misses = cache.cache_misses;
+    stats->precompressed = cache.precompressed;
+    stats->cache_entries = cache.entries;
+    stats->cache_bytes = cache.bytes;
+
+    _mutex_unlock(&cache.lock);
+}
+
+#else
+
+/* Without zlib responses go out as they are, precompressed static files are still served */
+
+static uint64_t compress_precompressed;
+
+void _res_apply_compression(chttpx_request_t* req, chttpx_response_t* res)
+{
+    (void)req;
+    (void)res;
+}
+
+void _compress_note_precompressed(void)
+{
+    chttpx_atomic_add(&compress_precompressed, 1);
+}
+
+void _compress_shutdown(void)
+{
+}
+
+void cHTTPX_CompressStats(chttpx_compress_stats_t* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->precompressed = chttpx_atomic_load(&compress_precompressed);
+}
+
+#endif
@@ -13,59 +13,78 @@
 #define CHTTPX_SAMESITE_STRICT 2
 #define CHTTPX_SAMESITE_NONE_MODE 3
 
-/* Parse cookie in request */
+/* Parse cookie in request: one copy of the Cookie header, split in place */
 void _parse_req_cookies(chttpx_request_t* req)
 {
-    const char* cookie_header = cHTTPX_HeaderGet(req, "Cookie");
+    const char* cookie_header = NULL;
+    size_t cookie_len = 0;
+
+    for (size_t i = 0; i < req->headers_count; i++)
+    {
+        if (req->headers[i].name_len == 6 && strncasecmp(req->headers[i].name, "Cookie", 6) == 0)
+        {
+            cookie_header = req->headers[i].value;
+            cookie_len = req->headers[i].value_len;
+            break;
+        }
+    }
+
     if (!cookie_header)
         return;
 
-    char buffer[strlen(cookie_header) + 1];
-    strcpy(buffer, cookie_header);
+    /* The header view stays intact for cHTTPX_HeaderGet */
+    char* buffer = _arena_strndup(req->arena, cookie_header, cookie_len);
+    if (!buffer)
+        return;
 
-    char* pair = strtok(buffer, ";");
+    char* pair = buffer;
 
     while (pair && req->cookies_count < MAX_COOKIES)
     {
+        char* semi = strchr(pair, ';');
+        if (semi)
+            *semi = '\0';
+
         while (*pair == ' ')
             pair++;
 
         char* eq = strchr(pair, '=');
         if (eq)
         {
-            *eq = '\0';
+            if (req->cookies_count == req->cookies_cap)
+            {
+                chttpx_cookie_t* grown = _arena_grow(req->arena, req->cookies, req->cookies_count, &req->cookies_cap, sizeof(chttpx_cookie_t));
+                if (!grown)
+                    return;
+
+                req->cookies = grown;
+            }
 
-            req->cookies[req->cookies_count].name = strdup(pair);
-            req->cookies[req->cookies_count].value = strdup(eq + 1);
+            *eq = '\0';
 
-            req->cookies[req->cookies_count].path = strdup("/");
-            req->cookies[req->cookies_count].domain = NULL;
+            chttpx_cookie_t* c = &req->cookies[req->cookies_count++];
+            c->name = pair;
+            c->value = eq + 1;
 
-            req->cookies[req->cookies_count].expires = 0;
-            req->cookies[req->cookies_count].http_only = false;
-            req->cookies[req->cookies_count].secure = false;
-            req->cookies[req->cookies_count].same_site = 0;
+            c->path = "/";
+            c->domain = NULL;
 
-            req->cookies_count++;
+            c->expires = 0;
+            c->http_only = false;
+            c->secure = false;
+            c->same_site = 0;
         }
 
-        pair = strtok(NULL, ";");
+        pair = semi ? semi + 1 : NULL;
     }
 }
 
+/* Cookies live in the REQuest arena, only forget them */
 void chttpx_free_req_cookie(chttpx_request_t* req)
 {
     if (!req)
         return;
 
-    for (size_t i = 0; i < req->cookies_count; i++)
-    {
-        free(req->cookies[i].name);
-        free(req->cookies[i].value);
-        free(req->cookies[i].path);
-        free(req->cookies[i].domain);
-    }
-
     req->cookies_count = 0;
 }
 
@@ -0,0 +1,894 @@
+#define _GNU_SOURCE
+
+/*
+ * Copyright (c) 2026 netcorelink
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include "eventloop.h"
+
+#include "serv.h"
+#include "utils.h"
+#include "body.h"
+#include "workers.h"
+#include "admission.h"
+#include "request.h"
+#include "response.h"
+#include "middlewares.h"
+
+#include <stdio.h>
+
+#ifdef CHTTPX_PLATFORM_LINUX
+
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#ifdef EPOLLEXCLUSIVE
+#define EVLOOP_LISTEN_EVENTS (EPOLLIN | EPOLLEXCLUSIVE)
+#else
+#define EVLOOP_LISTEN_EVENTS EPOLLIN
+#endif
+
+/* Connection states, every state has its own timeout list */
+typedef enum
+{
+    CONN_READING = 0,
+    CONN_WRITING,
+    /* Keep-alive, waiting for the next REQuest */
+    CONN_IDLE,
+    CONN_STATES
+} conn_state_t;
+
+typedef struct conn
+{
+    chttpx_socket_t fd;
+    conn_state_t state;
+
+    /* Receive buffer, allocated on first read */
+    char* in;
+    size_t in_len;
+    size_t in_cap;
+    /* Offset where the search for the end of the head resumes */
+    size_t scanned;
+    /* Size of the current REQuest (head + body), 0 until the head is complete */
+    size_t req_len;
+
+    /* REQuest, response head and body, reset once the response is sent */
+    chttpx_arena_t arena;
+
+    /* Pending response: serialized head followed by the body, the file or its ranges */
+    chttpx_send_part_t* out_parts;
+    size_t out_parts_count;
+    size_t out_off;
+    /* File of the response, owned until it is sent */
+    int out_file;
+    /* Streamed response (cHTTPX_ResStream) and the frame of its current chunk */
+    chttpx_response_t* out_stream;
+    char* out_frame;
+    /* Keep the connection open once the response is sent */
+    int keep_alive;
+
+    /* Last activity (monotonic seconds) and links in the timeout list */
+    time_t last_active;
+    struct conn* prev;
+    struct conn* next;
+} conn_t;
+
+typedef struct
+{
+    conn_t* head;
+    conn_t* tail;
+} conn_list_t;
+
+typedef struct
+{
+    int epfd;
+    chttpx_socket_t listen_fd;
+    time_t now;
+    /* Connections ordered by last activity, oldest first */
+    conn_list_t lists[CONN_STATES];
+
+    /* Overload: listening socket removed from epfd until a slot frees */
+    int paused;
+    /* Connection accepted while pausing, admitted on resume (-1 if none) */
+    chttpx_socket_t pending_fd;
+    /* eventfd written by _eventloop_wake_paused */
+    int wake_fd;
+    /* Loop number, for CPU pinning */
+    size_t index;
+} evloop_t;
+
+/* Running loops, for waking paused ones from other threads */
+static evloop_t* evloops = NULL;
+static size_t evloops_count = 0;
+static size_t evloops_paused = 0;
+
+/* REQuest with a large body, continued on a blocking thread */
+typedef struct
+{
+    chttpx_socket_t fd;
+    size_t len;
+    char buf[BUFFER_SIZE];
+} handoff_t;
+
+/* Result of a connection step */
+typedef enum
+{
+    /* Wait for the next event */
+    STEP_AGAIN = 0,
+    /* Response fully sent */
+    STEP_DONE,
+    /* Connection is no longer owned by the loop */
+    STEP_GONE,
+    /* Socket or protocol error */
+    STEP_ERROR,
+} step_t;
+
+static time_t monotonic_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+static void list_push(conn_list_t* list, conn_t* c)
+{
+    c->next = NULL;
+    c->prev = list->tail;
+
+    if (list->tail)
+        list->tail->next = c;
+    else
+        list->head = c;
+
+    list->tail = c;
+}
+
+static void list_remove(conn_list_t* list, conn_t* c)
+{
+    if (c->prev)
+        c->prev->next = c->next;
+    else
+        list->head = c->next;
+
+    if (c->next)
+        c->next->prev = c->prev;
+    else
+        list->tail = c->prev;
+
+    c->prev = c->next = NULL;
+}
+
+/* Refresh the activity time, moving the connection to the end of its list */
+static void conn_touch(evloop_t* loop, conn_t* c)
+{
+    c->last_active = loop->now;
+
+    if (loop->lists[c->state].tail != c)
+    {
+        list_remove(&loop->lists[c->state], c);
+        list_push(&loop->lists[c->state], c);
+    }
+}
+
+static void conn_set_state(evloop_t* loop, conn_t* c, conn_state_t state)
+{
+    list_remove(&loop->lists[c->state], c);
+    c->state = state;
+    c->last_active = loop->now;
+    list_push(&loop->lists[state], c);
+}
+
+/* Close the file and release the producer of the pending response, if any */
+static void conn_drop_file(conn_t* c)
+{
+    if (c->out_file >= 0)
+        close(c->out_file);
+
+    c->out_file = -1;
+
+    if (c->out_stream)
+        _res_release(c->out_stream);
+
+    c->out_stream = NULL;
+    c->out_frame = NULL;
+}
+
+/* Forget the connection without touching the socket */
+static void conn_release(evloop_t* loop, conn_t* c)
+{
+    list_remove(&loop->lists[c->state], c);
+    epoll_ctl(loop->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+
+    conn_drop_file(c);
+
+    free(c->in);
+    _arena_free(&c->arena);
+    free(c);
+}
+
+static void conn_close(evloop_t* loop, conn_t* c)
+{
+    chttpx_close(c->fd);
+    conn_release(loop, c);
+
+    _admission_release();
+}
+
+static void* handoff_thread(void* arg)
+{
+    handoff_t* h = (handoff_t*)arg;
+
+    chttpx_handle_buffered(h->fd, h->buf, h->len);
+    free(h);
+
+    _admission_release();
+    return NULL;
+}
+
+/* Move a REQuest whose body the loop cannot buffer to a blocking thread */
+static step_t conn_handoff(evloop_t* loop, conn_t* c)
+{
+    /* The blocking path takes at most BUFFER_SIZE - 1 buffered bytes, refuse more than it can hold */
+    if (c->in_len >= BUFFER_SIZE)
+        return STEP_ERROR;
+
+    handoff_t* h = malloc(sizeof(handoff_t));
+    if (!h)
+        return STEP_ERROR;
+
+    h->fd = c->fd;
+    h->len = c->in_len;
+    memcpy(h->buf, c->in, c->in_len);
+
+    conn_release(loop, c);
+
+    int flags = fcntl(h->fd, F_GETFL, 0);
+    fcntl(h->fd, F_SETFL, flags & ~O_NONBLOCK);
+
+    /* Prefer the worker pool, never blocking the loop on a full queue */
+    if (serv->workers > 0)
+    {
+        char* buf = malloc(h->len + 1);
+        if (buf)
+        {
+            memcpy(buf, h->buf, h->len);
+            if (_workers_try_submit(h->fd, buf, h->len) == 0)
+            {
+                free(h);
+                return STEP_GONE;
+            }
+            free(buf);
+        }
+    }
+
+    thread_t thread_id;
+    if (_thread_create(&thread_id, handoff_thread, h) != 0)
+    {
+        perror("pthread_create");
+        chttpx_close(h->fd);
+        free(h);
+
+        _admission_release();
+        return STEP_GONE;
+    }
+
+    pthread_detach(thread_id);
+    return STEP_GONE;
+}
+
+/* Pull the next chunk of a streamed response into the pending pieces, 0 at the end */
+static long conn_next_chunk(conn_t* c)
+{
+    const char* data;
+    long len = _res_stream_next(c->out_stream, c->out_frame, &data);
+
+    if (len > 0)
+        c->out_parts[c->out_parts_count++] = (chttpx_send_part_t){.data = data, .len = (size_t)len};
+
+    return len;
+}
+
+/* Send as much of the pending response as the socket accepts */
+static step_t conn_flush(evloop_t* loop, conn_t* c)
+{
+    for (;;)
+    {
+        size_t before = c->out_off;
+
+        int r = _send_parts(c->fd, c->out_parts, c->out_parts_count, &c->out_off);
+
+        if (c->out_off != before)
+            conn_touch(loop, c);
+
+        if (r <= 0)
+            return r < 0 ? STEP_ERROR : STEP_AGAIN;
+
+        if (!c->out_stream)
+            return STEP_DONE;
+
+        /* Sent out: the next chunk is only produced now, the socket paces the producer */
+        c->out_parts_count = c->out_off = 0;
+
+        long len = conn_next_chunk(c);
+        if (len < 0)
+            return STEP_ERROR;
+
+        if (len == 0)
+            return STEP_DONE;
+    }
+}
+
+/* Parse and run a complete REQuest, then start writing the response */
+static step_t conn_dispatch(evloop_t* loop, conn_t* c)
+{
+    /* The parser terminates the REQuest in place, keep the next pipelined byte */
+    char next = c->in[c->req_len];
+
+    chttpx_request_t* req = _parse_req_buffer(c->fd, c->in, c->req_len, &c->arena);
+    if (!req)
+        return STEP_ERROR;
+
+    c->in[c->req_len] = next;
+
+    chttpx_response_t res = {0};
+
+    if (_process_req(req, &res) == CHTTPX_REQ_DETACHED)
+    {
+        _free_req(req);
+        conn_release(loop, c);
+
+        _admission_release();
+        return STEP_GONE;
+    }
+
+    c->keep_alive = _conn_keep_alive(req, &res);
+
+    char head[BUFFER_SIZE];
+    size_t head_len = _build_response_head(req, &res, c->keep_alive, head, sizeof(head));
+
+    /* LOG */
+    _log_response(req, &res);
+    postmiddleware_logging_write(req, &res);
+
+    _free_req(req);
+
+    /* The connection owns the file until the response is sent */
+    if (res.file)
+        c->out_file = res.file_fd;
+
+    /* and the producer of a stream */
+    if (res.stream)
+    {
+        c->out_stream = _arena_alloc(&c->arena, sizeof(chttpx_response_t));
+        c->out_frame = _arena_alloc(&c->arena, CHTTPX_STREAM_FRAME);
+        if (!c->out_stream || !c->out_frame)
+        {
+            c->out_stream = NULL;
+            _res_release(&res);
+            return STEP_ERROR;
+        }
+
+        *c->out_stream = res;
+    }
+
+    char* out_head = _arena_alloc(&c->arena, head_len);
+    c->out_parts = _arena_alloc(&c->arena, CHTTPX_RES_PARTS * sizeof(chttpx_send_part_t));
+    if (!out_head || !c->out_parts)
+        return STEP_ERROR;
+
+    memcpy(out_head, head, head_len);
+    c->out_parts_count = _res_parts(&res, out_head, head_len, c->out_parts);
+    c->out_off = 0;
+
+    /* The head leaves with the first chunk */
+    if (c->out_stream && conn_next_chunk(c) < 0)
+        return STEP_ERROR;
+
+    conn_set_state(loop, c, CONN_WRITING);
+    return conn_flush(loop, c);
+}
+
+/* Drop the answered REQuest, keeping pipelined bytes that follow it */
+static void conn_next_request(evloop_t* loop, conn_t* c)
+{
+    c->out_parts = NULL;
+    c->out_parts_count = c->out_off = 0;
+    conn_drop_file(c);
+    _arena_reset(&c->arena);
+
+    c->in_len -= c->req_len;
+    memmove(c->in, c->in + c->req_len, c->in_len);
+    c->req_len = c->scanned = 0;
+
+    /* Release the buffer of idle connections */
+    if (c->in_len == 0)
+    {
+        free(c->in);
+        c->in = NULL;
+        c->in_cap = 0;
+    }
+    /* Shrink a buffer grown for a large body back to the head size */
+    else if (c->in_cap > BUFFER_SIZE && c->in_len < BUFFER_SIZE)
+    {
+        char* in = realloc(c->in, BUFFER_SIZE);
+        if (in)
+        {
+            c->in = in;
+            c->in_cap = BUFFER_SIZE;
+        }
+    }
+
+    conn_set_state(loop, c, c->in_len ? CONN_READING : CONN_IDLE);
+}
+
+/* Check whether the receive buffer holds a complete REQuest */
+static step_t conn_try_request(evloop_t* loop, conn_t* c)
+{
+    if (!c->req_len)
+    {
+        const char* end = memmem(c->in + c->scanned, c->in_len - c->scanned, "\r\n\r\n", 4);
+        if (!end)
+        {
+            /* Head larger than BUFFER_SIZE, even in a buffer kept large for pipelined bytes */
+            if (c->in_len >= BUFFER_SIZE - 1)
+                return STEP_ERROR;
+
+            c->scanned = c->in_len > 3 ? c->in_len - 3 : 0;
+            return STEP_AGAIN;
+        }
+
+        size_t head_len = (size_t)(end - c->in) + 4;
+        size_t content_length;
+        int chunked = _req_head_chunked(c->in, head_len);
+        if (chunked < 0 || _req_head_content_length(c->in, head_len, &content_length) != 0)
+        {
+            _req_head_reject(c->fd);
+            return STEP_ERROR;
+        }
+
+        /* Bodies the loop cannot buffer (too large, or framed by chunks) are read blocking */
+        if (content_length > MAX_BODY_IN_MEMORY || chunked)
+            return conn_handoff(loop, c);
+
+        c->req_len = head_len + content_length;
+
+        if (c->req_len + 1 > c->in_cap)
+        {
+            char* in = realloc(c->in, c->req_len + 1);
+            if (!in)
+                return STEP_ERROR;
+
+            c->in = in;
+            c->in_cap = c->req_len + 1;
+        }
+    }
+
+    if (c->in_len < c->req_len)
+        return STEP_AGAIN;
+
+    return conn_dispatch(loop, c);
+}
+
+/* Drain the socket (edge-triggered) while the connection is reading */
+static step_t conn_on_readable(evloop_t* loop, conn_t* c)
+{
+    while (c->state != CONN_WRITING)
+    {
+        if (!c->in)
+        {
+            c->in = malloc(BUFFER_SIZE);
+            if (!c->in)
+                return STEP_ERROR;
+
+            c->in_cap = BUFFER_SIZE;
+        }
+
+        /* Head larger than the receive buffer */
+        size_t room = c->in_cap - 1 - c->in_len;
+        if (room == 0)
+            return STEP_ERROR;
+
+        ssize_t n = recv(c->fd, c->in + c->in_len, room, 0);
+        if (n == 0)
+            return STEP_ERROR;
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return STEP_AGAIN;
+
+            return STEP_ERROR;
+        }
+
+        c->in_len += (size_t)n;
+        c->in[c->in_len] = '\0';
+
+        if (c->state == CONN_IDLE)
+            conn_set_state(loop, c, CONN_READING);
+        else
+            conn_touch(loop, c);
+
+        step_t step = conn_try_request(loop, c);
+        if (step != STEP_AGAIN)
+            return step;
+    }
+
+    return STEP_AGAIN;
+}
+
+static void evloop_on_event(evloop_t* loop, conn_t* c, uint32_t events)
+{
+    step_t step = STEP_AGAIN;
+
+    if (events & (EPOLLERR | EPOLLHUP))
+        step = STEP_ERROR;
+    else if (c->state == CONN_WRITING && (events & EPOLLOUT))
+        step = conn_flush(loop, c);
+    else if (c->state != CONN_WRITING && (events & (EPOLLIN | EPOLLRDHUP)))
+        step = conn_on_readable(loop, c);
+
+    /* Keep-alive: answer pipelined REQuests, then read until the socket blocks */
+    while (step == STEP_DONE && c->keep_alive)
+    {
+        conn_next_request(loop, c);
+
+        step = c->in_len ? conn_try_request(loop, c) : STEP_AGAIN;
+        if (step == STEP_AGAIN)
+            step = conn_on_readable(loop, c);
+    }
+
+    if (step == STEP_DONE || step == STEP_ERROR)
+        conn_close(loop, c);
+}
+
+/* Start serving an admitted connection */
+static void evloop_add_conn(evloop_t* loop, chttpx_socket_t fd)
+{
+    conn_t* c = calloc(1, sizeof(conn_t));
+    if (!c)
+    {
+        perror("calloc failed");
+        chttpx_close(fd);
+
+        _admission_release();
+        return;
+    }
+
+    c->fd = fd;
+    c->out_file = -1;
+    c->state = CONN_READING;
+    c->last_active = loop->now;
+    list_push(&loop->lists[CONN_READING], c);
+
+    /* Both directions edge-triggered, EPOLLOUT is only acted upon while writing */
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = c;
+
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        conn_close(loop, c);
+}
+
+/* CHTTPX_OVERLOAD_SHED_IDLE: close the oldest idle connection of the loop, 0 if there is none */
+static int evloop_shed_idle(evloop_t* loop)
+{
+    if (serv->overload != CHTTPX_OVERLOAD_SHED_IDLE || !loop->lists[CONN_IDLE].head)
+        return 0;
+
+    conn_close(loop, loop->lists[CONN_IDLE].head);
+    _admission_note_shed();
+    return 1;
+}
+
+/* Stop watching the listening socket, new clients wait in the backlog */
+static void evloop_pause(evloop_t* loop)
+{
+    if (loop->paused)
+        return;
+
+    epoll_ctl(loop->epfd, EPOLL_CTL_DEL, loop->listen_fd, NULL);
+    __atomic_store_n(&loop->paused, 1, __ATOMIC_SEQ_CST);
+
+    chttpx_atomic_add(&evloops_paused, 1);
+    _admission_note_wait();
+
+    /* A slot may have been freed before the loop was marked paused */
+    if (chttpx_atomic_load(&serv->current_clients) < serv->max_clients)
+        _eventloop_wake_paused();
+}
+
+/* Watch the listening socket again once a slot is free */
+static void evloop_resume(evloop_t* loop)
+{
+    if (!loop->paused)
+        return;
+
+    if (loop->pending_fd >= 0)
+    {
+        if (!_admission_try_acquire() && !(evloop_shed_idle(loop) && _admission_try_acquire()))
+            return;
+
+        evloop_add_conn(loop, loop->pending_fd);
+        loop->pending_fd = -1;
+    }
+
+    if (chttpx_atomic_load(&serv->current_clients) >= serv->max_clients)
+        return;
+
+    /* EPOLLEXCLUSIVE cannot be modified, the socket is added again */
+    struct epoll_event ev = {0};
+    ev.events = EVLOOP_LISTEN_EVENTS;
+    ev.data.ptr = NULL;
+
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->listen_fd, &ev) < 0)
+    {
+        perror("epoll_ctl listen");
+        return;
+    }
+
+    __atomic_store_n(&loop->paused, 0, __ATOMIC_SEQ_CST);
+    chttpx_atomic_sub(&evloops_paused, 1);
+}
+
+static void evloop_accept(evloop_t* loop)
+{
+    while (!loop->paused)
+    {
+        if (serv->overload == CHTTPX_OVERLOAD_QUEUE && chttpx_atomic_load(&serv->current_clients) >= serv->max_clients)
+        {
+            evloop_pause(loop);
+            return;
+        }
+
+        chttpx_socket_t fd = accept4(loop->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            return;
+        }
+
+        if (!_admission_try_acquire() && !(evloop_shed_idle(loop) && _admission_try_acquire()))
+        {
+            if (serv->overload == CHTTPX_OVERLOAD_REJECT)
+            {
+                _admission_reject(fd);
+                continue;
+            }
+
+            /* Hold the connection until a slot frees */
+            loop->pending_fd = fd;
+            evloop_pause(loop);
+            return;
+        }
+
+        evloop_add_conn(loop, fd);
+    }
+}
+
+/* eventfd wake-up: a slot was freed while the loop was paused */
+static void evloop_on_wake(evloop_t* loop)
+{
+    uint64_t value;
+    while (read(loop->wake_fd, &value, sizeof(value)) > 0)
+        ;
+
+    evloop_resume(loop);
+    evloop_accept(loop);
+}
+
+void _eventloop_wake_paused(void)
+{
+    if (chttpx_atomic_load(&evloops_paused) == 0)
+        return;
+
+    uint64_t one = 1;
+    for (size_t i = 0; i < evloops_count; i++)
+    {
+        if (__atomic_load_n(&evloops[i].paused, __ATOMIC_RELAXED))
+        {
+            ssize_t n = write(evloops[i].wake_fd, &one, sizeof(one));
+            (void)n;
+        }
+    }
+}
+
+/* Close connections idle for longer than the timeout of their state */
+static void evloop_sweep(evloop_t* loop)
+{
+    const time_t timeouts[CONN_STATES] = {serv->read_timeout_sec, serv->write_timeout_sec, serv->idle_timeout_sec};
+
+    for (int s = 0; s < CONN_STATES; s++)
+    {
+        if (timeouts[s] == 0)
+            continue;
+
+        conn_list_t* list = &loop->lists[s];
+        while (list->head && loop->now - list->head->last_active >= timeouts[s])
+            conn_close(loop, list->head);
+    }
+}
+
+static void* evloop_thread(void* arg)
+{
+    evloop_t* loop = (evloop_t*)arg;
+    struct epoll_event events[EVLOOP_MAX_EVENTS];
+
+    _serv_pin_cpu(loop->index);
+
+    loop->now = monotonic_sec();
+    time_t last_sweep = loop->now;
+
+    while (serv)
+    {
+        int n = epoll_wait(loop->epfd, events, EVLOOP_MAX_EVENTS, EVLOOP_TICK_MS);
+        if (n < 0 && errno != EINTR)
+        {
+            perror("epoll_wait");
+            break;
+        }
+
+        /* cHTTPX_Shutdown while waiting */
+        if (!serv)
+            break;
+
+        loop->now = monotonic_sec();
+
+        for (int i = 0; i < n; i++)
+        {
+            void* ptr = events[i].data.ptr;
+
+            if (!ptr)
+                evloop_accept(loop);
+            else if (ptr == &loop->wake_fd)
+                evloop_on_wake(loop);
+            else
+                evloop_on_event(loop, (conn_t*)ptr, events[i].events);
+        }
+
+        if (loop->now != last_sweep)
+        {
+            evloop_sweep(loop);
+            last_sweep = loop->now;
+
+            /* Safety net for a missed wake-up */
+            if (loop->paused)
+            {
+                evloop_resume(loop);
+                evloop_accept(loop);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Run the epoll reactor on the server listening socket (CHTTPX_MODE_EPOLL).
+ *
+ * Starts serv->loop_threads event loops (one per CPU by default), each with
+ * its own epoll instance sharing the listening socket (or with its own
+ * SO_REUSEPORT listener when serv->reuseport is set). Connections are read,
+ * parsed and answered as non-blocking state machines; requests whose body
+ * does not fit in memory are handed off to a blocking thread.
+ * This function blocks indefinitely.
+ */
+void _eventloop_run(void)
+{
+    size_t count = serv->loop_threads;
+    if (count == 0)
+        count = _cpu_count();
+
+    evloop_t* loops = calloc(count, sizeof(evloop_t));
+    if (!loops)
+    {
+        perror("calloc loops");
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        /* SO_REUSEPORT gives every loop its own accept queue */
+        chttpx_socket_t listen_fd = (chttpx_socket_t)serv->server_fd;
+        if (serv->reuseport && i > 0)
+        {
+            listen_fd = _serv_listen_socket();
+            if (listen_fd == CHTTPX_INVALID_SOCKET)
+                exit(1);
+        }
+
+        int flags = fcntl(listen_fd, F_GETFL, 0);
+        fcntl(listen_fd, F_SETFL, flags | O_NONBLOCK);
+
+        loops[i].listen_fd = listen_fd;
+        loops[i].index = i;
+        loops[i].pending_fd = -1;
+        loops[i].epfd = epoll_create1(EPOLL_CLOEXEC);
+        loops[i].wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loops[i].epfd < 0 || loops[i].wake_fd < 0)
+        {
+            perror("epoll_create1");
+            exit(1);
+        }
+
+        struct epoll_event wake = {0};
+        wake.events = EPOLLIN;
+        wake.data.ptr = &loops[i].wake_fd;
+
+        if (epoll_ctl(loops[i].epfd, EPOLL_CTL_ADD, loops[i].wake_fd, &wake) < 0)
+        {
+            perror("epoll_ctl eventfd");
+            exit(1);
+        }
+
+        /* Listening socket stays level-triggered, data.ptr == NULL marks it */
+        struct epoll_event ev = {0};
+        ev.events = EVLOOP_LISTEN_EVENTS;
+        ev.data.ptr = NULL;
+
+        if (epoll_ctl(loops[i].epfd, EPOLL_CTL_ADD, listen_fd, &ev) < 0)
+        {
+            perror("epoll_ctl listen");
+            exit(1);
+        }
+    }
+
+    evloops = loops;
+    evloops_count = count;
+
+    for (size_t i = 1; i < count; i++)
+    {
+        thread_t thread_id;
+        if (_thread_create(&thread_id, evloop_thread, &loops[i]) != 0)
+        {
+            perror("pthread_create");
+            exit(1);
+        }
+
+        pthread_detach(thread_id);
+    }
+
+    evloop_thread(&loops[0]);
+}
+
+#else
+
+void _eventloop_run(void)
+{
+    fprintf(stderr, "Error: epoll mode is not supported on this platform\n");
+}
+
+void _eventloop_wake_paused(void)
+{
+}
+
+#endif
@@ -0,0 +1,360 @@
+#define _GNU_SOURCE
+
+/*
+ * Copyright (c) 2026 netcorelink
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "hash.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define HASH_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+/* Bytes per stripe: eight 64-bit lanes */
+#define HASH_STRIPE 64
+/* Stripes between two scrambles of the accumulators */
+#define HASH_BLOCK_STRIPES 16
+
+#define P32_1 0x9E3779B1ULL
+#define P32_2 0x85EBCA77ULL
+#define P32_3 0xC2B2AE3DULL
+#define P64_1 0x9E3779B185EBCA87ULL
+#define P64_2 0xC2B2AE3D27D4EB4FULL
+#define P64_3 0x165667B19E3779F9ULL
+#define P64_4 0x85EBCA77C2B2AE63ULL
+#define P64_5 0x27D4EB2F165667C5ULL
+
+/* Keys mixed into the lanes, then into the final merge */
+static const uint64_t hash_secret[8] = {
+    0xBE4BA423396CFEB8ULL, 0x1CAD21F72C81017CULL, 0xDB979083E96DD4DEULL, 0x1F67B3B7A4A44072ULL,
+    0x78E5C0CC4EE679CBULL, 0x2172FFCC7DD05A82ULL, 0x8E2443F7744608B8ULL, 0x4C263A81E69035E0ULL,
+};
+
+static const uint64_t hash_merge_secret[8] = {
+    0xCB00C391BB52283CULL, 0xA32E531B8B65D088ULL, 0x4EF90DA297486471ULL, 0xD8ACDEA946EF1938ULL,
+    0x3F349CE33F76FAA8ULL, 0x1D4F0BC7C7BBDCF9ULL, 0x3159B4CD4BE0518AULL, 0x647378D9C97E9FC8ULL,
+};
+
+static inline uint64_t read64(const unsigned char* p)
+{
+    return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 | (uint64_t)p[3] << 24 | (uint64_t)p[4] << 32 |
+           (uint64_t)p[5] << 40 | (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+static inline uint64_t read32(const unsigned char* p)
+{
+    return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 | (uint64_t)p[3] << 24;
+}
+
+/* 64x64 -> 128 multiply, folded */
+static inline uint64_t mum(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    uint64_t hi;
+    uint64_t lo = _umul128(a, b, &hi);
+    return lo ^ hi;
+#else
+    uint64_t a_lo = a & 0xFFFFFFFF, a_hi = a >> 32;
+    uint64_t b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+
+    uint64_t lo_lo = a_lo * b_lo;
+    uint64_t hi_lo = a_hi * b_lo;
+    uint64_t lo_hi = a_lo * b_hi;
+    uint64_t hi_hi = a_hi * b_hi;
+
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    uint64_t hi = hi_hi + (hi_lo >> 32) + (cross >> 32);
+    uint64_t lo = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+    return lo ^ hi;
+#endif
+}
+
+static inline uint64_t avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+/* Up to 16 bytes */
+static uint64_t hash_small(const unsigned char* p, size_t len)
+{
+    uint64_t a = 0, b = 0;
+
+    if (len >= 8)
+    {
+        a = read64(p);
+        b = read64(p + len - 8);
+    }
+    else if (len >= 4)
+    {
+        a = read32(p);
+        b = read32(p + len - 4);
+    }
+    else if (len > 0)
+    {
+        a = (uint64_t)p[0] << 16 | (uint64_t)p[len >> 1] << 8 | p[len - 1];
+    }
+
+    return avalanche(mum(a ^ hash_secret[0], b ^ hash_secret[1] ^ len) ^ (len * P64_1));
+}
+
+/* 17 to 128 bytes: a chain of 16-byte pieces, the last one ending at len */
+static uint64_t hash_medium(const unsigned char* p, size_t len)
+{
+    uint64_t h = len * P64_1;
+    size_t k = 0;
+
+    for (size_t i = 0; i + 16 < len; i += 16, k = (k + 2) & 7)
+        h = mum(read64(p + i) ^ hash_secret[k] ^ h, read64(p + i + 8) ^ hash_secret[k + 1]);
+
+    h = mum(read64(p + len - 16) ^ hash_merge_secret[0] ^ h, read64(p + len - 8) ^ hash_merge_secret[1]);
+
+    return avalanche(h);
+}
+
+/*
+ * Long inputs. Per 64-byte stripe, lane i (0..7) with d = word i of the stripe:
+ *   acc[i] += lo32(d ^ secret[i]) * hi32(d ^ secret[i]) + (word i^1 of the stripe)
+ * After every HASH_BLOCK_STRIPES stripes:
+ *   acc[i] = ((acc[i] ^ acc[i] >> 47) ^ secret[i]) * P32_1
+ * The lanes are independent, which is what the SSE2 / AVX2 versions exploit.
+ */
+typedef void (*hash_accumulate_fn)(uint64_t* acc, const unsigned char* p, size_t stripes, int scramble);
+
+static void accumulate_scalar(uint64_t* acc, const unsigned char* p, size_t stripes, int scramble)
+{
+    for (size_t s = 0; s < stripes; s++, p += HASH_STRIPE)
+    {
+        for (size_t i = 0; i < 8; i++)
+        {
+            uint64_t d = read64(p + 8 * i);
+            uint64_t dk = d ^ hash_secret[i];
+            acc[i] += (dk & 0xFFFFFFFF) * (dk >> 32) + read64(p + 8 * (i ^ 1));
+        }
+    }
+
+    if (scramble)
+    {
+        for (size_t i = 0; i < 8; i++)
+        {
+            uint64_t a = acc[i];
+            a ^= a >> 47;
+            a ^= hash_secret[i];
+            acc[i] = a * P32_1;
+        }
+    }
+}
+
+#ifdef HASH_X86
+static void accumulate_sse2(uint64_t* acc, const unsigned char* p, size_t stripes, int scramble)
+{
+    __m128i a[4];
+    __m128i key[4];
+    for (size_t j = 0; j < 4; j++)
+    {
+        a[j] = _mm_loadu_si128((const __m128i*)(acc + 2 * j));
+        key[j] = _mm_loadu_si128((const __m128i*)(hash_secret + 2 * j));
+    }
+
+    for (size_t s = 0; s < stripes; s++, p += HASH_STRIPE)
+    {
+        for (size_t j = 0; j < 4; j++)
+        {
+            __m128i d = _mm_loadu_si128((const __m128i*)(p + 16 * j));
+            __m128i dk = _mm_xor_si128(d, key[j]);
+            __m128i prod = _mm_mul_epu32(dk, _mm_srli_epi64(dk, 32));
+            __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+            a[j] = _mm_add_epi64(a[j], _mm_add_epi64(prod, swapped));
+        }
+    }
+
+    if (scramble)
+    {
+        const __m128i prime = _mm_set1_epi32((int)P32_1);
+        for (size_t j = 0; j < 4; j++)
+        {
+            __m128i x = _mm_xor_si128(a[j], _mm_srli_epi64(a[j], 47));
+            x = _mm_xor_si128(x, key[j]);
+            __m128i lo = _mm_mul_epu32(x, prime);
+            __m128i hi = _mm_mul_epu32(_mm_srli_epi64(x, 32), prime);
+            a[j] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+        }
+    }
+
+    for (size_t j = 0; j < 4; j++)
+        _mm_storeu_si128((__m128i*)(acc + 2 * j), a[j]);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define HASH_AVX2
+
+__attribute__((target("avx2"))) static void accumulate_avx2(uint64_t* acc, const unsigned char* p, size_t stripes, int scramble)
+{
+    __m256i a[2];
+    __m256i key[2];
+    for (size_t j = 0; j < 2; j++)
+    {
+        a[j] = _mm256_loadu_si256((const __m256i*)(acc + 4 * j));
+        key[j] = _mm256_loadu_si256((const __m256i*)(hash_secret + 4 * j));
+    }
+
+    for (size_t s = 0; s < stripes; s++, p += HASH_STRIPE)
+    {
+        for (size_t j = 0; j < 2; j++)
+        {
+            __m256i d = _mm256_loadu_si256((const __m256i*)(p + 32 * j));
+            __m256i dk = _mm256_xor_si256(d, key[j]);
+            __m256i prod = _mm256_mul_epu32(dk, _mm256_srli_epi64(dk, 32));
+            __m256i swapped = _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+            a[j] = _mm256_add_epi64(a[j], _mm256_add_epi64(prod, swapped));
+        }
+    }
+
+    if (scramble)
+    {
+        const __m256i prime = _mm256_set1_epi32((int)P32_1);
+        for (size_t j = 0; j < 2; j++)
+        {
+            __m256i x = _mm256_xor_si256(a[j], _mm256_srli_epi64(a[j], 47));
+            x = _mm256_xor_si256(x, key[j]);
+            __m256i lo = _mm256_mul_epu32(x, prime);
+            __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), prime);
+            a[j] = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+        }
+    }
+
+    for (size_t j = 0; j < 2; j++)
+        _mm256_storeu_si256((__m256i*)(acc + 4 * j), a[j]);
+}
+#endif
+#endif
+
+static hash_accumulate_fn hash_accumulate = NULL;
+static const char* hash_impl = "scalar";
+
+int _hash64_select(const char* impl)
+{
+    if (!impl)
+    {
+        hash_accumulate = accumulate_scalar;
+        hash_impl = "scalar";
+#ifdef HASH_X86
+        hash_accumulate = accumulate_sse2;
+        hash_impl = "sse2";
+#ifdef HASH_AVX2
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            hash_accumulate = accumulate_avx2;
+            hash_impl = "avx2";
+        }
+#endif
+#endif
+        return 0;
+    }
+
+    if (strcmp(impl, "scalar") == 0)
+    {
+        hash_accumulate = accumulate_scalar;
+        hash_impl = "scalar";
+        return 0;
+    }
+
+#ifdef HASH_X86
+    if (strcmp(impl, "sse2") == 0)
+    {
+        hash_accumulate = accumulate_sse2;
+        hash_impl = "sse2";
+        return 0;
+    }
+
+#ifdef HASH_AVX2
+    __builtin_cpu_init();
+    if (strcmp(impl, "avx2") == 0 && __builtin_cpu_supports("avx2"))
+    {
+        hash_accumulate = accumulate_avx2;
+        hash_impl = "avx2";
+        return 0;
+    }
+#endif
+#endif
+
+    return -1;
+}
+
+const char* _hash64_impl(void)
+{
+    if (!hash_accumulate)
+        _hash64_select(NULL);
+
+    return hash_impl;
+}
+
+static uint64_t hash_long(const unsigned char* p, size_t len)
+{
+    uint64_t acc[8] = {P32_3, P64_1, P64_2, P64_3, P64_4, P32_2, P64_5, P32_1};
+
+    /* The last stripe, always processed, ends at len */
+    size_t stripes = (len - 1) / HASH_STRIPE;
+    size_t blocks = stripes / HASH_BLOCK_STRIPES;
+
+    for (size_t b = 0; b < blocks; b++)
+        hash_accumulate(acc, p + b * HASH_BLOCK_STRIPES * HASH_STRIPE, HASH_BLOCK_STRIPES, 1);
+
+    hash_accumulate(acc, p + blocks * HASH_BLOCK_STRIPES * HASH_STRIPE, stripes - blocks * HASH_BLOCK_STRIPES, 0);
+    hash_accumulate(acc, p + len - HASH_STRIPE, 1, 0);
+
+    uint64_t h = len * P64_1;
+    for (size_t i = 0; i < 8; i += 2)
+        h += mum(acc[i] ^ hash_merge_secret[i], acc[i + 1] ^ hash_merge_secret[i + 1]);
+
+    return avalanche(h);
+}
+
+uint64_t cHTTPX_Hash64(const void* data, size_t len)
+{
+    const unsigned char* p = (const unsigned char*)data;
+
+    if (len <= 16)
+        return hash_small(p, len);
+
+    if (len <= 128)
+        return hash_medium(p, len);
+
+    /* Racing first calls all store the same choice */
+    if (!hash_accumulate)
+        _hash64_select(NULL);
+
+    return hash_long(p, len);
+}
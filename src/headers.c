@@ -35,9 +35,11 @@ const char* cHTTPX_HeaderGet(chttpx_request_t* req, const char* name)
     if (!req || req->headers_count == 0 || !name)
         return NULL;
 
+    size_t name_len = strlen(name);
+
     for (size_t i = 0; i < req->headers_count; i++)
     {
-        if (strcasecmp(req->headers[i].name, name) == 0)
+        if (req->headers[i].name_len == name_len && strncasecmp(req->headers[i].name, name, name_len) == 0)
         {
             return req->headers[i].value;
         }
@@ -46,6 +48,72 @@ const char* cHTTPX_HeaderGet(chttpx_request_t* req, const char* name)
     return NULL;
 }
 
+/* Move every RESponse header to the REQuest arena, where they no longer have a limit */
+static int res_headers_spill(chttpx_response_t* res)
+{
+    chttpx_arena_t* arena = _res_arena();
+    if (!arena)
+        return -1;
+
+    size_t cap = 2 * MAX_RES_HEADERS;
+    chttpx_header_view_t* spilled = _arena_alloc(arena, cap * sizeof(chttpx_header_view_t));
+    if (!spilled)
+        return -1;
+
+    /* The pool is inside the RESponse, copied with it: the strings go too */
+    for (size_t i = 0; i < res->headers_count; i++)
+    {
+        const chttpx_res_header_t* h = &res->headers[i];
+        chttpx_header_view_t* v = &spilled[i];
+
+        v->name = _arena_strndup(arena, res->headers_pool + h->name, h->name_len);
+        v->name_len = h->name_len;
+        v->value = _arena_strndup(arena, res->headers_pool + h->value, h->value_len);
+        v->value_len = h->value_len;
+        if (!v->name || !v->value)
+            return -1;
+    }
+
+    res->headers_spilled = spilled;
+    res->headers_spilled_cap = cap;
+    res->headers_pool_used = 0;
+
+    return 0;
+}
+
+/* Copy the live names and values to the start of the pool, dropping values replaced by cHTTPX_ResHeaderSet */
+static void res_headers_compact(chttpx_response_t* res)
+{
+    char pool[RES_HEADERS_POOL];
+    size_t used = 0;
+
+    for (size_t i = 0; i < res->headers_count; i++)
+    {
+        chttpx_res_header_t* h = &res->headers[i];
+
+        memcpy(pool + used, res->headers_pool + h->name, h->name_len + 1);
+        h->name = (uint16_t)used;
+        used += h->name_len + 1;
+
+        memcpy(pool + used, res->headers_pool + h->value, h->value_len + 1);
+        h->value = (uint16_t)used;
+        used += h->value_len + 1;
+    }
+
+    memcpy(res->headers_pool, pool, used);
+    res->headers_pool_used = used;
+}
+
+/* Room for len more bytes in the pool, compacting it first if needed */
+static int res_headers_room(chttpx_response_t* res, size_t len)
+{
+    if (res->headers_pool_used + len <= RES_HEADERS_POOL)
+        return 1;
+
+    res_headers_compact(res);
+    return res->headers_pool_used + len <= RES_HEADERS_POOL;
+}
+
 /**
  * Add a new HTTP header.
  *
@@ -56,6 +124,8 @@ const char* cHTTPX_HeaderGet(chttpx_request_t* req, const char* name)
  * @param req   Pointer to HTTP request/response structure.
  * @param name  Header name.
  * @param value Header value.
+ * @return 0 on success, -1 past MAX_HEADERS headers, or past MAX_RES_HEADERS /
+ *         RES_HEADERS_POOL bytes outside a handler (no REQuest arena to spill into).
  */
 int cHTTPX_HeaderAdd(chttpx_response_t* res, const char* name, const char* value)
 {
@@ -65,19 +135,206 @@ int cHTTPX_HeaderAdd(chttpx_response_t* res, const char* name, const char* value
     if (res->headers_count >= MAX_HEADERS)
         return -1;
 
-    chttpx_header_t* h = &res->headers[res->headers_count];
+    size_t name_len = strlen(name);
+    size_t value_len = strlen(value);
+
+    /* Past the inline table or pool, every header moves to the arena, in order */
+    if (!res->headers_spilled && (res->headers_count >= MAX_RES_HEADERS || !res_headers_room(res, name_len + value_len + 2)) &&
+        res_headers_spill(res) != 0)
+        return -1;
+
+    if (res->headers_spilled)
+    {
+        chttpx_arena_t* arena = _res_arena();
+        if (!arena)
+            return -1;
+
+        if (res->headers_count == res->headers_spilled_cap)
+        {
+            chttpx_header_view_t* grown =
+                _arena_grow(arena, res->headers_spilled, res->headers_count, &res->headers_spilled_cap, sizeof(chttpx_header_view_t));
+            if (!grown)
+                return -1;
 
-    strncpy(h->name, name, MAX_HEADER_NAME - 1);
-    h->name[MAX_HEADER_NAME - 1] = '\0';
+            res->headers_spilled = grown;
+        }
+
+        chttpx_header_view_t* v = &res->headers_spilled[res->headers_count];
+        v->name = _arena_strndup(arena, name, name_len);
+        v->name_len = name_len;
+        v->value = _arena_strndup(arena, value, value_len);
+        v->value_len = value_len;
+        if (!v->name || !v->value)
+            return -1;
+
+        res->headers_count++;
+        return 0;
+    }
 
-    strncpy(h->value, value, MAX_HEADER_VALUE - 1);
-    h->value[MAX_HEADER_VALUE - 1] = '\0';
+    chttpx_res_header_t* h = &res->headers[res->headers_count];
+    char* pool = res->headers_pool + res->headers_pool_used;
 
+    memcpy(pool, name, name_len + 1);
+    memcpy(pool + name_len + 1, value, value_len + 1);
+
+    h->name = (uint16_t)res->headers_pool_used;
+    h->name_len = (uint16_t)name_len;
+    h->value = (uint16_t)(res->headers_pool_used + name_len + 1);
+    h->value_len = (uint16_t)value_len;
+
+    res->headers_pool_used += name_len + value_len + 2;
     res->headers_count++;
 
     return 0;
 }
 
+/* Remove the header added last by cHTTPX_HeaderAdd, its bytes end the pool */
+void _res_header_pop(chttpx_response_t* res)
+{
+    if (res->headers_count == 0)
+        return;
+
+    res->headers_count--;
+    if (!res->headers_spilled)
+        res->headers_pool_used = res->headers[res->headers_count].name;
+}
+
+void _res_header_at(const chttpx_response_t* res, size_t i, const char** name, const char** value)
+{
+    if (res->headers_spilled)
+    {
+        *name = res->headers_spilled[i].name;
+        *value = res->headers_spilled[i].value;
+        return;
+    }
+
+    *name = res->headers_pool + res->headers[i].name;
+    *value = res->headers_pool + res->headers[i].value;
+}
+
+/* Index of the first RESponse header with this name, -1 if none */
+static long res_header_find(const chttpx_response_t* res, const char* name, size_t name_len)
+{
+    for (size_t i = 0; i < res->headers_count; i++)
+    {
+        const char* h_name;
+        size_t h_name_len;
+
+        if (res->headers_spilled)
+        {
+            h_name = res->headers_spilled[i].name;
+            h_name_len = res->headers_spilled[i].name_len;
+        }
+        else
+        {
+            h_name = res->headers_pool + res->headers[i].name;
+            h_name_len = res->headers[i].name_len;
+        }
+
+        if (h_name_len == name_len && strncasecmp(h_name, name, name_len) == 0)
+            return (long)i;
+    }
+
+    return -1;
+}
+
+/**
+ * Get a response header by name.
+ * @param res Pointer to the HTTP response.
+ * @param name Header name (case-insensitive).
+ * @return Pointer to the first header value if found, otherwise NULL.
+ */
+const char* cHTTPX_ResHeaderGet(const chttpx_response_t* res, const char* name)
+{
+    if (!res || !name)
+        return NULL;
+
+    long i = res_header_find(res, name, strlen(name));
+    if (i < 0)
+        return NULL;
+
+    const char* h_name;
+    const char* value;
+    _res_header_at(res, (size_t)i, &h_name, &value);
+
+    return value;
+}
+
+int cHTTPX_ResHeaderSet(chttpx_response_t* res, const char* name, const char* value)
+{
+    if (!res || !name || !value)
+        return -1;
+
+    long i = res_header_find(res, name, strlen(name));
+    if (i < 0)
+        return cHTTPX_HeaderAdd(res, name, value);
+
+    size_t value_len = strlen(value);
+
+    if (res->headers_spilled)
+    {
+        chttpx_header_view_t* v = &res->headers_spilled[i];
+
+        /* The spilled value is a copy of its own, a shorter one replaces it in place */
+        if (value_len > v->value_len)
+        {
+            chttpx_arena_t* arena = _res_arena();
+            const char* copy = arena ? _arena_strndup(arena, value, value_len) : NULL;
+            if (!copy)
+                return -1;
+
+            v->value = copy;
+        }
+        else
+        {
+            memcpy((char*)v->value, value, value_len + 1);
+        }
+
+        v->value_len = value_len;
+        return 0;
+    }
+
+    chttpx_res_header_t* h = &res->headers[i];
+
+    /* A longer value is appended, the old one is dropped by the next compaction */
+    if (value_len > h->value_len)
+    {
+        if (!res_headers_room(res, value_len + 1))
+        {
+            if (res_headers_spill(res) != 0)
+                return -1;
+
+            return cHTTPX_ResHeaderSet(res, name, value);
+        }
+
+        h->value = (uint16_t)res->headers_pool_used;
+        res->headers_pool_used += value_len + 1;
+    }
+
+    memcpy(res->headers_pool + h->value, value, value_len + 1);
+    h->value_len = (uint16_t)value_len;
+
+    return 0;
+}
+
+/* Next free REQuest header slot, growing into the arena, NULL when full */
+static chttpx_header_view_t* req_header_slot(chttpx_request_t* req)
+{
+    if (req->headers_count >= MAX_HEADERS)
+        return NULL;
+
+    if (req->headers_count == req->headers_cap)
+    {
+        chttpx_header_view_t* grown = _arena_grow(req->arena, req->headers, req->headers_count, &req->headers_cap, sizeof(chttpx_header_view_t));
+        if (!grown)
+            return NULL;
+
+        req->headers = grown;
+    }
+
+    return &req->headers[req->headers_count++];
+}
+
 /**
  * Set or add a request header.
  * If header exists (case-insensitive), its value will be replaced.
@@ -93,26 +350,43 @@ int cHTTPX_HeaderSet(chttpx_request_t* req, const char* name, const char* value)
     if (!req || !name || !value)
         return -1;
 
+    size_t name_len = strlen(name);
+    size_t value_len = strlen(value);
+
+    chttpx_header_view_t* h = NULL;
+
     for (size_t i = 0; i < req->headers_count; i++)
     {
-        if (strcasecmp(req->headers[i].name, name) == 0)
+        if (req->headers[i].name_len == name_len && strncasecmp(req->headers[i].name, name, name_len) == 0)
         {
-            strncpy(req->headers[i].value, value, MAX_HEADER_VALUE - 1);
-            req->headers[i].value[MAX_HEADER_VALUE - 1] = '\0';
-            return 0;
+            h = &req->headers[i];
+            break;
         }
     }
 
-    if (req->headers_count >= MAX_HEADERS)
-        return -1;
-
-    strncpy(req->headers[req->headers_count].name, name, MAX_HEADER_NAME - 1);
-    req->headers[req->headers_count].name[MAX_HEADER_NAME - 1] = '\0';
+    if (!h)
+    {
+        const char* name_copy = _arena_strndup(req->arena, name, name_len);
+        if (!name_copy)
+            return -1;
+
+        h = req_header_slot(req);
+        if (!h)
+            return -1;
+
+        h->name = name_copy;
+        h->name_len = name_len;
+        h->value = "";
+        h->value_len = 0;
+    }
 
-    strncpy(req->headers[req->headers_count].value, value, MAX_HEADER_VALUE - 1);
-    req->headers[req->headers_count].value[MAX_HEADER_VALUE - 1] = '\0';
+    /* The parsed value is a view into the receive buffer, never written to */
+    const char* value_copy = _arena_strndup(req->arena, value, value_len);
+    if (!value_copy)
+        return -1;
 
-    req->headers_count++;
+    h->value = value_copy;
+    h->value_len = value_len;
 
     return 0;
 }
@@ -135,76 +409,72 @@ const char* cHTTPX_ClientIP(chttpx_request_t* req)
     return ip;
 }
 
-static void add_header(chttpx_request_t* req, const char* name, const char* value)
+/* Next header field of a REQuest head, shared by the parser and the body framing */
+int _req_head_field(const char** cursor, const char* end, chttpx_header_view_t* field)
 {
-    if (req->headers_count >= MAX_HEADERS)
-        return;
+    const char* line_start = *cursor;
 
-    chttpx_header_t* h = &req->headers[req->headers_count++];
+    const char* newline = memchr(line_start, '\n', (size_t)(end - line_start));
+    if (!newline)
+        return 0;
 
-    size_t len_name = strlen(name);
-    if (len_name >= MAX_HEADER_NAME)
-        len_name = MAX_HEADER_NAME - 1;
-    memcpy(h->name, name, len_name);
-    h->name[len_name] = '\0';
+    size_t line_len = (size_t)(newline - line_start);
+    if (line_len > 0 && line_start[line_len - 1] == '\r')
+        line_len--;
 
-    size_t len_value = strlen(value);
-    if (len_value >= MAX_HEADER_VALUE)
-        len_value = MAX_HEADER_VALUE - 1;
-    memcpy(h->value, value, len_value);
-    h->value[len_value] = '\0';
-}
+    /* End of the head, the body follows */
+    if (line_len == 0)
+        return 0;
 
-/* Parse headers in request */
-void _parse_req_headers(chttpx_request_t* req, char* buffer, size_t buffer_len)
-{
-    char* line_start = buffer;
-    char* buffer_end = buffer + buffer_len;
+    *cursor = newline + 1;
 
-    /* Meta data - continue one line */
-    char* newline = memchr(line_start, '\n', buffer_end - line_start);
-    if (!newline)
-        return;
-    line_start = newline + 1;
+    /* No name, or whitespace before the colon: another parser could read another name */
+    const char* colon = memchr(line_start, ':', line_len);
+    if (!colon || colon == line_start || colon[-1] == ' ' || colon[-1] == '\t')
+        return -1;
 
-    while (line_start < buffer_end)
-    {
-        newline = memchr(line_start, '\n', buffer_end - line_start);
-        if (!newline)
-            break;
+    const char* value_start = colon + 1;
+    const char* value_end = line_start + line_len;
 
-        size_t line_len = newline - line_start;
-        if (line_len > 0 && line_start[line_len - 1] == '\r')
-            line_len--;
+    while (value_start < value_end && (*value_start == ' ' || *value_start == '\t'))
+        value_start++;
+    while (value_end > value_start && (value_end[-1] == ' ' || value_end[-1] == '\t'))
+        value_end--;
 
-        char* colon = memchr(line_start, ':', line_len);
-        if (colon)
-        {
-            size_t name_len = colon - line_start;
-            size_t value_len = line_len - name_len - 1;
+    field->name = line_start;
+    field->name_len = (size_t)(colon - line_start);
+    field->value = value_start;
+    field->value_len = (size_t)(value_end - value_start);
 
-            char* value_start = colon + 1;
-            while (value_len > 0 && *value_start == ' ')
-            {
-                value_start++;
-                value_len--;
-            }
+    return 1;
+}
 
-            char name_buf[MAX_HEADER_NAME];
-            char value_buf[MAX_HEADER_VALUE];
+/* Parse headers in request: views into the buffer, NUL-terminated in place */
+void _parse_req_headers(chttpx_request_t* req, char* buffer, size_t buffer_len)
+{
+    const char* buffer_end = buffer + buffer_len;
 
-            size_t copy_name = name_len < MAX_HEADER_NAME - 1 ? name_len : MAX_HEADER_NAME - 1;
-            size_t copy_value = value_len < MAX_HEADER_VALUE - 1 ? value_len : MAX_HEADER_VALUE - 1;
+    /* Meta data - continue one line */
+    const char* cursor = memchr(buffer, '\n', buffer_len);
+    if (!cursor)
+        return;
+    cursor++;
 
-            memcpy(name_buf, line_start, copy_name);
-            name_buf[copy_name] = '\0';
+    chttpx_header_view_t field;
+    int r;
 
-            memcpy(value_buf, value_start, copy_value);
-            value_buf[copy_value] = '\0';
+    /* Invalid lines are skipped, the body framing answers 400 to them */
+    while ((r = _req_head_field(&cursor, buffer_end, &field)) != 0)
+    {
+        if (r < 0)
+            continue;
 
-            add_header(req, name_buf, value_buf);
-        }
+        chttpx_header_view_t* h = req_header_slot(req);
+        if (!h)
+            break;
 
-        line_start = newline + 1;
+        *h = field;
+        ((char*)field.name)[field.name_len] = '\0';
+        ((char*)field.value)[field.value_len] = '\0';
     }
 }
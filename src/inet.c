@@ -30,8 +30,8 @@
  * This function retrieves the real network-level IP address of the client
  * using the TCP socket (`getpeername`). It supports both IPv4 and IPv6.
  *
- * The returned value is a pointer to a static buffer, so it will be
- * overwritten on subsequent calls and is NOT thread-safe.
+ * The returned value is a pointer to a thread-local buffer, so it will be
+ * overwritten on subsequent calls from the same thread.
  *
  * This IP cannot be spoofed by HTTP headers, but if the server is behind
  * a reverse proxy (Nginx, CDN, load balancer), the returned address will
@@ -43,7 +43,7 @@
  */
 const char* cHTTPX_ClientInetIP(chttpx_socket_t client_fd)
 {
-    static char ip[INET6_ADDRSTRLEN];
+    static __thread char ip[INET6_ADDRSTRLEN];
     struct sockaddr_storage addr;
     socklen_t len = sizeof(addr);
 
@@ -0,0 +1,1630 @@
+#define _GNU_SOURCE
+
+/*
+ * Copyright (c) 2026 netcorelink
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "json.h"
+#include "i18n.h"
+#include "serv.h"
+#include "body.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define JSON_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* Buckets of the first level of the schema hash: one per 4 slots */
+#define JSON_SCHEMA_BUCKETS (JSON_SCHEMA_SLOTS / 4)
+/* Longest escaped key unescaped for a lookup, longer ones match no field */
+#define JSON_KEY_MAX 256
+
+/* Why decoding stopped */
+enum
+{
+    JSON_OK,
+    JSON_ERR_SYNTAX,
+    JSON_ERR_MEMORY,
+    JSON_ERR_FIELD
+};
+
+/*
+ * Perfect hash of the field names (hash and displace): a key's bucket gives the
+ * displacement that sends it to a slot of its own, so a lookup is one hash,
+ * two table reads and one name comparison.
+ */
+typedef struct
+{
+    uint32_t mask;
+    uint32_t bucket_mask;
+    uint8_t disp[JSON_SCHEMA_BUCKETS];
+    /* Field index + 1, 0 for an empty slot */
+    uint8_t slot[JSON_SCHEMA_SLOTS];
+    size_t name_len[CHTTPX_JSON_FIELDS_MAX];
+} json_schema_t;
+
+typedef struct
+{
+    const unsigned char* p;
+    const unsigned char* end;
+    /* Structural index of a large body (see _json_index): next mark and end of the marks */
+    const unsigned char* base;
+    const uint32_t* idx;
+    const uint32_t* idx_end;
+    chttpx_request_t* req;
+    chttpx_validation_t* fields;
+    unsigned flags;
+    int lang;
+    int depth;
+    int error;
+    /* Fields whose target holds a string or array allocated here */
+    uint8_t owned[CHTTPX_JSON_FIELDS_MAX];
+} json_reader_t;
+
+/*
+ * Hash tables found for the schemas a thread decodes, keyed by the addresses of
+ * the field names: these are usually literals, so a handler's schema maps to the
+ * same entry on every REQuest and only has its names placed again.
+ */
+typedef struct
+{
+    uint64_t key;
+    uint32_t mask;
+    uint32_t bucket_mask;
+    uint8_t disp[JSON_SCHEMA_BUCKETS];
+} json_schema_memo_t;
+
+static __thread json_schema_memo_t schema_memo[JSON_SCHEMA_MEMO];
+
+static inline unsigned char fold(unsigned char c)
+{
+    return (unsigned)(c - 'A') < 26 ? (unsigned char)(c + 32) : c;
+}
+
+/* Names are compared ASCII case-insensitively, as cJSON_GetObjectItem did */
+static uint64_t key_hash(const unsigned char* s, size_t len)
+{
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ fold(s[i])) * 0x100000001B3ULL;
+
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static int key_equal(const unsigned char* a, const unsigned char* b, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (fold(a[i]) != fold(b[i]))
+            return 0;
+    }
+
+    return 1;
+}
+
+static inline uint32_t slot_of(uint64_t h, uint8_t disp, uint32_t mask)
+{
+    uint32_t x = (uint32_t)(h >> 32) + disp * 0x9E3779B9u;
+    x ^= x >> 15;
+    x *= 0x2C1B3C6Du;
+    x ^= x >> 12;
+    return x & mask;
+}
+
+static int same_name(const json_schema_t* s, const chttpx_validation_t* fields, size_t a, size_t b)
+{
+    return s->name_len[a] == s->name_len[b] &&
+           key_equal((const unsigned char*)fields[a].name, (const unsigned char*)fields[b].name, s->name_len[a]);
+}
+
+/* Place every name with the displacements in s, 0 if two different names collide */
+static int schema_place(json_schema_t* s, const chttpx_validation_t* fields, size_t n, const uint64_t* hashes)
+{
+    memset(s->slot, 0, s->mask + 1);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!fields[i].name)
+            continue;
+
+        uint32_t at = slot_of(hashes[i], s->disp[hashes[i] & s->bucket_mask], s->mask);
+
+        if (s->slot[at])
+        {
+            /* A repeated name is never looked up, the first field gets the value */
+            if (same_name(s, fields, s->slot[at] - 1, i))
+                continue;
+
+            return 0;
+        }
+
+        s->slot[at] = (uint8_t)(i + 1);
+    }
+
+    return 1;
+}
+
+/* Find a displacement for every bucket, fullest buckets first */
+static int schema_search(json_schema_t* s, const chttpx_validation_t* fields, size_t n, const uint64_t* hashes)
+{
+    uint8_t order[CHTTPX_JSON_FIELDS_MAX];
+    uint16_t start[JSON_SCHEMA_BUCKETS + 1] = {0};
+    size_t buckets = s->bucket_mask + 1;
+    size_t fullest = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (fields[i].name)
+            start[(hashes[i] & s->bucket_mask) + 1]++;
+    }
+
+    for (size_t b = 0; b < buckets; b++)
+    {
+        if (start[b + 1] > fullest)
+            fullest = start[b + 1];
+
+        start[b + 1] += start[b];
+    }
+
+    uint16_t fill[JSON_SCHEMA_BUCKETS];
+    memcpy(fill, start, buckets * sizeof(fill[0]));
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (fields[i].name)
+            order[fill[hashes[i] & s->bucket_mask]++] = (uint8_t)i;
+    }
+
+    memset(s->slot, 0, s->mask + 1);
+    memset(s->disp, 0, buckets);
+
+    for (size_t size = fullest; size > 0; size--)
+    {
+        for (size_t b = 0; b < buckets; b++)
+        {
+            if ((size_t)(start[b + 1] - start[b]) != size)
+                continue;
+
+            const uint8_t* keys = order + start[b];
+            unsigned d = 0;
+
+            for (; d < 256; d++)
+            {
+                size_t placed = 0;
+
+                for (; placed < size; placed++)
+                {
+                    size_t i = keys[placed];
+                    uint32_t at = slot_of(hashes[i], (uint8_t)d, s->mask);
+
+                    if (s->slot[at])
+                    {
+                        if (same_name(s, fields, s->slot[at] - 1, i))
+                            continue;
+
+                        break;
+                    }
+
+                    s->slot[at] = (uint8_t)(i + 1);
+                }
+
+                if (placed == size)
+                    break;
+
+                /* Take back what this displacement placed */
+                for (size_t k = 0; k < placed; k++)
+                {
+                    uint32_t at = slot_of(hashes[keys[k]], (uint8_t)d, s->mask);
+                    if (s->slot[at] == keys[k] + 1)
+                        s->slot[at] = 0;
+                }
+            }
+
+            if (d == 256)
+                return 0;
+
+            s->disp[b] = (uint8_t)d;
+        }
+    }
+
+    return 1;
+}
+
+static uint64_t schema_key(const chttpx_validation_t* fields, size_t n)
+{
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ n;
+    for (size_t i = 0; i < n; i++)
+    {
+        h = (h ^ (uint64_t)(uintptr_t)fields[i].name) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 29;
+    }
+
+    return h | 1;
+}
+
+/* Build the hash table of a schema, -1 if it has too many fields */
+static int schema_build(json_schema_t* s, const chttpx_validation_t* fields, size_t n)
+{
+    if (n > CHTTPX_JSON_FIELDS_MAX)
+        return -1;
+
+    uint64_t hashes[CHTTPX_JSON_FIELDS_MAX];
+    for (size_t i = 0; i < n; i++)
+    {
+        s->name_len[i] = fields[i].name ? strlen(fields[i].name) : 0;
+        hashes[i] = key_hash((const unsigned char*)fields[i].name, s->name_len[i]);
+    }
+
+    uint64_t key = schema_key(fields, n);
+    json_schema_memo_t* memo = &schema_memo[key % JSON_SCHEMA_MEMO];
+
+    if (memo->key == key)
+    {
+        s->mask = memo->mask;
+        s->bucket_mask = memo->bucket_mask;
+        memcpy(s->disp, memo->disp, s->bucket_mask + 1);
+
+        if (schema_place(s, fields, n, hashes))
+            return 0;
+    }
+
+    /* Two slots per field at least; a denser table is tried before a bigger one */
+    uint32_t slots = 16;
+    while (slots < 2 * n)
+        slots *= 2;
+
+    for (; slots <= JSON_SCHEMA_SLOTS; slots *= 2)
+    {
+        s->mask = slots - 1;
+        s->bucket_mask = slots / 4 - 1;
+
+        if (schema_search(s, fields, n, hashes))
+        {
+            memo->key = key;
+            memo->mask = s->mask;
+            memo->bucket_mask = s->bucket_mask;
+            memcpy(memo->disp, s->disp, s->bucket_mask + 1);
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+static int hex4(const unsigned char* p, uint32_t* out)
+{
+    uint32_t v = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        unsigned char c = p[i];
+        v <<= 4;
+
+        if (c >= '0' && c <= '9')
+            v |= c - '0';
+        else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+            v |= (c | 0x20) - 'a' + 10;
+        else
+            return 0;
+    }
+
+    if (out)
+        *out = v;
+
+    return 1;
+}
+
+/* Whether the backslash at pos starts a valid escape */
+static inline int json_escape_valid(const unsigned char* buf, size_t len, size_t pos)
+{
+    if (pos + 1 >= len)
+        return 0;
+
+    switch (buf[pos + 1])
+    {
+    case '"':
+    case '\\':
+    case '/':
+    case 'b':
+    case 'f':
+    case 'n':
+    case 'r':
+    case 't':
+        return 1;
+    case 'u':
+        return pos + 6 <= len && hex4(buf + pos + 2, NULL);
+    default:
+        return 0;
+    }
+}
+
+/* Bytes of a 64-byte block by class, one bit per byte */
+typedef struct
+{
+    uint64_t quote;
+    uint64_t backslash;
+    /* { } [ ] : , */
+    uint64_t op;
+} json_block_t;
+
+typedef void (*json_classify_fn)(const unsigned char* p, json_block_t* b);
+
+#define CLASS_QUOTE 0x1
+#define CLASS_BACKSLASH 0x2
+#define CLASS_OP 0x4
+
+static const uint8_t json_class[256] = {
+    ['"'] = CLASS_QUOTE, ['\\'] = CLASS_BACKSLASH, ['{'] = CLASS_OP, ['}'] = CLASS_OP,
+    ['['] = CLASS_OP,    [']'] = CLASS_OP,         [':'] = CLASS_OP, [','] = CLASS_OP,
+};
+
+static void classify_scalar(const unsigned char* p, json_block_t* b)
+{
+    uint64_t quote = 0, backslash = 0, op = 0;
+
+    for (unsigned i = 0; i < 64; i++)
+    {
+        uint64_t c = json_class[p[i]];
+        quote |= (c & CLASS_QUOTE) << i;
+        backslash |= (c >> 1 & 1) << i;
+        op |= (c >> 2) << i;
+    }
+
+    b->quote = quote;
+    b->backslash = backslash;
+    b->op = op;
+}
+
+#ifdef JSON_X86
+/* '[' and '{', ']' and '}' differ by 0x20 only: one comparison each after folding */
+static void classify_sse2(const unsigned char* p, json_block_t* b)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i fold = _mm_set1_epi8(0x20);
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+
+    b->quote = b->backslash = b->op = 0;
+
+    for (unsigned j = 0; j < 4; j++)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i*)(p + 16 * j));
+        __m128i folded = _mm_or_si128(d, fold);
+        __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(d, colon), _mm_cmpeq_epi8(d, comma)));
+
+        b->quote |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(d, quote)) << (16 * j);
+        b->backslash |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(d, backslash)) << (16 * j);
+        b->op |= (uint64_t)(uint32_t)_mm_movemask_epi8(op) << (16 * j);
+    }
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define JSON_AVX2
+
+__attribute__((target("avx2"))) static void classify_avx2(const unsigned char* p, json_block_t* b)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i fold = _mm256_set1_epi8(0x20);
+    const __m256i open = _mm256_set1_epi8('{');
+    const __m256i close = _mm256_set1_epi8('}');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i comma = _mm256_set1_epi8(',');
+
+    b->quote = b->backslash = b->op = 0;
+
+    for (unsigned j = 0; j < 2; j++)
+    {
+        __m256i d = _mm256_loadu_si256((const __m256i*)(p + 32 * j));
+        __m256i folded = _mm256_or_si256(d, fold);
+        __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(folded, open), _mm256_cmpeq_epi8(folded, close)),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(d, colon), _mm256_cmpeq_epi8(d, comma)));
+
+        b->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d, quote)) << (32 * j);
+        b->backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d, backslash)) << (32 * j);
+        b->op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(op) << (32 * j);
+    }
+}
+#endif
+#endif
+
+static json_classify_fn json_classify = NULL;
+static const char* json_classify_impl = "scalar";
+/* Set by _json_index_select("none") */
+static int json_index_off = 0;
+
+int _json_index_select(const char* impl)
+{
+    if (!impl)
+    {
+        /* The scalar index costs more than it saves: without SIMD bodies are decoded byte by byte */
+        json_index_off = 1;
+        json_classify = classify_scalar;
+        json_classify_impl = "scalar";
+#ifdef JSON_X86
+        json_index_off = 0;
+        json_classify = classify_sse2;
+        json_classify_impl = "sse2";
+#ifdef JSON_AVX2
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            json_classify = classify_avx2;
+            json_classify_impl = "avx2";
+        }
+#endif
+#endif
+        return 0;
+    }
+
+    if (strcmp(impl, "none") == 0)
+    {
+        if (!json_classify)
+            _json_index_select(NULL);
+
+        json_index_off = 1;
+        return 0;
+    }
+
+    if (strcmp(impl, "scalar") == 0)
+    {
+        json_index_off = 0;
+        json_classify = classify_scalar;
+        json_classify_impl = "scalar";
+        return 0;
+    }
+
+#ifdef JSON_X86
+    if (strcmp(impl, "sse2") == 0)
+    {
+        json_index_off = 0;
+        json_classify = classify_sse2;
+        json_classify_impl = "sse2";
+        return 0;
+    }
+
+#ifdef JSON_AVX2
+    __builtin_cpu_init();
+    if (strcmp(impl, "avx2") == 0 && __builtin_cpu_supports("avx2"))
+    {
+        json_index_off = 0;
+        json_classify = classify_avx2;
+        json_classify_impl = "avx2";
+        return 0;
+    }
+#endif
+#endif
+
+    return -1;
+}
+
+const char* _json_index_impl(void)
+{
+    if (!json_classify)
+        _json_index_select(NULL);
+
+    return json_index_off ? "none" : json_classify_impl;
+}
+
+static inline unsigned ctz64(uint64_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward64(&i, x);
+    return (unsigned)i;
+#else
+    return (unsigned)__builtin_ctzll(x);
+#endif
+}
+
+size_t _json_index(const unsigned char* buf, size_t len, uint32_t* out)
+{
+    unsigned char tail[64];
+    /* The previous block ended with a backslash that escapes this block's first byte / inside a string */
+    uint64_t escape_carry = 0;
+    uint64_t string_carry = 0;
+    size_t n = 0;
+
+    if (!json_classify)
+        _json_index_select(NULL);
+
+    for (size_t base = 0; base < len; base += 64)
+    {
+        const unsigned char* p = buf + base;
+        json_block_t b;
+
+        if (len - base < 64)
+        {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, p, len - base);
+            p = tail;
+        }
+
+        json_classify(p, &b);
+
+        /* Every backslash that is not escaped itself escapes the next byte and is checked; runs of them are rare */
+        uint64_t escaped = escape_carry;
+        uint64_t bs = b.backslash & ~escaped;
+        escape_carry = 0;
+
+        while (bs)
+        {
+            unsigned i = ctz64(bs);
+            if (!json_escape_valid(buf, len, base + i))
+                return (size_t)-1;
+
+            if (i == 63)
+            {
+                escape_carry = 1;
+                break;
+            }
+
+            escaped |= 2ULL << i;
+            bs &= ~(3ULL << i);
+        }
+
+        uint64_t quotes = b.quote & ~escaped;
+
+        /* Prefix XOR of the quotes: set from an opening quote up to its closing one */
+        uint64_t in = quotes;
+        in ^= in << 1;
+        in ^= in << 2;
+        in ^= in << 4;
+        in ^= in << 8;
+        in ^= in << 16;
+        in ^= in << 32;
+        in ^= string_carry;
+        string_carry = 0 - (in >> 63);
+
+        uint64_t marks = (b.op & ~in) | quotes;
+
+        while (marks)
+        {
+            out[n++] = (uint32_t)(base + ctz64(marks));
+            marks &= marks - 1;
+        }
+    }
+
+    return string_carry ? (size_t)-1 : n;
+}
+
+void cHTTPX_JsonLimit(size_t max_size)
+{
+    if (!serv)
+    {
+        fprintf(stderr, "Error: server is not initialized\n");
+        return;
+    }
+
+    serv->json_max = max_size ? max_size : MAX_BODY_IN_MEMORY;
+}
+
+/* Move the index to the first mark at or after p */
+static inline const uint32_t* json_mark(json_reader_t* r, const unsigned char* p)
+{
+    uint32_t at = (uint32_t)(p - r->base);
+
+    while (r->idx < r->idx_end && *r->idx < at)
+        r->idx++;
+
+    return r->idx;
+}
+
+static int json_fail(json_reader_t* r, int error)
+{
+    if (!r->error)
+        r->error = error;
+
+    return -1;
+}
+
+static inline void json_ws(json_reader_t* r)
+{
+    /* Most tokens follow one another or a single space */
+    if (r->p < r->end && *r->p > ' ')
+        return;
+
+    while (r->p < r->end && (*r->p == ' ' || *r->p == '\n' || *r->p == '\r' || *r->p == '\t'))
+        r->p++;
+}
+
+/* Whether the next byte is c, consumed with the whitespace after it */
+static inline int json_take(json_reader_t* r, unsigned char c)
+{
+    if (r->p >= r->end || *r->p != c)
+        return 0;
+
+    r->p++;
+    json_ws(r);
+    return 1;
+}
+
+/* Scan the string at r->p: *s and *len give its raw bytes, *escaped (if not NULL) tells if it has escapes */
+static int json_scan_string(json_reader_t* r, const unsigned char** s, size_t* len, int* escaped)
+{
+    const unsigned char* p = r->p + 1;
+    int esc = 0;
+
+    /* Indexed: the closing quote is the mark after the opening one, escapes were checked by _json_index */
+    if (r->idx)
+    {
+        const uint32_t* m = json_mark(r, r->p);
+        if (m + 1 >= r->idx_end || r->base + *m != r->p)
+            return json_fail(r, JSON_ERR_SYNTAX);
+
+        const unsigned char* close = r->base + m[1];
+        r->idx = m + 2;
+
+        if (escaped)
+            *escaped = memchr(p, '\\', (size_t)(close - p)) != NULL;
+
+        *s = p;
+        *len = (size_t)(close - p);
+        r->p = close + 1;
+        return 0;
+    }
+
+    for (;;)
+    {
+        while (p < r->end && *p != '"' && *p != '\\')
+            p++;
+
+        if (p >= r->end)
+            return json_fail(r, JSON_ERR_SYNTAX);
+
+        if (*p == '"')
+            break;
+
+        esc = 1;
+
+        if (p + 1 >= r->end)
+            return json_fail(r, JSON_ERR_SYNTAX);
+
+        switch (p[1])
+        {
+        case '"':
+        case '\\':
+        case '/':
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't':
+            p += 2;
+            break;
+        case 'u':
+            if (r->end - p < 6 || !hex4(p + 2, NULL))
+                return json_fail(r, JSON_ERR_SYNTAX);
+            p += 6;
+            break;
+        default:
+            return json_fail(r, JSON_ERR_SYNTAX);
+        }
+    }
+
+    if (escaped)
+        *escaped = esc;
+
+    *s = r->p + 1;
+    *len = (size_t)(p - *s);
+    r->p = p + 1;
+    return 0;
+}
+
+/* Unescape a scanned string into dst (len bytes at most), (size_t)-1 on a broken surrogate pair */
+static size_t json_unescape(unsigned char* dst, const unsigned char* s, size_t len)
+{
+    const unsigned char* end = s + len;
+    unsigned char* out = dst;
+
+    while (s < end)
+    {
+        if (*s != '\\')
+        {
+            *out++ = *s++;
+            continue;
+        }
+
+        unsigned char c = s[1];
+        s += 2;
+
+        switch (c)
+        {
+        case 'b':
+            *out++ = '\b';
+            break;
+        case 'f':
+            *out++ = '\f';
+            break;
+        case 'n':
+            *out++ = '\n';
+            break;
+        case 'r':
+            *out++ = '\r';
+            break;
+        case 't':
+            *out++ = '\t';
+            break;
+        case 'u':
+        {
+            uint32_t cp = 0, lo = 0;
+            hex4(s, &cp);
+            s += 4;
+
+            if (cp >= 0xDC00 && cp <= 0xDFFF)
+                return (size_t)-1;
+
+            if (cp >= 0xD800 && cp <= 0xDBFF)
+            {
+                if (end - s < 6 || s[0] != '\\' || s[1] != 'u' || !hex4(s + 2, &lo) || lo < 0xDC00 || lo > 0xDFFF)
+                    return (size_t)-1;
+
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                s += 6;
+            }
+
+            if (cp < 0x80)
+            {
+                *out++ = (unsigned char)cp;
+            }
+            else if (cp < 0x800)
+            {
+                *out++ = (unsigned char)(0xC0 | cp >> 6);
+                *out++ = (unsigned char)(0x80 | (cp & 0x3F));
+            }
+            else if (cp < 0x10000)
+            {
+                *out++ = (unsigned char)(0xE0 | cp >> 12);
+                *out++ = (unsigned char)(0x80 | (cp >> 6 & 0x3F));
+                *out++ = (unsigned char)(0x80 | (cp & 0x3F));
+            }
+            else
+            {
+                *out++ = (unsigned char)(0xF0 | cp >> 18);
+                *out++ = (unsigned char)(0x80 | (cp >> 12 & 0x3F));
+                *out++ = (unsigned char)(0x80 | (cp >> 6 & 0x3F));
+                *out++ = (unsigned char)(0x80 | (cp & 0x3F));
+            }
+            break;
+        }
+        default:
+            /* '"', '\\' and '/' stand for themselves */
+            *out++ = c;
+            break;
+        }
+    }
+
+    return (size_t)(out - dst);
+}
+
+static void* json_alloc(json_reader_t* r, size_t size)
+{
+    void* p = r->flags & JSON_DECODE_ARENA ? _arena_alloc(r->req->arena, size) : malloc(size);
+    if (!p)
+        json_fail(r, JSON_ERR_MEMORY);
+
+    return p;
+}
+
+static void json_free(json_reader_t* r, void* p)
+{
+    if (!(r->flags & JSON_DECODE_ARENA))
+        free(p);
+}
+
+/* Copy the string at r->p, unescaped: the only copy of its bytes */
+static char* json_string(json_reader_t* r)
+{
+    const unsigned char* s;
+    size_t len;
+    int escaped;
+
+    if (json_scan_string(r, &s, &len, &escaped) != 0)
+        return NULL;
+
+    char* dst = json_alloc(r, len + 1);
+    if (!dst)
+        return NULL;
+
+    if (!escaped)
+    {
+        memcpy(dst, s, len);
+    }
+    else if ((len = json_unescape((unsigned char*)dst, s, len)) == (size_t)-1)
+    {
+        json_free(r, dst);
+        json_fail(r, JSON_ERR_SYNTAX);
+        return NULL;
+    }
+
+    dst[len] = '\0';
+    return dst;
+}
+
+/* Scan the number at r->p, its value goes to *value when value is not NULL */
+static int json_number(json_reader_t* r, double* value)
+{
+    const unsigned char* start = r->p;
+    const unsigned char* p = start;
+    const unsigned char* end = r->end;
+    int integer = 1;
+
+    if (p < end && *p == '-')
+        p++;
+
+    const unsigned char* digits = p;
+
+    if (p >= end || (unsigned)(*p - '0') > 9)
+        return json_fail(r, JSON_ERR_SYNTAX);
+
+    if (*p == '0')
+        p++;
+    else
+        while (p < end && (unsigned)(*p - '0') <= 9)
+            p++;
+
+    size_t int_digits = (size_t)(p - digits);
+
+    if (p < end && *p == '.')
+    {
+        integer = 0;
+        if (++p >= end || (unsigned)(*p - '0') > 9)
+            return json_fail(r, JSON_ERR_SYNTAX);
+        while (p < end && (unsigned)(*p - '0') <= 9)
+            p++;
+    }
+
+    if (p < end && (*p | 0x20) == 'e')
+    {
+        integer = 0;
+        if (++p < end && (*p == '+' || *p == '-'))
+            p++;
+        if (p >= end || (unsigned)(*p - '0') > 9)
+            return json_fail(r, JSON_ERR_SYNTAX);
+        while (p < end && (unsigned)(*p - '0') <= 9)
+            p++;
+    }
+
+    if (value)
+    {
+        if (integer && int_digits <= 18)
+        {
+            int64_t v = 0;
+            for (const unsigned char* q = digits; q < p; q++)
+                v = v * 10 + (*q - '0');
+
+            *value = digits > start ? -(double)v : (double)v;
+        }
+        else
+        {
+            /* Bodies are NUL-terminated (see _parse_req_body), strtod stops where the scan did */
+            *value = strtod((const char*)start, NULL);
+        }
+    }
+
+    r->p = p;
+    return 0;
+}
+
+/* int the way cJSON's valueint is: saturated, fraction dropped */
+static int json_int(double v)
+{
+    if (v >= (double)INT_MAX)
+        return INT_MAX;
+    if (v <= (double)INT_MIN)
+        return INT_MIN;
+
+    return (int)v;
+}
+
+static int json_literal(json_reader_t* r, const char* word, size_t len)
+{
+    if ((size_t)(r->end - r->p) < len || memcmp(r->p, word, len) != 0)
+        return json_fail(r, JSON_ERR_SYNTAX);
+
+    r->p += len;
+    return 0;
+}
+
+static int json_skip(json_reader_t* r);
+
+/* Check and skip the array or object at r->p */
+static int json_skip_container(json_reader_t* r)
+{
+    unsigned char close = *r->p == '{' ? '}' : ']';
+
+    if (++r->depth > CHTTPX_JSON_DEPTH_MAX)
+        return json_fail(r, JSON_ERR_SYNTAX);
+
+    r->p++;
+    json_ws(r);
+
+    if (json_take(r, close))
+    {
+        r->depth--;
+        return 0;
+    }
+
+    for (;;)
+    {
+        if (close == '}')
+        {
+            const unsigned char* key;
+            size_t len;
+
+            if (r->p >= r->end || *r->p != '"' || json_scan_string(r, &key, &len, NULL) != 0)
+                return json_fail(r, JSON_ERR_SYNTAX);
+
+            json_ws(r);
+            if (!json_take(r, ':'))
+                return json_fail(r, JSON_ERR_SYNTAX);
+        }
+
+        if (json_skip(r) != 0)
+            return -1;
+
+        json_ws(r);
+
+        if (json_take(r, ','))
+            continue;
+
+        if (json_take(r, close))
+            break;
+
+        return json_fail(r, JSON_ERR_SYNTAX);
+    }
+
+    r->depth--;
+    return 0;
+}
+
+/* A number or literal at r->p */
+static int json_scalar(json_reader_t* r)
+{
+    switch (*r->p)
+    {
+    case 't':
+        return json_literal(r, "true", 4);
+    case 'f':
+        return json_literal(r, "false", 5);
+    case 'n':
+        return json_literal(r, "null", 4);
+    default:
+        return json_number(r, NULL);
+    }
+}
+
+static inline int json_gap_ws(const unsigned char* p, const unsigned char* end)
+{
+    for (; p < end; p++)
+    {
+        if (*p != ' ' && *p != '\n' && *p != '\r' && *p != '\t')
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Indexed: check and skip the array or object at r->p on its marks. Brackets,
+ * strings and separators are the marks themselves; only the numbers, literals
+ * and whitespace between two marks are read.
+ */
+static int json_skip_marks(json_reader_t* r)
+{
+    enum
+    {
+        WANT_VALUE,
+        WANT_VALUE_OR_CLOSE,
+        WANT_KEY,
+        WANT_KEY_OR_CLOSE,
+        WANT_COLON,
+        WANT_NEXT
+    } want = WANT_VALUE;
+
+    /* Closing bracket of every open container */
+    unsigned char stack[CHTTPX_JSON_DEPTH_MAX];
+    size_t depth = 0;
+
+    const uint32_t* m = json_mark(r, r->p);
+    const unsigned char* gap = r->p;
+
+    for (; m < r->idx_end; m++)
+    {
+        const unsigned char* at = r->base + *m;
+        unsigned char c = *at;
+
+        if (want == WANT_VALUE || want == WANT_VALUE_OR_CLOSE)
+        {
+            /* A value that is not a mark lies in the gap */
+            r->p = gap;
+            json_ws(r);
+
+            if (r->p < at)
+            {
+                if (json_scalar(r) != 0)
+                    return -1;
+
+                json_ws(r);
+                if (r->p != at)
+                    return json_fail(r, JSON_ERR_SYNTAX);
+
+                want = WANT_NEXT;
+            }
+        }
+        else if (!json_gap_ws(gap, at))
+        {
+            return json_fail(r, JSON_ERR_SYNTAX);
+        }
+
+        switch (c)
+        {
+        case '{':
+        case '[':
+            if ((want != WANT_VALUE && want != WANT_VALUE_OR_CLOSE) || r->depth + depth + 1 > CHTTPX_JSON_DEPTH_MAX)
+                return json_fail(r, JSON_ERR_SYNTAX);
+
+            stack[depth++] = c == '{' ? '}' : ']';
+            want = c == '{' ? WANT_KEY_OR_CLOSE : WANT_VALUE_OR_CLOSE;
+            break;
+
+        case '"':
+            if (want == WANT_KEY || want == WANT_KEY_OR_CLOSE)
+                want = WANT_COLON;
+            else if (want == WANT_VALUE || want == WANT_VALUE_OR_CLOSE)
+                want = WANT_NEXT;
+            else
+                return json_fail(r, JSON_ERR_SYNTAX);
+
+            /* Its closing quote */
+            if (++m >= r->idx_end)
+                return json_fail(r, JSON_ERR_SYNTAX);
+            break;
+
+        case ':':
+            if (want != WANT_COLON)
+                return json_fail(r, JSON_ERR_SYNTAX);
+
+            want = WANT_VALUE;
+            break;
+
+        case ',':
+            if (want != WANT_NEXT)
+                return json_fail(r, JSON_ERR_SYNTAX);
+
+            want = stack[depth - 1] == '}' ? WANT_KEY : WANT_VALUE;
+            break;
+
+        default:
+            if (stack[depth - 1] != c ||
+                (want != WANT_NEXT && !(want == WANT_KEY_OR_CLOSE && c == '}') && !(want == WANT_VALUE_OR_CLOSE && c == ']')))
+                return json_fail(r, JSON_ERR_SYNTAX);
+
+            if (--depth == 0)
+            {
+                r->p = at + 1;
+                r->idx = m + 1;
+                return 0;
+            }
+
+            want = WANT_NEXT;
+            break;
+        }
+
+        gap = r->base + *m + 1;
+    }
+
+    return json_fail(r, JSON_ERR_SYNTAX);
+}
+
+/* Check and skip the value at r->p */
+static int json_skip(json_reader_t* r)
+{
+    if (r->p >= r->end)
+        return json_fail(r, JSON_ERR_SYNTAX);
+
+    switch (*r->p)
+    {
+    case '{':
+    case '[':
+        return r->idx ? json_skip_marks(r) : json_skip_container(r);
+    case '"':
+    {
+        const unsigned char* s;
+        size_t len;
+        return json_scan_string(r, &s, &len, NULL);
+    }
+    case 't':
+        return json_literal(r, "true", 4);
+    case 'f':
+        return json_literal(r, "false", 5);
+    case 'n':
+        return json_literal(r, "null", 4);
+    default:
+        return json_number(r, NULL);
+    }
+}
+
+/* A value whose type does not match its field */
+static int json_mismatch(json_reader_t* r, chttpx_validation_t* f)
+{
+    if (r->flags & JSON_DECODE_VALIDATE)
+    {
+        _validate_type_error(r->req, f, r->lang);
+        return json_fail(r, JSON_ERR_FIELD);
+    }
+
+    return json_skip(r);
+}
+
+static void* json_grow(json_reader_t* r, void* items, size_t count, size_t* cap, size_t elem_size)
+{
+    void* grown;
+
+    if (r->flags & JSON_DECODE_ARENA)
+    {
+        grown = _arena_grow(r->req->arena, items, count, cap, elem_size);
+    }
+    else
+    {
+        size_t new_cap = *cap ? *cap * 2 : 8;
+        if ((grown = realloc(items, new_cap * elem_size)) != NULL)
+            *cap = new_cap;
+    }
+
+    if (!grown)
+        json_fail(r, JSON_ERR_MEMORY);
+
+    return grown;
+}
+
+/* Upper bound of the elements of the array at r->p, from the marks up to its end */
+static size_t json_array_count(json_reader_t* r)
+{
+    const uint32_t* m = json_mark(r, r->p);
+    size_t depth = 0, commas = 0;
+
+    for (; m < r->idx_end; m++)
+    {
+        unsigned char c = r->base[*m];
+
+        if (c == '[' || c == '{')
+            depth++;
+        else if (c == ']' || c == '}')
+        {
+            if (--depth == 0)
+                break;
+        }
+        else if (c == ',' && depth == 1)
+            commas++;
+    }
+
+    return commas + 1;
+}
+
+/* Read an array of strings or numbers element by element straight into the field */
+static int json_array(json_reader_t* r, chttpx_validation_t* f)
+{
+    int strings = f->type == FIELD_STRING_ARRAY;
+    size_t elem_size = strings ? sizeof(char*) : sizeof(int);
+    void* items = NULL;
+    size_t count = 0, cap = 0;
+
+    if (++r->depth > CHTTPX_JSON_DEPTH_MAX)
+        return json_fail(r, JSON_ERR_SYNTAX);
+
+    /* Indexed: sized once from the commas of its top level */
+    if (r->idx)
+    {
+        cap = json_array_count(r);
+        if (!(items = json_alloc(r, cap * elem_size)))
+            return -1;
+    }
+
+    r->p++;
+    json_ws(r);
+
+    if (!json_take(r, ']'))
+    {
+        for (;;)
+        {
+            if (count == cap)
+            {
+                void* grown = json_grow(r, items, count, &cap, elem_size);
+                if (!grown)
+                    goto fail;
+
+                items = grown;
+            }
+
+            if (r->p >= r->end)
+            {
+                json_fail(r, JSON_ERR_SYNTAX);
+                goto fail;
+            }
+
+            /* Elements of another type are NULL / 0 */
+            unsigned char c = *r->p;
+
+            if (strings)
+            {
+                char* s = NULL;
+
+                if (c == '"')
+                {
+                    if (!(s = json_string(r)))
+                        goto fail;
+                }
+                else if (json_mismatch(r, f) != 0)
+                {
+                    goto fail;
+                }
+
+                ((char**)items)[count] = s;
+            }
+            else
+            {
+                double v = 0;
+
+                if (c == '-' || (unsigned)(c - '0') <= 9)
+                {
+                    if (json_number(r, &v) != 0)
+                        goto fail;
+                }
+                else if (json_mismatch(r, f) != 0)
+                {
+                    goto fail;
+                }
+
+                ((int*)items)[count] = json_int(v);
+            }
+
+            count++;
+            json_ws(r);
+
+            if (json_take(r, ','))
+                continue;
+
+            if (json_take(r, ']'))
+                break;
+
+            json_fail(r, JSON_ERR_SYNTAX);
+            goto fail;
+        }
+    }
+
+    r->depth--;
+
+    if (strings)
+    {
+        ((chttpx_string_array_t*)f->target)->items = items;
+        ((chttpx_string_array_t*)f->target)->count = count;
+    }
+    else
+    {
+        ((chttpx_number_array_t*)f->target)->items = items;
+        ((chttpx_number_array_t*)f->target)->count = count;
+    }
+
+    return 0;
+
+fail:
+    if (!(r->flags & JSON_DECODE_ARENA))
+    {
+        for (size_t i = 0; strings && i < count; i++)
+            free(((char**)items)[i]);
+
+        free(items);
+    }
+
+    return -1;
+}
+
+/* Decode the value at r->p into its field, then check it when validating */
+static int json_field(json_reader_t* r, chttpx_validation_t* f)
+{
+    unsigned char c = *r->p;
+    int match;
+
+    /* null leaves the field absent */
+    if (c == 'n')
+        return json_literal(r, "null", 4);
+
+    switch (f->type)
+    {
+    case FIELD_STRING:
+        match = c == '"';
+        break;
+    case FIELD_NUMBER:
+        match = c == '-' || (unsigned)(c - '0') <= 9;
+        break;
+    case FIELD_BOOL:
+        match = c == 't' || c == 'f';
+        break;
+    default:
+        match = c == '[';
+        break;
+    }
+
+    if (!match)
+    {
+        /* Present with its target untouched, unless validating */
+        if (json_mismatch(r, f) != 0)
+            return -1;
+
+        f->present = 1;
+        return 0;
+    }
+
+    switch (f->type)
+    {
+    case FIELD_STRING:
+    {
+        char* s = json_string(r);
+        if (!s)
+            return -1;
+
+        *(char**)f->target = s;
+        r->owned[f - r->fields] = 1;
+        break;
+    }
+
+    case FIELD_NUMBER:
+    {
+        double v;
+        if (json_number(r, &v) != 0)
+            return -1;
+
+        *(int*)f->target = json_int(v);
+        break;
+    }
+
+    case FIELD_BOOL:
+        if (json_literal(r, c == 't' ? "true" : "false", c == 't' ? 4 : 5) != 0)
+            return -1;
+
+        *(uint8_t*)f->target = c == 't';
+        break;
+
+    default:
+        if (json_array(r, f) != 0)
+            return -1;
+
+        r->owned[f - r->fields] = 1;
+        break;
+    }
+
+    f->present = 1;
+
+    if ((r->flags & JSON_DECODE_VALIDATE) && !_validate_field(r->req, f, r->lang))
+        return json_fail(r, JSON_ERR_FIELD);
+
+    return 0;
+}
+
+/* Field named by the key at s (raw bytes of a scanned string), NULL if none */
+static chttpx_validation_t* json_lookup(json_reader_t* r, const json_schema_t* schema, const unsigned char* s, size_t len, int escaped)
+{
+    unsigned char buf[JSON_KEY_MAX];
+
+    if (escaped)
+    {
+        if (len > sizeof(buf) || (len = json_unescape(buf, s, len)) == (size_t)-1)
+            return NULL;
+
+        s = buf;
+    }
+
+    uint64_t h = key_hash(s, len);
+    uint8_t at = schema->slot[slot_of(h, schema->disp[h & schema->bucket_mask], schema->mask)];
+
+    if (!at || schema->name_len[at - 1] != len || !key_equal((const unsigned char*)r->fields[at - 1].name, s, len))
+        return NULL;
+
+    return &r->fields[at - 1];
+}
+
+/* Walk the whole document once, the fields are read from a top-level object */
+static int json_document(json_reader_t* r, const json_schema_t* schema)
+{
+    json_ws(r);
+
+    if (r->p < r->end && *r->p == '{')
+    {
+        r->p++;
+        r->depth = 1;
+        json_ws(r);
+
+        if (!json_take(r, '}'))
+        {
+            for (;;)
+            {
+                const unsigned char* key;
+                size_t len;
+                int escaped;
+
+                if (r->p >= r->end || *r->p != '"' || json_scan_string(r, &key, &len, &escaped) != 0)
+                    return json_fail(r, JSON_ERR_SYNTAX);
+
+                chttpx_validation_t* f = json_lookup(r, schema, key, len, escaped);
+
+                json_ws(r);
+                if (!json_take(r, ':') || r->p >= r->end)
+                    return json_fail(r, JSON_ERR_SYNTAX);
+
+                /* A repeated key keeps the first value */
+                if (f && !f->present ? json_field(r, f) != 0 : json_skip(r) != 0)
+                    return -1;
+
+                json_ws(r);
+
+                if (json_take(r, ','))
+                    continue;
+
+                if (json_take(r, '}'))
+                    break;
+
+                return json_fail(r, JSON_ERR_SYNTAX);
+            }
+        }
+    }
+    else if (json_skip(r) != 0)
+    {
+        /* Any other document holds none of the fields but still has to be JSON */
+        return -1;
+    }
+
+    json_ws(r);
+
+    if (r->p != r->end)
+        return json_fail(r, JSON_ERR_SYNTAX);
+
+    return 0;
+}
+
+/* Free what a failed cHTTPX_Parse stored, so an error leaves nothing to the caller */
+static void json_release(json_reader_t* r, size_t field_count)
+{
+    for (size_t i = 0; i < field_count; i++)
+    {
+        chttpx_validation_t* f = &r->fields[i];
+
+        if (!r->owned[i])
+            continue;
+
+        if (f->type == FIELD_STRING)
+        {
+            free(*(char**)f->target);
+            *(char**)f->target = NULL;
+        }
+        else if (f->type == FIELD_STRING_ARRAY)
+        {
+            chttpx_string_array_t* arr = f->target;
+            for (size_t j = 0; j < arr->count; j++)
+                free(arr->items[j]);
+
+            free(arr->items);
+            arr->items = NULL;
+            arr->count = 0;
+        }
+        else
+        {
+            chttpx_number_array_t* arr = f->target;
+            free(arr->items);
+            arr->items = NULL;
+            arr->count = 0;
+        }
+
+        f->present = 0;
+    }
+}
+
+int _json_decode(chttpx_request_t* req, chttpx_validation_t* fields, size_t field_count, unsigned flags, const char* lang)
+{
+    json_schema_t schema;
+
+    if (!req->body)
+    {
+        snprintf(req->error_msg, sizeof(req->error_msg), "Invalid JSON");
+        return 0;
+    }
+
+    if (schema_build(&schema, fields, field_count) != 0)
+    {
+        snprintf(req->error_msg, sizeof(req->error_msg), "too many fields");
+        return 0;
+    }
+
+    json_reader_t r = {
+        .p = req->body,
+        .end = req->body + req->body_size,
+        .base = req->body,
+        .req = req,
+        .fields = fields,
+        .flags = flags,
+        .lang = i18n_lang_from_string(lang ? lang : "en"),
+    };
+
+    /* Large bodies are indexed first: strings and arrays are then found on the marks */
+    uint32_t* index = NULL;
+
+    if (!json_classify)
+        _json_index_select(NULL);
+
+    if (!json_index_off && req->body_size >= CHTTPX_JSON_INDEX_MIN && req->body_size < UINT32_MAX &&
+        (index = malloc(req->body_size * sizeof(uint32_t))) != NULL)
+    {
+        size_t marks = _json_index(req->body, req->body_size, index);
+        if (marks == (size_t)-1)
+        {
+            free(index);
+            snprintf(req->error_msg, sizeof(req->error_msg), "Invalid JSON");
+            return 0;
+        }
+
+        r.idx = index;
+        r.idx_end = index + marks;
+    }
+
+    for (size_t i = 0; i < field_count; i++)
+        fields[i].present = 0;
+
+    int rc = (flags & JSON_DECODE_ARENA) && !req->arena ? json_fail(&r, JSON_ERR_MEMORY) : json_document(&r, &schema);
+
+    /* Values were checked as they came, what is left is the fields that never did */
+    for (size_t i = 0; rc == 0 && (flags & JSON_DECODE_VALIDATE) && i < field_count; i++)
+    {
+        if (!fields[i].present && !_validate_field(req, &fields[i], r.lang))
+            rc = json_fail(&r, JSON_ERR_FIELD);
+    }
+
+    free(index);
+
+    if (rc == 0)
+        return 1;
+
+    if (!(flags & JSON_DECODE_ARENA))
+        json_release(&r, field_count);
+
+    if (r.error == JSON_ERR_SYNTAX)
+        snprintf(req->error_msg, sizeof(req->error_msg), "Invalid JSON");
+    else if (r.error == JSON_ERR_MEMORY)
+        snprintf(req->error_msg, sizeof(req->error_msg), "out of memory");
+
+    return 0;
+}
@@ -0,0 +1,420 @@
+#define _GNU_SOURCE
+
+/*
+ * Copyright (c) 2026 netcorelink
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "json_writer.h"
+#include "arena.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* How a byte is written inside a string: 0 as it is, otherwise the character after the backslash ('u' for \u00XX) */
+static const char json_escape[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 0,   0,   '"', ['\\'] = '\\',
+};
+
+static const char hex_digits[] = "0123456789abcdef";
+
+void cHTTPX_JsonInit(chttpx_json_t* json, chttpx_request_t* req)
+{
+    memset(json, 0, sizeof(*json));
+    json->arena = req ? req->arena : NULL;
+}
+
+void cHTTPX_JsonFree(chttpx_json_t* json)
+{
+    if (!json->arena && !json->frame)
+        free(json->buf);
+
+    free(json->spill);
+
+    json->buf = NULL;
+    json->len = json->cap = 0;
+    json->spill = NULL;
+    json->spill_len = json->spill_cap = json->spill_sent = 0;
+}
+
+/* Make room for n more bytes in buf, 0 if out of memory */
+static int json_grow(chttpx_json_t* json, size_t n)
+{
+    size_t cap = json->cap ? json->cap : CHTTPX_JSON_WRITER_SIZE;
+    while (cap - json->len < n)
+        cap *= 2;
+
+    char* grown;
+    if (json->arena)
+    {
+        /* The old buffer stays in the arena until the REQuest ends */
+        grown = _arena_alloc(json->arena, cap);
+        if (grown && json->len)
+            memcpy(grown, json->buf, json->len);
+    }
+    else
+    {
+        grown = realloc(json->buf, cap);
+    }
+
+    if (!grown)
+        return 0;
+
+    json->buf = grown;
+    json->cap = cap;
+    return 1;
+}
+
+/* Streamed: what does not fit the frame waits in spill */
+static void json_spill(chttpx_json_t* json, const char* s, size_t n)
+{
+    if (json->spill_cap - json->spill_len < n)
+    {
+        size_t cap = json->spill_cap ? json->spill_cap : CHTTPX_JSON_WRITER_SIZE;
+        while (cap - json->spill_len < n)
+            cap *= 2;
+
+        char* grown = realloc(json->spill, cap);
+        if (!grown)
+        {
+            json->failed = true;
+            return;
+        }
+
+        json->spill = grown;
+        json->spill_cap = cap;
+    }
+
+    memcpy(json->spill + json->spill_len, s, n);
+    json->spill_len += n;
+}
+
+static void json_put_slow(chttpx_json_t* json, const char* s, size_t n)
+{
+    if (json->frame)
+    {
+        size_t fit = json->cap - json->len;
+        memcpy(json->buf + json->len, s, fit);
+        json->len += fit;
+        json_spill(json, s + fit, n - fit);
+        return;
+    }
+
+    if (!json_grow(json, n))
+    {
+        json->failed = true;
+        return;
+    }
+
+    memcpy(json->buf + json->len, s, n);
+    json->len += n;
+}
+
+static inline void json_put(chttpx_json_t* json, const char* s, size_t n)
+{
+    if (json->cap - json->len < n)
+    {
+        json_put_slow(json, s, n);
+        return;
+    }
+
+    memcpy(json->buf + json->len, s, n);
+    json->len += n;
+}
+
+static inline int json_in_object(const chttpx_json_t* json)
+{
+    uint32_t top = json->depth - 1;
+    return json->depth && (json->object[top / 8] >> (top % 8) & 1);
+}
+
+/* Comma before a value, 0 if a value may not come here */
+static int json_value_start(chttpx_json_t* json)
+{
+    if (json->failed)
+        return 0;
+
+    if (json->after_key)
+    {
+        json->after_key = false;
+        return 1;
+    }
+
+    /* Members of an object need a key, the top level holds one value */
+    if (json_in_object(json) || (json->depth == 0 && json->comma))
+    {
+        json->failed = true;
+        return 0;
+    }
+
+    if (json->comma)
+        json_put(json, ",", 1);
+
+    return 1;
+}
+
+static void json_put_string(chttpx_json_t* json, const char* s, size_t len)
+{
+    const unsigned char* p = (const unsigned char*)s;
+    size_t run = 0;
+
+    json_put(json, "\"", 1);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        char e = json_escape[p[i]];
+        if (!e)
+            continue;
+
+        json_put(json, s + run, i - run);
+        run = i + 1;
+
+        if (e == 'u')
+        {
+            char u[6] = {'\\', 'u', '0', '0', hex_digits[p[i] >> 4], hex_digits[p[i] & 15]};
+            json_put(json, u, sizeof(u));
+        }
+        else
+        {
+            char esc[2] = {'\\', e};
+            json_put(json, esc, sizeof(esc));
+        }
+    }
+
+    json_put(json, s + run, len - run);
+    json_put(json, "\"", 1);
+}
+
+static void json_open(chttpx_json_t* json, char c, int object)
+{
+    if (!json_value_start(json))
+        return;
+
+    if (json->depth >= CHTTPX_JSON_DEPTH_MAX)
+    {
+        json->failed = true;
+        return;
+    }
+
+    uint32_t top = json->depth++;
+    if (object)
+        json->object[top / 8] |= (uint8_t)(1u << (top % 8));
+    else
+        json->object[top / 8] &= (uint8_t)~(1u << (top % 8));
+
+    json_put(json, &c, 1);
+    json->comma = false;
+}
+
+static void json_close(chttpx_json_t* json, char c, int object)
+{
+    if (json->failed)
+        return;
+
+    if (json->depth == 0 || json->after_key || json_in_object(json) != object)
+    {
+        json->failed = true;
+        return;
+    }
+
+    json->depth--;
+    json_put(json, &c, 1);
+    json->comma = true;
+}
+
+void cHTTPX_JsonObject(chttpx_json_t* json)
+{
+    json_open(json, '{', 1);
+}
+
+void cHTTPX_JsonObjectEnd(chttpx_json_t* json)
+{
+    json_close(json, '}', 1);
+}
+
+void cHTTPX_JsonArray(chttpx_json_t* json)
+{
+    json_open(json, '[', 0);
+}
+
+void cHTTPX_JsonArrayEnd(chttpx_json_t* json)
+{
+    json_close(json, ']', 0);
+}
+
+void cHTTPX_JsonKey(chttpx_json_t* json, const char* key)
+{
+    if (json->failed)
+        return;
+
+    if (!json_in_object(json) || json->after_key || !key)
+    {
+        json->failed = true;
+        return;
+    }
+
+    if (json->comma)
+        json_put(json, ",", 1);
+
+    json_put_string(json, key, strlen(key));
+    json_put(json, ":", 1);
+    json->after_key = true;
+}
+
+void cHTTPX_JsonStringLen(chttpx_json_t* json, const char* s, size_t len)
+{
+    if (!json_value_start(json))
+        return;
+
+    json_put_string(json, s, len);
+    json->comma = true;
+}
+
+void cHTTPX_JsonString(chttpx_json_t* json, const char* s)
+{
+    if (!s)
+    {
+        cHTTPX_JsonNull(json);
+        return;
+    }
+
+    cHTTPX_JsonStringLen(json, s, strlen(s));
+}
+
+void cHTTPX_JsonInt(chttpx_json_t* json, long long value)
+{
+    if (!json_value_start(json))
+        return;
+
+    /* Digits from the end, no format string to parse */
+    char tmp[24];
+    char* p = tmp + sizeof(tmp);
+    unsigned long long u = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+
+    do
+    {
+        *--p = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+
+    if (value < 0)
+        *--p = '-';
+
+    json_put(json, p, (size_t)(tmp + sizeof(tmp) - p));
+    json->comma = true;
+}
+
+void cHTTPX_JsonDouble(chttpx_json_t* json, double value)
+{
+    if (!isfinite(value))
+    {
+        cHTTPX_JsonNull(json);
+        return;
+    }
+
+    /* Whole numbers are written as integers */
+    if (value > -1e15 && value < 1e15 && value == (double)(long long)value)
+    {
+        cHTTPX_JsonInt(json, (long long)value);
+        return;
+    }
+
+    if (!json_value_start(json))
+        return;
+
+    /* Up to 6 decimals (prices, scores, coordinates) without printf: the
+     * digits read back the same when the division by 1e6 gives the value
+     */
+    double scaled_value = value * 1e6;
+    long long scaled = value > -1e12 && value < 1e12 ? (long long)(scaled_value < 0 ? scaled_value - 0.5 : scaled_value + 0.5) : 0;
+    if (scaled && (double)scaled / 1e6 == value)
+    {
+        char tmp[32];
+        char* p = tmp + sizeof(tmp);
+        unsigned long long u = scaled < 0 ? 0ULL - (unsigned long long)scaled : (unsigned long long)scaled;
+        int digits = 0;
+
+        /* Fraction first, its trailing zeros dropped (there is at least one digit: the value is not whole) */
+        for (; digits < 6 && u % 10 == 0; digits++)
+            u /= 10;
+
+        for (; digits < 6; digits++)
+        {
+            *--p = (char)('0' + u % 10);
+            u /= 10;
+        }
+
+        *--p = '.';
+        do
+        {
+            *--p = (char)('0' + u % 10);
+            u /= 10;
+        } while (u);
+
+        if (scaled < 0)
+            *--p = '-';
+
+        json_put(json, p, (size_t)(tmp + sizeof(tmp) - p));
+        json->comma = true;
+        return;
+    }
+
+    /* 15 digits unless they do not read back the same */
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), "%.15g", value);
+    if (strtod(tmp, NULL) != value)
+        n = snprintf(tmp, sizeof(tmp), "%.17g", value);
+
+    json_put(json, tmp, (size_t)n);
+    json->comma = true;
+}
+
+void cHTTPX_JsonBool(chttpx_json_t* json, bool value)
+{
+    if (!json_value_start(json))
+        return;
+
+    if (value)
+        json_put(json, "true", 4);
+    else
+        json_put(json, "false", 5);
+
+    json->comma = true;
+}
+
+void cHTTPX_JsonNull(chttpx_json_t* json)
+{
+    if (!json_value_start(json))
+        return;
+
+    json_put(json, "null", 4);
+    json->comma = true;
+}
+
+void cHTTPX_JsonRaw(chttpx_json_t* json, const char* text, size_t len)
+{
+    if (!json_value_start(json))
+        return;
+
+    json_put(json, text, len);
+    json->comma = true;
+}
@@ -1,3 +1,5 @@
+#define _GNU_SOURCE
+
 /*
  * Copyright (c) 2026 netcorelink
  *
@@ -24,7 +26,10 @@
 
 #include "http.h"
 #include "headers.h"
+#include "body.h"
+#include "utils.h"
 #include "request.h"
+#include "multipart.h"
 #include "crosspltm.h"
 
 #include <time.h>
@@ -33,11 +38,15 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+
+#ifdef CHTTPX_PLATFORM_LINUX
+#include <unistd.h>
+#include <sys/random.h>
+#endif
 
 /* Save body(file) to temp file */
-static int _save_body_to_temp_file(chttpx_request_t* req, char* initial_buffer, size_t initial_len, char* tmp_filename, size_t tmp_filename_size);
-/* Get ext file by content type */
-static const char* content_type_to_ext(const char* content_type);
+static int _save_body_to_temp_file(chttpx_request_t* req, char* tmp_filename, size_t tmp_filename_size);
 
 /* Ext map with content types */
 static const content_type_map_t content_type_map[] = {{cHTTPX_CTYPE_HTML, ".html"},
@@ -85,16 +94,196 @@ static const content_type_map_t content_type_map[] = {{cHTTPX_CTYPE_HTML, ".html
 
                                                       {NULL, ".tmp"}};
 
-/* Parse media in request */
-void _parse_media(chttpx_request_t* req, char* buffer, size_t buffer_len)
+/* Get ext file by content type */
+static const char* content_type_to_ext(const char* content_type)
+{
+    if (!content_type)
+        return ".tmp";
+
+    for (size_t i = 0; content_type_map[i].ctype; i++)
+    {
+        if (strstr(content_type, content_type_map[i].ctype))
+        {
+            return content_type_map[i].ext;
+        }
+    }
+
+    return ".tmp";
+}
+
+#ifdef CHTTPX_PLATFORM_LINUX
+/* Unpredictable name of an upload, "/tmp/upload_<64-bit hex><ext>" */
+static void spool_name(const char* ext, char* path, size_t size)
+{
+    static size_t counter;
+    uint64_t r;
+
+    if (getrandom(&r, sizeof(r), GRND_NONBLOCK) != (ssize_t)sizeof(r))
+        r = ((uint64_t)time(NULL) << 20) ^ ((uint64_t)getpid() << 40) ^ chttpx_atomic_add(&counter, 1);
+
+    snprintf(path, size, MEDIA_TMP_DIR "/upload_%016llx%s", (unsigned long long)r, ext);
+}
+
+int _spool_open(media_spool_t* s, const char* content_type, uint64_t size)
+{
+    s->ext = content_type_to_ext(content_type);
+    s->path[0] = '\0';
+
+    /* Nameless until _spool_commit: a failed upload leaves nothing behind, even on a crash */
+    s->fd = open(MEDIA_TMP_DIR, O_TMPFILE | O_RDWR | O_CLOEXEC, 0666);
+    s->anonymous = s->fd >= 0;
+
+    /* File systems without O_TMPFILE: a named file, removed by _spool_abort */
+    for (int i = 0; s->fd < 0 && i < 16; i++)
+    {
+        spool_name(s->ext, s->path, sizeof(s->path));
+        s->fd = open(s->path, O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0666);
+        if (s->fd < 0 && errno != EEXIST)
+            break;
+    }
+
+    if (s->fd < 0)
+        return -1;
+
+    /* Best effort: the blocks of a body of known size are reserved at once */
+    if (size > 0)
+        fallocate(s->fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)size);
+
+    return 0;
+}
+
+int _spool_write(media_spool_t* s, const void* data, size_t len)
+{
+    const char* p = data;
+
+    while (len > 0)
+    {
+        ssize_t n = write(s->fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            return -1;
+
+        p += n;
+        len -= (size_t)n;
+    }
+
+    return 0;
+}
+
+int _spool_commit(media_spool_t* s, char* path, size_t path_size)
+{
+    if (s->anonymous)
+    {
+        char proc[64];
+        snprintf(proc, sizeof(proc), "/proc/self/fd/%d", s->fd);
+
+        int linked = -1;
+        for (int i = 0; linked != 0 && i < 16; i++)
+        {
+            spool_name(s->ext, s->path, sizeof(s->path));
+
+            /* Without /proc, AT_EMPTY_PATH (needs CAP_DAC_READ_SEARCH) */
+            linked = linkat(AT_FDCWD, proc, AT_FDCWD, s->path, AT_SYMLINK_FOLLOW);
+            if (linked != 0 && errno == ENOENT)
+                linked = linkat(s->fd, "", AT_FDCWD, s->path, AT_EMPTY_PATH);
+
+            if (linked != 0 && errno != EEXIST)
+                break;
+        }
+
+        if (linked != 0)
+        {
+            close(s->fd);
+            s->fd = -1;
+            return -1;
+        }
+    }
+
+    int failed = close(s->fd) != 0;
+    s->fd = -1;
+
+    if (failed)
+    {
+        unlink(s->path);
+        return -1;
+    }
+
+    snprintf(path, path_size, "%s", s->path);
+    return 0;
+}
+
+void _spool_abort(media_spool_t* s)
+{
+    if (s->fd < 0)
+        return;
+
+    close(s->fd);
+    s->fd = -1;
+
+    if (!s->anonymous)
+        unlink(s->path);
+}
+
+#else
+
+int _spool_open(media_spool_t* s, const char* content_type, uint64_t size)
+{
+    (void)size;
+
+    snprintf(s->path, sizeof(s->path), MEDIA_TMP_DIR "/upload_%ld_%d%s", (long)time(NULL), rand(), content_type_to_ext(content_type));
+    s->file = fopen(s->path, "wb");
+
+    return s->file ? 0 : -1;
+}
+
+int _spool_write(media_spool_t* s, const void* data, size_t len)
+{
+    return fwrite(data, 1, len, s->file) == len ? 0 : -1;
+}
+
+int _spool_commit(media_spool_t* s, char* path, size_t path_size)
+{
+    int failed = fclose(s->file) != 0;
+    s->file = NULL;
+
+    if (failed)
+    {
+        remove(s->path);
+        return -1;
+    }
+
+    snprintf(path, path_size, "%s", s->path);
+    return 0;
+}
+
+void _spool_abort(media_spool_t* s)
 {
-    if (!req->content_type)
+    if (!s->file)
         return;
 
-    if (req->content_length > 0 && (!req->content_type || !strstr(req->content_type, cHTTPX_CTYPE_JSON)))
+    fclose(s->file);
+    s->file = NULL;
+    remove(s->path);
+}
+
+#endif
+
+/* Parse media in request */
+void _parse_media(chttpx_request_t* req)
+{
+    if ((req->content_length > 0 || req->body_reader.chunked) && !strstr(req->content_type, cHTTPX_CTYPE_JSON))
     {
+        /* Parts are split into fields and files of their own */
+        if (strncasecmp(req->content_type, cHTTPX_CTYPE_MULTI, strlen(cHTTPX_CTYPE_MULTI)) == 0)
+        {
+            _parse_multipart(req);
+            return;
+        }
+
         char tmp_filename[512];
-        if (_save_body_to_temp_file(req, buffer, buffer_len, tmp_filename, sizeof(tmp_filename)) != 0)
+        if (_save_body_to_temp_file(req, tmp_filename, sizeof(tmp_filename)) != 0)
         {
             fprintf(stderr, "error write body in temp file\n");
             return;
@@ -108,79 +297,68 @@ void _parse_media(chttpx_request_t* req, char* buffer, size_t buffer_len)
 }
 
 /* Save file to temp file */
-static int _save_body_to_temp_file(chttpx_request_t* req, char* initial_buffer, size_t initial_len, char* tmp_filename, size_t tmp_filename_size)
+static int _save_body_to_temp_file(chttpx_request_t* req, char* tmp_filename, size_t tmp_filename_size)
 {
-    const char* ext = content_type_to_ext(req->content_type);
+    /* Only a plain Content-Length body tells its size up front */
+    bool sized = !req->body_reader.chunked && !req->body_reader.inflate;
 
-    snprintf(tmp_filename, tmp_filename_size, "/tmp/upload_%ld_%d%s", time(NULL), rand(), ext);
-    FILE* f = fopen(tmp_filename, "wb");
-    if (!f)
+    media_spool_t spool;
+    if (_spool_open(&spool, req->content_type, sized ? req->content_length : 0) != 0)
         return 1;
 
-    size_t total_written = 0;
-
-    const char* body_start = memmem(initial_buffer, initial_len, "\r\n\r\n", 4);
-    if (!body_start)
+    /* Text bodies are already read into memory by _parse_req_body */
+    if (req->body && req->body_size > 0)
     {
-        fclose(f);
-        return 1;
-    }
-
-    body_start += 4;
-    size_t body_in_buffer = initial_len - (body_start - initial_buffer);
-    if (body_in_buffer > req->content_length)
-        body_in_buffer = req->content_length;
+        if (_spool_write(&spool, req->body, req->body_size) != 0 || req->body_size != req->content_length)
+        {
+            _spool_abort(&spool);
+            return 1;
+        }
 
-    if (fwrite(body_start, 1, body_in_buffer, f) != body_in_buffer)
-    {
-        fclose(f);
-        return 1;
+        return _spool_commit(&spool, tmp_filename, tmp_filename_size) != 0;
     }
-    total_written += body_in_buffer;
 
-    unsigned char tmp_buf[FILE_BUFFER];
+    size_t total_written = 0;
 
-    while (total_written < req->content_length)
+#ifdef CHTTPX_PLATFORM_LINUX
+    /* Socket to file inside the kernel */
+    if (_body_can_splice(req))
     {
-        size_t to_read = FILE_BUFFER;
-        if (req->content_length - total_written < to_read)
-            to_read = req->content_length - total_written;
-
-        ssize_t n = recv(req->client_fd, tmp_buf, to_read, 0);
-        if (n <= 0)
+        long n = _body_splice(req, spool.fd);
+        if (n < 0)
         {
-            if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
-                continue;
-            fclose(f);
+            _spool_abort(&spool);
             return 1;
         }
 
-        if (fwrite(tmp_buf, 1, n, f) != (size_t)n)
+        return _spool_commit(&spool, tmp_filename, tmp_filename_size) != 0;
+    }
+#endif
+
+    unsigned char tmp_buf[FILE_BUFFER];
+    long n;
+
+    /* The rest of the receive buffer, then the socket (de-chunked, inflated) */
+    while ((n = cHTTPX_BodyRead(req, tmp_buf, sizeof(tmp_buf))) > 0)
+    {
+        if (_spool_write(&spool, tmp_buf, (size_t)n) != 0)
         {
-            fclose(f);
+            _spool_abort(&spool);
             return 1;
         }
 
-        total_written += n;
+        total_written += (size_t)n;
     }
 
-    fclose(f);
-    return 0;
-}
-
-/* Get ext file by content type */
-static const char* content_type_to_ext(const char* content_type)
-{
-    if (!content_type)
-        return ".tmp";
-
-    for (size_t i = 0; content_type_map[i].ctype; i++)
+    if (n < 0)
     {
-        if (strstr(content_type, content_type_map[i].ctype))
-        {
-            return content_type_map[i].ext;
-        }
+        _spool_abort(&spool);
+        return 1;
     }
 
-    return ".tmp";
-}
\ No newline at end of file
+    /* The size of a chunked or compressed body is only known now */
+    if (!sized)
+        req->content_length = total_written;
+
+    return _spool_commit(&spool, tmp_filename, tmp_filename_size) != 0;
+}
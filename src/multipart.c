@@ -0,0 +1,497 @@
+#define _GNU_SOURCE
+
+/*
+ * Copyright (c) 2026 netcorelink
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "multipart.h"
+
+#include "http.h"
+#include "media.h"
+#include "utils.h"
+#include "crosspltm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* Window over the body; holds a part's header section and the delimiter searched across reads */
+#define MULTIPART_WINDOW FILE_BUFFER
+/* Spaces allowed between a boundary and its CRLF */
+#define MULTIPART_PADDING_MAX 256
+
+/* Parser states */
+enum
+{
+    /* Before the first boundary, dropped */
+    MP_PREAMBLE = 0,
+    /* Right after a boundary: "--" closes the body, CRLF opens a part */
+    MP_BOUNDARY,
+    MP_HEADERS,
+    MP_DATA,
+    /* After the closing boundary, read and dropped */
+    MP_EPILOGUE,
+};
+
+/* Parameter of a header value, `name="a b"` or `name=ab`, copied into the arena */
+static const char* header_param(chttpx_request_t* req, const char* value, size_t len, const char* key)
+{
+    const char* p = value;
+    const char* end = value + len;
+    size_t key_len = strlen(key);
+
+    while (p < end)
+    {
+        /* Next parameter, after a ';' */
+        const char* semi = memchr(p, ';', (size_t)(end - p));
+        if (!semi)
+            return NULL;
+
+        p = semi + 1;
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+
+        if ((size_t)(end - p) <= key_len || strncasecmp(p, key, key_len) != 0 || p[key_len] != '=')
+            continue;
+
+        p += key_len + 1;
+
+        if (p < end && *p == '"')
+        {
+            /* Quoted string, backslash escapes */
+            char* out = _arena_alloc(req->arena, (size_t)(end - p));
+            if (!out)
+                return NULL;
+
+            size_t n = 0;
+            for (p++; p < end && *p != '"'; p++)
+            {
+                if (*p == '\\' && p + 1 < end)
+                    p++;
+                out[n++] = *p;
+            }
+
+            out[n] = '\0';
+            return out;
+        }
+
+        const char* v = p;
+        while (p < end && *p != ';' && *p != ' ' && *p != '\t')
+            p++;
+
+        return _arena_strndup(req->arena, v, (size_t)(p - v));
+    }
+
+    return NULL;
+}
+
+/* Delimiter of the body, "\r\n--" and the boundary of the Content-Type */
+static int multipart_delimiter(chttpx_request_t* req, char* delim, size_t* delim_len)
+{
+    const char* boundary = header_param(req, req->content_type, strlen(req->content_type), "boundary");
+    if (!boundary)
+        return -1;
+
+    size_t len = strlen(boundary);
+    if (len == 0 || len > MULTIPART_BOUNDARY_MAX)
+        return -1;
+
+    memcpy(delim, "\r\n--", 4);
+    memcpy(delim + 4, boundary, len);
+    *delim_len = len + 4;
+
+    return 0;
+}
+
+/* Parse the header section of a part (header lines, each ending with CRLF) */
+static int multipart_headers(chttpx_request_t* req, const char* p, const char* end, chttpx_part_t* part)
+{
+    memset(part, 0, sizeof(*part));
+    part->name = "";
+    part->content_type = "";
+    part->path = "";
+
+    while (p < end)
+    {
+        const char* eol = memmem(p, (size_t)(end - p), "\r\n", 2);
+        if (!eol)
+            eol = end;
+
+        const char* colon = memchr(p, ':', (size_t)(eol - p));
+        if (colon)
+        {
+            size_t name_len = (size_t)(colon - p);
+            const char* v = colon + 1;
+            while (v < eol && (*v == ' ' || *v == '\t'))
+                v++;
+            size_t v_len = (size_t)(eol - v);
+
+            if (name_len == 19 && strncasecmp(p, "Content-Disposition", 19) == 0)
+            {
+                const char* name = header_param(req, v, v_len, "name");
+                if (name)
+                    part->name = name;
+
+                part->filename = header_param(req, v, v_len, "filename");
+            }
+            else if (name_len == 12 && strncasecmp(p, "Content-Type", 12) == 0)
+            {
+                const char* ct = _arena_strndup(req->arena, v, v_len);
+                if (!ct)
+                    return -1;
+                part->content_type = ct;
+            }
+        }
+
+        p = eol + 2;
+    }
+
+    return 0;
+}
+
+int cHTTPX_Multipart(chttpx_request_t* req, chttpx_part_fn on_part, void* userdata)
+{
+    char delim[4 + MULTIPART_BOUNDARY_MAX];
+    size_t delim_len;
+
+    if (multipart_delimiter(req, delim, &delim_len) != 0)
+        return -1;
+
+    char* buf = _arena_alloc(req->arena, MULTIPART_WINDOW);
+    if (!buf)
+        return -1;
+
+    /* The first boundary may open the body without the CRLF of a delimiter */
+    memcpy(buf, "\r\n", 2);
+    size_t len = 2;
+
+    chttpx_part_t part;
+    memset(&part, 0, sizeof(part));
+
+    int state = MP_PREAMBLE;
+    bool eof = false;
+
+    for (;;)
+    {
+        if (!eof)
+        {
+            long n = cHTTPX_BodyRead(req, buf + len, MULTIPART_WINDOW - len);
+            if (n < 0)
+                return -1;
+
+            eof = n == 0;
+            len += (size_t)n;
+        }
+
+        /* Consume what the window holds until a state needs more bytes */
+        size_t pos = 0;
+        bool more = false;
+
+        while (!more)
+        {
+            switch (state)
+            {
+            case MP_PREAMBLE:
+            case MP_DATA:
+            {
+                const char* hit = memmem(buf + pos, len - pos, delim, delim_len);
+
+                /* Without a delimiter, all but its possible start at the end of the window */
+                size_t end;
+                if (hit)
+                    end = (size_t)(hit - buf);
+                else
+                    end = len - pos >= delim_len ? len - delim_len + 1 : pos;
+
+                if (state == MP_DATA && end > pos)
+                {
+                    if (on_part(&part, buf + pos, end - pos, userdata) != 0)
+                        return -1;
+                    part.size += end - pos;
+                }
+
+                pos = end;
+                if (!hit)
+                {
+                    more = true;
+                    break;
+                }
+
+                if (state == MP_DATA && on_part(&part, NULL, 0, userdata) != 0)
+                    return -1;
+
+                pos += delim_len;
+                state = MP_BOUNDARY;
+                break;
+            }
+
+            case MP_BOUNDARY:
+            {
+                if (len - pos < 2)
+                {
+                    more = true;
+                    break;
+                }
+
+                if (buf[pos] == '-' && buf[pos + 1] == '-')
+                {
+                    state = MP_EPILOGUE;
+                    break;
+                }
+
+                /* Transport padding, then the CRLF ending the boundary line */
+                size_t i = pos;
+                while (i < len && (buf[i] == ' ' || buf[i] == '\t'))
+                    i++;
+
+                if (i - pos > MULTIPART_PADDING_MAX)
+                    return -1;
+
+                if (len - i < 2)
+                {
+                    more = true;
+                    break;
+                }
+
+                if (buf[i] != '\r' || buf[i + 1] != '\n')
+                    return -1;
+
+                /* The CRLF stays: an empty header section is then "\r\n\r\n" too */
+                pos = i;
+                state = MP_HEADERS;
+                break;
+            }
+
+            case MP_HEADERS:
+            {
+                const char* end = memmem(buf + pos, len - pos, "\r\n\r\n", 4);
+                if (!end)
+                {
+                    if (len - pos > MULTIPART_HEADERS_MAX)
+                        return -1;
+
+                    more = true;
+                    break;
+                }
+
+                if (multipart_headers(req, buf + pos + 2, end + 2, &part) != 0)
+                    return -1;
+
+                pos = (size_t)(end - buf) + 4;
+                state = MP_DATA;
+                break;
+            }
+
+            default:
+                /* Epilogue */
+                pos = len;
+                more = true;
+                break;
+            }
+        }
+
+        /* Keep what is left for the next read */
+        memmove(buf, buf + pos, len - pos);
+        len -= pos;
+
+        if (eof)
+            return state == MP_EPILOGUE ? 0 : -1;
+    }
+}
+
+/* Parts read before the handler, see _parse_multipart */
+typedef struct
+{
+    chttpx_request_t* req;
+    /* Part being stored, NULL between parts */
+    chttpx_part_t* current;
+    /* Temp file of the current part, or its value growing in the arena */
+    media_spool_t spool;
+    bool spooled;
+    char* value;
+    size_t value_cap;
+} multipart_store_t;
+
+/* Move the current part into a temp file of its own, named once the part is complete */
+static int store_open_file(multipart_store_t* st)
+{
+    chttpx_part_t* part = st->current;
+
+    const char* content_type = part->content_type[0] ? part->content_type : part->filename ? cHTTPX_CTYPE_OCTET : cHTTPX_CTYPE_TEXT;
+    if (_spool_open(&st->spool, content_type, 0) != 0)
+        return -1;
+
+    st->spooled = true;
+
+    /* A field too large for memory: what was kept goes first */
+    if (st->value && part->size > 0 && _spool_write(&st->spool, st->value, part->size) != 0)
+        return -1;
+
+    st->value = NULL;
+    return 0;
+}
+
+static int store_begin(multipart_store_t* st, const chttpx_part_t* part)
+{
+    chttpx_request_t* req = st->req;
+
+    if (req->parts_count >= MULTIPART_MAX_PARTS)
+        return -1;
+
+    if (req->parts_count == req->parts_cap)
+    {
+        chttpx_part_t* grown = _arena_grow(req->arena, req->parts, req->parts_count, &req->parts_cap, sizeof(chttpx_part_t));
+        if (!grown)
+            return -1;
+
+        req->parts = grown;
+    }
+
+    st->current = &req->parts[req->parts_count++];
+    *st->current = *part;
+    st->current->size = 0;
+
+    st->spooled = false;
+    st->value = NULL;
+    st->value_cap = 0;
+
+    return part->filename ? store_open_file(st) : 0;
+}
+
+static int store_part(const chttpx_part_t* part, const char* data, size_t len, void* userdata)
+{
+    multipart_store_t* st = userdata;
+
+    if (!st->current && store_begin(st, part) != 0)
+        return -1;
+
+    chttpx_part_t* cur = st->current;
+
+    /* End of the part */
+    if (!data)
+    {
+        st->current = NULL;
+
+        if (st->spooled)
+        {
+            char path[sizeof(st->spool.path)];
+
+            st->spooled = false;
+            if (_spool_commit(&st->spool, path, sizeof(path)) != 0)
+                return -1;
+
+            cur->path = _arena_strndup(st->req->arena, path, strlen(path));
+            return cur->path ? 0 : -1;
+        }
+
+        cur->value = st->value ? st->value : "";
+        return 0;
+    }
+
+    if (!st->spooled && cur->size + len > MULTIPART_FIELD_MAX && store_open_file(st) != 0)
+        return -1;
+
+    if (st->spooled)
+    {
+        if (_spool_write(&st->spool, data, len) != 0)
+            return -1;
+
+        cur->size += len;
+        return 0;
+    }
+
+    /* Field value, doubled as it grows */
+    if (cur->size + len + 1 > st->value_cap)
+    {
+        size_t cap = st->value_cap ? st->value_cap : 256;
+        while (cap < cur->size + len + 1)
+            cap *= 2;
+
+        char* grown = _arena_alloc(st->req->arena, cap);
+        if (!grown)
+            return -1;
+
+        if (st->value)
+            memcpy(grown, st->value, cur->size);
+
+        st->value = grown;
+        st->value_cap = cap;
+    }
+
+    memcpy(st->value + cur->size, data, len);
+    cur->size += len;
+    st->value[cur->size] = '\0';
+
+    return 0;
+}
+
+void _parse_multipart(chttpx_request_t* req)
+{
+    multipart_store_t st = {.req = req};
+
+    if (cHTTPX_Multipart(req, store_part, &st) == 0)
+    {
+        /* Handlers of single file uploads keep using req->filename */
+        for (size_t i = 0; i < req->parts_count; i++)
+        {
+            if (req->parts[i].filename)
+            {
+                snprintf(req->filename, sizeof(req->filename), "%s", req->parts[i].path);
+                break;
+            }
+        }
+
+        return;
+    }
+
+    /* A broken body leaves nothing behind */
+    if (st.spooled)
+        _spool_abort(&st.spool);
+
+    for (size_t i = 0; i < req->parts_count; i++)
+    {
+        if (req->parts[i].path[0])
+            remove(req->parts[i].path);
+    }
+
+    req->parts_count = 0;
+}
+
+const chttpx_part_t* cHTTPX_FormPart(chttpx_request_t* req, const char* name)
+{
+    if (!req || !name)
+        return NULL;
+
+    for (size_t i = 0; i < req->parts_count; i++)
+    {
+        if (strcmp(req->parts[i].name, name) == 0)
+            return &req->parts[i];
+    }
+
+    return NULL;
+}
+
+const char* cHTTPX_FormValue(chttpx_request_t* req, const char* name)
+{
+    const chttpx_part_t* part = cHTTPX_FormPart(req, name);
+
+    return part && !part->filename ? part->value : NULL;
+}
@@ -43,18 +43,13 @@ int cHTTPX_MatchPath(const char* template, const char* path, chttpx_param_t* par
             if (count >= MAX_PARAMS)
                 return 0;
 
-            size_t name_len = (size_t)(t_end - t - 1);
-            if (name_len >= MAX_PARAM_NAME)
-                name_len = MAX_PARAM_NAME - 1;
-            strncpy(params[count].name, t + 1, name_len);
-            params[count].name[name_len] = 0;
-
             const char* slash = strchr(p, '/');
             size_t val_len = slash ? (size_t)(slash - p) : strlen(p);
-            if (val_len >= MAX_PARAM_VALUE)
-                val_len = MAX_PARAM_VALUE - 1;
-            strncpy(params[count].value, p, val_len);
-            params[count].value[val_len] = 0;
+
+            params[count].name = t + 1;
+            params[count].name_len = (size_t)(t_end - t - 1);
+            params[count].value = p;
+            params[count].value_len = val_len;
 
             count++;
             t = t_end + 1;
@@ -88,13 +83,43 @@ const char* cHTTPX_Param(chttpx_request_t* req, const char* name)
     if (!req || !name || req->params_count == 0)
         return NULL;
 
+    size_t name_len = strlen(name);
+
     for (size_t i = 0; i < req->params_count; i++)
     {
-        if (strcmp(req->params[i].name, name) == 0)
+        if (req->params[i].name_len == name_len && memcmp(req->params[i].name, name, name_len) == 0)
         {
             return req->params[i].value;
         }
     }
 
     return NULL;
-}
\ No newline at end of file
+}
+/* Store matched params on the REQuest as NUL-terminated arena copies */
+int _req_set_params(chttpx_request_t* req, const chttpx_param_t* params, size_t count)
+{
+    chttpx_param_t* dst = req->params_inline;
+
+    if (count > REQ_INLINE_PARAMS)
+    {
+        dst = _arena_alloc(req->arena, count * sizeof(chttpx_param_t));
+        if (!dst)
+            return -1;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        dst[i].name = _arena_strndup(req->arena, params[i].name, params[i].name_len);
+        dst[i].name_len = params[i].name_len;
+        dst[i].value = _arena_strndup(req->arena, params[i].value, params[i].value_len);
+        dst[i].value_len = params[i].value_len;
+
+        if (!dst[i].name || !dst[i].value)
+            return -1;
+    }
+
+    req->params = dst;
+    req->params_count = count;
+
+    return 0;
+}
@@ -36,12 +36,14 @@
  */
 const char* cHTTPX_Query(chttpx_request_t* req, const char* name)
 {
-    if (!req || !req->query || req->query_count == 0)
+    if (!req || req->query_count == 0 || !name)
         return NULL;
 
+    size_t name_len = strlen(name);
+
     for (size_t i = 0; i < req->query_count; i++)
     {
-        if (strcmp(req->query[i].name, name) == 0)
+        if (req->query[i].name_len == name_len && memcmp(req->query[i].name, name, name_len) == 0)
         {
             return req->query[i].value;
         }
@@ -50,25 +52,38 @@ const char* cHTTPX_Query(chttpx_request_t* req, const char* name)
     return NULL;
 }
 
-/* Parse queries in request */
+/* Parse queries in request: split the query string in place */
 void _parse_req_query(chttpx_request_t* req, char* query)
 {
-    char* token = strtok(query, "&");
+    char* token = query;
 
-    while (token)
+    while (token && req->query_count < MAX_QUERIES)
     {
+        char* amp = strchr(token, '&');
+        if (amp)
+            *amp = '\0';
+
         char* eq = strchr(token, '=');
         if (eq)
         {
-            *eq = '\0';
+            if (req->query_count == req->query_cap)
+            {
+                chttpx_query_t* grown = _arena_grow(req->arena, req->query, req->query_count, &req->query_cap, sizeof(chttpx_query_t));
+                if (!grown)
+                    return;
 
-            req->query = realloc(req->query, sizeof(chttpx_query_t) * (req->query_count + 1));
+                req->query = grown;
+            }
+
+            *eq = '\0';
 
-            req->query[req->query_count].name = strdup(token);
-            req->query[req->query_count].value = strdup(eq + 1);
-            req->query_count++;
+            chttpx_query_t* q = &req->query[req->query_count++];
+            q->name = token;
+            q->name_len = (size_t)(eq - token);
+            q->value = eq + 1;
+            q->value_len = strlen(eq + 1);
         }
 
-        token = strtok(NULL, "&");
+        token = amp ? amp + 1 : NULL;
     }
 }
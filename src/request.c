@@ -23,14 +23,9 @@
 #include "request.h"
 
 #include "i18n.h"
+#include "json.h"
 #include "crosspltm.h"
 
-#if defined(_WIN32) || defined(_WIN64)
-#include "../lib/cjson/cJSON.h"
-#else
-#include <cjson/cJSON.h>
-#endif
-
 #include <ctype.h>
 #include <stdio.h>
 
@@ -52,119 +47,56 @@ validation_messages_t messages_ru = {"поле '%s' обязательно", "м
 validation_messages_t* messages[] = {&messages_en, &messages_ru};
 
 /**
- * Parse a JSON body and validate fields according to the provided definitions.
+ * Allocate memory that lives until the response to the REQuest is sent.
  * @param req Pointer to the HTTP request.
- * @param fields Array of field validation definitions (cHTTPX_FieldValidation).
- * @param field_count Number of fields in the array.
- * @return 1 if parsing and validation succeed, 0 if there is an error.
- * This function automatically checks required fields, string length, boolean types, etc.
+ * @param size Number of bytes.
+ * @return Pointer aligned for any type, NULL if out of memory.
  */
-int cHTTPX_Parse(chttpx_request_t* req, chttpx_validation_t* fields, size_t field_count)
+void* cHTTPX_Alloc(chttpx_request_t* req, size_t size)
 {
-    char* body = malloc(req->body_size + 1);
-    if (!body)
-        return 0;
+    if (!req || !req->arena)
+        return NULL;
 
-    memcpy(body, (const void*)req->body, req->body_size);
-    body[req->body_size] = '\0';
+    return _arena_alloc(req->arena, size);
+}
 
-    cJSON* json = cJSON_Parse(body);
-    free(body);
+/**
+ * Copy a string into the REQuest arena.
+ * @param req Pointer to the HTTP request.
+ * @param s String to copy.
+ * @return Copy of s, NULL if out of memory.
+ */
+char* cHTTPX_Strdup(chttpx_request_t* req, const char* s)
+{
+    if (!req || !req->arena || !s)
+        return NULL;
 
-    if (!json)
-    {
-        snprintf(req->error_msg, sizeof(req->error_msg), "Invalid JSON");
-        return 0;
-    }
+    return _arena_strndup(req->arena, s, strlen(s));
+}
 
-    for (size_t i = 0; i < field_count; i++)
-    {
-        chttpx_validation_t* f = &fields[i];
-        cJSON* item = cJSON_GetObjectItem(json, f->name);
-
-        if (!item)
-            continue;
-
-        f->present = 1;
-
-        switch (f->type)
-        {
-        case FIELD_STRING:
-            if (cJSON_IsString(item))
-            {
-                *(char**)f->target = NULL;
-                *(char**)f->target = strdup(item->valuestring);
-            }
-            break;
-
-        case FIELD_STRING_ARRAY:
-            if (cJSON_IsArray(item))
-            {
-                size_t count = cJSON_GetArraySize(item);
-
-                chttpx_string_array_t* arr = (chttpx_string_array_t*)f->target;
-                arr->count = count;
-                arr->items = malloc(sizeof(char*) * count);
-
-                for (size_t j = 0; j < count; j++)
-                {
-                    cJSON* el = cJSON_GetArrayItem(item, j);
-                    if (cJSON_IsString(el))
-                    {
-                        arr->items[j] = strdup(el->valuestring);
-                    }
-                    else
-                    {
-                        arr->items[j] = NULL;
-                    }
-                }
-            }
-            break;
-
-        case FIELD_NUMBER:
-            if (cJSON_IsNumber(item))
-            {
-                *(int*)f->target = 0;
-                *(int*)f->target = item->valueint;
-            }
-            break;
-
-        case FIELD_NUMBER_ARRAY:
-            if (cJSON_IsArray(item))
-            {
-                size_t count = cJSON_GetArraySize(item);
-
-                chttpx_number_array_t* arr = (chttpx_number_array_t*)f->target;
-                arr->count = count;
-                arr->items = malloc(sizeof(int) * count);
-
-                for (size_t j = 0; j < count; j++)
-                {
-                    cJSON* el = cJSON_GetArrayItem(item, j);
-                    if (cJSON_IsNumber(el))
-                    {
-                        arr->items[j] = el->valueint;
-                    }
-                    else
-                    {
-                        arr->items[j] = 0;
-                    }
-                }
-            }
-            break;
-
-        case FIELD_BOOL:
-            if (cJSON_IsBool(item))
-            {
-                *(uint8_t*)f->target = 0;
-                *(uint8_t*)f->target = cJSON_IsTrue(item);
-            }
-            break;
-        }
-    }
+/**
+ * Parse a JSON body into the fields, see _json_decode.
+ * @param req Pointer to the HTTP request.
+ * @param fields Array of field validation definitions (cHTTPX_FieldValidation).
+ * @param field_count Number of fields in the array.
+ * @return 1 if the body is valid JSON, 0 if there is an error.
+ */
+int cHTTPX_Parse(chttpx_request_t* req, chttpx_validation_t* fields, size_t field_count)
+{
+    return _json_decode(req, fields, field_count, 0, NULL);
+}
 
-    cJSON_Delete(json);
-    return 1;
+/**
+ * Parse a JSON body into the fields and validate them in the same pass, see _json_decode.
+ * @param req Pointer to the HTTP request.
+ * @param fields Array of field validation definitions.
+ * @param field_count Number of fields in the array.
+ * @param l Language of the error messages.
+ * @return 1 if parsing and validation succeed, 0 if there is an error.
+ */
+int cHTTPX_ParseValidate(chttpx_request_t* req, chttpx_validation_t* fields, size_t field_count, const char* l)
+{
+    return _json_decode(req, fields, field_count, JSON_DECODE_ARENA | JSON_DECODE_VALIDATE, l);
 }
 
 /* Validator email string */
@@ -192,7 +124,8 @@ static int is_valid_email(const char* email)
 
 static void set_error(char* error_msg, size_t error_size, i18n_language_t lang, int key, const char* field_name, size_t num)
 {
-    validation_messages_t* msg = messages[lang];
+    /* Languages without validation messages get the English ones */
+    validation_messages_t* msg = (size_t)lang < sizeof(messages) / sizeof(messages[0]) ? messages[lang] : messages[LANG_EN];
 
     switch (key)
     {
@@ -214,6 +147,58 @@ static void set_error(char* error_msg, size_t error_size, i18n_language_t lang,
     }
 }
 
+/* Check one field the way cHTTPX_Validate does */
+int _validate_field(chttpx_request_t* req, const chttpx_validation_t* f, int lang)
+{
+    if (!f->present)
+    {
+        if (!f->required)
+            return 1;
+
+        set_error(req->error_msg, sizeof(req->error_msg), lang, 0, f->name, 0);
+        return 0;
+    }
+
+    if (f->type != FIELD_STRING)
+        return 1;
+
+    const char* v = *(char**)f->target;
+
+    /* Present with a value of another type (cHTTPX_Parse leaves the target as it was) */
+    if (!v)
+    {
+        _validate_type_error(req, f, lang);
+        return 0;
+    }
+
+    size_t len = strlen(v);
+
+    if (f->min_length && len < f->min_length)
+    {
+        set_error(req->error_msg, sizeof(req->error_msg), lang, 1, f->name, f->min_length);
+        return 0;
+    }
+
+    if (f->max_length && len > f->max_length)
+    {
+        set_error(req->error_msg, sizeof(req->error_msg), lang, 2, f->name, f->max_length);
+        return 0;
+    }
+
+    if (f->validator == VALIDATOR_EMAIL && !is_valid_email(v))
+    {
+        set_error(req->error_msg, sizeof(req->error_msg), lang, 3, f->name, 0);
+        return 0;
+    }
+
+    return 1;
+}
+
+void _validate_type_error(chttpx_request_t* req, const chttpx_validation_t* f, int lang)
+{
+    set_error(req->error_msg, sizeof(req->error_msg), lang, 4, f->name, 0);
+}
+
 /*
  * Validates an array of cHTTPX_FieldValidation structures.
  * This function ensures that required fields are present, string lengths are within limits,
@@ -225,40 +210,8 @@ int cHTTPX_Validate(chttpx_request_t* req, chttpx_validation_t* fields, size_t f
 
     for (size_t i = 0; i < field_count; i++)
     {
-        chttpx_validation_t* f = &fields[i];
-
-        if (f->required && !f->present)
-        {
-            set_error(req->error_msg, sizeof(req->error_msg), lang, 0, f->name, 0);
+        if (!_validate_field(req, &fields[i], lang))
             return 0;
-        }
-
-        if (!f->present)
-            continue;
-
-        if (f->type == FIELD_STRING)
-        {
-            char* v = *(char**)f->target;
-            size_t len = strlen(v);
-
-            if (f->min_length && len < f->min_length)
-            {
-                set_error(req->error_msg, sizeof(req->error_msg), lang, 1, f->name, f->min_length);
-                return 0;
-            }
-
-            if (f->max_length && len > f->max_length)
-            {
-                set_error(req->error_msg, sizeof(req->error_msg), lang, 2, f->name, f->max_length);
-                return 0;
-            }
-
-            if (f->validator == VALIDATOR_EMAIL && !is_valid_email(v))
-            {
-                set_error(req->error_msg, sizeof(req->error_msg), lang, 3, f->name, 0);
-                return 0;
-            }
-        }
     }
 
     return 1;
@@ -1,3 +1,5 @@
+#define _GNU_SOURCE
+
 /*
  * Copyright (c) 2026 netcorelink
  *
@@ -25,17 +27,38 @@
 #include "inet.h"
 #include "body.h"
 #include "http.h"
+#include "hash.h"
+#include "compress.h"
 #include "serv.h"
 #include "media.h"
 #include "headers.h"
 #include "cookies.h"
 #include "queries.h"
 #include "params.h"
+#include "static.h"
+#include "sse.h"
 #include "crosspltm.h"
 #include "websocket.h"
+#include "json_writer.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdarg.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <poll.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef CHTTPX_PLATFORM_LINUX
+#include <sys/sendfile.h>
+#endif
+
+/* Buffer of the read/send fallback for file bodies */
+#define SEND_FILE_CHUNK 65536
 
 chttpx_response_t cHTTPX_ResJson(uint16_t status, const char* fmt, ...);
 
@@ -47,45 +70,52 @@ static chttpx_route_t* find_route(chttpx_request_t* req)
         return NULL;
     }
 
-    for (size_t i = 0; i < serv->routes_count; i++)
-    {
-        if (strcmp(serv->routes[i].method, req->method) != 0)
-            continue;
+    chttpx_param_t params[MAX_PARAMS];
+    int count = 0;
 
-        int count = 0;
-        if (cHTTPX_MatchPath(serv->routes[i].path, req->path, req->params, &count))
-        {
-            req->params_count = count;
-            return &serv->routes[i];
-        }
-    }
+    long i = _router_find(serv->route_tree, req->method, req->path, params, &count);
+    if (i < 0)
+        return NULL;
 
-    return NULL;
+    _req_set_params(req, params, (size_t)count);
+    return &serv->routes[i];
 }
 
-static ssize_t read_req(int fd, char* buffer, size_t buffer_size)
+/* Whether the route of a REQuest reads the body itself (cHTTPX_RouteBodyStream) */
+static bool route_streams_body(chttpx_request_t* req)
 {
-    size_t total = 0;
+    if (!serv || !serv->route_tree)
+        return false;
 
-    while (1)
-    {
-        if (total >= buffer_size - 1)
-            break;
+    chttpx_param_t params[MAX_PARAMS];
+    int count = 0;
 
-        ssize_t n = recv(fd, buffer + total, buffer_size - 1 - total, 0);
-        if (n <= 0)
-            return -1;
+    long i = _router_find(serv->route_tree, req->method, req->path, params, &count);
+    return i >= 0 && serv->routes[i].body_stream;
+}
 
-        total += n;
+/* Wait until the socket is readable, 0 on timeout or error */
+static int wait_readable(chttpx_socket_t fd, uint16_t timeout_sec)
+{
+#ifdef _WIN32
+    WSAPOLLFD pfd = {0};
+    pfd.fd = fd;
+    pfd.events = POLLRDNORM;
 
-        if (total < buffer_size)
-            buffer[total] = '\0';
+    return WSAPoll(&pfd, 1, (int)timeout_sec * 1000) > 0;
+#else
+    struct pollfd pfd = {0};
+    pfd.fd = fd;
+    pfd.events = POLLIN;
 
-        if (memmem(buffer, total, "\r\n\r\n", 4))
-            break;
-    }
+    int r;
+    do
+    {
+        r = poll(&pfd, 1, (int)timeout_sec * 1000);
+    } while (r < 0 && errno == EINTR);
 
-    return total;
+    return r > 0;
+#endif
 }
 
 static void set_client_timeout(chttpx_socket_t client_fd)
@@ -115,6 +145,22 @@ static void set_client_timeout(chttpx_socket_t client_fd)
 #endif
 }
 
+/* Wait for the next keep-alive REQuest, 0 if the connection should close */
+static int wait_idle(chttpx_socket_t client_sock)
+{
+    if (serv->overload != CHTTPX_OVERLOAD_SHED_IDLE)
+        return wait_readable(client_sock, serv->idle_timeout_sec);
+
+    /* Make the connection sheddable while it waits */
+    chttpx_idle_conn_t idle;
+    _admission_idle_enter(&idle, client_sock);
+
+    int readable = wait_readable(client_sock, serv->idle_timeout_sec);
+
+    _admission_idle_leave(&idle);
+    return readable;
+}
+
 /* Cors */
 static const char* allowed_origin_cors(const char* req_origin)
 {
@@ -141,94 +187,889 @@ static const char* allowed_origin_cors(const char* req_origin)
 }
 
 /* Etag for response cache */
-static const char* generate_etag(const unsigned char* body, size_t body_size);
+static void generate_etag(const unsigned char* body, size_t body_size, char* etag, size_t etag_size);
+
+/* REQuest whose handler runs on this thread, NULL outside handlers */
+static __thread chttpx_request_t* current_req = NULL;
+
+/* Response body storage: the running REQuest's arena, the heap outside a handler */
+static void* res_body_alloc(size_t size)
+{
+    if (current_req && current_req->arena)
+        return _arena_alloc(current_req->arena, size);
+
+    return malloc(size);
+}
+
+chttpx_arena_t* _res_arena(void)
+{
+    return current_req ? current_req->arena : NULL;
+}
+
+/* Format a body into response storage, whatever its size; NULL if out of memory */
+static unsigned char* res_body_format(size_t* len, const char* fmt, va_list args)
+{
+    char buffer[BUFFER_SIZE];
+
+    va_list again;
+    va_copy(again, args);
+    int n = vsnprintf(buffer, sizeof(buffer), fmt, args);
+
+    unsigned char* body = n < 0 ? NULL : res_body_alloc((size_t)n + 1);
+    if (body)
+    {
+        /* Larger than the stack buffer: formatted again, straight into the body */
+        if ((size_t)n < sizeof(buffer))
+            memcpy(body, buffer, (size_t)n + 1);
+        else
+            vsnprintf((char*)body, (size_t)n + 1, fmt, again);
+
+        *len = (size_t)n;
+    }
+
+    va_end(again);
+    return body;
+}
+
+/* Append formatted text to the buffer, never writing past its end */
+static size_t buf_append(char* buffer, size_t buffer_size, size_t n, const char* fmt, ...)
+{
+    if (n >= buffer_size - 1)
+        return n;
+
+    va_list args;
+    va_start(args, fmt);
+    int written = vsnprintf(buffer + n, buffer_size - n, fmt, args);
+    va_end(args);
+
+    if (written < 0)
+        return n;
+
+    n += (size_t)written;
+    return n < buffer_size ? n : buffer_size - 1;
+}
+
+/* Case-insensitive search of a token in a comma-separated header value */
+static int header_has_token(const char* value, const char* token)
+{
+    size_t token_len = strlen(token);
+
+    while (value && *value)
+    {
+        while (*value == ' ' || *value == '\t' || *value == ',')
+            value++;
+
+        size_t len = strcspn(value, ",");
+        size_t trimmed = len;
+        while (trimmed > 0 && (value[trimmed - 1] == ' ' || value[trimmed - 1] == '\t'))
+            trimmed--;
+
+        if (trimmed == token_len && strncasecmp(value, token, token_len) == 0)
+            return 1;
+
+        value += len;
+    }
+
+    return 0;
+}
+
+/**
+ * Decide whether the connection stays open after answering a REQuest.
+ * HTTP/1.1 keeps it by default, HTTP/1.0 only with "Connection: keep-alive".
+ * The connection is closed when the body was not fully read from the socket,
+ * when either side sends "Connection: close" or idle_timeout_sec is 0.
+ * @param req Parsed request.
+ * @param res Response about to be sent.
+ * @return 1 to keep the connection, 0 to close it after the response.
+ */
+int _conn_keep_alive(chttpx_request_t* req, chttpx_response_t* res)
+{
+    if (!serv || serv->idle_timeout_sec == 0)
+        return 0;
+
+    /* Unread body on the socket, the next REQuest cannot be framed */
+    if (!_body_complete(req))
+        return 0;
+
+    if (header_has_token(cHTTPX_ResHeaderGet(res, "Connection"), "close"))
+        return 0;
+
+    /* A stream without chunked framing ends with the connection */
+    if (res->stream && !res->stream_chunked)
+        return 0;
+
+    const char* connection = cHTTPX_HeaderGet(req, "Connection");
+
+    if (strcmp(req->protocol, "HTTP/1.0") == 0)
+        return header_has_token(connection, "keep-alive");
+
+    return !header_has_token(connection, "close");
+}
+
+/**
+ * Format the status line and headers of an HTTP response.
+ * @param req Pointer to the HTTP request (used for CORS).
+ * @param res Response to serialize.
+ * @param keep_alive Result of _conn_keep_alive, selects the Connection header.
+ * @param buffer Output buffer.
+ * @param buffer_size Size of the output buffer.
+ * @return Number of bytes written, the head is truncated if it does not fit.
+ */
+size_t _build_response_head(chttpx_request_t* req, chttpx_response_t* res, int keep_alive, char* buffer, size_t buffer_size)
+{
+    /* Cors */
+    const char* allowed_origin = req ? allowed_origin_cors(cHTTPX_HeaderGet(req, "Origin")) : NULL;
+
+    size_t n = buf_append(buffer, buffer_size, 0, "HTTP/1.1 %d OK\r\n", res->status);
+
+    /* 304 describes the representation the client has, it carries no body */
+    if (res->stream || res->sse_topic)
+    {
+        n = buf_append(buffer, buffer_size, n, "Content-Type: %s\r\n", res->content_type);
+        if (res->stream_chunked)
+            n = buf_append(buffer, buffer_size, n, "Transfer-Encoding: chunked\r\n");
+    }
+    else if (res->status != cHTTPX_StatusNotModified)
+    {
+        n = buf_append(buffer, buffer_size, n,
+                       "Content-Type: %s\r\n"
+                       "Content-Length: %zu\r\n",
+                       res->content_type, res->body_size);
+    }
+
+    if (allowed_origin)
+    {
+        n = buf_append(buffer, buffer_size, n,
+                       "Access-Control-Allow-Origin: %s\r\n"
+                       "Access-Control-Allow-Methods: %s\r\n"
+                       "Access-Control-Allow-Headers: %s\r\n"
+                       "Access-Control-Allow-Credentials: true\r\n",
+                       allowed_origin, serv->cors.methods, serv->cors.headers);
+    }
+
+    /* Add all request headers */
+    for (size_t i = 0; i < res->headers_count; i++)
+    {
+        const char* name;
+        const char* value;
+        _res_header_at(res, i, &name, &value);
+        n = buf_append(buffer, buffer_size, n, "%s: %s\r\n", name, value);
+    }
+
+    /* Connection, unless the handler set it */
+    if (!cHTTPX_ResHeaderGet(res, "Connection"))
+    {
+        if (keep_alive)
+            n = buf_append(buffer, buffer_size, n, "Connection: keep-alive\r\nKeep-Alive: timeout=%u\r\n",
+                           (unsigned)serv->idle_timeout_sec);
+        else
+            n = buf_append(buffer, buffer_size, n, "Connection: close\r\n");
+    }
+
+    return buf_append(buffer, buffer_size, n, "\r\n");
+}
+
+/* Print the access log line to stdout */
+void _log_response(chttpx_request_t* req, chttpx_response_t* res)
+{
+    time_t rawtime;
+    struct tm timeinfo;
+    char time_str[64];
+
+    time(&rawtime);
+    localtime_r(&rawtime, &timeinfo);
+    strftime(time_str, sizeof(time_str), "%d/%b/%Y:%H:%M:%S %z", &timeinfo);
+
+    printf("[%s] - - [%s] \"%s %s %s\" %d %zu \"%s\"\n", req->client_ip, time_str, req->protocol[0] ? req->protocol : "HTTP/1.1",
+           req->method ? req->method : "-", req->path ? req->path : "-", res->status, res->body_size,
+           req->user_agent[0] ? req->user_agent : "-");
+}
 
 /**
  * Send an HTTP response to a connected client socket.
  * @param req Pointer to the HTTP request.
  * @param res httpx_response_t structure containing status, content type, and body.
- * @param client_fd File descriptor of the connected client socket.
+ * @param keep_alive Whether the connection stays open after the response.
  *
  * This function formats the HTTP response headers and body according to HTTP/1.1.
  */
-static void send_response(chttpx_request_t* req, chttpx_response_t res)
+static int send_response(chttpx_request_t* req, chttpx_response_t* res, int keep_alive)
 {
     char buffer[BUFFER_SIZE];
 
-    /* Cors */
-    const char* allowed_origin = req ? allowed_origin_cors(cHTTPX_HeaderGet(req, "Origin")) : NULL;
+    size_t n = _build_response_head(req, res, keep_alive, buffer, sizeof(buffer));
+
+    /* LOG */
+    _log_response(req, res);
+
+    chttpx_send_part_t parts[CHTTPX_RES_PARTS];
+    size_t count = _res_parts(res, buffer, n, parts);
+    size_t offset = 0;
+
+    if (!res->stream)
+        return _send_parts(req->client_fd, parts, count, &offset) == 1 ? 0 : -1;
+
+    char* frame = _arena_alloc(req->arena, CHTTPX_STREAM_FRAME);
+    if (!frame)
+        return -1;
+
+    /* The head leaves with the first chunk, then one chunk per write */
+    for (;;)
+    {
+        const char* data;
+        long len = _res_stream_next(res, frame, &data);
+        if (len < 0)
+            return -1;
+
+        if (len > 0)
+            parts[count++] = (chttpx_send_part_t){.data = data, .len = (size_t)len};
+
+        if (count > 0 && _send_parts(req->client_fd, parts, count, &offset) != 1)
+            return -1;
+
+        if (len == 0)
+            return 0;
+
+        count = 0;
+        offset = 0;
+    }
+}
+
+size_t _res_parts(const chttpx_response_t* res, const char* head, size_t head_len, chttpx_send_part_t* parts)
+{
+    size_t count = 0;
+    parts[count++] = (chttpx_send_part_t){.data = head, .len = head_len};
+
+    if (res->head_only)
+        return count;
+
+    if (!res->file)
+    {
+        if (res->body && res->body_size > 0)
+            parts[count++] = (chttpx_send_part_t){.data = res->body, .len = res->body_size};
+
+        return count;
+    }
+
+    if (!res->ranges)
+    {
+        parts[count++] = (chttpx_send_part_t){.len = res->body_size, .fd = res->file_fd, .offset = res->file_offset};
+        return count;
+    }
+
+    for (size_t i = 0; i < res->ranges_count; i++)
+    {
+        const chttpx_res_range_t* r = &res->ranges[i];
+        parts[count++] = (chttpx_send_part_t){.data = r->head, .len = r->head_len};
+
+        if (r->len > 0)
+            parts[count++] = (chttpx_send_part_t){.len = r->len, .fd = res->file_fd, .offset = r->offset};
+    }
+
+    return count;
+}
+
+/* Copy a file range through a user-space buffer, where sendfile is unavailable */
+static int send_file_copy(chttpx_socket_t fd, const chttpx_send_part_t* file, size_t* done)
+{
+    char chunk[SEND_FILE_CHUNK];
+
+    while (*done < file->len)
+    {
+        size_t want = file->len - *done < sizeof(chunk) ? file->len - *done : sizeof(chunk);
+
+#ifdef _WIN32
+        if (_lseeki64(file->fd, (__int64)(file->offset + *done), SEEK_SET) < 0)
+            return -1;
+
+        int got = _read(file->fd, chunk, (unsigned)want);
+        if (got <= 0)
+            return -1;
+
+        int sent = send(fd, chunk, got, 0);
+        if (sent == SOCKET_ERROR)
+            return WSAGetLastError() == WSAEWOULDBLOCK ? 0 : -1;
+#else
+        ssize_t got = pread(file->fd, chunk, want, (off_t)(file->offset + *done));
+        if (got < 0 && errno == EINTR)
+            continue;
+
+        /* The file shrank below the announced Content-Length */
+        if (got <= 0)
+            return -1;
+
+        ssize_t sent = send(fd, chunk, (size_t)got, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+#endif
+
+        *done += (size_t)sent;
+    }
+
+    return 1;
+}
+
+/* Send a file range from *done, straight from the page cache where possible */
+static int send_file(chttpx_socket_t fd, const chttpx_send_part_t* file, size_t* done)
+{
+#ifdef CHTTPX_PLATFORM_LINUX
+    while (*done < file->len)
+    {
+        off_t pos = (off_t)(file->offset + *done);
+
+        ssize_t sent = sendfile(fd, file->fd, &pos, file->len - *done);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return 0;
+
+            /* File system without sendfile support */
+            if (errno == EINVAL || errno == ENOSYS)
+                return send_file_copy(fd, file, done);
+
+            return -1;
+        }
+
+        /* The file shrank below the announced Content-Length */
+        if (sent == 0)
+            return -1;
+
+        *done += (size_t)sent;
+    }
+
+    return 1;
+#else
+    return send_file_copy(fd, file, done);
+#endif
+}
+
+/* Send consecutive memory pieces from parts[0], skip bytes of the first one already sent */
+static int send_memory(chttpx_socket_t fd, const chttpx_send_part_t* parts, size_t count, size_t skip, int more, size_t* sent_out)
+{
+#ifdef _WIN32
+    WSABUF iov[CHTTPX_SEND_PARTS];
+#else
+    struct iovec iov[CHTTPX_SEND_PARTS];
+#endif
+    size_t iov_count = 0;
+
+    for (size_t i = 0; i < count && iov_count < CHTTPX_SEND_PARTS && parts[i].data; i++)
+    {
+        if (parts[i].len <= skip)
+        {
+            skip -= parts[i].len;
+            continue;
+        }
+
+#ifdef _WIN32
+        iov[iov_count].buf = (char*)parts[i].data + skip;
+        iov[iov_count].len = (ULONG)(parts[i].len - skip);
+#else
+        iov[iov_count].iov_base = (char*)parts[i].data + skip;
+        iov[iov_count].iov_len = parts[i].len - skip;
+#endif
+        iov_count++;
+        skip = 0;
+    }
+
+    *sent_out = 0;
+    if (iov_count == 0)
+        return 1;
+
+#ifdef _WIN32
+    (void)more;
+
+    DWORD sent = 0;
+    if (WSASend(fd, iov, (DWORD)iov_count, &sent, 0, NULL, NULL) != 0)
+        return WSAGetLastError() == WSAEWOULDBLOCK ? 0 : -1;
+
+    *sent_out = sent;
+#else
+    struct msghdr msg = {0};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iov_count;
+
+    int flags = MSG_NOSIGNAL;
+#ifdef MSG_MORE
+    /* Hold the pieces back so they leave in the same segment as the file that follows */
+    if (more)
+        flags |= MSG_MORE;
+#else
+    (void)more;
+#endif
+
+    ssize_t sent;
+    do
+    {
+        sent = sendmsg(fd, &msg, flags);
+    } while (sent < 0 && errno == EINTR);
+
+    if (sent < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+
+    *sent_out = (size_t)sent;
+#endif
+
+    return 1;
+}
+
+int _send_parts(chttpx_socket_t fd, const chttpx_send_part_t* parts, size_t count, size_t* offset)
+{
+    for (;;)
+    {
+        /* First piece not completely sent */
+        size_t i = 0, skip = *offset;
+        while (i < count && skip >= parts[i].len)
+        {
+            skip -= parts[i].len;
+            i++;
+        }
+
+        if (i == count)
+            return 1;
+
+        size_t sent = 0;
+        int r;
+
+        if (parts[i].data)
+        {
+            /* A file range follows the memory pieces */
+            size_t next = i;
+            while (next < count && parts[next].data)
+                next++;
+
+            r = send_memory(fd, parts + i, count - i, skip, next < count, &sent);
+        }
+        else
+        {
+            sent = skip;
+            r = send_file(fd, &parts[i], &sent);
+            sent -= skip;
+        }
+
+        *offset += sent;
+
+        if (r <= 0)
+            return r;
+    }
+}
+
+static const char* const http_days[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+static const char* const http_months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                          "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+void _http_date(time_t t, char* buf, size_t size)
+{
+    struct tm gm;
+    gmtime_r(&t, &gm);
+
+    snprintf(buf, size, "%s, %02d %s %04d %02d:%02d:%02d GMT", http_days[gm.tm_wday], gm.tm_mday, http_months[gm.tm_mon],
+             gm.tm_year + 1900, gm.tm_hour, gm.tm_min, gm.tm_sec);
+}
+
+int _http_date_parse(const char* s, time_t* t)
+{
+    /* IMF-fixdate: "Sun, 06 Nov 1994 08:49:37 GMT" */
+    char month[4];
+    int day, year, hour, min, sec;
+
+    if (!s || strlen(s) != 29 || s[3] != ',' ||
+        sscanf(s + 5, "%2d %3s %4d %2d:%2d:%2d GMT", &day, month, &year, &hour, &min, &sec) != 6)
+        return -1;
+
+    int mon = -1;
+    for (int i = 0; i < 12; i++)
+    {
+        if (strcmp(month, http_months[i]) == 0)
+            mon = i;
+    }
+
+    if (mon < 0 || day < 1 || day > 31 || hour > 23 || min > 59 || sec > 60)
+        return -1;
+
+    /* Days since the epoch of a proleptic Gregorian date */
+    int y = year - (mon < 2);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (mon + (mon > 1 ? -2 : 10)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long long days = (long long)era * 146097 + doe - 719468;
+
+    *t = (time_t)(days * 86400 + hour * 3600 + min * 60 + sec);
+    return 0;
+}
+
+/* Entity tags of an If-None-Match list match the ETag (weak comparison) */
+static int etag_list_match(const char* list, const char* etag)
+{
+    if (strncmp(etag, "W/", 2) == 0)
+        etag += 2;
+    size_t etag_len = strlen(etag);
+
+    const char* p = list;
+    while (*p)
+    {
+        while (*p == ' ' || *p == '\t' || *p == ',')
+            p++;
+
+        if (*p == '*')
+            return 1;
+
+        if (strncmp(p, "W/", 2) == 0)
+            p += 2;
+
+        if (*p != '"')
+            return 0;
+
+        const char* end = strchr(p + 1, '"');
+        if (!end)
+            return 0;
+
+        size_t len = (size_t)(end - p) + 1;
+        if (len == etag_len && memcmp(p, etag, len) == 0)
+            return 1;
+
+        p = end + 1;
+    }
+
+    return 0;
+}
+
+void _res_apply_conditional(chttpx_request_t* req, chttpx_response_t* res, int etag)
+{
+    if (res->status != cHTTPX_StatusOK)
+        return;
+
+    /* Validator of memory bodies, unless the handler supplied one */
+    if (etag && !res->file && res->body && !cHTTPX_ResHeaderGet(res, "ETag"))
+    {
+        char value[32];
+        generate_etag(res->body, res->body_size, value, sizeof(value));
+        cHTTPX_HeaderAdd(res, "ETag", value);
+    }
+
+    if (strcmp(req->method, cHTTPX_MethodGet) != 0 && strcmp(req->method, "HEAD") != 0)
+        return;
+
+    int not_modified = 0;
+
+    /* If-None-Match takes precedence over If-Modified-Since */
+    const char* if_none_match = cHTTPX_HeaderGet(req, "If-None-Match");
+    if (if_none_match)
+    {
+        const char* value = cHTTPX_ResHeaderGet(res, "ETag");
+        not_modified = value && etag_list_match(if_none_match, value);
+    }
+    else
+    {
+        time_t since, modified;
+        if (_http_date_parse(cHTTPX_HeaderGet(req, "If-Modified-Since"), &since) == 0 &&
+            _http_date_parse(cHTTPX_ResHeaderGet(res, "Last-Modified"), &modified) == 0)
+            not_modified = modified <= since;
+    }
+
+    if (!not_modified)
+        return;
+
+    _res_release(res);
+    res->status = cHTTPX_StatusNotModified;
+    res->body = NULL;
+    res->body_size = 0;
+    res->ranges = NULL;
+    res->ranges_count = 0;
+}
+
+/* Printf into the arena, NULL if it does not fit */
+static char* arena_printf(chttpx_arena_t* arena, size_t* len, const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+
+    if (n < 0)
+        return NULL;
+
+    char* s = _arena_alloc(arena, (size_t)n + 1);
+    if (!s)
+        return NULL;
+
+    va_start(args, fmt);
+    vsnprintf(s, (size_t)n + 1, fmt, args);
+    va_end(args);
+
+    *len = (size_t)n;
+    return s;
+}
+
+/* Decimal number of a range spec, -1 if malformed */
+static int range_number(const char** p, const char* end, uint64_t* value)
+{
+    const char* start = *p;
+    uint64_t v = 0;
+
+    while (*p < end && **p >= '0' && **p <= '9')
+    {
+        if (v > (UINT64_MAX - 9) / 10)
+            return -1;
+
+        v = v * 10 + (uint64_t)(**p - '0');
+        (*p)++;
+    }
+
+    *value = v;
+    return *p > start ? 0 : -1;
+}
+
+/**
+ * One range spec ("a-b", "a-" or "-n") against the file size.
+ * @return 1 with the inclusive bounds, 0 if unsatisfiable, -1 if malformed.
+ */
+static int range_spec(const char* p, const char* end, uint64_t size, uint64_t* first, uint64_t* last)
+{
+    uint64_t a = 0, b = 0;
+
+    if (p < end && *p == '-')
+    {
+        /* Suffix: the last n bytes */
+        p++;
+        if (range_number(&p, end, &b) != 0 || p != end)
+            return -1;
+
+        if (b == 0 || size == 0)
+            return 0;
+
+        *first = b < size ? size - b : 0;
+        *last = size - 1;
+        return 1;
+    }
+
+    if (range_number(&p, end, &a) != 0 || p == end || *p++ != '-')
+        return -1;
+
+    b = UINT64_MAX;
+    if (p < end && (range_number(&p, end, &b) != 0 || b < a))
+        return -1;
+
+    if (p != end)
+        return -1;
+
+    if (a >= size)
+        return 0;
+
+    *first = a;
+    *last = b < size ? b : size - 1;
+    return 1;
+}
+
+/* Boundary of a multipart/byteranges body */
+static void range_boundary(char* boundary, size_t size)
+{
+    static __thread uint64_t state = 0;
+    if (state == 0)
+        state = (uint64_t)time(NULL) ^ (uint64_t)(uintptr_t)&state;
+
+    /* splitmix64 */
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+
+    snprintf(boundary, size, "chttpx-%016llx", (unsigned long long)z);
+}
+
+void _res_apply_range(chttpx_request_t* req, chttpx_response_t* res)
+{
+    if (!res->file || res->status != cHTTPX_StatusOK)
+        return;
+
+    const char* range = cHTTPX_HeaderGet(req, "Range");
+    if (!range || strncasecmp(range, "bytes=", 6) != 0)
+        return;
+
+    /* If-Range: ranges only of the representation the client already has (strong ETag match) */
+    const char* if_range = cHTTPX_HeaderGet(req, "If-Range");
+    if (if_range)
+    {
+        const char* etag = cHTTPX_ResHeaderGet(res, "ETag");
+        if (!etag || strncmp(etag, "W/", 2) == 0 || strcmp(if_range, etag) != 0)
+            return;
+    }
+
+    uint64_t size = res->body_size;
+    uint64_t first[CHTTPX_MAX_RANGES], last[CHTTPX_MAX_RANGES];
+    size_t count = 0;
+
+    for (const char* p = range + 6; *p;)
+    {
+        size_t len = strcspn(p, ",");
+        const char* start = p;
+        const char* end = p + len;
+        p = *end ? end + 1 : end;
+
+        while (start < end && (*start == ' ' || *start == '\t'))
+            start++;
+        while (end > start && (end[-1] == ' ' || end[-1] == '\t'))
+            end--;
+
+        if (start == end)
+            continue;
+
+        uint64_t a, b;
+        int r = range_spec(start, end, size, &a, &b);
+
+        /* Malformed or too many ranges: the Range header is ignored */
+        if (r < 0 || (r > 0 && count == CHTTPX_MAX_RANGES))
+            return;
+
+        if (r > 0)
+        {
+            first[count] = a;
+            last[count] = b;
+            count++;
+        }
+    }
+
+    if (count == 0)
+    {
+        _res_release(res);
+        *res = cHTTPX_ResJson(cHTTPX_StatusRangeNotSatisfiable, "{\"error\": \"range not satisfiable\"}");
+
+        char content_range[48];
+        snprintf(content_range, sizeof(content_range), "bytes */%llu", (unsigned long long)size);
+        cHTTPX_HeaderAdd(res, "Content-Range", content_range);
+        return;
+    }
+
+    /* Overlapping ranges would resend the same bytes, answer with the whole file */
+    for (size_t i = 0; i < count; i++)
+    {
+        for (size_t j = i + 1; j < count; j++)
+        {
+            if (first[i] <= last[j] && first[j] <= last[i])
+                return;
+        }
+    }
+
+    if (count == 1)
+    {
+        char content_range[80];
+        snprintf(content_range, sizeof(content_range), "bytes %llu-%llu/%llu", (unsigned long long)first[0],
+                 (unsigned long long)last[0], (unsigned long long)size);
+
+        if (cHTTPX_HeaderAdd(res, "Content-Range", content_range) != 0)
+            return;
+
+        res->status = cHTTPX_StatusPartialContent;
+        res->file_offset += first[0];
+        res->body_size = (size_t)(last[0] - first[0] + 1);
+        return;
+    }
+
+    /* multipart/byteranges: a header before every range and a closing boundary */
+    chttpx_res_range_t* ranges = _arena_alloc(req->arena, (count + 1) * sizeof(chttpx_res_range_t));
+    if (!ranges)
+        return;
+
+    char boundary[32];
+    range_boundary(boundary, sizeof(boundary));
+
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        chttpx_res_range_t* r = &ranges[i];
+        r->head = arena_printf(req->arena, &r->head_len, "\r\n--%s\r\nContent-Type: %s\r\nContent-Range: bytes %llu-%llu/%llu\r\n\r\n",
+                               boundary, res->content_type, (unsigned long long)first[i], (unsigned long long)last[i],
+                               (unsigned long long)size);
+        if (!r->head)
+            return;
+
+        r->offset = res->file_offset + first[i];
+        r->len = (size_t)(last[i] - first[i] + 1);
+        total += r->head_len + r->len;
+    }
+
+    chttpx_res_range_t* tail = &ranges[count];
+    tail->head = arena_printf(req->arena, &tail->head_len, "\r\n--%s--\r\n", boundary);
+    tail->offset = 0;
+    tail->len = 0;
 
-    int n = snprintf(buffer, sizeof(buffer),
-                     "HTTP/1.1 %d OK\r\n"
-                     "Content-Type: %s\r\n"
-                     "Content-Length: %zu\r\n",
-                     res.status, res.content_type, res.body_size);
+    size_t content_type_len;
+    const char* content_type = arena_printf(req->arena, &content_type_len, "multipart/byteranges; boundary=%s", boundary);
+    if (!tail->head || !content_type)
+        return;
 
-    /* Etag */
-    const char* etag = generate_etag(res.body, res.body_size);
-    if (etag)
-    {
-        n += snprintf(buffer + n, sizeof(buffer) - n, "Etag: %s\r\n", etag);
-        free((void*)etag);
-    }
+    res->status = cHTTPX_StatusPartialContent;
+    res->content_type = content_type;
+    res->ranges = ranges;
+    res->ranges_count = count + 1;
+    res->body_size = total + tail->head_len;
+}
 
-    if (allowed_origin)
+void _res_release(chttpx_response_t* res)
+{
+    if (res->file)
     {
-        n += snprintf(buffer + n, sizeof(buffer) - n,
-                      "Access-Control-Allow-Origin: %s\r\n"
-                      "Access-Control-Allow-Methods: %s\r\n"
-                      "Access-Control-Allow-Headers: %s\r\n"
-                      "Access-Control-Allow-Credentials: true\r\n",
-                      allowed_origin, serv->cors.methods, serv->cors.headers);
+        close(res->file_fd);
+        res->file = false;
     }
 
-    /* Add all request headers */
-    for (size_t i = 0; i < res.headers_count; i++)
+    if (res->stream)
     {
-        n += snprintf(buffer + n, sizeof(buffer) - n, "%s: %s\r\n", res.headers[i].name, res.headers[i].value);
+        if (res->stream_free)
+            res->stream_free(res->stream_ctx);
+
+        res->stream = NULL;
+        res->stream_free = NULL;
     }
+}
 
-    n += snprintf(buffer + n, sizeof(buffer) - n, "\r\n");
+long _res_stream_next(chttpx_response_t* res, char* frame, const char** data)
+{
+    /* Chunk data starts after the longest size line */
+    const size_t line = 10;
 
-    /* LOG */
-    /* --- */
-    time_t rawtime;
-    struct tm* timeinfo;
-    char time_str[64];
+    if (!res->stream || res->stream_done)
+        return 0;
 
-    time(&rawtime);
-    timeinfo = localtime(&rawtime);
-    strftime(time_str, sizeof(time_str), "%d/%b/%Y:%H:%M:%S %z", timeinfo);
+    long n = res->stream(res->stream_ctx, frame + line, CHTTPX_STREAM_CHUNK);
+    if (n < 0 || n > CHTTPX_STREAM_CHUNK)
+        return -1;
 
-    printf("[%s] - - [%s] \"%s %s %s\" %d %zu \"%s\"\n", req->client_ip, time_str, req->protocol[0] ? req->protocol : "HTTP/1.1",
-           req->method ? req->method : "-", req->path ? req->path : "-", res.status, res.body_size,
-           req->user_agent[0] ? (const char*)req->user_agent : "-");
-    /* --- */
-    /* LOG */
+    if (n == 0)
+    {
+        res->stream_done = true;
+        if (!res->stream_chunked)
+            return 0;
 
-    send(req->client_fd, buffer, strlen(buffer), 0);
+        memcpy(frame, "0\r\n\r\n", 5);
+        *data = frame;
+        return 5;
+    }
 
-    if (res.body && res.body_size > 0)
-        send(req->client_fd, res.body, res.body_size, 0);
-}
+    if (!res->stream_chunked)
+    {
+        *data = frame + line;
+        return n;
+    }
 
-static void send_sse_event(chttpx_request_t* req, const char* data)
-{
-    char buffer[1024];
-    snprintf(buffer, sizeof(buffer), "data: %s\n\n", data);
+    char size_line[16];
+    int size_len = snprintf(size_line, sizeof(size_line), "%lx\r\n", n);
 
-    send(req->client_fd, buffer, strlen(buffer), 0);
-}
+    char* start = frame + line - size_len;
+    memcpy(start, size_line, (size_t)size_len);
+    memcpy(frame + line + n, "\r\n", 2);
 
-/* For OPTIONS method */
-static void is_method_options(chttpx_request_t* req)
-{
-    if (strcasecmp(req->method, cHTTPX_MethodOptions) == 0)
-    {
-        chttpx_response_t res = {.status = cHTTPX_StatusNoContent, .content_type = cHTTPX_CTYPE_TEXT, .body = NULL, .body_size = 0};
-        send_response(req, res);
-        chttpx_close(req->client_fd);
-    }
+    *data = start;
+    return size_len + n + 2;
 }
 
 static void chttpx_context_free(chttpx_request_t* req)
@@ -243,30 +1084,82 @@ static void chttpx_context_free(chttpx_request_t* req)
     }
 }
 
-static chttpx_request_t* parse_req_buffer(chttpx_socket_t client_fd, char* buffer, size_t received)
+/* Next token of the REQuest line, NUL-terminated in place */
+static char* req_line_token(char** cursor, char* end, size_t* len)
 {
-    chttpx_request_t* req = calloc(1, sizeof(chttpx_request_t));
-    if (!req)
-    {
-        perror("calloc failed");
+    char* p = *cursor;
+    while (p < end && *p == ' ')
+        p++;
+
+    char* start = p;
+    while (p < end && *p != ' ' && *p != '\r' && *p != '\n')
+        p++;
+
+    *len = (size_t)(p - start);
+    if (*len == 0)
         return NULL;
-    }
 
-    if (received >= BUFFER_SIZE)
-        received = BUFFER_SIZE - 1;
+    *cursor = p < end ? p + 1 : p;
+    *p = '\0';
 
+    return start;
+}
+
+/**
+ * Parse a received REQuest (head and the part of the body already read).
+ * Method, path, headers and query are views into the buffer, which is
+ * modified in place and must outlive the REQuest.
+ * @param client_fd Client socket, used to read the rest of the body.
+ * @param buffer Receive buffer, must have room for a terminating NUL at buffer[received].
+ * @param received Number of bytes in the buffer.
+ * @param arena Connection arena, the REQuest and its copies are allocated from it.
+ * @return Request or NULL if the request line is invalid.
+ */
+chttpx_request_t* _parse_req_buffer(chttpx_socket_t client_fd, char* buffer, size_t received, chttpx_arena_t* arena)
+{
     buffer[received] = '\0';
 
-    char method[16], path[MAX_PATH];
+    /* Find the end of the head before it is terminated in place */
+    const char* head_end = memmem(buffer, received, "\r\n\r\n", 4);
+    size_t head_len = head_end ? (size_t)(head_end - buffer) + 4 : received;
+
+    char* line_end = memchr(buffer, '\n', head_len);
+    if (!line_end)
+        line_end = buffer + head_len;
 
-    if (sscanf(buffer, "%15s %4095s", method, path) != 2)
+    chttpx_request_t* req = _arena_alloc(arena, sizeof(chttpx_request_t));
+    if (!req)
     {
-        free(req);
+        perror("malloc failed");
         return NULL;
     }
 
-    req->method = strdup(method);
-    req->path = strdup(path);
+    memset(req, 0, sizeof(*req));
+    req->arena = arena;
+    req->client_fd = client_fd;
+
+    req->headers = req->headers_inline;
+    req->headers_cap = REQ_INLINE_HEADERS;
+    req->query = req->query_inline;
+    req->query_cap = REQ_INLINE_QUERIES;
+    req->params = req->params_inline;
+    req->cookies = req->cookies_inline;
+    req->cookies_cap = REQ_INLINE_COOKIES;
+
+    /* Parse headers (before the request line terminates its first line) */
+    _parse_req_headers(req, buffer, head_len);
+
+    char* cursor = buffer;
+    size_t protocol_len = 0;
+
+    req->method = req_line_token(&cursor, line_end, &req->method_len);
+    char* path = req->method ? req_line_token(&cursor, line_end, &req->path_len) : NULL;
+    const char* protocol = path ? req_line_token(&cursor, line_end, &protocol_len) : NULL;
+
+    if (!req->method || !path || req->path_len >= MAX_PATH)
+        return NULL;
+
+    req->path = path;
 
     /* Client IP */
     const char* client_ip = cHTTPX_ClientInetIP(client_fd);
@@ -275,184 +1168,364 @@ static chttpx_request_t* parse_req_buffer(chttpx_socket_t client_fd, char* buffe
         snprintf(req->client_ip, sizeof(req->client_ip), "%s", client_ip);
     }
 
-    /* Parse headers */
-    _parse_req_headers(req, buffer, received);
-
     /* Parse cookies */
     _parse_req_cookies(req);
 
     /* Content-Type */
     const char* content_type = cHTTPX_HeaderGet(req, "Content-Type");
-    if (content_type)
-        snprintf(req->content_type, sizeof(req->content_type), "%s", content_type ? content_type : cHTTPX_CTYPE_JSON);
+    req->content_type = content_type ? content_type : "";
 
     /* User-Agent */
     const char* user_agent = cHTTPX_HeaderGet(req, "User-Agent");
-    if (user_agent)
-        snprintf(req->user_agent, sizeof(req->user_agent), "%s", user_agent);
+    req->user_agent = user_agent ? user_agent : "";
 
     /* Protocol */
-    strncpy(req->protocol, "HTTP/1.1", sizeof(req->protocol) - 1);
+    req->protocol = protocol && strncmp(protocol, "HTTP/", 5) == 0 ? protocol : "HTTP/1.1";
 
     /* Parse query request */
-    char* query = strchr(req->path, '?');
+    char* query = memchr(path, '?', req->path_len);
     if (query)
     {
         *query = '\0';
+        req->path_len = (size_t)(query - path);
         _parse_req_query(req, query + 1);
     }
 
+    /* Part of the body already in the buffer */
+    char* body = buffer + head_len;
+    size_t body_len = received - head_len;
+
+    _body_reader_init(req, body, body_len);
+
+    /* Streaming routes read the body in the handler (cHTTPX_BodyRead) */
+    if ((req->content_length > 0 || req->body_reader.chunked) && route_streams_body(req))
+        return req;
+
     /* Parse body request */
-    _parse_req_body(req, client_fd, buffer, received);
+    _parse_req_body(req);
 
     /* Parse media request */
-    _parse_media(req, buffer, received);
+    _parse_media(req);
 
     return req;
 }
 
 /**
- * Handle a single client connection.
- * @param client_fd The file descriptor of the accepted client socket.
- * This function reads the request, parses it, calls the matching route handler,
- * and sends the response back to the client.
+ * Run a parsed REQuest through the server: OPTIONS, WebSocket upgrade,
+ * middlewares and the matching route handler.
+ * @param req Parsed request.
+ * @param res Zero-initialized response, filled by this function.
+ * @return CHTTPX_REQ_RESPOND if res must be sent back to the client,
+ *         CHTTPX_REQ_DETACHED if the socket was taken over (WebSocket).
  */
-void* chttpx_handle(void* arg)
+int _process_req(chttpx_request_t* req, chttpx_response_t* res)
 {
-    int client_sock = *(int*)arg;
-    free(arg);
+    /* Start time for logging (handlers overwrite *res) */
+    struct timespec start_ts;
+    clock_gettime(CLOCK_MONOTONIC, &start_ts);
 
-    if (!serv)
-    {
-        fprintf(stderr, "Error: server is not initialized\n");
-        return NULL;
-    }
+    /* cHTTPX_Res* builders allocate from this REQuest's arena */
+    current_req = req;
 
-    /* Timeouts */
-    set_client_timeout(client_sock);
+    chttpx_route_t* r = NULL;
 
-    char buf[BUFFER_SIZE];
-    ssize_t received = read_req(client_sock, buf, BUFFER_SIZE);
-    if (received <= 0)
+    /* ALLOWED OPTIONS METHOD */
+    if (strcasecmp(req->method, cHTTPX_MethodOptions) == 0)
     {
-        chttpx_close(client_sock);
-        return NULL;
+        res->status = cHTTPX_StatusNoContent;
+        res->content_type = cHTTPX_CTYPE_TEXT;
+        goto done;
     }
 
-    /* REQUEST */
-    chttpx_request_t* req = parse_req_buffer(client_sock, buf, received);
-    if (!req)
+    /* A body that decoded past its limit is refused before any handler sees it */
+    if (req->body_reader.too_large)
     {
-        chttpx_close(client_sock);
-        return NULL;
+        *res = cHTTPX_ResJson(cHTTPX_StatusPayloadTooLarge, "{\"error\": \"request body too large\"}");
+        goto done;
     }
 
-    /* ALLOWED OPTIONS METHOD */
-    is_method_options(req);
-
     int ws_result = cHTTPX_WSocketTryHandle(req);
-    int keep_socket = 0;
     if (ws_result == 1)
     {
-        keep_socket = 1;
-        goto cleanup;
+        current_req = NULL;
+        return CHTTPX_REQ_DETACHED;
     }
 
     if (ws_result == -1)
     {
-        chttpx_response_t res =
-            cHTTPX_ResJson(cHTTPX_StatusBadRequest, "{\"error\": \"websocket upgrade failed\"}");
-            
-        send_response(req, res);
-        goto cleanup;
+        *res = cHTTPX_ResJson(cHTTPX_StatusBadRequest, "{\"error\": \"websocket upgrade failed\"}");
+        goto done;
     }
 
-    chttpx_route_t* r = find_route(req);
-    chttpx_response_t res = {0};
+    r = find_route(req);
 
-    /* Start time for logging */
-    clock_gettime(CLOCK_MONOTONIC, &res.start_ts);
+    /* Static directories answer what no route matches */
+    long mount = r ? -1 : _static_find(req);
 
-    if (r)
+    if (r || mount >= 0)
     {
         /* Use middlewares */
         for (size_t i = 0; i < serv->middleware.middleware_count; i++)
         {
-            if (!serv->middleware.middlewares[i](req, &res))
-            {
-                /* End time for logging */
-                clock_gettime(CLOCK_MONOTONIC, &res.end_ts);
+            if (!serv->middleware.middlewares[i](req, res))
+                goto done;
+        }
+
+        /* Handler */
+        if (r)
+            r->handler(req, res);
+        else
+            _static_serve(mount, req, res);
 
-                send_response(req, res);
-                postmiddleware_logging_write(req, &res);
+        /* Event stream: the SSE engine takes the socket over */
+        if (res->sse_topic)
+        {
+            res->start_ts = start_ts;
+            clock_gettime(CLOCK_MONOTONIC, &res->end_ts);
 
-                goto cleanup;
+            if (_sse_attach(req, res) == 0)
+            {
+                current_req = NULL;
+                return CHTTPX_REQ_DETACHED;
             }
-        }
 
-        /* Handler */
-        r->handler(req, &res);
+            *res = cHTTPX_ResJson(cHTTPX_StatusInternalServerError, "{\"error\": \"event stream unavailable\"}");
+        }
     }
     else
     {
-        res = cHTTPX_ResJson(cHTTPX_StatusNotFound, "{\"error\": \"not found\"}");
+        *res = cHTTPX_ResJson(cHTTPX_StatusNotFound, "{\"error\": \"not found\"}");
     }
 
-    /* End time for logging */
-    clock_gettime(CLOCK_MONOTONIC, &res.end_ts);
+done:
+    /* Validators and 304, partial content of file responses, then compression */
+    _res_apply_conditional(req, res, !r || !r->etag_disabled);
+    _res_apply_range(req, res);
+    _res_apply_compression(req, res);
+
+    /* Chunks need HTTP/1.1, a HEAD REQuest only gets the head */
+    res->head_only = strcasecmp(req->method, "HEAD") == 0;
+    if (res->stream)
+    {
+        res->stream_chunked = strcmp(req->protocol, "HTTP/1.0") != 0;
+        res->stream_done = res->head_only;
+    }
 
-    send_response(req, res);
+    current_req = NULL;
+    res->start_ts = start_ts;
+
+    /* End time for logging */
+    clock_gettime(CLOCK_MONOTONIC, &res->end_ts);
 
-    /* Logging response */
-    postmiddleware_logging_write(req, &res);
+    return CHTTPX_REQ_RESPOND;
+}
 
-cleanup:
+/* Release a REQuest created by _parse_req_buffer, its memory goes with the arena */
+void _free_req(chttpx_request_t* req)
+{
     /* Free REQuest context */
     chttpx_context_free(req);
 
     /* Free REQuest cookie */
     chttpx_free_req_cookie(req);
+}
+
+/**
+ * Serve REQuests on a blocking connection until it is closed.
+ * Pipelined REQuests already in the buffer are answered in order; between
+ * REQuests the connection waits up to idle_timeout_sec for the next one.
+ * @param client_sock Client socket in blocking mode.
+ * @param initial Bytes already read from the socket, may be NULL.
+ * @param initial_len Number of bytes in initial, less than BUFFER_SIZE.
+ */
+static void serve_connection(chttpx_socket_t client_sock, const char* initial, size_t initial_len)
+{
+    char buf[BUFFER_SIZE];
+    size_t len = 0;
+    int idle = 0;
 
-    free(req->method);
-    free(req->path);
-    free(req->body);
+    /* REQuests and responses of the connection, reset after each response */
+    chttpx_arena_t arena = {0};
 
-    for (size_t i = 0; i < req->query_count; i++)
+    if (initial && initial_len > 0)
     {
-        free(req->query[i].name);
-        free(req->query[i].value);
+        len = initial_len < BUFFER_SIZE - 1 ? initial_len : BUFFER_SIZE - 1;
+        memcpy(buf, initial, len);
     }
 
-    free(req->query);
-    free(req);
+    for (;;)
+    {
+        /* Complete REQuest head */
+        const char* end;
+        while (!(end = memmem(buf, len, "\r\n\r\n", 4)))
+        {
+            if (len >= BUFFER_SIZE - 1)
+                goto close;
 
-    if (!keep_socket)
-        chttpx_close(client_sock);
+            if (len == 0 && idle && !wait_idle(client_sock))
+                goto close;
+
+            ssize_t n = recv(client_sock, buf + len, BUFFER_SIZE - 1 - len, 0);
+            if (n <= 0)
+                goto close;
+
+            len += (size_t)n;
+        }
+
+        /* Frame the REQuest: head and the part of the body in the buffer, all of it for chunks */
+        size_t head_len = (size_t)(end - buf) + 4;
+        size_t content_length;
+        int chunked = _req_head_chunked(buf, head_len);
+        if (chunked < 0 || _req_head_content_length(buf, head_len, &content_length) != 0)
+        {
+            _req_head_reject(client_sock);
+            goto close;
+        }
+
+        size_t req_len = head_len + (content_length < len - head_len ? content_length : len - head_len);
+
+        if (chunked)
+            req_len = len;
+
+        /* The parser terminates the REQuest in place, keep the next pipelined byte */
+        char next = buf[req_len];
+
+        chttpx_request_t* req = _parse_req_buffer(client_sock, buf, req_len, &arena);
+        if (!req)
+            goto close;
+
+        chttpx_response_t res = {0};
+
+        if (_process_req(req, &res) == CHTTPX_REQ_DETACHED)
+        {
+            _free_req(req);
+            _arena_free(&arena);
+            return;
+        }
+
+        int keep_alive = _conn_keep_alive(req, &res);
+
+        if (send_response(req, &res, keep_alive) != 0)
+            keep_alive = 0;
+
+        _res_release(&res);
+
+        /* Logging response */
+        postmiddleware_logging_write(req, &res);
+
+        if (keep_alive)
+        {
+            const chttpx_body_reader_t* body = &req->body_reader;
+            buf[req_len] = next;
+
+            /* Bytes after the last chunk belong to the next REQuest: in buf, or in the body reader's refill */
+            if (body->filled)
+            {
+                len = body->len;
+                memcpy(buf, body->data, len);
+            }
+            else
+            {
+                req_len -= body->chunked ? body->len : 0;
+                len -= req_len;
+                memmove(buf, buf + req_len, len);
+            }
+        }
+
+        _free_req(req);
+        _arena_reset(&arena);
+
+        if (!keep_alive)
+            goto close;
+
+        idle = 1;
+    }
+
+close:
+    _arena_free(&arena);
+    chttpx_close(client_sock);
+}
+
+/**
+ * Handle a single client connection.
+ * @param client_fd The file descriptor of the accepted client socket.
+ * This function reads requests, parses them, calls the matching route handlers
+ * and sends the responses back, keeping the connection alive between requests.
+ */
+void* chttpx_handle(void* arg)
+{
+    int client_sock = *(int*)arg;
+    free(arg);
+
+    chttpx_handle_client(client_sock);
     return NULL;
 }
 
-static const char* generate_etag(const unsigned char* body, size_t body_size)
+/**
+ * Handle a single accepted client connection on the calling thread.
+ * @param client_sock The accepted client socket, closed by this function
+ *                    unless it is taken over by WebSocket.
+ */
+void chttpx_handle_client(chttpx_socket_t client_sock)
 {
-    uint64_t hash = 5381;
-    for (size_t i = 0; i < body_size; i++)
+    if (!serv)
     {
-        hash = ((hash << 5) + hash) + body[i];
+        fprintf(stderr, "Error: server is not initialized\n");
+        chttpx_close(client_sock);
+        return;
     }
 
-    char* buffer = malloc(64);
-    if (!buffer)
-        return NULL;
+    /* Timeouts */
+    set_client_timeout(client_sock);
+
+    serve_connection(client_sock, NULL, 0);
+}
+
+/**
+ * Handle a client connection whose request head has already been read
+ * (e.g. by the event loop) on a blocking socket.
+ * @param client_sock Client socket in blocking mode.
+ * @param buf Bytes received so far, copied by this function.
+ * @param received Number of bytes in buf, less than BUFFER_SIZE.
+ */
+void chttpx_handle_buffered(chttpx_socket_t client_sock, const char* buf, size_t received)
+{
+    if (!serv)
+    {
+        fprintf(stderr, "Error: server is not initialized\n");
+        chttpx_close(client_sock);
+        return;
+    }
+
+    /* Timeouts */
+    set_client_timeout(client_sock);
+
+    serve_connection(client_sock, buf, received);
+}
 
-    snprintf(buffer, 64, "\"%llx\"", (unsigned long long)hash);
-    return buffer;
+/* Hash of generated ETags, see cHTTPX_ETagHash */
+static chttpx_hash_fn_t etag_hash = cHTTPX_Hash64;
+
+void cHTTPX_ETagHash(chttpx_hash_fn_t fn)
+{
+    etag_hash = fn ? fn : cHTTPX_Hash64;
+}
+
+static void generate_etag(const unsigned char* body, size_t body_size, char* etag, size_t etag_size)
+{
+    uint64_t hash = etag_hash(body, body_size);
+
+    snprintf(etag, etag_size, "\"%llx\"", (unsigned long long)hash);
 }
 
 /**
  * Create a JSON HTTP response with formatted content.
  *
  * Formats a JSON response body using printf-style arguments,
- * allocates memory for the response body, and returns a
- * fully initialized chttpx_response_t structure.
+ * allocates the response body (REQuest arena inside a handler,
+ * malloc outside one), and returns a fully initialized
+ * chttpx_response_t structure. Values are not escaped; documents
+ * built from data are better written with cHTTPX_JsonInit.
  *
  * @param status HTTP status code (e.g. 200, 400, 404).
  * @param fmt    printf-style format string for the JSON body.
@@ -460,15 +1533,13 @@ static const char* generate_etag(const unsigned char* body, size_t body_size)
  */
 chttpx_response_t cHTTPX_ResJson(uint16_t status, const char* fmt, ...)
 {
-    char buffer[BUFFER_SIZE];
+    size_t len = 0;
 
     va_list args;
     va_start(args, fmt);
-    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    unsigned char* body = res_body_format(&len, fmt, args);
     va_end(args);
 
-    size_t len = strlen(buffer);
-    unsigned char* body = malloc(len + 1);
     if (!body)
     {
         perror("malloc failed");
@@ -480,9 +1551,6 @@ chttpx_response_t cHTTPX_ResJson(uint16_t status, const char* fmt, ...)
                                    .end_ts = {0}};
     }
 
-    memcpy(body, buffer, len);
-    body[len] = '\0';
-
     return (chttpx_response_t){.status = status, .content_type = cHTTPX_CTYPE_JSON, .body = body, .body_size = len, .start_ts = {0}, .end_ts = {0}};
 }
 
@@ -491,8 +1559,9 @@ chttpx_response_t cHTTPX_ResJson(uint16_t status, const char* fmt, ...)
  *
  * This function generates a chttpx_response_t structure with the specified
  * HTTP status code and HTML body. The body is created using a printf-style
- * format string (fmt) and additional arguments. Memory for the body is
- * dynamically allocated and must be freed after sending the response.
+ * format string (fmt) and additional arguments. Inside a handler the body
+ * lives in the REQuest arena (see cHTTPX_Alloc), outside one it is malloc'd
+ * and must be freed by the caller.
  *
  * @param status HTTP status code (e.g., 200, 404, 500).
  * @param fmt Format string containing the HTML content (like printf).
@@ -500,15 +1569,13 @@ chttpx_response_t cHTTPX_ResJson(uint16_t status, const char* fmt, ...)
  */
 chttpx_response_t cHTTPX_ResHtml(uint16_t status, const char* fmt, ...)
 {
-    char buffer[BUFFER_SIZE];
+    size_t len = 0;
 
     va_list args;
     va_start(args, fmt);
-    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    unsigned char* body = res_body_format(&len, fmt, args);
     va_end(args);
 
-    size_t len = strlen(buffer);
-    unsigned char* body = malloc(len + 1);
     if (!body)
     {
         perror("malloc failed");
@@ -520,17 +1587,14 @@ chttpx_response_t cHTTPX_ResHtml(uint16_t status, const char* fmt, ...)
                                    .end_ts = {0}};
     }
 
-    memcpy(body, buffer, len);
-    body[len] = '\0';
-
     return (chttpx_response_t){.status = status, .content_type = cHTTPX_CTYPE_HTML, .body = body, .body_size = len, .start_ts = {0}, .end_ts = {0}};
 }
 
 /**
  * Create a binary HTTP response (file, media, etc.).
  *
- * Allocates memory for the response body and returns a fully initialized
- * chttpx_response_t structure.
+ * Copies the body (REQuest arena inside a handler, malloc outside one)
+ * and returns a fully initialized chttpx_response_t structure.
  *
  * @param status HTTP status code (e.g. 200, 400, 404)
  * @param content_type MIME type of the response (e.g. "image/png")
@@ -540,7 +1604,7 @@ chttpx_response_t cHTTPX_ResHtml(uint16_t status, const char* fmt, ...)
  */
 chttpx_response_t cHTTPX_ResBinary(uint16_t status, const char* content_type, const unsigned char* body, size_t body_size)
 {
-    unsigned char* buffer = malloc(body_size);
+    unsigned char* buffer = res_body_alloc(body_size);
     if (!buffer)
     {
         perror("malloc failed");
@@ -554,7 +1618,9 @@ chttpx_response_t cHTTPX_ResBinary(uint16_t status, const char* content_type, co
 }
 
 /**
- * Create a binary HTTP response from FILE.
+ * Create an HTTP response backed by a file.
+ * The file is not read into memory: it is kept open and sent with sendfile
+ * once the handler returns, then closed.
  *
  * @param status HTTP status code (e.g. 200, 400, 404)
  * @param content_type MIME type of the response (e.g. "image/png")
@@ -563,25 +1629,217 @@ chttpx_response_t cHTTPX_ResBinary(uint16_t status, const char* content_type, co
  */
 chttpx_response_t cHTTPX_ResFile(uint16_t status, const char* content_type, const char* path)
 {
-    FILE* f = fopen(path, "rb");
-    if (!f)
+#ifdef _WIN32
+    int fd = _open(path, _O_RDONLY | _O_BINARY);
+    struct _stat64 st;
+    if (fd >= 0 && _fstat64(fd, &st) != 0)
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) != 0)
+#endif
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    if (fd < 0)
     {
         return cHTTPX_ResJson(cHTTPX_StatusNotFound, "{\"error\": \"file not found\"}");
     }
 
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
+    if (!S_ISREG(st.st_mode))
+    {
+        close(fd);
+        return cHTTPX_ResJson(cHTTPX_StatusNotFound, "{\"error\": \"file not found\"}");
+    }
+
+    /* Validators from the file metadata, the body is never hashed */
+    char etag[CHTTPX_FILE_ETAG_SIZE];
+    _file_etag((uint64_t)st.st_mtime, (uint64_t)st.st_size, etag, sizeof(etag));
+
+    char last_modified[CHTTPX_HTTP_DATE_SIZE];
+    _http_date(st.st_mtime, last_modified, sizeof(last_modified));
+
+    return _res_file_fd(status, content_type, fd, (size_t)st.st_size, etag, last_modified);
+}
+
+chttpx_response_t cHTTPX_ResStream(uint16_t status, const char* content_type, chttpx_stream_fn_t fn, void* ctx,
+                                   void (*free_ctx)(void* ctx))
+{
+    chttpx_response_t res = {.status = status, .content_type = content_type};
+    res.stream = fn;
+    res.stream_ctx = ctx;
+    res.stream_free = free_ctx;
+    res.stream_chunked = true;
+
+    return res;
+}
+
+chttpx_response_t cHTTPX_ResJsonWriter(uint16_t status, chttpx_json_t* json)
+{
+    if (json->failed || json->frame || json->depth || json->after_key || json->len == 0)
+    {
+        cHTTPX_JsonFree(json);
+        return cHTTPX_ResJson(cHTTPX_StatusInternalServerError, "{\"error\": \"internal server error\"}");
+    }
+
+    unsigned char* body = (unsigned char*)json->buf;
+
+    /* A heap document inside a handler moves to the arena, like every other body there */
+    if (!json->arena && current_req && current_req->arena)
+    {
+        body = _arena_alloc(current_req->arena, json->len);
+        if (body)
+            memcpy(body, json->buf, json->len);
+
+        free(json->buf);
+        if (!body)
+            return cHTTPX_ResJson(cHTTPX_StatusInternalServerError, "{\"error\": \"internal server error\"}");
+    }
+
+    chttpx_response_t res = {.status = status, .content_type = cHTTPX_CTYPE_JSON, .body = body, .body_size = json->len};
+
+    /* The body belongs to the response now */
+    json->buf = NULL;
+    json->len = json->cap = 0;
+    return res;
+}
+
+/* cHTTPX_ResJsonStream state */
+typedef struct
+{
+    chttpx_json_t json;
+    chttpx_json_stream_fn_t fn;
+    void* ctx;
+    void (*free_ctx)(void* ctx);
+    bool done;
+} res_json_stream_t;
+
+/* The producer writes into the chunk buffer itself, only what overflows it is copied */
+static long res_json_stream_next(void* ctx, char* buf, size_t size)
+{
+    res_json_stream_t* s = ctx;
+    chttpx_json_t* json = &s->json;
+
+    if (json->spill_sent < json->spill_len)
+    {
+        size_t n = json->spill_len - json->spill_sent < size ? json->spill_len - json->spill_sent : size;
+        memcpy(buf, json->spill + json->spill_sent, n);
+        json->spill_sent += n;
+        return (long)n;
+    }
+
+    json->spill_len = json->spill_sent = 0;
+    if (s->done)
+        return 0;
+
+    json->buf = buf;
+    json->cap = size;
+    json->len = 0;
+
+    while (json->len < size && json->spill_len == 0)
+    {
+        int r = s->fn(s->ctx, json);
+        if (r < 0 || json->failed)
+            return -1;
+
+        if (r == 0)
+        {
+            /* A complete document or nothing */
+            s->done = true;
+            if (json->depth || json->after_key || !json->comma)
+                return -1;
+            break;
+        }
+    }
+
+    long n = (long)json->len;
+    json->buf = NULL;
+    json->len = json->cap = 0;
+
+    /* Everything went to spill (a first value larger than the chunk) */
+    if (n == 0 && json->spill_len)
+        return res_json_stream_next(ctx, buf, size);
+
+    return n;
+}
+
+static void res_json_stream_free(void* ctx)
+{
+    res_json_stream_t* s = ctx;
+
+    if (s->free_ctx)
+        s->free_ctx(s->ctx);
+
+    cHTTPX_JsonFree(&s->json);
+    free(s);
+}
 
-    unsigned char* data = malloc(size);
-    if (!data)
+chttpx_response_t cHTTPX_ResJsonStream(uint16_t status, chttpx_json_stream_fn_t fn, void* ctx, void (*free_ctx)(void* ctx))
+{
+    res_json_stream_t* s = calloc(1, sizeof(*s));
+    if (!s)
     {
-        fclose(f);
+        perror("malloc failed");
+        if (free_ctx)
+            free_ctx(ctx);
+
         return cHTTPX_ResJson(cHTTPX_StatusInternalServerError, "{\"error\": \"internal server error\"}");
     }
 
-    fread(data, 1, size, f);
-    fclose(f);
+    cHTTPX_JsonInit(&s->json, NULL);
+    s->json.frame = true;
+    s->fn = fn;
+    s->ctx = ctx;
+    s->free_ctx = free_ctx;
+
+    return cHTTPX_ResStream(status, cHTTPX_CTYPE_JSON, res_json_stream_next, s, res_json_stream_free);
+}
+
+chttpx_response_t cHTTPX_ResSSE(const char* topic)
+{
+    chttpx_response_t res = {.status = cHTTPX_StatusOK, .content_type = cHTTPX_CTYPE_EVENTS};
+
+    size_t len = topic ? strlen(topic) : 0;
+    char* copy = res_body_alloc(len + 1);
+    if (!copy)
+    {
+        perror("malloc failed");
+        return cHTTPX_ResJson(cHTTPX_StatusInternalServerError, "{\"error\": \"event stream unavailable\"}");
+    }
+
+    memcpy(copy, topic ? topic : "", len + 1);
+    res.sse_topic = copy;
+
+    /* Proxies must neither cache nor buffer the stream */
+    cHTTPX_HeaderAdd(&res, "Cache-Control", "no-cache");
+    cHTTPX_HeaderAdd(&res, "Connection", "keep-alive");
+    cHTTPX_HeaderAdd(&res, "X-Accel-Buffering", "no");
+
+    return res;
+}
+
+void _file_etag(uint64_t mtime, uint64_t size, char* etag, size_t etag_size)
+{
+    snprintf(etag, etag_size, "\"%llx-%llx\"", (unsigned long long)mtime, (unsigned long long)size);
+}
+
+chttpx_response_t _res_file_fd(uint16_t status, const char* content_type, int fd, size_t size, const char* etag,
+                               const char* last_modified)
+{
+    chttpx_response_t res = {.status = status, .content_type = content_type, .body_size = size};
+    res.file = true;
+    res.file_fd = fd;
+    res.file_offset = 0;
+
+    if (etag && etag[0])
+        cHTTPX_HeaderAdd(&res, "ETag", etag);
+
+    if (last_modified && last_modified[0])
+        cHTTPX_HeaderAdd(&res, "Last-Modified", last_modified);
+
+    cHTTPX_HeaderAdd(&res, "Accept-Ranges", "bytes");
 
-    return (chttpx_response_t){.status = status, .content_type = content_type, .body = data, .body_size = size, .start_ts = {0}, .end_ts = {0}};
+    return res;
 }
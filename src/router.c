@@ -0,0 +1,357 @@
+#define _GNU_SOURCE
+
+/*
+ * Copyright (c) 2026 netcorelink
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "router.h"
+
+#include "crosspltm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Route registered for one method at a node */
+typedef struct
+{
+    char* method;
+    size_t route;
+
+    /* Names of the {param} segments on the way to the node, in order */
+    char** param_names;
+    size_t param_count;
+} route_leaf_t;
+
+struct chttpx_route_node
+{
+    /* Static bytes matched by this node (empty for {param} nodes) */
+    char* prefix;
+    size_t prefix_len;
+
+    /* Static children, indices[i] is the first byte of children[i] */
+    char* indices;
+    struct chttpx_route_node** children;
+    size_t children_count;
+
+    /* {param} child, matches one non-empty segment */
+    struct chttpx_route_node* param;
+
+    /* Per-method leaf table */
+    route_leaf_t* leaves;
+    size_t leaves_count;
+};
+
+/* Matched {param} value inside the REQuest path */
+typedef struct
+{
+    const char* value;
+    size_t len;
+} param_span_t;
+
+static chttpx_route_node_t* node_new(const char* prefix, size_t prefix_len)
+{
+    chttpx_route_node_t* n = calloc(1, sizeof(chttpx_route_node_t));
+    if (!n)
+        return NULL;
+
+    n->prefix = malloc(prefix_len + 1);
+    if (!n->prefix)
+    {
+        free(n);
+        return NULL;
+    }
+
+    memcpy(n->prefix, prefix, prefix_len);
+    n->prefix[prefix_len] = '\0';
+    n->prefix_len = prefix_len;
+
+    return n;
+}
+
+static int node_add_child(chttpx_route_node_t* n, chttpx_route_node_t* child)
+{
+    chttpx_route_node_t** children = realloc(n->children, sizeof(chttpx_route_node_t*) * (n->children_count + 1));
+    if (!children)
+        return -1;
+    n->children = children;
+
+    char* indices = realloc(n->indices, n->children_count + 1);
+    if (!indices)
+        return -1;
+    n->indices = indices;
+
+    n->children[n->children_count] = child;
+    n->indices[n->children_count] = child->prefix[0];
+    n->children_count++;
+
+    return 0;
+}
+
+/* Insert a static run below n, splitting shared prefixes; returns the node at its end */
+static chttpx_route_node_t* insert_static(chttpx_route_node_t* n, const char* s, size_t len)
+{
+    while (len > 0)
+    {
+        size_t i = 0;
+        while (i < n->children_count && n->indices[i] != s[0])
+            i++;
+
+        if (i == n->children_count)
+        {
+            chttpx_route_node_t* child = node_new(s, len);
+            if (!child || node_add_child(n, child) != 0)
+            {
+                _router_free(child);
+                return NULL;
+            }
+
+            return child;
+        }
+
+        chttpx_route_node_t* c = n->children[i];
+
+        size_t common = 0;
+        while (common < c->prefix_len && common < len && c->prefix[common] == s[common])
+            common++;
+
+        /* Split: the shared part becomes the parent of the old child */
+        if (common < c->prefix_len)
+        {
+            chttpx_route_node_t* mid = node_new(c->prefix, common);
+            if (!mid)
+                return NULL;
+
+            memmove(c->prefix, c->prefix + common, c->prefix_len - common + 1);
+            c->prefix_len -= common;
+
+            if (node_add_child(mid, c) != 0)
+            {
+                _router_free(mid);
+                return NULL;
+            }
+
+            n->children[i] = mid;
+            c = mid;
+        }
+
+        n = c;
+        s += common;
+        len -= common;
+    }
+
+    return n;
+}
+
+static void leaf_free(route_leaf_t* leaf)
+{
+    free(leaf->method);
+
+    for (size_t i = 0; i < leaf->param_count; i++)
+        free(leaf->param_names[i]);
+
+    free(leaf->param_names);
+}
+
+int _router_insert(chttpx_route_node_t** root, const char* method, const char* path, size_t route)
+{
+    if (!*root)
+    {
+        *root = node_new("", 0);
+        if (!*root)
+            return -1;
+    }
+
+    route_leaf_t leaf = {0};
+    leaf.route = route;
+
+    chttpx_route_node_t* n = *root;
+    const char* t = path;
+
+    while (n && *t)
+    {
+        if (*t == '{')
+        {
+            const char* end = strchr(t, '}');
+            if (!end || leaf.param_count >= MAX_PARAMS)
+            {
+                fprintf(stderr, "Error: invalid route template '%s'\n", path);
+                leaf_free(&leaf);
+                return 1;
+            }
+
+            char** names = realloc(leaf.param_names, sizeof(char*) * (leaf.param_count + 1));
+            if (!names)
+            {
+                leaf_free(&leaf);
+                return -1;
+            }
+            leaf.param_names = names;
+
+            size_t name_len = (size_t)(end - t - 1);
+
+            leaf.param_names[leaf.param_count] = malloc(name_len + 1);
+            if (!leaf.param_names[leaf.param_count])
+            {
+                leaf_free(&leaf);
+                return -1;
+            }
+            memcpy(leaf.param_names[leaf.param_count], t + 1, name_len);
+            leaf.param_names[leaf.param_count][name_len] = '\0';
+            leaf.param_count++;
+
+            if (!n->param)
+                n->param = node_new("", 0);
+
+            n = n->param;
+            t = end + 1;
+        }
+        else
+        {
+            size_t run = strcspn(t, "{");
+            n = insert_static(n, t, run);
+            t += run;
+        }
+    }
+
+    if (!n)
+    {
+        leaf_free(&leaf);
+        return -1;
+    }
+
+    /* The first registration wins, as with the linear scan */
+    for (size_t i = 0; i < n->leaves_count; i++)
+    {
+        if (strcmp(n->leaves[i].method, method) == 0)
+        {
+            leaf_free(&leaf);
+            return 1;
+        }
+    }
+
+    route_leaf_t* leaves = realloc(n->leaves, sizeof(route_leaf_t) * (n->leaves_count + 1));
+    leaf.method = strdup(method);
+    if (!leaves || !leaf.method)
+    {
+        if (leaves)
+            n->leaves = leaves;
+        leaf_free(&leaf);
+        return -1;
+    }
+
+    n->leaves = leaves;
+    n->leaves[n->leaves_count++] = leaf;
+
+    return 0;
+}
+
+static const route_leaf_t* lookup(const chttpx_route_node_t* n, const char* method, const char* p, size_t len, param_span_t* spans,
+                                  size_t depth)
+{
+    if (len == 0)
+    {
+        for (size_t i = 0; i < n->leaves_count; i++)
+        {
+            if (strcmp(n->leaves[i].method, method) == 0)
+                return &n->leaves[i];
+        }
+
+        return NULL;
+    }
+
+    /* Static children first */
+    for (size_t i = 0; i < n->children_count; i++)
+    {
+        if (n->indices[i] != p[0])
+            continue;
+
+        const chttpx_route_node_t* c = n->children[i];
+        if (c->prefix_len <= len && memcmp(c->prefix, p, c->prefix_len) == 0)
+        {
+            const route_leaf_t* leaf = lookup(c, method, p + c->prefix_len, len - c->prefix_len, spans, depth);
+            if (leaf)
+                return leaf;
+        }
+
+        break;
+    }
+
+    /* Then one {param} segment */
+    if (n->param && depth < MAX_PARAMS)
+    {
+        const char* slash = memchr(p, '/', len);
+        size_t seg = slash ? (size_t)(slash - p) : len;
+
+        if (seg > 0)
+        {
+            spans[depth].value = p;
+            spans[depth].len = seg;
+
+            return lookup(n->param, method, p + seg, len - seg, spans, depth + 1);
+        }
+    }
+
+    return NULL;
+}
+
+long _router_find(const chttpx_route_node_t* root, const char* method, const char* path, chttpx_param_t* params, int* param_count)
+{
+    if (!root || !method || !path)
+        return -1;
+
+    param_span_t spans[MAX_PARAMS];
+
+    const route_leaf_t* leaf = lookup(root, method, path, strlen(path), spans, 0);
+    if (!leaf)
+        return -1;
+
+    for (size_t i = 0; i < leaf->param_count; i++)
+    {
+        params[i].name = leaf->param_names[i];
+        params[i].name_len = strlen(leaf->param_names[i]);
+        params[i].value = spans[i].value;
+        params[i].value_len = spans[i].len;
+    }
+
+    *param_count = (int)leaf->param_count;
+    return (long)leaf->route;
+}
+
+void _router_free(chttpx_route_node_t* root)
+{
+    if (!root)
+        return;
+
+    for (size_t i = 0; i < root->children_count; i++)
+        _router_free(root->children[i]);
+
+    _router_free(root->param);
+
+    for (size_t i = 0; i < root->leaves_count; i++)
+        leaf_free(&root->leaves[i]);
+
+    free(root->leaves);
+    free(root->children);
+    free(root->indices);
+    free(root->prefix);
+    free(root);
+}
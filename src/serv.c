@@ -1,3 +1,5 @@
+#define _GNU_SOURCE
+
 /*
  * Copyright (c) 2026 netcorelink
  *
@@ -26,6 +28,13 @@
 #include "crosspltm.h"
 #include "middlewares.h"
 #include "websocket.h"
+#include "workers.h"
+#include "admission.h"
+#include "eventloop.h"
+#include "static.h"
+#include "sse.h"
+
+#include <signal.h>
 
 /* Extern server struct data */
 chttpx_serv_t* serv = NULL;
@@ -35,6 +44,13 @@ chttpx_serv_t* serv = NULL;
  * @param serv_p The basic structure for working with a server.
  * @param port The TCP port on which the server will listen (e.g., 80, 8080).
  * This function must be called before registering routes or starting the server.
+ *
+ * Set serv_p->mode (and optionally serv_p->loop_threads) before the call to
+ * select the epoll event loop instead of a thread per connection.
+ * Set serv_p->workers (and optionally serv_p->workers_queue) to serve
+ * connections from a fixed worker pool instead.
+ * Set serv_p->reuseport to give every loop (or accept) thread its own
+ * SO_REUSEPORT listening socket, serv_p->backlog for the listen backlog.
  */
 int cHTTPX_Init(chttpx_serv_t* serv_p, uint16_t port, void* max_clients)
 {
@@ -43,6 +59,9 @@ int cHTTPX_Init(chttpx_serv_t* serv_p, uint16_t port, void* max_clients)
     /* Recovery initial */
     _recovery_init();
 
+    /* Connection admission */
+    _admission_init();
+
 #ifdef _WIN32
     WSADATA wsa;
     if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
@@ -53,22 +72,68 @@ int cHTTPX_Init(chttpx_serv_t* serv_p, uint16_t port, void* max_clients)
 #endif
 
     serv->port = port;
-    serv->server_fd = socket(AF_INET, SOCK_STREAM, 0);
     serv->max_clients = max_clients ? *(size_t*)max_clients : MAX_CLIENTS_DEFAULT;
     serv->current_clients = 0;
 
-#ifdef _WIN32
-    if (serv->server_fd == INVALID_SOCKET)
-#else
-    if (serv->server_fd < 0)
+#ifndef CHTTPX_PLATFORM_LINUX
+    if (serv->mode == CHTTPX_MODE_EPOLL)
+    {
+        fprintf(stderr, "Warning: epoll mode is not supported on this platform, using threads\n");
+        serv->mode = CHTTPX_MODE_THREADS;
+    }
 #endif
+
+#ifndef SO_REUSEPORT
+    if (serv->reuseport)
     {
-        perror("socket");
+        fprintf(stderr, "Warning: SO_REUSEPORT is not supported on this platform, using one listener\n");
+        serv->reuseport = 0;
+    }
+#endif
+
+    chttpx_socket_t server_fd = _serv_listen_socket();
+    if (server_fd == CHTTPX_INVALID_SOCKET)
         exit(1);
+
+    serv->server_fd = server_fd;
+
+    /* Timeouts */
+    serv->read_timeout_sec = 300;
+    serv->write_timeout_sec = 300;
+    serv->idle_timeout_sec = 90;
+
+    /* Default values for routes */
+    serv->routes = NULL;
+    serv->routes_count = 0;
+    serv->routes_capacity = 0;
+    serv->route_tree = NULL;
+
+    serv->ws_routes = NULL;
+    serv->ws_routes_count = 0;
+    serv->ws_routes_capacity = 0;
+
+    printf("HTTP server started on port %d...\n", port);
+
+    return 0;
+}
+
+/**
+ * Open a listening socket on the server port.
+ * With serv->reuseport every call returns a new socket bound to the same port,
+ * the kernel spreads incoming connections between them.
+ * @return Listening socket or CHTTPX_INVALID_SOCKET on error.
+ */
+chttpx_socket_t _serv_listen_socket(void)
+{
+    chttpx_socket_t fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == CHTTPX_INVALID_SOCKET)
+    {
+        perror("socket");
+        return CHTTPX_INVALID_SOCKET;
     }
 
     int opt = 1;
-    setsockopt(serv->server_fd, SOL_SOCKET, SO_REUSEADDR,
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
 #ifdef _WIN32
                (const char*)&opt,
 #else
@@ -76,40 +141,54 @@ int cHTTPX_Init(chttpx_serv_t* serv_p, uint16_t port, void* max_clients)
 #endif
                sizeof(opt));
 
+#ifdef SO_REUSEPORT
+    if (serv->reuseport && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+        perror("setsockopt SO_REUSEPORT");
+#endif
+
     struct sockaddr_in addr = {0};
     addr.sin_family = AF_INET;
-    addr.sin_port = htons(port);
+    addr.sin_port = htons(serv->port);
     addr.sin_addr.s_addr = INADDR_ANY;
 
-    if (bind(serv->server_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
     {
         perror("bind");
-        exit(1);
+        chttpx_close(fd);
+        return CHTTPX_INVALID_SOCKET;
     }
 
-    if (listen(serv->server_fd, 128) < 0)
+    if (listen(fd, serv->backlog > 0 ? serv->backlog : SOMAXCONN) < 0)
     {
         perror("listen");
-        exit(1);
+        chttpx_close(fd);
+        return CHTTPX_INVALID_SOCKET;
     }
 
-    /* Timeouts */
-    serv->read_timeout_sec = 300;
-    serv->write_timeout_sec = 300;
-    serv->idle_timeout_sec = 90;
+    return fd;
+}
 
-    /* Default values for routes */
-    serv->routes = NULL;
-    serv->routes_count = 0;
-    serv->routes_capacity = 0;
+/**
+ * Pin the calling thread to a CPU (serv->pin_cpus, Linux only).
+ * @param index Thread index, mapped to CPU index % online CPUs.
+ */
+void _serv_pin_cpu(size_t index)
+{
+#ifdef CHTTPX_PLATFORM_LINUX
+    if (!serv || !serv->pin_cpus)
+        return;
 
-    serv->ws_routes = NULL;
-    serv->ws_routes_count = 0;
-    serv->ws_routes_capacity = 0;
+    size_t cpu = index % _cpu_count();
 
-    printf("HTTP server started on port %d...\n", port);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
 
-    return 0;
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        fprintf(stderr, "Warning: failed to pin thread to CPU %zu\n", cpu);
+#else
+    (void)index;
+#endif
 }
 
 /* Register a route handler for a specific HTTP method and path. */
@@ -139,6 +218,15 @@ static void route(const char* method, const char* path, chttpx_handler_t handler
     serv->routes[serv->routes_count].method = strdup(method);
     serv->routes[serv->routes_count].path = strdup(path);
     serv->routes[serv->routes_count].handler = handler;
+    serv->routes[serv->routes_count].etag_disabled = false;
+    serv->routes[serv->routes_count].body_stream = false;
+
+    if (_router_insert(&serv->route_tree, method, path, serv->routes_count) < 0)
+    {
+        perror("router insert");
+        exit(1);
+    }
+
     serv->routes_count++;
 }
 
@@ -172,6 +260,69 @@ void cHTTPX_RegisterRoute(chttpx_router_t* r, const char* method, const char* pa
     route(method, fpath, handler);
 }
 
+/* Registered route with this method and path (under the router's prefix), NULL if none */
+static chttpx_route_t* registered_route(chttpx_router_t* r, const char* method, const char* path)
+{
+    if (!r || !r->serv || !method || !path)
+        return NULL;
+
+    char fpath[MAX_PATH];
+
+    if (snprintf(fpath, sizeof(fpath), "%s%s", r->prefix, path) >= (int)sizeof(fpath))
+        return NULL;
+
+    for (size_t i = 0; i < serv->routes_count; i++)
+    {
+        if (strcmp(serv->routes[i].method, method) == 0 && strcmp(serv->routes[i].path, fpath) == 0)
+            return &serv->routes[i];
+    }
+
+    return NULL;
+}
+
+int cHTTPX_RouteETag(chttpx_router_t* r, const char* method, const char* path, bool enabled)
+{
+    chttpx_route_t* route = registered_route(r, method, path);
+    if (!route)
+        return -1;
+
+    route->etag_disabled = !enabled;
+    return 0;
+}
+
+int cHTTPX_RouteBodyStream(chttpx_router_t* r, const char* method, const char* path, bool enabled)
+{
+    chttpx_route_t* route = registered_route(r, method, path);
+    if (!route)
+        return -1;
+
+    route->body_stream = enabled;
+    return 0;
+}
+
+/* Admit a connection accepted while max_clients are open, 0 if it was rejected */
+static int admit_overloaded(chttpx_socket_t client_fd)
+{
+    if (serv->overload == CHTTPX_OVERLOAD_REJECT)
+    {
+        _admission_reject(client_fd);
+        return 0;
+    }
+
+    _admission_note_wait();
+
+    /* Close the oldest idle keep-alive connection, retrying until one goes idle or closes */
+    do
+    {
+        if (serv->overload == CHTTPX_OVERLOAD_SHED_IDLE && _admission_shed_idle())
+            _admission_wait(0);
+        else
+            _admission_wait(serv->overload == CHTTPX_OVERLOAD_SHED_IDLE ? ADMISSION_SHED_RETRY_MS : 0);
+    } while (!_admission_try_acquire());
+
+    return 1;
+}
+
 static void* handle_client_wrapper(void* arg)
 {
     if (!serv)
@@ -179,7 +330,83 @@ static void* handle_client_wrapper(void* arg)
 
     chttpx_handle(arg);
 
-    serv->current_clients--;
+    _admission_release();
+    return NULL;
+}
+
+/* Accept connections on one listening socket, forever */
+static void accept_loop(chttpx_socket_t listen_fd)
+{
+    while (1)
+    {
+        /* Full: sleep until a connection closes, new clients wait in the listen backlog */
+        if (serv->overload == CHTTPX_OVERLOAD_QUEUE && chttpx_atomic_load(&serv->current_clients) >= serv->max_clients)
+        {
+            _admission_note_wait();
+            _admission_wait(0);
+        }
+
+        chttpx_socket_t client_fd = accept(listen_fd, NULL, NULL);
+        if (client_fd < 0)
+            continue;
+
+        /* Inc. max clients */
+        if (!_admission_try_acquire() && !admit_overloaded(client_fd))
+            continue;
+
+        if (serv->workers > 0)
+        {
+            if (_workers_submit(client_fd, NULL, 0) != 0)
+            {
+                chttpx_close(client_fd);
+                _admission_release();
+            }
+            continue;
+        }
+
+        /* Get client socket */
+        int* client_sock = malloc(sizeof(int));
+        if (!client_sock)
+        {
+            perror("malloc failed");
+            chttpx_close(client_fd);
+            _admission_release();
+            continue;
+        }
+        *client_sock = client_fd;
+
+        thread_t thread_id;
+        if (_thread_create(&thread_id, handle_client_wrapper, client_sock) != 0)
+        {
+            perror("thread create");
+            free(client_sock);
+            chttpx_close(client_fd);
+            _admission_release();
+            continue;
+        }
+
+#if defined(_WIN32) || defined(_WIN64)
+        CloseHandle(thread_id);
+#else
+        pthread_detach(thread_id);
+#endif
+    }
+}
+
+/* Extra SO_REUSEPORT listener served by its own accept thread */
+typedef struct
+{
+    chttpx_socket_t listen_fd;
+    size_t index;
+} accept_thread_t;
+
+static void* accept_thread(void* arg)
+{
+    accept_thread_t t = *(accept_thread_t*)arg;
+    free(arg);
+
+    _serv_pin_cpu(t.index);
+    accept_loop(t.listen_fd);
     return NULL;
 }
 
@@ -187,6 +414,11 @@ static void* handle_client_wrapper(void* arg)
  * Start the server loop to listen for incoming connections.
  * This function blocks indefinitely, accepting new client connections
  * and dispatching them to cHTTPX_Handle.
+ *
+ * With serv->workers set, connections are queued to a fixed worker pool;
+ * a full queue blocks the accept loop so the kernel backlog absorbs bursts.
+ * While max_clients connections are open, new ones are handled according
+ * to serv->overload; the accept loop sleeps instead of spinning.
  */
 void cHTTPX_Listen()
 {
@@ -196,30 +428,56 @@ void cHTTPX_Listen()
         return;
     }
 
-    while (1)
+#ifndef _WIN32
+    /* sendfile has no MSG_NOSIGNAL: a client closing mid-file must not kill the process */
+    struct sigaction sa;
+    if (sigaction(SIGPIPE, NULL, &sa) == 0 && sa.sa_handler == SIG_DFL)
+        signal(SIGPIPE, SIG_IGN);
+#endif
+
+    if (serv->workers > 0 && _workers_start(serv->workers, serv->workers_queue) != 0)
     {
-        if (serv->current_clients >= serv->max_clients)
-            continue;
+        fprintf(stderr, "Error: failed to start worker pool\n");
+        return;
+    }
 
-        chttpx_socket_t client_fd = accept(serv->server_fd, NULL, NULL);
-        if (client_fd < 0)
-            continue;
+    if (serv->mode == CHTTPX_MODE_EPOLL)
+    {
+        _eventloop_run();
+        return;
+    }
 
-        /* Inc. max clients */
-        serv->current_clients++;
+    /* SO_REUSEPORT: one more listener and accept thread per extra CPU */
+    size_t count = 1;
+    if (serv->reuseport)
+    {
+        count = serv->loop_threads;
+        if (count == 0)
+            count = _cpu_count();
+    }
 
-        /* Get client socket */
-        int* client_sock = malloc(sizeof(int));
-        if (!client_sock)
+    for (size_t i = 1; i < count; i++)
+    {
+        accept_thread_t* t = malloc(sizeof(accept_thread_t));
+        if (!t)
+            break;
+
+        t->listen_fd = _serv_listen_socket();
+        t->index = i;
+        if (t->listen_fd == CHTTPX_INVALID_SOCKET)
         {
-            perror("malloc failed");
-            chttpx_close(client_fd);
-            continue;
+            free(t);
+            break;
         }
-        *client_sock = client_fd;
 
         thread_t thread_id;
-        _thread_create(&thread_id, handle_client_wrapper, client_sock);
+        if (_thread_create(&thread_id, accept_thread, t) != 0)
+        {
+            perror("thread create");
+            chttpx_close(t->listen_fd);
+            free(t);
+            break;
+        }
 
 #if defined(_WIN32) || defined(_WIN64)
         CloseHandle(thread_id);
@@ -227,6 +485,9 @@ void cHTTPX_Listen()
         pthread_detach(thread_id);
 #endif
     }
+
+    _serv_pin_cpu(0);
+    accept_loop((chttpx_socket_t)serv->server_fd);
 }
 
 void cHTTPX_Shutdown()
@@ -245,6 +506,9 @@ void cHTTPX_Shutdown()
     serv->routes_count = 0;
     serv->routes_capacity = 0;
 
+    _router_free(serv->route_tree);
+    serv->route_tree = NULL;
+
     for (size_t i = 0; i < serv->ws_routes_count; i++)
         free(serv->ws_routes[i].path);
 
@@ -253,7 +517,11 @@ void cHTTPX_Shutdown()
     serv->ws_routes_count = 0;
     serv->ws_routes_capacity = 0;
 
+    _workers_stop();
     cHTTPX_WSocketShutdown();
+    _static_shutdown();
+    _sse_shutdown();
+    _compress_shutdown();
 #ifdef _WIN32
     chttpx_close(serv->server_fd);
 #else
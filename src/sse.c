@@ -0,0 +1,731 @@
+#define _GNU_SOURCE
+
+/*
+ * Copyright (c) 2026 netcorelink
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "sse.h"
+
+#include "http.h"
+#include "utils.h"
+#include "headers.h"
+#include "crosspltm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef CHTTPX_PLATFORM_LINUX
+
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/* Serialized event, shared by every subscriber of its topic */
+typedef struct
+{
+    uint64_t id;
+    size_t len;
+    char data[];
+} sse_msg_t;
+
+typedef struct sse_sub sse_sub_t;
+
+typedef struct sse_topic
+{
+    struct sse_topic* next;
+    uint64_t hash;
+
+    /* Last events: id n is in ring[n % CHTTPX_SSE_REPLAY] while n > next_id - CHTTPX_SSE_REPLAY */
+    sse_msg_t* ring[CHTTPX_SSE_REPLAY];
+    /* Id of the next event, ids start at 1 */
+    uint64_t next_id;
+
+    sse_sub_t** subs;
+    size_t subs_count;
+    size_t subs_cap;
+
+    /* Published to since the engine last wrote to the subscribers */
+    bool dirty;
+    struct sse_topic* next_dirty;
+
+    size_t name_len;
+    char name[];
+} sse_topic_t;
+
+/* Connection subscribed to a topic */
+struct sse_sub
+{
+    chttpx_socket_t fd;
+    /* NULL once closed, the memory goes at the end of the engine iteration */
+    sse_topic_t* topic;
+    size_t index;
+    sse_sub_t* next_closed;
+
+    /* Id of the next event to write */
+    uint64_t cursor;
+    /* Bytes of the first unwritten piece (pre, or the cursor's event) already written */
+    size_t off;
+
+    /* Response head or heartbeat, written before the events */
+    const char* pre;
+    size_t pre_len;
+    bool pre_owned;
+
+    /* Socket full, waiting for EPOLLOUT */
+    bool blocked;
+    time_t last_write;
+};
+
+typedef struct
+{
+    int initialized;
+    int stop;
+
+    /* Guards everything below, the engine thread writes under it */
+    chttpx_mutex_t lock;
+
+    int epfd;
+    /* eventfd written when a topic becomes dirty or on shutdown */
+    int wake_fd;
+    thread_t thread;
+
+    sse_topic_t* buckets[CHTTPX_SSE_BUCKETS];
+    sse_topic_t* dirty;
+    sse_sub_t* closed;
+
+    unsigned heartbeat_sec;
+    time_t last_sweep;
+
+    /* Counters */
+    size_t topics;
+    size_t subscribers;
+    uint64_t published;
+    uint64_t dropped;
+    uint64_t heartbeats;
+} sse_engine_t;
+
+static sse_engine_t engine = {.lock = PTHREAD_MUTEX_INITIALIZER, .heartbeat_sec = CHTTPX_SSE_HEARTBEAT_SEC};
+
+static const char sse_heartbeat[] = ":\n\n";
+
+/* FNV-1a, topics are short names */
+static uint64_t sse_hash(const char* s, size_t len)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+/* Oldest event still in the topic's ring */
+static uint64_t sse_oldest(const sse_topic_t* t)
+{
+    return t->next_id > CHTTPX_SSE_REPLAY ? t->next_id - CHTTPX_SSE_REPLAY : 1;
+}
+
+/* Find a topic, creating it when missing; engine lock held */
+static sse_topic_t* sse_topic(const char* name)
+{
+    size_t len = strlen(name);
+    uint64_t hash = sse_hash(name, len);
+    sse_topic_t** bucket = &engine.buckets[hash % CHTTPX_SSE_BUCKETS];
+
+    for (sse_topic_t* t = *bucket; t; t = t->next)
+    {
+        if (t->hash == hash && t->name_len == len && memcmp(t->name, name, len) == 0)
+            return t;
+    }
+
+    sse_topic_t* t = calloc(1, sizeof(*t) + len + 1);
+    if (!t)
+    {
+        perror("malloc failed");
+        return NULL;
+    }
+
+    t->hash = hash;
+    t->next_id = 1;
+    t->name_len = len;
+    memcpy(t->name, name, len + 1);
+
+    t->next = *bucket;
+    *bucket = t;
+    engine.topics++;
+
+    return t;
+}
+
+static void sse_wake(void)
+{
+    uint64_t one = 1;
+    if (write(engine.wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        perror("eventfd write");
+}
+
+/* Whether the engine waits for EPOLLOUT on a subscriber */
+static void sse_set_blocked(sse_sub_t* s, bool blocked)
+{
+    if (s->blocked == blocked)
+        return;
+
+    struct epoll_event ev = {.events = EPOLLIN | EPOLLRDHUP | (blocked ? EPOLLOUT : 0), .data.ptr = s};
+    epoll_ctl(engine.epfd, EPOLL_CTL_MOD, s->fd, &ev);
+    s->blocked = blocked;
+}
+
+static void sse_set_pre(sse_sub_t* s, const char* pre, size_t len, bool owned)
+{
+    if (s->pre_owned)
+        free((char*)s->pre);
+
+    s->pre = pre;
+    s->pre_len = len;
+    s->pre_owned = owned;
+}
+
+/* Close a subscriber: out of its topic and epoll now, freed after the current batch of events */
+static void sse_close(sse_sub_t* s)
+{
+    sse_topic_t* t = s->topic;
+    if (!t)
+        return;
+
+    t->subs[s->index] = t->subs[--t->subs_count];
+    t->subs[s->index]->index = s->index;
+
+    epoll_ctl(engine.epfd, EPOLL_CTL_DEL, s->fd, NULL);
+    chttpx_close(s->fd);
+
+    sse_set_pre(s, NULL, 0, false);
+    s->topic = NULL;
+    s->next_closed = engine.closed;
+    engine.closed = s;
+
+    engine.subscribers--;
+}
+
+static void sse_free_closed(void)
+{
+    while (engine.closed)
+    {
+        sse_sub_t* s = engine.closed;
+        engine.closed = s->next_closed;
+        free(s);
+    }
+}
+
+/**
+ * Write what a subscriber is owed: its head or heartbeat, then the events from its cursor,
+ * CHTTPX_SSE_BATCH events per call. Engine lock held.
+ * @return 0 when it is up to date, 1 if the socket is full, -1 if it has to be closed.
+ */
+static int sse_flush(sse_sub_t* s, time_t now)
+{
+    sse_topic_t* t = s->topic;
+
+    for (;;)
+    {
+        /* Too slow: the events it still needs are gone from the ring */
+        if (s->cursor < sse_oldest(t))
+        {
+            engine.dropped++;
+            return -1;
+        }
+
+        chttpx_send_part_t parts[CHTTPX_SSE_BATCH + 1];
+        size_t count = 0;
+        bool pre = s->pre != NULL;
+
+        if (pre)
+            parts[count++] = (chttpx_send_part_t){.data = s->pre, .len = s->pre_len, .fd = -1};
+
+        for (uint64_t id = s->cursor; id < t->next_id && count < CHTTPX_SSE_BATCH + 1; id++)
+        {
+            const sse_msg_t* m = t->ring[id % CHTTPX_SSE_REPLAY];
+            parts[count++] = (chttpx_send_part_t){.data = m->data, .len = m->len, .fd = -1};
+        }
+
+        if (count == 0)
+            return 0;
+
+        size_t off = s->off;
+        int r = _send_parts(s->fd, parts, count, &off);
+        if (r < 0)
+            return -1;
+
+        if (off > s->off)
+            s->last_write = now;
+
+        /* Move past the pieces written completely */
+        for (size_t i = 0; i < count && off >= parts[i].len; i++)
+        {
+            off -= parts[i].len;
+
+            if (i == 0 && pre)
+                sse_set_pre(s, NULL, 0, false);
+            else
+                s->cursor++;
+        }
+        s->off = off;
+
+        if (r == 0)
+            return 1;
+    }
+}
+
+/* Flush a subscriber and wait for EPOLLOUT if its socket is full */
+static void sse_write(sse_sub_t* s, time_t now)
+{
+    int r = sse_flush(s, now);
+
+    if (r < 0)
+        sse_close(s);
+    else
+        sse_set_blocked(s, r == 1);
+}
+
+/* Heartbeat to the subscribers that had nothing written for heartbeat_sec */
+static void sse_sweep(time_t now)
+{
+    for (size_t b = 0; b < CHTTPX_SSE_BUCKETS; b++)
+    {
+        for (sse_topic_t* t = engine.buckets[b]; t; t = t->next)
+        {
+            /* Backwards: closing moves the last subscriber into the slot */
+            for (size_t i = t->subs_count; i-- > 0;)
+            {
+                sse_sub_t* s = t->subs[i];
+                if (s->blocked || s->pre || s->cursor != t->next_id ||
+                    now - s->last_write < (time_t)engine.heartbeat_sec)
+                    continue;
+
+                sse_set_pre(s, sse_heartbeat, sizeof(sse_heartbeat) - 1, false);
+                engine.heartbeats++;
+                sse_write(s, now);
+            }
+        }
+    }
+}
+
+static void* sse_loop(void* arg)
+{
+    (void)arg;
+
+    struct epoll_event events[64];
+
+    for (;;)
+    {
+        int n = epoll_wait(engine.epfd, events, 64, 1000);
+        if (n < 0 && errno != EINTR)
+        {
+            perror("epoll_wait");
+            break;
+        }
+
+        _mutex_lock(&engine.lock);
+
+        if (engine.stop)
+        {
+            _mutex_unlock(&engine.lock);
+            break;
+        }
+
+        time_t now = time(NULL);
+
+        for (int i = 0; i < n; i++)
+        {
+            sse_sub_t* s = events[i].data.ptr;
+
+            if (!s)
+            {
+                uint64_t count;
+                if (read(engine.wake_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+                    perror("eventfd read");
+                continue;
+            }
+
+            /* Closed earlier in this batch */
+            if (!s->topic)
+                continue;
+
+            /* Clients only listen: input or a hang-up ends the stream */
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                sse_close(s);
+            else if (events[i].events & EPOLLOUT)
+                sse_write(s, now);
+        }
+
+        /* New events: write them to the subscribers that have room */
+        while (engine.dirty)
+        {
+            sse_topic_t* t = engine.dirty;
+            engine.dirty = t->next_dirty;
+            t->dirty = false;
+
+            for (size_t i = t->subs_count; i-- > 0;)
+            {
+                sse_sub_t* s = t->subs[i];
+
+                if (!s->blocked)
+                    sse_write(s, now);
+                else if (s->cursor < sse_oldest(t))
+                {
+                    engine.dropped++;
+                    sse_close(s);
+                }
+            }
+        }
+
+        if (engine.heartbeat_sec && now != engine.last_sweep)
+        {
+            engine.last_sweep = now;
+            sse_sweep(now);
+        }
+
+        sse_free_closed();
+        _mutex_unlock(&engine.lock);
+    }
+
+    return NULL;
+}
+
+/* Start the engine on first use; engine lock held */
+static int sse_init(void)
+{
+    if (engine.initialized)
+        return 0;
+
+    engine.epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (engine.epfd < 0)
+    {
+        perror("epoll_create1");
+        return -1;
+    }
+
+    engine.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (engine.wake_fd < 0)
+    {
+        perror("eventfd");
+        close(engine.epfd);
+        return -1;
+    }
+
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+    if (epoll_ctl(engine.epfd, EPOLL_CTL_ADD, engine.wake_fd, &ev) != 0 ||
+        _thread_create(&engine.thread, sse_loop, NULL) != 0)
+    {
+        perror("sse engine");
+        close(engine.wake_fd);
+        close(engine.epfd);
+        return -1;
+    }
+
+    engine.stop = 0;
+    engine.initialized = 1;
+    return 0;
+}
+
+/* Serialize an event: "id:", "event:" and one "data:" line per line of data */
+static sse_msg_t* sse_format(uint64_t id, const char* event, const char* data)
+{
+    size_t data_len = strlen(data);
+    size_t event_len = event ? strlen(event) : 0;
+
+    size_t lines = 1;
+    for (size_t i = 0; i < data_len; i++)
+    {
+        if (data[i] == '\n' || (data[i] == '\r' && data[i + 1] != '\n'))
+            lines++;
+    }
+
+    size_t cap = 32 + (event ? event_len + 8 : 0) + data_len + lines * 7 + 1;
+    sse_msg_t* m = malloc(sizeof(*m) + cap);
+    if (!m)
+    {
+        perror("malloc failed");
+        return NULL;
+    }
+
+    char* p = m->data;
+    p += sprintf(p, "id: %llu\n", (unsigned long long)id);
+
+    if (event)
+        p += sprintf(p, "event: %s\n", event);
+
+    /* CRLF, LF and CR all end a line of data */
+    const char* line = data;
+    const char* end = data + data_len;
+    for (;;)
+    {
+        const char* eol = line;
+        while (eol < end && *eol != '\n' && *eol != '\r')
+            eol++;
+
+        memcpy(p, "data: ", 6);
+        memcpy(p + 6, line, (size_t)(eol - line));
+        p += 6 + (eol - line);
+        *p++ = '\n';
+
+        if (eol == end)
+            break;
+
+        line = eol + (eol[0] == '\r' && eol + 1 < end && eol[1] == '\n' ? 2 : 1);
+    }
+    *p++ = '\n';
+
+    m->id = id;
+    m->len = (size_t)(p - m->data);
+    return m;
+}
+
+uint64_t cHTTPX_SSEPublish(const char* topic, const char* event, const char* data)
+{
+    if (!topic || (event && strpbrk(event, "\r\n")))
+        return 0;
+
+    _mutex_lock(&engine.lock);
+
+    sse_topic_t* t = sse_init() == 0 ? sse_topic(topic) : NULL;
+    sse_msg_t* m = t ? sse_format(t->next_id, event, data ? data : "") : NULL;
+    if (!m)
+    {
+        _mutex_unlock(&engine.lock);
+        return 0;
+    }
+
+    /* The oldest event makes room */
+    sse_msg_t** slot = &t->ring[m->id % CHTTPX_SSE_REPLAY];
+    free(*slot);
+    *slot = m;
+    t->next_id++;
+    engine.published++;
+
+    /* One wake-up for every event published before the engine gets to the topic */
+    if (t->subs_count > 0 && !t->dirty)
+    {
+        t->dirty = true;
+        t->next_dirty = engine.dirty;
+        engine.dirty = t;
+        sse_wake();
+    }
+
+    _mutex_unlock(&engine.lock);
+    return m->id;
+}
+
+int _sse_attach(chttpx_request_t* req, chttpx_response_t* res)
+{
+    char head[BUFFER_SIZE];
+    size_t head_len = _build_response_head(req, res, 1, head, sizeof(head));
+
+    sse_sub_t* s = calloc(1, sizeof(*s));
+    char* pre = malloc(head_len);
+    if (!s || !pre)
+    {
+        perror("malloc failed");
+        free(s);
+        free(pre);
+        return -1;
+    }
+    memcpy(pre, head, head_len);
+
+    /* Replay after the last event the client saw, if the ring still has it */
+    const char* last = cHTTPX_HeaderGet(req, "Last-Event-ID");
+    char* last_end = NULL;
+    unsigned long long last_id = last && *last ? strtoull(last, &last_end, 10) : 0;
+    bool replay = last_end && *last_end == '\0';
+
+    /* The engine writes without blocking */
+    int flags = fcntl(req->client_fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(req->client_fd, F_SETFL, flags | O_NONBLOCK) != 0)
+    {
+        free(s);
+        free(pre);
+        return -1;
+    }
+
+    _mutex_lock(&engine.lock);
+
+    sse_topic_t* t = sse_init() == 0 ? sse_topic(res->sse_topic) : NULL;
+    if (t && t->subs_count == t->subs_cap)
+    {
+        size_t cap = t->subs_cap ? t->subs_cap * 2 : 16;
+        sse_sub_t** subs = realloc(t->subs, cap * sizeof(*subs));
+        if (subs)
+        {
+            t->subs = subs;
+            t->subs_cap = cap;
+        }
+        else
+        {
+            perror("malloc failed");
+            t = NULL;
+        }
+    }
+
+    if (!t)
+    {
+        _mutex_unlock(&engine.lock);
+        free(s);
+        free(pre);
+        return -1;
+    }
+
+    s->fd = req->client_fd;
+    s->topic = t;
+    s->cursor = t->next_id;
+    if (replay && last_id < t->next_id)
+        s->cursor = last_id + 1 < sse_oldest(t) ? sse_oldest(t) : last_id + 1;
+    s->last_write = time(NULL);
+    sse_set_pre(s, pre, head_len, true);
+
+    /* Registered for EPOLLOUT: the engine writes the head and the replay */
+    s->blocked = true;
+    struct epoll_event ev = {.events = EPOLLIN | EPOLLRDHUP | EPOLLOUT, .data.ptr = s};
+    if (epoll_ctl(engine.epfd, EPOLL_CTL_ADD, s->fd, &ev) != 0)
+    {
+        perror("epoll_ctl");
+        _mutex_unlock(&engine.lock);
+        free(pre);
+        free(s);
+        return -1;
+    }
+
+    s->index = t->subs_count;
+    t->subs[t->subs_count++] = s;
+    engine.subscribers++;
+
+    _mutex_unlock(&engine.lock);
+
+    _log_response(req, res);
+    return 0;
+}
+
+void cHTTPX_SSEHeartbeat(unsigned sec)
+{
+    _mutex_lock(&engine.lock);
+    engine.heartbeat_sec = sec;
+    _mutex_unlock(&engine.lock);
+}
+
+void cHTTPX_SSEStats(chttpx_sse_stats_t* stats)
+{
+    _mutex_lock(&engine.lock);
+
+    stats->topics = engine.topics;
+    stats->subscribers = engine.subscribers;
+    stats->published = engine.published;
+    stats->dropped = engine.dropped;
+    stats->heartbeats = engine.heartbeats;
+
+    _mutex_unlock(&engine.lock);
+}
+
+void _sse_shutdown(void)
+{
+    _mutex_lock(&engine.lock);
+
+    if (!engine.initialized)
+    {
+        _mutex_unlock(&engine.lock);
+        return;
+    }
+
+    engine.stop = 1;
+    sse_wake();
+    _mutex_unlock(&engine.lock);
+
+    _thread_join(engine.thread);
+
+    _mutex_lock(&engine.lock);
+
+    for (size_t b = 0; b < CHTTPX_SSE_BUCKETS; b++)
+    {
+        while (engine.buckets[b])
+        {
+            sse_topic_t* t = engine.buckets[b];
+            engine.buckets[b] = t->next;
+
+            while (t->subs_count > 0)
+                sse_close(t->subs[0]);
+
+            for (size_t i = 0; i < CHTTPX_SSE_REPLAY; i++)
+                free(t->ring[i]);
+
+            free(t->subs);
+            free(t);
+        }
+    }
+    sse_free_closed();
+
+    close(engine.wake_fd);
+    close(engine.epfd);
+
+    engine.dirty = NULL;
+    engine.topics = engine.subscribers = 0;
+    engine.published = engine.dropped = engine.heartbeats = 0;
+    engine.initialized = 0;
+
+    _mutex_unlock(&engine.lock);
+}
+
+#else
+
+/* Without epoll there is no engine: event streams are refused */
+
+uint64_t cHTTPX_SSEPublish(const char* topic, const char* event, const char* data)
+{
+    (void)topic;
+    (void)event;
+    (void)data;
+    return 0;
+}
+
+int _sse_attach(chttpx_request_t* req, chttpx_response_t* res)
+{
+    (void)req;
+    (void)res;
+    return -1;
+}
+
+void cHTTPX_SSEHeartbeat(unsigned sec)
+{
+    (void)sec;
+}
+
+void cHTTPX_SSEStats(chttpx_sse_stats_t* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+void _sse_shutdown(void)
+{
+}
+
+#endif
@@ -0,0 +1,885 @@
+#define _GNU_SOURCE
+
+/*
+ * Copyright (c) 2026 netcorelink
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "static.h"
+
+#include "http.h"
+#include "utils.h"
+#include "headers.h"
+#include "compress.h"
+#include "crosspltm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <io.h>
+#endif
+
+#ifdef CHTTPX_PLATFORM_LINUX
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+/* Directory served under a URL prefix */
+typedef struct
+{
+    char* prefix;
+    size_t prefix_len;
+    char* dir;
+    size_t dir_len;
+} static_mount_t;
+
+/* Cached file, keyed by its path in the file system */
+typedef struct static_entry
+{
+    struct static_entry* next;
+    uint64_t hash;
+
+    /* -1: the file is known to be missing (precompressed siblings) */
+    int fd;
+    size_t size;
+    const char* content_type;
+    char etag[CHTTPX_FILE_ETAG_SIZE];
+    char last_modified[CHTTPX_HTTP_DATE_SIZE];
+    /* Last check against the file system (without inotify) */
+    time_t checked;
+
+    size_t path_len;
+    char path[];
+} static_entry_t;
+
+#ifdef CHTTPX_PLATFORM_LINUX
+/* Watched directory: inotify events carry the wd and the file name */
+typedef struct
+{
+    int wd;
+    char* dir;
+} static_watch_t;
+#endif
+
+typedef struct
+{
+    int initialized;
+
+    static_mount_t mounts[STATIC_MAX_MOUNTS];
+    size_t mounts_count;
+
+    /* Concurrent hash map: bucket i is guarded by locks[i % STATIC_LOCKS] */
+    static_entry_t* buckets[STATIC_BUCKETS];
+    chttpx_mutex_t locks[STATIC_LOCKS];
+
+#ifdef CHTTPX_PLATFORM_LINUX
+    /* Invalidation: parent directories of cached files are watched */
+    int inotify_fd;
+    int stop_pipe[2];
+    thread_t watcher;
+    int watcher_running;
+
+    chttpx_mutex_t watch_lock;
+    static_watch_t* watches;
+    size_t watches_count;
+    size_t watches_cap;
+#endif
+
+    /* Counters */
+    size_t entries;
+    size_t hits;
+    size_t misses;
+    size_t invalidations;
+} static_cache_t;
+
+static static_cache_t cache;
+
+/* Extension to Content-Type */
+static const struct
+{
+    const char* ext;
+    const char* type;
+} static_types[] = {
+    {"html", cHTTPX_CTYPE_HTML}, {"htm", cHTTPX_CTYPE_HTML},   {"css", cHTTPX_CTYPE_CSS},     {"js", cHTTPX_CTYPE_JS},
+    {"mjs", cHTTPX_CTYPE_JS},    {"json", cHTTPX_CTYPE_JSON},  {"xml", cHTTPX_CTYPE_XML},     {"csv", cHTTPX_CTYPE_CSV},
+    {"txt", cHTTPX_CTYPE_TEXT},  {"png", cHTTPX_CTYPE_PNG},    {"jpg", cHTTPX_CTYPE_JPEG},    {"jpeg", cHTTPX_CTYPE_JPEG},
+    {"gif", cHTTPX_CTYPE_GIF},   {"webp", cHTTPX_CTYPE_WEBP},  {"svg", cHTTPX_CTYPE_SVG},     {"bmp", cHTTPX_CTYPE_BMP},
+    {"mp3", cHTTPX_CTYPE_MP3},   {"wav", cHTTPX_CTYPE_WAV},    {"ogg", cHTTPX_CTYPE_OGG},     {"mp4", cHTTPX_CTYPE_MP4},
+    {"webm", cHTTPX_CTYPE_WEBM}, {"avi", cHTTPX_CTYPE_AVI},    {"zip", cHTTPX_CTYPE_ZIP},     {"rar", cHTTPX_CTYPE_RAR},
+    {"7z", cHTTPX_CTYPE_7Z},     {"pdf", cHTTPX_CTYPE_PDF},    {"woff", cHTTPX_CTYPE_WOFF},   {"woff2", cHTTPX_CTYPE_WOFF2},
+    {"ttf", cHTTPX_CTYPE_TTF},   {"otf", cHTTPX_CTYPE_OTF},
+};
+
+static const char* static_content_type(const char* path, size_t len)
+{
+    const char* dot = NULL;
+    for (size_t i = len; i > 0 && path[i - 1] != '/'; i--)
+    {
+        if (path[i - 1] == '.')
+        {
+            dot = path + i;
+            break;
+        }
+    }
+
+    if (dot)
+    {
+        for (size_t i = 0; i < sizeof(static_types) / sizeof(static_types[0]); i++)
+        {
+            if (strcasecmp(static_types[i].ext, dot) == 0)
+                return static_types[i].type;
+        }
+    }
+
+    return cHTTPX_CTYPE_OCTET;
+}
+
+/* FNV-1a */
+static uint64_t static_hash(const char* s, size_t len)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+static chttpx_mutex_t* static_lock(uint64_t hash)
+{
+    return &cache.locks[(hash % STATIC_BUCKETS) % STATIC_LOCKS];
+}
+
+static void static_entry_free(static_entry_t* e)
+{
+    if (e->fd >= 0)
+        close(e->fd);
+    free(e);
+    chttpx_atomic_sub(&cache.entries, 1);
+}
+
+/* Drop the entry of a path, if cached */
+static void static_invalidate(const char* path, size_t len)
+{
+    uint64_t hash = static_hash(path, len);
+    chttpx_mutex_t* lock = static_lock(hash);
+
+    _mutex_lock(lock);
+
+    static_entry_t** link = &cache.buckets[hash % STATIC_BUCKETS];
+    while (*link)
+    {
+        static_entry_t* e = *link;
+        if (e->hash == hash && e->path_len == len && memcmp(e->path, path, len) == 0)
+        {
+            *link = e->next;
+            static_entry_free(e);
+            chttpx_atomic_add(&cache.invalidations, 1);
+            break;
+        }
+        link = &e->next;
+    }
+
+    _mutex_unlock(lock);
+}
+
+/* Drop every entry */
+static void static_flush(int count_invalidations)
+{
+    for (size_t b = 0; b < STATIC_BUCKETS; b++)
+    {
+        chttpx_mutex_t* lock = &cache.locks[b % STATIC_LOCKS];
+        _mutex_lock(lock);
+
+        while (cache.buckets[b])
+        {
+            static_entry_t* e = cache.buckets[b];
+            cache.buckets[b] = e->next;
+            static_entry_free(e);
+
+            if (count_invalidations)
+                chttpx_atomic_add(&cache.invalidations, 1);
+        }
+
+        _mutex_unlock(lock);
+    }
+}
+
+#ifdef CHTTPX_PLATFORM_LINUX
+/* Watch the parent directory of a file before it is cached */
+static int static_watch_dir(const char* path, size_t len)
+{
+    size_t dir_len = len;
+    while (dir_len > 0 && path[dir_len - 1] != '/')
+        dir_len--;
+    if (dir_len > 1)
+        dir_len--;
+
+    char dir[STATIC_PATH_MAX];
+    memcpy(dir, path, dir_len);
+    dir[dir_len] = '\0';
+
+    _mutex_lock(&cache.watch_lock);
+
+    for (size_t i = 0; i < cache.watches_count; i++)
+    {
+        if (strcmp(cache.watches[i].dir, dir) == 0)
+        {
+            _mutex_unlock(&cache.watch_lock);
+            return 0;
+        }
+    }
+
+    int wd = inotify_add_watch(cache.inotify_fd, dir,
+                               IN_CREATE | IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM |
+                                   IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+
+    if (wd >= 0 && cache.watches_count == cache.watches_cap)
+    {
+        size_t cap = cache.watches_cap ? cache.watches_cap * 2 : 16;
+        static_watch_t* watches = realloc(cache.watches, cap * sizeof(static_watch_t));
+        if (watches)
+        {
+            cache.watches = watches;
+            cache.watches_cap = cap;
+        }
+    }
+
+    char* copy = wd >= 0 ? strdup(dir) : NULL;
+    if (!copy || cache.watches_count == cache.watches_cap)
+    {
+        free(copy);
+        _mutex_unlock(&cache.watch_lock);
+        return -1;
+    }
+
+    cache.watches[cache.watches_count].wd = wd;
+    cache.watches[cache.watches_count].dir = copy;
+    cache.watches_count++;
+
+    _mutex_unlock(&cache.watch_lock);
+    return 0;
+}
+
+/* Apply one inotify event to the cache */
+static void static_watch_event(const struct inotify_event* ev)
+{
+    /* Lost events, or a watched directory went away: start over */
+    if (ev->mask & (IN_Q_OVERFLOW | IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF))
+    {
+        if (ev->mask & IN_IGNORED)
+        {
+            _mutex_lock(&cache.watch_lock);
+            for (size_t i = 0; i < cache.watches_count;)
+            {
+                if (cache.watches[i].wd == ev->wd)
+                {
+                    free(cache.watches[i].dir);
+                    cache.watches[i] = cache.watches[--cache.watches_count];
+                    continue;
+                }
+                i++;
+            }
+            _mutex_unlock(&cache.watch_lock);
+        }
+
+        static_flush(1);
+        return;
+    }
+
+    if (ev->len == 0)
+        return;
+
+    /* The same directory may be watched under several spellings (one per mount) */
+    _mutex_lock(&cache.watch_lock);
+    for (size_t i = 0; i < cache.watches_count; i++)
+    {
+        if (cache.watches[i].wd != ev->wd)
+            continue;
+
+        char path[STATIC_PATH_MAX];
+        const char* dir = cache.watches[i].dir;
+        int n = snprintf(path, sizeof(path), "%s%s%s", dir, strcmp(dir, "/") == 0 ? "" : "/", ev->name);
+
+        if (n > 0 && (size_t)n < sizeof(path))
+            static_invalidate(path, (size_t)n);
+    }
+    _mutex_unlock(&cache.watch_lock);
+}
+
+static void* static_watcher(void* arg)
+{
+    (void)arg;
+
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    for (;;)
+    {
+        struct pollfd pfd[2] = {{cache.inotify_fd, POLLIN, 0}, {cache.stop_pipe[0], POLLIN, 0}};
+        if (poll(pfd, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if (pfd[1].revents)
+            break;
+
+        ssize_t len = read(cache.inotify_fd, buf, sizeof(buf));
+        if (len <= 0)
+        {
+            if (len < 0 && (errno == EINTR || errno == EAGAIN))
+                continue;
+            break;
+        }
+
+        for (char* p = buf; p < buf + len;)
+        {
+            const struct inotify_event* ev = (const struct inotify_event*)p;
+            static_watch_event(ev);
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+
+    return NULL;
+}
+#endif
+
+static int static_init(void)
+{
+    if (cache.initialized)
+        return 0;
+
+    for (size_t i = 0; i < STATIC_LOCKS; i++)
+        _mutex_init(&cache.locks[i]);
+
+#ifdef CHTTPX_PLATFORM_LINUX
+    _mutex_init(&cache.watch_lock);
+
+    cache.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (cache.inotify_fd < 0)
+    {
+        perror("inotify_init1");
+        return -1;
+    }
+
+    if (pipe2(cache.stop_pipe, O_CLOEXEC) != 0)
+    {
+        perror("pipe2");
+        close(cache.inotify_fd);
+        return -1;
+    }
+
+    if (_thread_create(&cache.watcher, static_watcher, NULL) != 0)
+    {
+        perror("thread create");
+        close(cache.inotify_fd);
+        close(cache.stop_pipe[0]);
+        close(cache.stop_pipe[1]);
+        return -1;
+    }
+
+    cache.watcher_running = 1;
+#endif
+
+    cache.initialized = 1;
+    return 0;
+}
+
+int cHTTPX_Static(const char* prefix, const char* dir)
+{
+    if (!prefix || !dir || !dir[0])
+        return -1;
+
+    if (static_init() != 0)
+        return -1;
+
+    if (cache.mounts_count == STATIC_MAX_MOUNTS)
+    {
+        fprintf(stderr, "Error: too many static directories\n");
+        return -1;
+    }
+
+    /* Without trailing slashes: "/assets/" and "/assets" are the same mount */
+    size_t prefix_len = strlen(prefix);
+    while (prefix_len > 0 && prefix[prefix_len - 1] == '/')
+        prefix_len--;
+
+    size_t dir_len = strlen(dir);
+    while (dir_len > 1 && dir[dir_len - 1] == '/')
+        dir_len--;
+
+    static_mount_t* m = &cache.mounts[cache.mounts_count];
+    m->prefix = malloc(prefix_len + 1);
+    m->dir = malloc(dir_len + 1);
+    if (!m->prefix || !m->dir)
+    {
+        perror("malloc failed");
+        free(m->prefix);
+        free(m->dir);
+        return -1;
+    }
+
+    memcpy(m->prefix, prefix, prefix_len);
+    m->prefix[prefix_len] = '\0';
+    m->prefix_len = prefix_len;
+    memcpy(m->dir, dir, dir_len);
+    m->dir[dir_len] = '\0';
+    m->dir_len = dir_len;
+
+    cache.mounts_count++;
+    return 0;
+}
+
+long _static_find(const chttpx_request_t* req)
+{
+    if (cache.mounts_count == 0 || (strcmp(req->method, cHTTPX_MethodGet) != 0 && strcmp(req->method, "HEAD") != 0))
+        return -1;
+
+    for (size_t i = 0; i < cache.mounts_count; i++)
+    {
+        const static_mount_t* m = &cache.mounts[i];
+
+        if (req->path_len >= m->prefix_len && memcmp(req->path, m->prefix, m->prefix_len) == 0 &&
+            (req->path_len == m->prefix_len || req->path[m->prefix_len] == '/'))
+            return (long)i;
+    }
+
+    return -1;
+}
+
+/**
+ * File path of a REQuest: the mount directory and the path below the prefix,
+ * without empty or "." segments so it matches the names reported by inotify.
+ * A path ending in "/" gets index.html.
+ * @return Length of the path, 0 if it contains ".." or does not fit.
+ */
+static size_t static_build_path(const static_mount_t* m, const char* rel, size_t rel_len, char* path, size_t size)
+{
+    if (m->dir_len >= size)
+        return 0;
+
+    memcpy(path, m->dir, m->dir_len);
+    size_t len = m->dir_len;
+    if (len == 1 && path[0] == '/')
+        len = 0;
+
+    size_t i = 0;
+    while (i < rel_len)
+    {
+        while (i < rel_len && rel[i] == '/')
+            i++;
+
+        size_t start = i;
+        while (i < rel_len && rel[i] != '/')
+            i++;
+
+        size_t seg = i - start;
+        if (seg == 0 || (seg == 1 && rel[start] == '.'))
+            continue;
+
+        if ((seg == 2 && rel[start] == '.' && rel[start + 1] == '.') || memchr(rel + start, '\\', seg))
+            return 0;
+
+        if (len + 1 + seg >= size)
+            return 0;
+
+        path[len++] = '/';
+        memcpy(path + len, rel + start, seg);
+        len += seg;
+    }
+
+    if (rel_len == 0 || rel[rel_len - 1] == '/')
+    {
+        static const char index[] = "/index.html";
+        if (len + sizeof(index) > size)
+            return 0;
+
+        memcpy(path + len, index, sizeof(index) - 1);
+        len += sizeof(index) - 1;
+    }
+
+    path[len] = '\0';
+    return len;
+}
+
+/* Cached file, the response gets its own descriptor.
+ * @return 1 if res is set, 0 if the path is not cached, -1 if it is known to be missing.
+ */
+static int static_lookup(const char* path, size_t len, uint64_t hash, chttpx_response_t* res)
+{
+    chttpx_mutex_t* lock = static_lock(hash);
+    _mutex_lock(lock);
+
+    static_entry_t** link = &cache.buckets[hash % STATIC_BUCKETS];
+    static_entry_t* e = *link;
+    while (e && !(e->hash == hash && e->path_len == len && memcmp(e->path, path, len) == 0))
+    {
+        link = &e->next;
+        e = *link;
+    }
+
+#ifndef CHTTPX_PLATFORM_LINUX
+    /* No change notifications: revalidate against the file system now and then */
+    time_t now = time(NULL);
+    if (e && now - e->checked >= STATIC_REVALIDATE_SEC)
+    {
+        struct stat st;
+        char etag[CHTTPX_FILE_ETAG_SIZE] = "";
+        if (stat(e->path, &st) == 0)
+            _file_etag((uint64_t)st.st_mtime, (uint64_t)st.st_size, etag, sizeof(etag));
+
+        if (strcmp(etag, e->etag) != 0)
+        {
+            *link = e->next;
+            static_entry_free(e);
+            chttpx_atomic_add(&cache.invalidations, 1);
+            e = NULL;
+        }
+        else
+        {
+            e->checked = now;
+        }
+    }
+#endif
+
+    if (e && e->fd < 0)
+    {
+        _mutex_unlock(lock);
+        return -1;
+    }
+
+#ifdef _WIN32
+    int fd = e ? _dup(e->fd) : -1;
+#else
+    int fd = e ? fcntl(e->fd, F_DUPFD_CLOEXEC, 0) : -1;
+#endif
+
+    if (fd < 0)
+    {
+        _mutex_unlock(lock);
+        return 0;
+    }
+
+    size_t size = e->size;
+    const char* content_type = e->content_type;
+    char etag[CHTTPX_FILE_ETAG_SIZE];
+    memcpy(etag, e->etag, sizeof(etag));
+    char last_modified[CHTTPX_HTTP_DATE_SIZE];
+    memcpy(last_modified, e->last_modified, sizeof(last_modified));
+
+    _mutex_unlock(lock);
+
+    *res = _res_file_fd(cHTTPX_StatusOK, content_type, fd, size, etag, last_modified);
+    return 1;
+}
+
+/* Open a file and add it to the cache */
+static int static_load(const char* path, size_t len, uint64_t hash, chttpx_response_t* res)
+{
+#ifdef CHTTPX_PLATFORM_LINUX
+    /* Watch first, a change between open and watch would never be seen */
+    int watched = static_watch_dir(path, len) == 0;
+#else
+    int watched = 1;
+#endif
+
+#ifdef _WIN32
+    int fd = _open(path, _O_RDONLY | _O_BINARY);
+    struct _stat64 st;
+    if (fd >= 0 && _fstat64(fd, &st) != 0)
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) != 0)
+#endif
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    if (fd >= 0 && !S_ISREG(st.st_mode))
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    if (fd < 0)
+        return 0;
+
+    const char* content_type = static_content_type(path, len);
+    char etag[CHTTPX_FILE_ETAG_SIZE];
+    _file_etag((uint64_t)st.st_mtime, (uint64_t)st.st_size, etag, sizeof(etag));
+    char last_modified[CHTTPX_HTTP_DATE_SIZE];
+    _http_date(st.st_mtime, last_modified, sizeof(last_modified));
+
+    static_entry_t* e = NULL;
+    if (watched && chttpx_atomic_load(&cache.entries) < STATIC_MAX_ENTRIES)
+        e = malloc(sizeof(static_entry_t) + len + 1);
+
+    /* Full cache: serve the file uncached */
+    if (!e)
+    {
+        *res = _res_file_fd(cHTTPX_StatusOK, content_type, fd, (size_t)st.st_size, etag, last_modified);
+        return 1;
+    }
+
+#ifdef _WIN32
+    int res_fd = _dup(fd);
+#else
+    int res_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+#endif
+    if (res_fd < 0)
+    {
+        free(e);
+        *res = _res_file_fd(cHTTPX_StatusOK, content_type, fd, (size_t)st.st_size, etag, last_modified);
+        return 1;
+    }
+
+    e->hash = hash;
+    e->fd = fd;
+    e->size = (size_t)st.st_size;
+    e->content_type = content_type;
+    memcpy(e->etag, etag, sizeof(etag));
+    memcpy(e->last_modified, last_modified, sizeof(last_modified));
+    e->checked = time(NULL);
+    e->path_len = len;
+    memcpy(e->path, path, len);
+    e->path[len] = '\0';
+
+    chttpx_mutex_t* lock = static_lock(hash);
+    _mutex_lock(lock);
+
+    /* Another thread may have loaded it meanwhile, keep the first one */
+    static_entry_t* other = cache.buckets[hash % STATIC_BUCKETS];
+    while (other && !(other->hash == hash && other->path_len == len && memcmp(other->path, path, len) == 0))
+        other = other->next;
+
+    if (other)
+    {
+        close(fd);
+        free(e);
+    }
+    else
+    {
+        e->next = cache.buckets[hash % STATIC_BUCKETS];
+        cache.buckets[hash % STATIC_BUCKETS] = e;
+        chttpx_atomic_add(&cache.entries, 1);
+    }
+
+    _mutex_unlock(lock);
+
+    *res = _res_file_fd(cHTTPX_StatusOK, content_type, res_fd, (size_t)st.st_size, etag, last_modified);
+    return 1;
+}
+
+/* Remember that a path does not exist, until its directory reports a change */
+static void static_remember_missing(const char* path, size_t len, uint64_t hash)
+{
+    if (chttpx_atomic_load(&cache.entries) >= STATIC_MAX_ENTRIES)
+        return;
+
+#ifdef CHTTPX_PLATFORM_LINUX
+    if (static_watch_dir(path, len) != 0)
+        return;
+#endif
+
+    static_entry_t* e = calloc(1, sizeof(static_entry_t) + len + 1);
+    if (!e)
+        return;
+
+    e->hash = hash;
+    e->fd = -1;
+    e->content_type = cHTTPX_CTYPE_OCTET;
+    e->checked = time(NULL);
+    e->path_len = len;
+    memcpy(e->path, path, len);
+
+    chttpx_mutex_t* lock = static_lock(hash);
+    _mutex_lock(lock);
+
+    static_entry_t* other = cache.buckets[hash % STATIC_BUCKETS];
+    while (other && !(other->hash == hash && other->path_len == len && memcmp(other->path, path, len) == 0))
+        other = other->next;
+
+    if (other)
+    {
+        free(e);
+    }
+    else
+    {
+        e->next = cache.buckets[hash % STATIC_BUCKETS];
+        cache.buckets[hash % STATIC_BUCKETS] = e;
+        chttpx_atomic_add(&cache.entries, 1);
+    }
+
+    _mutex_unlock(lock);
+}
+
+/* Precompressed siblings, in order of preference */
+static const struct
+{
+    unsigned coding;
+    const char* ext;
+    const char* name;
+} static_encodings[] = {{CHTTPX_ENC_BR, ".br", "br"}, {CHTTPX_ENC_GZIP, ".gz", "gzip"}};
+
+/* Answer with "<path>.br" or "<path>.gz" when the client accepts it and the file exists */
+static void static_precompressed(const char* path, size_t len, unsigned accepts, chttpx_response_t* res)
+{
+    for (size_t i = 0; i < sizeof(static_encodings) / sizeof(static_encodings[0]); i++)
+    {
+        size_t ext_len = strlen(static_encodings[i].ext);
+        if (!(accepts & static_encodings[i].coding) || len + ext_len >= STATIC_PATH_MAX)
+            continue;
+
+        char sibling[STATIC_PATH_MAX];
+        memcpy(sibling, path, len);
+        memcpy(sibling + len, static_encodings[i].ext, ext_len + 1);
+        size_t sibling_len = len + ext_len;
+        uint64_t hash = static_hash(sibling, sibling_len);
+
+        /* Missing siblings are cached too, or every hit would pay an open() */
+        chttpx_response_t alt = {0};
+        int found = static_lookup(sibling, sibling_len, hash, &alt);
+        if (found == 0)
+        {
+            found = static_load(sibling, sibling_len, hash, &alt);
+            if (!found)
+                static_remember_missing(sibling, sibling_len, hash);
+        }
+
+        if (found <= 0)
+            continue;
+
+        /* The sibling's bytes, the original's type */
+        alt.content_type = res->content_type;
+        if (cHTTPX_HeaderAdd(&alt, "Content-Encoding", static_encodings[i].name) != 0)
+        {
+            _res_release(&alt);
+            continue;
+        }
+
+        _res_release(res);
+        *res = alt;
+
+        _compress_note_precompressed();
+        return;
+    }
+}
+
+void _static_serve(long mount, chttpx_request_t* req, chttpx_response_t* res)
+{
+    const static_mount_t* m = &cache.mounts[mount];
+
+    char path[STATIC_PATH_MAX];
+    size_t len = static_build_path(m, req->path + m->prefix_len, req->path_len - m->prefix_len, path, sizeof(path));
+    if (len == 0)
+    {
+        *res = cHTTPX_ResJson(cHTTPX_StatusNotFound, "{\"error\": \"not found\"}");
+        return;
+    }
+
+    uint64_t hash = static_hash(path, len);
+    int found = static_lookup(path, len, hash, res);
+
+    /* A path known to be missing is not served from the cache, it counts as a miss */
+    if (found > 0)
+    {
+        chttpx_atomic_add(&cache.hits, 1);
+    }
+    else
+    {
+        chttpx_atomic_add(&cache.misses, 1);
+        if (found == 0)
+            found = static_load(path, len, hash, res);
+    }
+
+    if (found <= 0)
+    {
+        *res = cHTTPX_ResJson(cHTTPX_StatusNotFound, "{\"error\": \"not found\"}");
+        return;
+    }
+
+    unsigned accepts = _compress_accepts(req);
+    if (accepts && _compress_type(res->content_type))
+        static_precompressed(path, len, accepts, res);
+}
+
+void _static_shutdown(void)
+{
+    if (!cache.initialized)
+        return;
+
+#ifdef CHTTPX_PLATFORM_LINUX
+    if (cache.watcher_running)
+    {
+        char stop = 1;
+        if (write(cache.stop_pipe[1], &stop, 1) == 1)
+            _thread_join(cache.watcher);
+        cache.watcher_running = 0;
+    }
+
+    close(cache.inotify_fd);
+    close(cache.stop_pipe[0]);
+    close(cache.stop_pipe[1]);
+
+    for (size_t i = 0; i < cache.watches_count; i++)
+        free(cache.watches[i].dir);
+
+    free(cache.watches);
+    cache.watches = NULL;
+    cache.watches_count = cache.watches_cap = 0;
+
+    _mutex_destroy(&cache.watch_lock);
+#endif
+
+    static_flush(0);
+
+    for (size_t i = 0; i < cache.mounts_count; i++)
+    {
+        free(cache.mounts[i].prefix);
+        free(cache.mounts[i].dir);
+    }
+    cache.mounts_count = 0;
+
+    for (size_t i = 0; i < STATIC_LOCKS; i++)
+        _mutex_destroy(&cache.locks[i]);
+
+    cache.hits = cache.misses = cache.invalidations = 0;
+    cache.initialized = 0;
+}
+
+void cHTTPX_StaticStats(chttpx_static_stats_t* stats)
+{
+    stats->entries = chttpx_atomic_load(&cache.entries);
+    stats->hits = chttpx_atomic_load(&cache.hits);
+    stats->misses = chttpx_atomic_load(&cache.misses);
+    stats->invalidations = chttpx_atomic_load(&cache.invalidations);
+}
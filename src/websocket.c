@@ -15,7 +15,7 @@
 #include <strings.h>
 #include <unistd.h>
 #include <errno.h>
-#include <sys/select.h>
+#include <poll.h>
 #else
 #include <winsock2.h>
 #endif
@@ -346,12 +346,16 @@ static chttpx_wsocket_route_entry_t* find_ws_route(chttpx_request_t* req)
     if (!serv || !req || !req->path)
         return NULL;
 
+    chttpx_param_t params[MAX_PARAMS];
+
     for (size_t i = 0; i < serv->ws_routes_count; i++)
     {
         int count = 0;
-        if (cHTTPX_MatchPath(serv->ws_routes[i].path, req->path, req->params, &count))
+        if (cHTTPX_MatchPath(serv->ws_routes[i].path, req->path, params, &count))
         {
-            req->params_count = count;
+            if (_req_set_params(req, params, (size_t)count) != 0)
+                return NULL;
+
             return &serv->ws_routes[i];
         }
     }
@@ -396,9 +400,41 @@ static void ws_connection_close(ws_connection_t* conn)
     conn->public_ws.socket = (chttpx_socket_t)-1;
 }
 
+/* Copy REQuest params into one block owned by the connection */
+static int ws_copy_params(chttpx_wsocket_t* ws, const chttpx_request_t* req)
+{
+    size_t size = sizeof(chttpx_param_t) * req->params_count;
+    for (size_t i = 0; i < req->params_count; i++)
+        size += req->params[i].name_len + req->params[i].value_len + 2;
+
+    chttpx_param_t* params = malloc(size);
+    if (!params)
+        return -1;
+
+    char* strings = (char*)(params + req->params_count);
+    for (size_t i = 0; i < req->params_count; i++)
+    {
+        params[i] = req->params[i];
+
+        memcpy(strings, req->params[i].name, req->params[i].name_len + 1);
+        params[i].name = strings;
+        strings += req->params[i].name_len + 1;
+
+        memcpy(strings, req->params[i].value, req->params[i].value_len + 1);
+        params[i].value = strings;
+        strings += req->params[i].value_len + 1;
+    }
+
+    ws->params = params;
+    ws->params_count = req->params_count;
+
+    return 0;
+}
+
 static void ws_remove_connection(size_t index)
 {
     ws_connection_close(&ws_engine.items[index]);
+    free(ws_engine.items[index].public_ws.params);
     ws_engine.items[index] = ws_engine.items[ws_engine.count - 1];
     ws_engine.count--;
 }
@@ -422,11 +458,8 @@ static int ws_add_connection(chttpx_socket_t fd, chttpx_wsocket_route_entry_t* r
     conn->public_ws.connected = 1;
     if (req && req->path)
         strncpy(conn->public_ws.path, req->path, sizeof(conn->public_ws.path) - 1);
-    if (req && req->params_count > 0)
-    {
-        conn->public_ws.params_count = req->params_count;
-        memcpy(conn->public_ws.params, req->params, sizeof(chttpx_param_t) * req->params_count);
-    }
+    if (req && req->params_count > 0 && ws_copy_params(&conn->public_ws, req) != 0)
+        return -1;
     conn->public_ws.userdata = route->userdata;
     conn->on_open = route->on_open;
     conn->on_message = route->on_message;
@@ -645,13 +678,38 @@ static void ws_read_and_parse(ws_connection_t* conn)
     }
 }
 
-/* --- Poll thread (select: works on Linux and Windows/MinGW) --- */
+/* --- Poll thread (poll / WSAPoll: upgraded event loop sockets go past FD_SETSIZE) --- */
+
+#if defined(_WIN32) || defined(_WIN64)
+typedef WSAPOLLFD ws_pollfd_t;
+#define WS_POLL_IN POLLRDNORM
+#define ws_poll(fds, n, timeout_ms) WSAPoll((fds), (ULONG)(n), (timeout_ms))
+#else
+typedef struct pollfd ws_pollfd_t;
+#define WS_POLL_IN POLLIN
+#define ws_poll(fds, n, timeout_ms) poll((fds), (nfds_t)(n), (timeout_ms))
+#endif
 
 static void ws_poll_process_readable(ws_connection_t* conn)
 {
     ws_read_and_parse(conn);
 }
 
+/* Connection of a polled socket: still at its index unless the list changed meanwhile */
+static ws_connection_t* ws_poll_find(chttpx_socket_t fd, size_t hint)
+{
+    if (hint < ws_engine.count && ws_engine.items[hint].public_ws.socket == fd)
+        return &ws_engine.items[hint];
+
+    for (size_t i = 0; i < ws_engine.count; i++)
+    {
+        if (ws_engine.items[i].public_ws.socket == fd)
+            return &ws_engine.items[i];
+    }
+
+    return NULL;
+}
+
 static void* ws_poll_loop(void* arg)
 {
     (void)arg;
@@ -661,14 +719,17 @@ static void* ws_poll_loop(void* arg)
         ws_lock();
         size_t n = ws_engine.count;
 
-        chttpx_socket_t* fds = NULL;
+        ws_pollfd_t* fds = NULL;
         if (n > 0)
         {
-            fds = malloc(sizeof(chttpx_socket_t) * n);
+            fds = calloc(n, sizeof(ws_pollfd_t));
             if (fds)
             {
                 for (size_t i = 0; i < n; i++)
-                    fds[i] = ws_engine.items[i].public_ws.socket;
+                {
+                    fds[i].fd = ws_engine.items[i].public_ws.socket;
+                    fds[i].events = WS_POLL_IN;
+                }
             }
             else
                 n = 0;
@@ -686,18 +747,7 @@ static void* ws_poll_loop(void* arg)
             continue;
         }
 
-        fd_set readfds;
-        FD_ZERO(&readfds);
-        chttpx_socket_t maxfd = 0;
-        for (size_t i = 0; i < n; i++)
-        {
-            FD_SET(fds[i], &readfds);
-            if (fds[i] > maxfd)
-                maxfd = fds[i];
-        }
-
-        struct timeval tv = {.tv_sec = 0, .tv_usec = 50000};
-        int ready = select((int)(maxfd + 1), &readfds, NULL, NULL, &tv);
+        int ready = ws_poll(fds, n, 50);
 
         if (ready <= 0)
         {
@@ -706,24 +756,24 @@ static void* ws_poll_loop(void* arg)
         }
 
         ws_lock();
-        for (size_t i = 0; i < ws_engine.count;)
+        for (size_t i = 0; i < n; i++)
         {
-            ws_connection_t* conn = &ws_engine.items[i];
-            if (!conn->public_ws.connected)
-            {
-                ws_remove_connection(i);
+            /* Errors and hang-ups are seen by the read */
+            if (!fds[i].revents)
                 continue;
-            }
-            if (FD_ISSET(conn->public_ws.socket, &readfds))
-            {
-                ws_unlock();
-                ws_poll_process_readable(conn);
-                ws_lock();
-                if (i >= ws_engine.count)
-                    break;
-                conn = &ws_engine.items[i];
-            }
-            if (!conn->public_ws.connected)
+
+            ws_connection_t* conn = ws_poll_find(fds[i].fd, i);
+            if (!conn || !conn->public_ws.connected)
+                continue;
+
+            ws_unlock();
+            ws_poll_process_readable(conn);
+            ws_lock();
+        }
+
+        for (size_t i = 0; i < ws_engine.count;)
+        {
+            if (!ws_engine.items[i].public_ws.connected)
             {
                 ws_remove_connection(i);
                 continue;
@@ -0,0 +1,284 @@
+#define _GNU_SOURCE
+
+/*
+ * Copyright (c) 2026 netcorelink
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "workers.h"
+
+#include "serv.h"
+#include "utils.h"
+#include "response.h"
+#include "admission.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Accepted connection waiting for a worker */
+typedef struct
+{
+    chttpx_socket_t fd;
+    /* Already read request bytes, NULL if the worker reads the request */
+    char* buf;
+    size_t len;
+    /* Enqueue time, for wait time accounting */
+    struct timespec queued_at;
+} work_item_t;
+
+/* Bounded MPMC ring of connections served by a fixed set of threads */
+typedef struct
+{
+    chttpx_mutex_t lock;
+    chttpx_cond_t not_empty;
+    chttpx_cond_t not_full;
+
+    work_item_t* items;
+    size_t capacity;
+    size_t head;
+    size_t count;
+
+    thread_t* threads;
+    size_t threads_count;
+    int running;
+
+    chttpx_workers_stats_t stats;
+} workers_t;
+
+static workers_t pool;
+
+static uint64_t elapsed_us(const struct timespec* from, const struct timespec* to)
+{
+    int64_t us = (int64_t)(to->tv_sec - from->tv_sec) * 1000000 + (to->tv_nsec - from->tv_nsec) / 1000;
+    return us > 0 ? (uint64_t)us : 0;
+}
+
+static void* worker_thread(void* arg)
+{
+    (void)arg;
+
+    for (;;)
+    {
+        _mutex_lock(&pool.lock);
+
+        while (pool.running && pool.count == 0)
+            _cond_wait(&pool.not_empty, &pool.lock);
+
+        if (!pool.running)
+        {
+            _mutex_unlock(&pool.lock);
+            break;
+        }
+
+        work_item_t item = pool.items[pool.head];
+        pool.head = (pool.head + 1) % pool.capacity;
+        pool.count--;
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint64_t waited = elapsed_us(&item.queued_at, &now);
+
+        pool.stats.wait_total_us += waited;
+        if (waited > pool.stats.wait_max_us)
+            pool.stats.wait_max_us = waited;
+        pool.stats.busy++;
+
+        _cond_signal(&pool.not_full);
+        _mutex_unlock(&pool.lock);
+
+        if (item.buf)
+        {
+            chttpx_handle_buffered(item.fd, item.buf, item.len);
+            free(item.buf);
+        }
+        else
+        {
+            chttpx_handle_client(item.fd);
+        }
+
+        _admission_release();
+
+        _mutex_lock(&pool.lock);
+        pool.stats.busy--;
+        pool.stats.completed++;
+        _mutex_unlock(&pool.lock);
+    }
+
+    return NULL;
+}
+
+int _workers_start(size_t threads, size_t capacity)
+{
+    if (threads == 0 || pool.running)
+        return -1;
+
+    if (capacity == 0)
+        capacity = threads * WORKERS_QUEUE_PER_THREAD;
+
+    memset(&pool, 0, sizeof(pool));
+
+    pool.items = calloc(capacity, sizeof(work_item_t));
+    pool.threads = calloc(threads, sizeof(thread_t));
+    if (!pool.items || !pool.threads)
+    {
+        perror("calloc workers");
+        free(pool.items);
+        free(pool.threads);
+        memset(&pool, 0, sizeof(pool));
+        return -1;
+    }
+
+    _mutex_init(&pool.lock);
+    _cond_init(&pool.not_empty);
+    _cond_init(&pool.not_full);
+
+    pool.capacity = capacity;
+    pool.running = 1;
+
+    for (size_t i = 0; i < threads; i++)
+    {
+        if (_thread_create(&pool.threads[i], worker_thread, NULL) != 0)
+        {
+            perror("worker thread");
+            break;
+        }
+        pool.threads_count++;
+    }
+
+    if (pool.threads_count == 0)
+    {
+        _workers_stop();
+        return -1;
+    }
+
+    return 0;
+}
+
+static int submit(chttpx_socket_t fd, char* buf, size_t len, int wait)
+{
+    _mutex_lock(&pool.lock);
+
+    if (pool.running && pool.count == pool.capacity)
+    {
+        if (!wait)
+        {
+            pool.stats.rejected++;
+            _mutex_unlock(&pool.lock);
+            return -1;
+        }
+
+        pool.stats.full_waits++;
+        while (pool.running && pool.count == pool.capacity)
+            _cond_wait(&pool.not_full, &pool.lock);
+    }
+
+    if (!pool.running)
+    {
+        _mutex_unlock(&pool.lock);
+        return -1;
+    }
+
+    work_item_t* item = &pool.items[(pool.head + pool.count) % pool.capacity];
+    item->fd = fd;
+    item->buf = buf;
+    item->len = len;
+    clock_gettime(CLOCK_MONOTONIC, &item->queued_at);
+
+    pool.count++;
+    pool.stats.submitted++;
+    if (pool.count > pool.stats.queue_peak)
+        pool.stats.queue_peak = pool.count;
+
+    _cond_signal(&pool.not_empty);
+    _mutex_unlock(&pool.lock);
+
+    return 0;
+}
+
+int _workers_submit(chttpx_socket_t fd, char* buf, size_t len)
+{
+    if (!pool.items)
+        return -1;
+
+    return submit(fd, buf, len, 1);
+}
+
+int _workers_try_submit(chttpx_socket_t fd, char* buf, size_t len)
+{
+    if (!pool.items)
+        return -1;
+
+    return submit(fd, buf, len, 0);
+}
+
+void _workers_stop(void)
+{
+    if (!pool.items)
+        return;
+
+    _mutex_lock(&pool.lock);
+    pool.running = 0;
+    _cond_broadcast(&pool.not_empty);
+    _cond_broadcast(&pool.not_full);
+    _mutex_unlock(&pool.lock);
+
+    for (size_t i = 0; i < pool.threads_count; i++)
+        _thread_join(pool.threads[i]);
+
+    /* Connections nobody picked up */
+    while (pool.count > 0)
+    {
+        work_item_t* item = &pool.items[pool.head];
+        chttpx_close(item->fd);
+        free(item->buf);
+
+        _admission_release();
+
+        pool.head = (pool.head + 1) % pool.capacity;
+        pool.count--;
+    }
+
+    _cond_destroy(&pool.not_full);
+    _cond_destroy(&pool.not_empty);
+    _mutex_destroy(&pool.lock);
+
+    free(pool.threads);
+    free(pool.items);
+    memset(&pool, 0, sizeof(pool));
+}
+
+void cHTTPX_WorkersStats(chttpx_workers_stats_t* stats)
+{
+    if (!stats)
+        return;
+
+    memset(stats, 0, sizeof(*stats));
+    if (!pool.items)
+        return;
+
+    _mutex_lock(&pool.lock);
+    *stats = pool.stats;
+    stats->threads = pool.threads_count;
+    stats->queue_capacity = pool.capacity;
+    stats->queue_depth = pool.count;
+    _mutex_unlock(&pool.lock);
+}
@@ -47,6 +47,21 @@ extern int g_tests_failed;
         }                                                                   \
     } while (0)
 
+#define ASSERT_VIEWEQ(expected, actual, actual_len)                                   \
+    do                                                                                \
+    {                                                                                 \
+        const char* _exp = (expected);                                                \
+        const char* _act = (actual);                                                  \
+        size_t _len = (actual_len);                                                   \
+        if (!_act || strlen(_exp) != _len || memcmp(_exp, _act, _len) != 0)           \
+        {                                                                             \
+            printf("FAIL\n  expected '%s', got '%.*s' (%s:%d)\n", _exp, (int)_len, \
+                   _act ? _act : "", __FILE__, __LINE__);                             \
+            g_tests_failed++;                                                         \
+            return;                                                                   \
+        }                                                                             \
+    } while (0)
+
 #define ASSERT_EQ(expected, actual)                                           \
     do                                                                        \
     {                                                                         \
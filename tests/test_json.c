@@ -0,0 +1,573 @@
+#include "test_framework.h"
+
+#include "libchttpx.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Parse a POST carrying body as its JSON payload */
+static chttpx_request_t* json_request(char* buf, size_t cap, const char* body, chttpx_arena_t* arena)
+{
+    size_t len = (size_t)snprintf(buf, cap, "POST /items HTTP/1.1\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n\r\n%s",
+                                  strlen(body), body);
+    return _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, len, arena);
+}
+
+TEST(test_json_parse_fields)
+{
+    chttpx_arena_t arena = {0};
+    static char buf[4096];
+    const char* body = "{\"name\": \"caf\\u00e9 \\\"x\\\"\\n\\ud83d\\ude00\", \"skip\": {\"a\": [1, {\"b\": null}], \"c\": \"}\"},"
+                       " \"AGE\": 42.9, \"big\": 1e20, \"admin\": true, \"nothing\": null,"
+                       " \"tags\": [\"a\", 7, \"b\"], \"scores\": [1, -2, \"x\", 3.5], \"name\": \"second\"}";
+
+    chttpx_request_t* req = json_request(buf, sizeof(buf), body, &arena);
+    ASSERT(req != NULL);
+
+    char* name = NULL;
+    char* nothing = NULL;
+    int age = 0, big = 0, missing = 5;
+    uint8_t admin = 0;
+    chttpx_string_array_t tags = {0};
+    chttpx_number_array_t scores = {0};
+
+    chttpx_validation_t fields[] = {
+        chttpx_validation_string("name", &name, true, 0, 0, VALIDATOR_NONE),
+        chttpx_validation_integer("age", &age, true),
+        chttpx_validation_integer("big", &big, false),
+        chttpx_validation_boolean("admin", &admin, false),
+        chttpx_validation_string("nothing", &nothing, false, 0, 0, VALIDATOR_NONE),
+        chttpx_validation_integer("missing", &missing, false),
+        {"tags", &tags, false, 0, 0, FIELD_STRING_ARRAY, VALIDATOR_NONE, 0},
+        {"scores", &scores, false, 0, 0, FIELD_NUMBER_ARRAY, VALIDATOR_NONE, 0},
+    };
+
+    ASSERT_EQ(1, cHTTPX_Parse(req, fields, 8));
+
+    /* Unescaped once; the first of two "name" keys wins */
+    ASSERT_STREQ("caf\xc3\xa9 \"x\"\n\xf0\x9f\x98\x80", name);
+    ASSERT_EQ(42, age);
+    ASSERT_EQ(INT_MAX, big);
+    ASSERT_EQ(1, admin);
+    ASSERT(nothing == NULL && !fields[4].present);
+    ASSERT(missing == 5 && !fields[5].present);
+
+    /* Elements of another type are NULL / 0 */
+    ASSERT_EQ(3, (long long)tags.count);
+    ASSERT_STREQ("a", tags.items[0]);
+    ASSERT(tags.items[1] == NULL);
+    ASSERT_STREQ("b", tags.items[2]);
+    ASSERT_EQ(4, (long long)scores.count);
+    ASSERT_EQ(1, scores.items[0]);
+    ASSERT_EQ(-2, scores.items[1]);
+    ASSERT_EQ(0, scores.items[2]);
+    ASSERT_EQ(3, scores.items[3]);
+
+    free(name);
+    for (size_t i = 0; i < tags.count; i++)
+        free(tags.items[i]);
+    free(tags.items);
+    free(scores.items);
+
+    /* Another document holds none of the fields */
+    _free_req(req);
+    _arena_reset(&arena);
+    req = json_request(buf, sizeof(buf), " [1, 2] ", &arena);
+    ASSERT_EQ(1, cHTTPX_Parse(req, fields, 8));
+    ASSERT(!fields[0].present);
+
+    _free_req(req);
+    _arena_free(&arena);
+}
+
+TEST(test_json_parse_invalid)
+{
+    chttpx_arena_t arena = {0};
+    static char buf[4096];
+    static char deep[1024];
+    const char* bodies[] = {
+        "{\"name\": \"netcorelink\", \"tags\": [\"a\",]}",
+        "{\"name\": \"netcorelink\" \"age\": 1}",
+        "{\"name\": \"netcorelink\", \"age\": 01}",
+        "{\"name\": \"netcorelink\", \"bio\": \"\\x\"}",
+        "{\"name\": \"netcorelink\", \"tags\": [\"\\udc00\"]}",
+        "{\"name\": \"netcorelink\", \"age\": tru}",
+        "{\"name\": \"netcorelink\"} x",
+        "{\"name\": \"netcorelink",
+        "",
+        deep,
+    };
+
+    memset(deep, '[', 300);
+    memcpy(deep, "{\"name\": \"x\", \"a\": ", 19);
+
+    for (size_t i = 0; i < sizeof(bodies) / sizeof(bodies[0]); i++)
+    {
+        char* name = NULL;
+        chttpx_string_array_t tags = {0};
+        chttpx_validation_t fields[] = {
+            chttpx_validation_string("name", &name, true, 0, 0, VALIDATOR_NONE),
+            {"tags", &tags, false, 0, 0, FIELD_STRING_ARRAY, VALIDATOR_NONE, 0},
+        };
+
+        chttpx_request_t* req = json_request(buf, sizeof(buf), bodies[i], &arena);
+        ASSERT(req != NULL);
+
+        ASSERT_EQ(0, cHTTPX_Parse(req, fields, 2));
+        ASSERT_STREQ("Invalid JSON", req->error_msg);
+
+        /* What was stored before the error is freed again */
+        ASSERT(name == NULL && !fields[0].present);
+        ASSERT(tags.items == NULL);
+
+        _free_req(req);
+        _arena_reset(&arena);
+    }
+
+    _arena_free(&arena);
+}
+
+TEST(test_json_parse_validate)
+{
+    chttpx_arena_t arena = {0};
+    static char buf[4096];
+
+    struct
+    {
+        const char* body;
+        const char* lang;
+        const char* error;
+    } cases[] = {
+        {"{\"email\": \"user@example.com\", \"password\": \"12345\"}", "en", "field 'password' min length is 6"},
+        {"{\"email\": \"user@\", \"password\": \"123456\"}", "en", "field 'email' is not a valid email"},
+        {"{\"password\": \"123456\"}", "en", "field 'email' is required"},
+        {"{\"email\": \"user@example.com\", \"password\": 123456}", "en", "field 'password' validation error"},
+        {"{\"email\": \"user@example.com\", \"age\": \"18\"}", "en", "field 'age' validation error"},
+        {"{\"password\": \"123456\"}", "ru", "поле 'email' обязательно"},
+        {"{\"password\": \"123456\"}", "es", "field 'email' is required"},
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        char* email = NULL;
+        char* password = NULL;
+        int age = 0;
+        chttpx_validation_t fields[] = {
+            chttpx_validation_string("email", &email, true, 0, 64, VALIDATOR_EMAIL),
+            chttpx_validation_string("password", &password, false, 6, 16, VALIDATOR_NONE),
+            chttpx_validation_integer("age", &age, false),
+        };
+
+        chttpx_request_t* req = json_request(buf, sizeof(buf), cases[i].body, &arena);
+        ASSERT_EQ(0, cHTTPX_ParseValidate(req, fields, 3, cases[i].lang));
+        ASSERT_STREQ(cases[i].error, req->error_msg);
+
+        _free_req(req);
+        _arena_reset(&arena);
+    }
+
+    /* Values live in the arena, nothing to free */
+    char* email = NULL;
+    chttpx_string_array_t tags = {0};
+    chttpx_validation_t fields[] = {
+        chttpx_validation_string("email", &email, true, 0, 64, VALIDATOR_EMAIL),
+        {"tags", &tags, true, 0, 0, FIELD_STRING_ARRAY, VALIDATOR_NONE, 0},
+    };
+
+    chttpx_request_t* req = json_request(buf, sizeof(buf), "{\"tags\": [\"a\", \"b\"], \"email\": \"user@example.com\"}", &arena);
+    ASSERT_EQ(1, cHTTPX_ParseValidate(req, fields, 2, NULL));
+    ASSERT_STREQ("user@example.com", email);
+    ASSERT_EQ(2, (long long)tags.count);
+    ASSERT_STREQ("b", tags.items[1]);
+
+    /* An element of another type fails the field */
+    _free_req(req);
+    _arena_reset(&arena);
+    req = json_request(buf, sizeof(buf), "{\"tags\": [\"a\", 1], \"email\": \"user@example.com\"}", &arena);
+    ASSERT_EQ(0, cHTTPX_ParseValidate(req, fields, 2, NULL));
+    ASSERT_STREQ("field 'tags' validation error", req->error_msg);
+
+    _free_req(req);
+    _arena_free(&arena);
+}
+
+TEST(test_json_schema_hash)
+{
+    chttpx_arena_t arena = {0};
+    static char body[4096];
+    static char buf[8192];
+    static char names[CHTTPX_JSON_FIELDS_MAX + 1][8];
+    static int values[CHTTPX_JSON_FIELDS_MAX + 1];
+    static chttpx_validation_t fields[CHTTPX_JSON_FIELDS_MAX + 1];
+
+    /* Every name of a full schema gets a slot of its own */
+    size_t len = 0;
+    body[len++] = '{';
+    for (size_t i = 0; i <= CHTTPX_JSON_FIELDS_MAX; i++)
+    {
+        snprintf(names[i], sizeof(names[i]), "f%zu", i);
+        fields[i] = chttpx_validation_integer(names[i], &values[i], true);
+        len += (size_t)snprintf(body + len, sizeof(body) - len, "%s\"F%zu\": %zu", i ? ", " : "", i, i * 7);
+    }
+    body[len++] = '}';
+
+    /* Twice: the second one starts from the table found by the first */
+    for (int round = 0; round < 2; round++)
+    {
+        chttpx_request_t* req = json_request(buf, sizeof(buf), body, &arena);
+        memset(values, 0, sizeof(values));
+
+        ASSERT_EQ(1, cHTTPX_ParseValidate(req, fields, CHTTPX_JSON_FIELDS_MAX, "en"));
+        for (size_t i = 0; i < CHTTPX_JSON_FIELDS_MAX; i++)
+            ASSERT_EQ((long long)(i * 7), values[i]);
+
+        _free_req(req);
+        _arena_reset(&arena);
+    }
+
+    /* A repeated name takes nothing from the first */
+    chttpx_validation_t twice[] = {fields[3], fields[3]};
+    twice[1].target = &values[CHTTPX_JSON_FIELDS_MAX];
+    values[CHTTPX_JSON_FIELDS_MAX] = -1;
+
+    chttpx_request_t* req = json_request(buf, sizeof(buf), "{\"f3\": 11}", &arena);
+    ASSERT_EQ(1, cHTTPX_Parse(req, twice, 2));
+    ASSERT_EQ(11, values[3]);
+    ASSERT_EQ(-1, values[CHTTPX_JSON_FIELDS_MAX]);
+
+    ASSERT_EQ(0, cHTTPX_Parse(req, fields, CHTTPX_JSON_FIELDS_MAX + 1));
+    ASSERT_STREQ("too many fields", req->error_msg);
+
+    _free_req(req);
+    _arena_free(&arena);
+}
+
+/* Marks of _json_index by a byte at a time, 0 with *bad set for what it refuses */
+static size_t index_reference(const unsigned char* buf, size_t len, uint32_t* out, int* bad)
+{
+    size_t n = 0;
+    int in = 0;
+
+    *bad = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned char c = buf[i];
+
+        if (c == '\\')
+        {
+            int hex = 0;
+            while (i + 2 + hex < len && hex < 4 && isxdigit(buf[i + 2 + hex]))
+                hex++;
+
+            if (i + 1 >= len || !strchr("\"\\/bfnrtu", buf[i + 1]) || (buf[i + 1] == 'u' && hex < 4))
+            {
+                *bad = 1;
+                return 0;
+            }
+
+            /* An escaped bracket outside a string is still a mark, the decoder refuses it */
+            i++;
+            if (!in && strchr("{}[]:,", buf[i]))
+                out[n++] = (uint32_t)i;
+            continue;
+        }
+
+        if (c == '"')
+            in = !in;
+
+        if (c == '"' || (!in && strchr("{}[]:,", c)))
+            out[n++] = (uint32_t)i;
+    }
+
+    *bad = in;
+    return in ? 0 : n;
+}
+
+TEST(test_json_index_impls_agree)
+{
+    static const char* impls[] = {"scalar", "sse2", "avx2"};
+    static const char alphabet[] = "\"\\{}[]:, xu0";
+    static unsigned char buf[512];
+    static uint32_t want[512], got[512];
+    uint64_t seed = 42;
+
+    for (int round = 0; round < 20000; round++)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        size_t len = (size_t)(seed >> 33) % sizeof(buf);
+        for (size_t i = 0; i < len; i++)
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            buf[i] = (unsigned char)alphabet[(seed >> 33) % (sizeof(alphabet) - 1)];
+        }
+
+        int bad;
+        size_t n = index_reference(buf, len, want, &bad);
+
+        for (size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); k++)
+        {
+            if (_json_index_select(impls[k]) != 0)
+                continue;
+
+            size_t m = _json_index(buf, len, got);
+            if (bad)
+            {
+                ASSERT(m == (size_t)-1);
+                continue;
+            }
+
+            ASSERT_EQ((long long)n, (long long)m);
+            ASSERT(memcmp(want, got, n * sizeof(uint32_t)) == 0);
+        }
+    }
+
+    ASSERT_EQ(-1, _json_index_select("neon"));
+    ASSERT_EQ(0, _json_index_select("none"));
+    ASSERT_STREQ("none", _json_index_impl());
+    ASSERT_EQ(0, _json_index_select(NULL));
+}
+
+/* cHTTPX_Parse of a body with and without the index */
+static void json_parse_both(unsigned char* body, size_t len, int* rc, char** name, chttpx_number_array_t* ids)
+{
+    for (int indexed = 0; indexed < 2; indexed++)
+    {
+        chttpx_arena_t arena = {0};
+        chttpx_request_t req = {.arena = &arena, .body = body, .body_size = len};
+        chttpx_validation_t fields[] = {
+            chttpx_validation_string("name", &name[indexed], false, 0, 0, VALIDATOR_NONE),
+            {"ids", &ids[indexed], false, 0, 0, FIELD_NUMBER_ARRAY, VALIDATOR_NONE, 0},
+        };
+
+        name[indexed] = NULL;
+        ids[indexed] = (chttpx_number_array_t){0};
+
+        _json_index_select(indexed ? NULL : "none");
+        rc[indexed] = cHTTPX_Parse(&req, fields, 2);
+        _arena_free(&arena);
+    }
+
+    _json_index_select(NULL);
+}
+
+TEST(test_json_parse_indexed)
+{
+    static unsigned char body[CHTTPX_JSON_INDEX_MIN * 4];
+    size_t len = 0;
+
+    /* Records the schema skips, then its fields */
+    len += (size_t)snprintf((char*)body, sizeof(body), "{\"records\": [");
+    for (int i = 0; len < CHTTPX_JSON_INDEX_MIN * 2; i++)
+        len += (size_t)snprintf((char*)body + len, sizeof(body) - len,
+                                "%s{\"id\": %d, \"note\": \"a \\\"}\\\" \\\\\", \"tags\": [true, null, -1.5e3, {}, []], \"x\": {\"y\": \"\\u00e9\"}}",
+                                i ? ",\n " : "", i);
+    len += (size_t)snprintf((char*)body + len, sizeof(body) - len, "], \"name\": \"caf\\u00e9\", \"ids\": [3, 2, 1]}");
+
+    int rc[2];
+    char* name[2];
+    chttpx_number_array_t ids[2];
+
+    json_parse_both(body, len, rc, name, ids);
+    for (int i = 0; i < 2; i++)
+    {
+        ASSERT_EQ(1, rc[i]);
+        ASSERT_STREQ("caf\xc3\xa9", name[i]);
+        ASSERT_EQ(3, (long long)ids[i].count);
+        ASSERT_EQ(1, ids[i].items[2]);
+        free(name[i]);
+        free(ids[i].items);
+    }
+
+    /* Broken inside the skipped records: both refuse it */
+    const char* breaks[] = {"\"id\": 1}", "\"id\": 1,}", "\"id\" 1}", "\"id\": 1]", "\"id\": \"\\q\"}", "\"id\": 01}", "\"id\": tru}"};
+    char* at = strstr((char*)body, "\"id\": 5,");
+
+    for (size_t i = 0; i < sizeof(breaks) / sizeof(breaks[0]); i++)
+    {
+        char saved[16];
+        size_t n = strlen(breaks[i]);
+        memcpy(saved, at, n);
+        memcpy(at, breaks[i], n);
+
+        json_parse_both(body, len, rc, name, ids);
+        ASSERT_EQ(0, rc[0]);
+        ASSERT_EQ(0, rc[1]);
+        ASSERT(name[1] == NULL && ids[1].items == NULL);
+
+        memcpy(at, saved, n);
+    }
+
+    /* Ends inside a string */
+    json_parse_both(body, (size_t)(strstr((char*)body, "\"caf") + 3 - (char*)body), rc, name, ids);
+    ASSERT_EQ(0, rc[0]);
+    ASSERT_EQ(0, rc[1]);
+}
+
+TEST(test_json_writer_values)
+{
+    chttpx_json_t json;
+    cHTTPX_JsonInit(&json, NULL);
+
+    cHTTPX_JsonObject(&json);
+    cHTTPX_JsonKey(&json, "name");
+    cHTTPX_JsonString(&json, "caf\xc3\xa9 \"q\" \\ \n\t\x01");
+    cHTTPX_JsonKey(&json, "nul");
+    cHTTPX_JsonStringLen(&json, "a\0b", 3);
+    cHTTPX_JsonKey(&json, "n");
+    cHTTPX_JsonArray(&json);
+    cHTTPX_JsonInt(&json, 0);
+    cHTTPX_JsonInt(&json, LLONG_MIN);
+    cHTTPX_JsonDouble(&json, 3.0);
+    cHTTPX_JsonDouble(&json, 0.1);
+    cHTTPX_JsonDouble(&json, 1e300);
+    cHTTPX_JsonDouble(&json, NAN);
+    cHTTPX_JsonArrayEnd(&json);
+    cHTTPX_JsonKey(&json, "empty");
+    cHTTPX_JsonObject(&json);
+    cHTTPX_JsonObjectEnd(&json);
+    cHTTPX_JsonKey(&json, "flags");
+    cHTTPX_JsonArray(&json);
+    cHTTPX_JsonBool(&json, true);
+    cHTTPX_JsonBool(&json, false);
+    cHTTPX_JsonNull(&json);
+    cHTTPX_JsonString(&json, NULL);
+    cHTTPX_JsonRaw(&json, "{\"cached\":1}", 12);
+    cHTTPX_JsonArrayEnd(&json);
+    cHTTPX_JsonObjectEnd(&json);
+
+    ASSERT(!json.failed);
+    chttpx_response_t res = cHTTPX_ResJsonWriter(cHTTPX_StatusCreated, &json);
+    ASSERT_EQ(cHTTPX_StatusCreated, res.status);
+    ASSERT_STREQ("application/json", res.content_type);
+    ASSERT_VIEWEQ("{\"name\":\"caf\xc3\xa9 \\\"q\\\" \\\\ \\n\\t\\u0001\",\"nul\":\"a\\u0000b\","
+                  "\"n\":[0,-9223372036854775808,3,0.1,1e+300,null],\"empty\":{},"
+                  "\"flags\":[true,false,null,null,{\"cached\":1}]}",
+                  (const char*)res.body, res.body_size);
+
+    /* Outside a handler the body is the caller's */
+    ASSERT(json.buf == NULL);
+    free((void*)res.body);
+
+    /* Numbers read back as they were */
+    uint64_t seed = 7;
+    for (int i = 0; i < 20000; i++)
+    {
+        double value = i * 0.01 - 50;
+        if (i % 2)
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            memcpy(&value, &seed, sizeof(value));
+        }
+
+        cHTTPX_JsonInit(&json, NULL);
+        cHTTPX_JsonDouble(&json, value);
+        ASSERT(json.len < json.cap);
+        json.buf[json.len] = '\0';
+
+        if (isfinite(value))
+            ASSERT(strtod(json.buf, NULL) == value);
+        else
+            ASSERT_STREQ("null", json.buf);
+
+        cHTTPX_JsonFree(&json);
+    }
+}
+
+TEST(test_json_writer_misuse)
+{
+    chttpx_json_t json;
+
+    /* A member without a key */
+    cHTTPX_JsonInit(&json, NULL);
+    cHTTPX_JsonObject(&json);
+    cHTTPX_JsonInt(&json, 1);
+    ASSERT(json.failed);
+
+    chttpx_response_t res = cHTTPX_ResJsonWriter(cHTTPX_StatusOK, &json);
+    ASSERT_EQ(cHTTPX_StatusInternalServerError, res.status);
+    free((void*)res.body);
+
+    /* A key in an array, a closer that does not match, two top-level values */
+    cHTTPX_JsonInit(&json, NULL);
+    cHTTPX_JsonArray(&json);
+    cHTTPX_JsonKey(&json, "k");
+    ASSERT(json.failed);
+    cHTTPX_JsonFree(&json);
+
+    cHTTPX_JsonInit(&json, NULL);
+    cHTTPX_JsonArray(&json);
+    cHTTPX_JsonObjectEnd(&json);
+    ASSERT(json.failed);
+    cHTTPX_JsonFree(&json);
+
+    cHTTPX_JsonInit(&json, NULL);
+    cHTTPX_JsonInt(&json, 1);
+    cHTTPX_JsonInt(&json, 2);
+    ASSERT(json.failed);
+    cHTTPX_JsonFree(&json);
+
+    /* Unfinished */
+    cHTTPX_JsonInit(&json, NULL);
+    cHTTPX_JsonObject(&json);
+    cHTTPX_JsonKey(&json, "k");
+    ASSERT(!json.failed);
+
+    res = cHTTPX_ResJsonWriter(cHTTPX_StatusOK, &json);
+    ASSERT_EQ(cHTTPX_StatusInternalServerError, res.status);
+    free((void*)res.body);
+}
+
+TEST(test_json_writer_round_trip)
+{
+    chttpx_arena_t arena = {0};
+    chttpx_request_t req = {.arena = &arena};
+    chttpx_json_t json;
+
+    /* Far past one buffer, in the REQuest arena */
+    cHTTPX_JsonInit(&json, &req);
+    cHTTPX_JsonObject(&json);
+    cHTTPX_JsonKey(&json, "tags");
+    cHTTPX_JsonArray(&json);
+    for (int i = 0; i < 5000; i++)
+    {
+        char tag[32];
+        snprintf(tag, sizeof(tag), "tag \"%d\"\n", i);
+        cHTTPX_JsonString(&json, tag);
+    }
+    cHTTPX_JsonArrayEnd(&json);
+    cHTTPX_JsonObjectEnd(&json);
+
+    chttpx_response_t res = cHTTPX_ResJsonWriter(cHTTPX_StatusOK, &json);
+    ASSERT_EQ(cHTTPX_StatusOK, res.status);
+    ASSERT(res.body_size > 4 * BUFFER_SIZE);
+
+    /* The decoder reads back what was written */
+    chttpx_string_array_t tags = {0};
+    chttpx_validation_t fields[] = {{"tags", &tags, true, 0, 0, FIELD_STRING_ARRAY, VALIDATOR_NONE, 0}};
+
+    req.body = (unsigned char*)res.body;
+    req.body_size = res.body_size;
+    ASSERT_EQ(1, cHTTPX_ParseValidate(&req, fields, 1, NULL));
+    ASSERT_EQ(5000, (long long)tags.count);
+    ASSERT_STREQ("tag \"4999\"\n", tags.items[4999]);
+
+    _arena_free(&arena);
+}
+
+void run_json_tests(void)
+{
+    printf("json\n");
+    RUN_TEST(test_json_index_impls_agree);
+    RUN_TEST(test_json_parse_fields);
+    RUN_TEST(test_json_parse_indexed);
+    RUN_TEST(test_json_parse_invalid);
+    RUN_TEST(test_json_parse_validate);
+    RUN_TEST(test_json_schema_hash);
+    RUN_TEST(test_json_writer_values);
+    RUN_TEST(test_json_writer_misuse);
+    RUN_TEST(test_json_writer_round_trip);
+}
@@ -0,0 +1,273 @@
+#include "test_framework.h"
+
+#include "libchttpx.h"
+#include "body.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define BOUNDARY "XyZzy-42"
+
+/* A file part whose bytes hold pieces of the delimiter, also across the parser's window */
+static size_t file_bytes(unsigned char* out, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        out[i] = (unsigned char)(i * 7 + 3);
+
+    const size_t at[] = {100, 65530, 65536 - 6, 99990, size - 12};
+    for (size_t i = 0; i < sizeof(at) / sizeof(at[0]); i++)
+    {
+        if (at[i] + 11 <= size)
+            memcpy(out + at[i], "\r\n--XyZzy-4", 11);
+    }
+
+    return size;
+}
+
+/* multipart/form-data body: preamble, a field, an empty field, a file and an epilogue */
+static size_t form_body(char* out, size_t cap, const unsigned char* file, size_t file_len)
+{
+    size_t len = (size_t)snprintf(out, cap,
+                                  "preamble\r\n"
+                                  "--" BOUNDARY "\r\n"
+                                  "Content-Disposition: form-data; name=\"title\"\r\n\r\n"
+                                  "hello\r\nworld\r\n"
+                                  "--" BOUNDARY "  \r\n"
+                                  "content-disposition: form-data; name=\"empty\"\r\n\r\n"
+                                  "\r\n"
+                                  "--" BOUNDARY "\r\n"
+                                  "Content-Disposition: form-data; name=\"avatar\"; filename=\"me \\\"1\\\".png\"\r\n"
+                                  "Content-Type: image/png\r\n\r\n");
+    memcpy(out + len, file, file_len);
+    len += file_len;
+    len += (size_t)snprintf(out + len, cap - len, "\r\n--" BOUNDARY "--\r\nepilogue");
+    return len;
+}
+
+/* Parse a REQuest whose body is sent over a socketpair after the first bytes */
+static chttpx_request_t* parse_over_socket(const char* body, size_t body_len, char* buf, size_t cap, chttpx_arena_t* arena, int* peer)
+{
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+        return NULL;
+
+    size_t len = (size_t)snprintf(buf, cap,
+                                  "POST /avatar HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=\"" BOUNDARY "\"\r\n"
+                                  "Content-Length: %zu\r\n\r\n",
+                                  body_len);
+
+    /* Part of the body comes with the head, the rest from the socket */
+    size_t first = body_len < 300 ? body_len : 300;
+    memcpy(buf + len, body, first);
+    len += first;
+
+    if (write(sv[0], body + first, body_len - first) != (ssize_t)(body_len - first))
+        return NULL;
+
+    *peer = sv[0];
+    return _parse_req_buffer(sv[1], buf, len, arena);
+}
+
+static int read_file(const char* path, unsigned char* out, size_t cap)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return -1;
+
+    size_t n = fread(out, 1, cap, f);
+    fclose(f);
+    return (int)n;
+}
+
+TEST(test_multipart_fields_and_files)
+{
+    chttpx_arena_t arena = {0};
+    static unsigned char file[150000];
+    static unsigned char back[160000];
+    static char body[160000];
+    static char buf[BUFFER_SIZE];
+
+    size_t body_len = form_body(body, sizeof(body), file, file_bytes(file, sizeof(file)));
+
+    int peer = -1;
+    chttpx_request_t* req = parse_over_socket(body, body_len, buf, sizeof(buf), &arena, &peer);
+    ASSERT(req != NULL);
+    ASSERT(_body_complete(req));
+
+    ASSERT_EQ(3, (long long)req->parts_count);
+    ASSERT_STREQ("hello\r\nworld", cHTTPX_FormValue(req, "title"));
+    ASSERT_STREQ("", cHTTPX_FormValue(req, "empty"));
+    ASSERT(cHTTPX_FormValue(req, "avatar") == NULL);
+    ASSERT(cHTTPX_FormValue(req, "missing") == NULL);
+
+    /* The file part alone, in a temp file of its own */
+    const chttpx_part_t* avatar = cHTTPX_FormPart(req, "avatar");
+    ASSERT(avatar != NULL);
+    ASSERT_STREQ("me \"1\".png", avatar->filename);
+    ASSERT_STREQ("image/png", avatar->content_type);
+    ASSERT_EQ((long long)sizeof(file), (long long)avatar->size);
+    ASSERT(strstr(avatar->path, ".png") != NULL);
+    ASSERT_STREQ(avatar->path, req->filename);
+
+    ASSERT_EQ((long long)sizeof(file), read_file(avatar->path, back, sizeof(back)));
+    ASSERT(memcmp(back, file, sizeof(file)) == 0);
+
+    remove(avatar->path);
+    close(peer);
+    close(req->client_fd);
+    _free_req(req);
+    _arena_free(&arena);
+}
+
+TEST(test_multipart_broken_body)
+{
+    chttpx_arena_t arena = {0};
+    static unsigned char file[20000];
+    static char body[30000];
+    static char buf[BUFFER_SIZE];
+
+    /* Cut in the file: no parts, and the file written so far never got a name */
+    size_t body_len = form_body(body, sizeof(body), file, file_bytes(file, sizeof(file)));
+    int peer = -1;
+    chttpx_request_t* req = parse_over_socket(body, body_len - 100, buf, sizeof(buf), &arena, &peer);
+    ASSERT(req != NULL);
+
+    ASSERT_EQ(0, (long long)req->parts_count);
+    ASSERT(req->parts != NULL);
+    ASSERT_STREQ("", req->parts[2].path);
+    ASSERT_STREQ("", req->filename);
+
+    close(peer);
+    close(req->client_fd);
+    _free_req(req);
+    _arena_reset(&arena);
+
+    /* Cut after the file: the complete file is removed again */
+    size_t len = (size_t)snprintf(body, sizeof(body),
+                                  "--" BOUNDARY "\r\nContent-Disposition: form-data; name=\"doc\"; filename=\"a.txt\"\r\n\r\n"
+                                  "text\r\n--" BOUNDARY "\r\nContent-Disposition: form-data; name=\"more\"\r\n\r\nunfinished");
+    req = parse_over_socket(body, len, buf, sizeof(buf), &arena, &peer);
+    ASSERT(req != NULL);
+
+    ASSERT_EQ(0, (long long)req->parts_count);
+    ASSERT(req->parts[0].path[0] != '\0');
+    ASSERT(access(req->parts[0].path, F_OK) != 0);
+
+    close(peer);
+    close(req->client_fd);
+    _free_req(req);
+    _arena_reset(&arena);
+
+    /* A field too large for memory is saved like a file */
+    static char big[MULTIPART_FIELD_MAX + 1000];
+    memset(big, 'v', sizeof(big));
+    len = (size_t)snprintf(body, sizeof(body), "--" BOUNDARY "\r\nContent-Disposition: form-data; name=\"note\"\r\n\r\n");
+    static char large[sizeof(big) + 512];
+    memcpy(large, body, len);
+    memcpy(large + len, big, sizeof(big));
+    len += sizeof(big);
+    len += (size_t)snprintf(large + len, sizeof(large) - len, "\r\n--" BOUNDARY "--\r\n");
+
+    req = parse_over_socket(large, len, buf, sizeof(buf), &arena, &peer);
+    ASSERT(req != NULL);
+
+    const chttpx_part_t* note = cHTTPX_FormPart(req, "note");
+    ASSERT(note != NULL);
+    ASSERT(note->value == NULL);
+    ASSERT(cHTTPX_FormValue(req, "note") == NULL);
+    ASSERT_EQ((long long)sizeof(big), (long long)note->size);
+
+    static unsigned char back[sizeof(big) + 1];
+    ASSERT_EQ((long long)sizeof(big), read_file(note->path, back, sizeof(back)));
+    ASSERT(memcmp(back, big, sizeof(big)) == 0);
+
+    remove(note->path);
+    close(peer);
+    close(req->client_fd);
+    _free_req(req);
+    _arena_free(&arena);
+}
+
+typedef struct
+{
+    char names[64];
+    size_t calls;
+    size_t bytes;
+    int stop_after;
+} collect_t;
+
+static int collect_part(const chttpx_part_t* part, const char* data, size_t len, void* userdata)
+{
+    collect_t* c = userdata;
+    c->calls++;
+    c->bytes += len;
+
+    /* Every part once, at its end */
+    if (!data)
+    {
+        strncat(c->names, part->name, sizeof(c->names) - strlen(c->names) - 2);
+        strcat(c->names, ",");
+    }
+
+    return c->stop_after && (int)c->calls >= c->stop_after;
+}
+
+TEST(test_multipart_stream_callback)
+{
+    chttpx_arena_t arena = {0};
+    static unsigned char file[100000];
+    static char body[110000];
+    static char buf[BUFFER_SIZE + 110000];
+
+    size_t body_len = form_body(body, sizeof(body), file, file_bytes(file, sizeof(file)));
+    size_t len = (size_t)snprintf(buf, sizeof(buf),
+                                  "POST /avatar HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=" BOUNDARY "\r\n"
+                                  "Content-Length: %zu\r\n\r\n",
+                                  body_len);
+    memcpy(buf + len, body, body_len);
+
+    chttpx_request_t* req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, len + body_len, &arena);
+    ASSERT(req != NULL);
+    ASSERT_EQ(3, (long long)req->parts_count);
+    remove(cHTTPX_FormPart(req, "avatar")->path);
+
+    /* Read again, as a handler of a streaming route does */
+    _body_reader_init(req, body, body_len);
+
+    collect_t c = {0};
+    ASSERT_EQ(0, cHTTPX_Multipart(req, collect_part, &c));
+    ASSERT_STREQ("title,empty,avatar,", c.names);
+    ASSERT_EQ((long long)(strlen("hello\r\nworld") + sizeof(file)), (long long)c.bytes);
+    ASSERT(_body_complete(req));
+
+    /* The callback stops the body */
+    _body_reader_init(req, body, body_len);
+    collect_t stop = {.stop_after = 2};
+    ASSERT_EQ(-1, cHTTPX_Multipart(req, collect_part, &stop));
+    ASSERT_EQ(2, (long long)stop.calls);
+
+    /* No boundary, no parts */
+    ASSERT_EQ(0, cHTTPX_HeaderSet(req, "Content-Type", "multipart/form-data"));
+    req->content_type = cHTTPX_HeaderGet(req, "Content-Type");
+    _body_reader_init(req, body, body_len);
+    ASSERT_EQ(-1, cHTTPX_Multipart(req, collect_part, &c));
+
+    _free_req(req);
+    _arena_free(&arena);
+}
+#endif
+
+void run_multipart_tests(void)
+{
+    printf("multipart\n");
+#ifndef _WIN32
+    RUN_TEST(test_multipart_fields_and_files);
+    RUN_TEST(test_multipart_broken_body);
+    RUN_TEST(test_multipart_stream_callback);
+#endif
+}
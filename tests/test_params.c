@@ -18,8 +18,8 @@ TEST(test_match_single_param)
 
     ASSERT(cHTTPX_MatchPath("/users/{uuid}", "/users/abc-123", params, &count));
     ASSERT_EQ(1, count);
-    ASSERT_STREQ("uuid", params[0].name);
-    ASSERT_STREQ("abc-123", params[0].value);
+    ASSERT_VIEWEQ("uuid", params[0].name, params[0].name_len);
+    ASSERT_VIEWEQ("abc-123", params[0].value, params[0].value_len);
 }
 
 TEST(test_match_ws_room_path)
@@ -29,8 +29,8 @@ TEST(test_match_ws_room_path)
 
     ASSERT(cHTTPX_MatchPath("/api/v1/ws/chat/{room_id}", "/api/v1/ws/chat/lobby", params, &count));
     ASSERT_EQ(1, count);
-    ASSERT_STREQ("room_id", params[0].name);
-    ASSERT_STREQ("lobby", params[0].value);
+    ASSERT_VIEWEQ("room_id", params[0].name, params[0].name_len);
+    ASSERT_VIEWEQ("lobby", params[0].value, params[0].value_len);
 }
 
 TEST(test_match_rejects_extra_segments)
@@ -0,0 +1,482 @@
+#include "test_framework.h"
+
+#include "libchttpx.h"
+#include "body.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <zlib.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+TEST(test_request_views_into_buffer)
+{
+    chttpx_arena_t arena = {0};
+    char buf[] = "GET /search?q=chttpx&&lang=en HTTP/1.1\r\n"
+                 "Host: localhost\r\n"
+                 "User-Agent:  curl/8.0 \r\n"
+                 "Cookie: session=abc; theme=dark\r\n"
+                 "\r\n";
+    size_t len = sizeof(buf) - 1;
+
+    chttpx_request_t* req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, len, &arena);
+    ASSERT(req != NULL);
+
+    /* Views point into the receive buffer */
+    ASSERT(req->method == buf);
+    ASSERT(req->path > buf && req->path < buf + len);
+    ASSERT_STREQ("GET", req->method);
+    ASSERT_EQ(3, (long long)req->method_len);
+    ASSERT_STREQ("/search", req->path);
+    ASSERT_EQ(7, (long long)req->path_len);
+    ASSERT_STREQ("HTTP/1.1", req->protocol);
+
+    ASSERT_EQ(3, (long long)req->headers_count);
+    ASSERT(req->headers[0].name > buf && req->headers[0].name < buf + len);
+    ASSERT_STREQ("localhost", cHTTPX_HeaderGet(req, "host"));
+    ASSERT_STREQ("curl/8.0", req->user_agent);
+    ASSERT_EQ(8, (long long)req->headers[1].value_len);
+    ASSERT_STREQ("", req->content_type);
+
+    ASSERT_EQ(2, (long long)req->query_count);
+    ASSERT_STREQ("chttpx", cHTTPX_Query(req, "q"));
+    ASSERT_STREQ("en", cHTTPX_Query(req, "lang"));
+    ASSERT(cHTTPX_Query(req, "l") == NULL);
+
+    /* Cookies are split from a copy, the header stays intact */
+    ASSERT_EQ(2, (long long)req->cookies_count);
+    ASSERT_STREQ("abc", cHTTPX_CookieGet(req, "session")->value);
+    ASSERT_STREQ("dark", cHTTPX_CookieGet(req, "theme")->value);
+    ASSERT_STREQ("session=abc; theme=dark", cHTTPX_HeaderGet(req, "Cookie"));
+
+    _free_req(req);
+    _arena_free(&arena);
+}
+
+TEST(test_request_header_set_copies)
+{
+    chttpx_arena_t arena = {0};
+    char buf[] = "POST /items HTTP/1.0\r\nContent-Type: application/json\r\nContent-Length: 2\r\n\r\n{}";
+
+    chttpx_request_t* req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, sizeof(buf) - 1, &arena);
+    ASSERT(req != NULL);
+
+    ASSERT_STREQ("HTTP/1.0", req->protocol);
+    ASSERT_STREQ("application/json", req->content_type);
+    ASSERT_EQ(2, (long long)req->content_length);
+    ASSERT_STREQ("{}", (const char*)req->body);
+
+    ASSERT_EQ(0, cHTTPX_HeaderSet(req, "Content-Type", "text/plain; charset=utf-8"));
+    ASSERT_EQ(0, cHTTPX_HeaderSet(req, "X-Request-Id", "42"));
+    ASSERT_STREQ("text/plain; charset=utf-8", cHTTPX_HeaderGet(req, "content-type"));
+    ASSERT_STREQ("42", cHTTPX_HeaderGet(req, "X-Request-Id"));
+    ASSERT_EQ(3, (long long)req->headers_count);
+
+    /* The receive buffer is not written past the parsed head */
+    ASSERT_STREQ("{}", buf + sizeof(buf) - 3);
+
+    _free_req(req);
+    _arena_free(&arena);
+}
+
+TEST(test_request_chunked_body)
+{
+    chttpx_arena_t arena = {0};
+    char buf[] = "POST /items HTTP/1.1\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n\r\n"
+                 "4;ext=1\r\n{\"a\"\r\n3\r\n:1}\r\n0\r\nX-Trailer: y\r\n\r\n";
+
+    chttpx_request_t* req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, sizeof(buf) - 1, &arena);
+    ASSERT(req != NULL);
+
+    ASSERT_STREQ("{\"a\":1}", (const char*)req->body);
+    ASSERT_EQ(7, (long long)req->body_size);
+    ASSERT_EQ(7, (long long)req->content_length);
+    ASSERT(_body_complete(req));
+
+    _free_req(req);
+    _arena_reset(&arena);
+
+    /* A malformed chunk size, the connection cannot be reused */
+    char bad[] = "POST /items HTTP/1.1\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n\r\n"
+                 "zz\r\n{}\r\n0\r\n\r\n";
+
+    req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, bad, sizeof(bad) - 1, &arena);
+    ASSERT(req != NULL);
+    ASSERT_EQ(0, (long long)req->body_size);
+    ASSERT(!_body_complete(req));
+    ASSERT_EQ(-1, cHTTPX_BodyRead(req, buf, sizeof(buf)));
+
+    _free_req(req);
+    _arena_free(&arena);
+}
+
+#ifdef __linux__
+/* Compress data as a gzip member (window_bits 31) or a zlib stream (15) */
+static size_t deflate_to(int window_bits, const void* data, size_t len, unsigned char* out, size_t cap)
+{
+    z_stream z = {0};
+    if (deflateInit2(&z, 9, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return 0;
+
+    z.next_in = (unsigned char*)data;
+    z.avail_in = (uInt)len;
+    z.next_out = out;
+    z.avail_out = (uInt)cap;
+
+    int rc = deflate(&z, Z_FINISH);
+    deflateEnd(&z);
+
+    return rc == Z_STREAM_END ? cap - z.avail_out : 0;
+}
+
+/* A POST head followed by a compressed body */
+static size_t encoded_request(char* buf, size_t cap, const char* coding, const unsigned char* body, size_t body_len)
+{
+    size_t len = (size_t)snprintf(buf, cap,
+                                  "POST /items HTTP/1.1\r\nContent-Type: application/json\r\n"
+                                  "Content-Encoding: %s\r\nContent-Length: %zu\r\n\r\n",
+                                  coding, body_len);
+    memcpy(buf + len, body, body_len);
+    return len + body_len;
+}
+
+TEST(test_request_gzip_body)
+{
+    chttpx_arena_t arena = {0};
+    static unsigned char packed[4096];
+    static char buf[8192];
+    const char* json = "{\"name\": \"netcorelink\", \"tags\": [\"a\", \"a\", \"a\", \"a\", \"a\", \"a\"]}";
+
+    /* Inflated in place of the body, content_length is the decoded size */
+    size_t packed_len = deflate_to(31, json, strlen(json), packed, sizeof(packed));
+    ASSERT(packed_len > 0);
+
+    chttpx_request_t* req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, encoded_request(buf, sizeof(buf), "gzip", packed, packed_len), &arena);
+    ASSERT(req != NULL);
+    ASSERT_STREQ(json, (const char*)req->body);
+    ASSERT_EQ((long long)strlen(json), (long long)req->content_length);
+    ASSERT(_body_complete(req));
+
+    /* Straight into the JSON parser */
+    char* name = NULL;
+    chttpx_validation_t fields[] = {chttpx_validation_string("name", &name, true, 1, 32, VALIDATOR_NONE)};
+    ASSERT_EQ(1, cHTTPX_Parse(req, fields, 1));
+    ASSERT_STREQ("netcorelink", name);
+    free(name);
+
+    _free_req(req);
+    _arena_reset(&arena);
+
+    /* "deflate" is a zlib stream; a gzip body may be several members */
+    packed_len = deflate_to(15, json, strlen(json), packed, sizeof(packed));
+    req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, encoded_request(buf, sizeof(buf), "deflate", packed, packed_len), &arena);
+    ASSERT_STREQ(json, (const char*)req->body);
+    _free_req(req);
+    _arena_reset(&arena);
+
+    packed_len = deflate_to(31, "[1,", 3, packed, sizeof(packed));
+    packed_len += deflate_to(31, "2]", 2, packed + packed_len, sizeof(packed) - packed_len);
+    req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, encoded_request(buf, sizeof(buf), "gzip", packed, packed_len), &arena);
+    ASSERT_STREQ("[1,2]", (const char*)req->body);
+    ASSERT(_body_complete(req));
+    _free_req(req);
+    _arena_reset(&arena);
+
+    /* A truncated stream is not a body */
+    packed_len = deflate_to(31, json, strlen(json), packed, sizeof(packed));
+    req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, encoded_request(buf, sizeof(buf), "gzip", packed, packed_len - 4), &arena);
+    ASSERT(req->body == NULL);
+    ASSERT(!req->body_reader.too_large);
+
+    _free_req(req);
+    _arena_free(&arena);
+}
+
+TEST(test_request_gzip_bomb)
+{
+    chttpx_serv_t s = {0};
+    chttpx_serv_t* saved = serv;
+    serv = &s;
+    cHTTPX_DecompressLimit(64 * 1024);
+
+    chttpx_arena_t arena = {0};
+    static unsigned char zeros[1024 * 1024];
+    static unsigned char packed[8192];
+    static char buf[16384];
+
+    /* 1MB of zeros packs into about 1KB, refused once 64KB are decoded */
+    memset(zeros, '0', sizeof(zeros));
+    size_t packed_len = deflate_to(31, zeros, sizeof(zeros), packed, sizeof(packed));
+    ASSERT(packed_len > 0 && packed_len < 2048);
+
+    chttpx_request_t* req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, encoded_request(buf, sizeof(buf), "gzip", packed, packed_len), &arena);
+    ASSERT(req != NULL);
+    ASSERT(req->body == NULL);
+    ASSERT(req->body_reader.too_large);
+    ASSERT(!_body_complete(req));
+
+    chttpx_response_t res = {0};
+    ASSERT_EQ(CHTTPX_REQ_RESPOND, _process_req(req, &res));
+    ASSERT_EQ(cHTTPX_StatusPayloadTooLarge, res.status);
+
+    _free_req(req);
+    _arena_free(&arena);
+    serv = saved;
+}
+#endif
+
+#ifdef __linux__
+TEST(test_request_upload_spliced)
+{
+    chttpx_arena_t arena = {0};
+    static unsigned char data[120000];
+    static unsigned char back[sizeof(data) + 1];
+    static char buf[BUFFER_SIZE];
+
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = (unsigned char)(i * 13 + 1);
+
+    int sv[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+    /* The start of the body arrives with the head, the rest is spliced from the socket */
+    size_t len = (size_t)snprintf(buf, sizeof(buf), "PUT /blob HTTP/1.1\r\nContent-Type: application/octet-stream\r\nContent-Length: %zu\r\n\r\n",
+                                  sizeof(data));
+    memcpy(buf + len, data, 1000);
+    len += 1000;
+    ASSERT_EQ((long long)(sizeof(data) - 1000), write(sv[0], data + 1000, sizeof(data) - 1000));
+
+    chttpx_request_t* req = _parse_req_buffer(sv[1], buf, len, &arena);
+    ASSERT(req != NULL);
+    ASSERT(_body_complete(req));
+
+    /* Named only once complete, not after rand() */
+    ASSERT_EQ(0, strncmp(req->filename, "/tmp/upload_", 12));
+    ASSERT_EQ(12 + 16 + 4, (long long)strlen(req->filename));
+    ASSERT_STREQ(".bin", req->filename + 28);
+
+    FILE* f = fopen(req->filename, "rb");
+    ASSERT(f != NULL);
+    ASSERT_EQ((long long)sizeof(data), (long long)fread(back, 1, sizeof(back), f));
+    fclose(f);
+    ASSERT(memcmp(back, data, sizeof(data)) == 0);
+    remove(req->filename);
+
+    _free_req(req);
+    _arena_reset(&arena);
+
+    /* A body cut short leaves no file */
+    len = (size_t)snprintf(buf, sizeof(buf), "PUT /blob HTTP/1.1\r\nContent-Type: application/octet-stream\r\nContent-Length: %zu\r\n\r\n",
+                           sizeof(data));
+    ASSERT_EQ(80000, write(sv[0], data, 80000));
+    shutdown(sv[0], SHUT_WR);
+
+    req = _parse_req_buffer(sv[1], buf, len, &arena);
+    ASSERT(req != NULL);
+    ASSERT(!_body_complete(req));
+    ASSERT_STREQ("", req->filename);
+
+    close(sv[0]);
+    close(sv[1]);
+    _free_req(req);
+    _arena_free(&arena);
+}
+#endif
+
+#ifdef __linux__
+TEST(test_request_body_on_high_fd)
+{
+    chttpx_arena_t arena = {0};
+    static char buf[BUFFER_SIZE];
+    static char body[4000];
+    memset(body, 'b', sizeof(body));
+
+    /* Event loop connections run far past FD_SETSIZE */
+    struct rlimit rl;
+    ASSERT_EQ(0, getrlimit(RLIMIT_NOFILE, &rl));
+    if (rl.rlim_cur < 2048 && rl.rlim_max >= 2048)
+    {
+        rl.rlim_cur = 2048;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    int sv[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+    int fd = dup2(sv[0], 2000);
+    close(sv[0]);
+    if (fd != 2000)
+    {
+        /* No room for such a descriptor here */
+        close(sv[1]);
+        return;
+    }
+
+    /* The head arrives with part of the body, the rest is read from the socket */
+    size_t len = (size_t)snprintf(buf, sizeof(buf), "POST /items HTTP/1.1\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n\r\n",
+                                  sizeof(body));
+    memcpy(buf + len, body, 100);
+    len += 100;
+    ASSERT_EQ((long)(sizeof(body) - 100), (long)write(sv[1], body + 100, sizeof(body) - 100));
+
+    chttpx_request_t* req = _parse_req_buffer(fd, buf, len, &arena);
+    ASSERT(req != NULL);
+    ASSERT(_body_complete(req));
+    ASSERT_EQ((long long)sizeof(body), (long long)req->body_size);
+    ASSERT(memcmp(body, req->body, sizeof(body)) == 0);
+
+    _free_req(req);
+    _arena_free(&arena);
+    close(fd);
+    close(sv[1]);
+}
+#endif
+
+TEST(test_request_tables_spill_into_arena)
+{
+    chttpx_arena_t arena = {0};
+    char buf[4096];
+    size_t len = (size_t)snprintf(buf, sizeof(buf), "GET /list?a0=0&a1=1&a2=2&a3=3&a4=4&a5=5&a6=6&a7=7&a8=8&a9=9 HTTP/1.1\r\n");
+
+    for (int i = 0; i < 40; i++)
+        len += (size_t)snprintf(buf + len, sizeof(buf) - len, "X-Header-%d: value-%d\r\n", i, i);
+    len += (size_t)snprintf(buf + len, sizeof(buf) - len, "Cookie: c0=0; c1=1; c2=2; c3=3; c4=4; c5=5\r\n\r\n");
+
+    chttpx_request_t* req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, len, &arena);
+    ASSERT(req != NULL);
+
+    ASSERT_EQ(41, (long long)req->headers_count);
+    ASSERT(req->headers != req->headers_inline);
+    ASSERT_STREQ("value-0", cHTTPX_HeaderGet(req, "X-Header-0"));
+    ASSERT_STREQ("value-39", cHTTPX_HeaderGet(req, "X-Header-39"));
+
+    ASSERT_EQ(10, (long long)req->query_count);
+    ASSERT_STREQ("9", cHTTPX_Query(req, "a9"));
+
+    ASSERT_EQ(6, (long long)req->cookies_count);
+    ASSERT_STREQ("5", cHTTPX_CookieGet(req, "c5")->value);
+
+    /* Params are NUL-terminated copies */
+    chttpx_param_t params[MAX_PARAMS];
+    int count = 0;
+    ASSERT(cHTTPX_MatchPath("/{a}/{b}/{c}/{d}/{e}", "/1/2/3/4/five", params, &count));
+    ASSERT_EQ(0, _req_set_params(req, params, (size_t)count));
+    ASSERT_EQ(5, (long long)req->params_count);
+    ASSERT_STREQ("five", cHTTPX_Param(req, "e"));
+    ASSERT_STREQ("1", req->params[0].value);
+
+    _free_req(req);
+    _arena_free(&arena);
+}
+
+TEST(test_request_invalid_line)
+{
+    chttpx_arena_t arena = {0};
+    char buf[] = "GET\r\n\r\n";
+
+    chttpx_request_t* req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, sizeof(buf) - 1, &arena);
+    _arena_free(&arena);
+
+    ASSERT(req == NULL);
+}
+
+TEST(test_request_arena_reset_between_requests)
+{
+    chttpx_arena_t arena = {0};
+    char buf[] = "GET /a HTTP/1.1\r\nHost: x\r\n\r\n";
+    char copy[sizeof(buf)];
+    memcpy(copy, buf, sizeof(buf));
+
+    chttpx_request_t* req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, sizeof(buf) - 1, &arena);
+    ASSERT(req != NULL);
+
+    char* small = cHTTPX_Alloc(req, 100);
+    unsigned char* large = cHTTPX_Alloc(req, 3 * ARENA_BLOCK_SIZE);
+    ASSERT(small != NULL && large != NULL);
+    ASSERT(((uintptr_t)small % (2 * sizeof(void*))) == 0);
+    memset(large, 0xab, 3 * ARENA_BLOCK_SIZE);
+    ASSERT_STREQ("hello", cHTTPX_Strdup(req, "hello"));
+
+    _free_req(req);
+    _arena_reset(&arena);
+
+    /* One standard block is kept and reused by the next REQuest */
+    ASSERT(arena.head != NULL);
+    ASSERT(arena.head->next == NULL);
+    ASSERT_EQ(ARENA_BLOCK_SIZE, (long long)arena.head->size);
+    ASSERT_EQ(0, (long long)arena.head->used);
+
+    chttpx_request_t* next = _parse_req_buffer(CHTTPX_INVALID_SOCKET, copy, sizeof(copy) - 1, &arena);
+    ASSERT(next == req);
+    ASSERT_STREQ("/a", next->path);
+
+    _free_req(next);
+    _arena_free(&arena);
+    ASSERT(arena.head == NULL);
+}
+
+TEST(test_request_head_framing)
+{
+    size_t content_length;
+
+    const char ok[] = "POST / HTTP/1.1\r\ncontent-length:  12 \r\nX-Content-Length: 5\r\n\r\n";
+    ASSERT_EQ(0, _req_head_content_length(ok, sizeof(ok) - 1, &content_length));
+    ASSERT_EQ(12, (long long)content_length);
+
+    const char none[] = "GET / HTTP/1.1\r\nHost: x\r\n\r\n";
+    ASSERT_EQ(0, _req_head_content_length(none, sizeof(none) - 1, &content_length));
+    ASSERT_EQ(0, (long long)content_length);
+
+    /* The parser would read a header the framing does not see, or the other way round */
+    const char* bad[] = {
+        "POST / HTTP/1.1\r\nContent-Length : 5\r\n\r\n",
+        "POST / HTTP/1.1\r\nContent-Length\t: 5\r\n\r\n",
+        "POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 5\r\n\r\n",
+        "POST / HTTP/1.1\r\nContent-Length: 5\r\ncontent-length: 7\r\n\r\n",
+        "POST / HTTP/1.1\r\nContent-Length: 5, 5\r\n\r\n",
+        "POST / HTTP/1.1\r\nContent-Length: +5\r\n\r\n",
+        "POST / HTTP/1.1\r\nContent-Length:\r\n\r\n",
+        "POST / HTTP/1.1\r\nContent-Length: 99999999999999999999999\r\n\r\n",
+        "POST / HTTP/1.1\r\nHost x\r\n\r\n",
+    };
+
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+        ASSERT_EQ(-1, _req_head_content_length(bad[i], strlen(bad[i]), &content_length));
+}
+
+TEST(test_request_head_chunked_framing)
+{
+    const char chunked[] = "POST / HTTP/1.1\r\ntransfer-encoding: gzip, chunked\r\n\r\n";
+    ASSERT_EQ(1, _req_head_chunked(chunked, sizeof(chunked) - 1));
+
+    const char other[] = "POST / HTTP/1.1\r\nX-Transfer-Encoding: chunked\r\n\r\n";
+    ASSERT_EQ(0, _req_head_chunked(other, sizeof(other) - 1));
+
+    /* Chunked for a proxy that trims the name, a plain header for the parser */
+    const char spaced[] = "POST / HTTP/1.1\r\nTransfer-Encoding : chunked\r\n\r\n";
+    ASSERT_EQ(-1, _req_head_chunked(spaced, sizeof(spaced) - 1));
+}
+
+void run_request_tests(void)
+{
+    printf("request\n");
+    RUN_TEST(test_request_views_into_buffer);
+    RUN_TEST(test_request_header_set_copies);
+    RUN_TEST(test_request_chunked_body);
+#ifdef __linux__
+    RUN_TEST(test_request_gzip_body);
+    RUN_TEST(test_request_gzip_bomb);
+    RUN_TEST(test_request_upload_spliced);
+    RUN_TEST(test_request_body_on_high_fd);
+#endif
+    RUN_TEST(test_request_tables_spill_into_arena);
+    RUN_TEST(test_request_invalid_line);
+    RUN_TEST(test_request_head_framing);
+    RUN_TEST(test_request_head_chunked_framing);
+    RUN_TEST(test_request_arena_reset_between_requests);
+}
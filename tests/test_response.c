@@ -2,9 +2,20 @@
 
 #include "libchttpx.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <zlib.h>
+#endif
+
 TEST(test_res_json_body)
 {
     chttpx_response_t res = cHTTPX_ResJson(cHTTPX_StatusOK, "{\"msg\":\"hi\"}");
@@ -39,10 +50,937 @@ TEST(test_res_json_not_found)
     free(res.body);
 }
 
+TEST(test_res_json_large_body)
+{
+    static char text[3 * BUFFER_SIZE];
+    memset(text, 'x', sizeof(text) - 1);
+
+    /* Larger than the formatting buffer: nothing is cut */
+    chttpx_response_t res = cHTTPX_ResJson(cHTTPX_StatusOK, "{\"text\": \"%s\"}", text);
+
+    ASSERT_EQ(sizeof(text) - 1 + 12, (long long)res.body_size);
+    ASSERT(memcmp(res.body + res.body_size - 3, "x\"}", 3) == 0);
+    free((void*)res.body);
+}
+
+TEST(test_res_headers_survive_copy)
+{
+    chttpx_response_t res = {0};
+
+    ASSERT_EQ(0, cHTTPX_HeaderAdd(&res, "Set-Cookie", "a=1"));
+    ASSERT_EQ(0, cHTTPX_HeaderAdd(&res, "Set-Cookie", "b=2"));
+    ASSERT_EQ(0, cHTTPX_HeaderAdd(&res, "Cache-Control", "no-store"));
+
+    /* Handlers return the RESponse by value */
+    chttpx_response_t copy = res;
+    memset(&res, 0xff, sizeof(res));
+
+    ASSERT_EQ(3, (long long)copy.headers_count);
+    ASSERT_STREQ("a=1", cHTTPX_ResHeaderGet(&copy, "set-cookie"));
+    ASSERT_STREQ("no-store", cHTTPX_ResHeaderGet(&copy, "Cache-Control"));
+    ASSERT(cHTTPX_ResHeaderGet(&copy, "Connection") == NULL);
+
+    /* Outside a handler the header pool is bounded */
+    char big[RES_HEADERS_POOL];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    ASSERT_EQ(-1, cHTTPX_HeaderAdd(&copy, "X-Big", big));
+    ASSERT_EQ(3, (long long)copy.headers_count);
+}
+
+static void many_headers_handler(chttpx_request_t* req, chttpx_response_t* res)
+{
+    (void)req;
+    *res = cHTTPX_ResJson(cHTTPX_StatusOK, "{}");
+
+    /* Rewriting a value must not use up the pool */
+    for (int i = 0; i < 1000; i++)
+        cHTTPX_ResHeaderSet(res, "X-Counter", i % 2 ? "odd-value-that-is-longer" : "even");
+
+    char name[32];
+    for (int i = 0; i < 60; i++)
+    {
+        snprintf(name, sizeof(name), "X-H%d", i);
+        cHTTPX_HeaderAdd(res, name, "v");
+    }
+
+    static char big[4096];
+    memset(big, 'b', sizeof(big) - 1);
+    cHTTPX_HeaderAdd(res, "X-Big", big);
+    cHTTPX_ResHeaderSet(res, "X-Counter", "last");
+}
+
+TEST(test_res_headers_spill_into_arena)
+{
+    chttpx_serv_t serv = {0};
+    ASSERT_EQ(0, cHTTPX_Init(&serv, 18096, NULL));
+
+    chttpx_router_t r = cHTTPX_RoutePathPrefix("");
+    cHTTPX_RegisterRoute(&r, "GET", "/many", many_headers_handler);
+
+    /* Replaced values are reclaimed, even outside a handler */
+    chttpx_response_t res = {0};
+    for (int i = 0; i < 1000; i++)
+        ASSERT_EQ(0, cHTTPX_ResHeaderSet(&res, "X-Counter", i % 2 ? "odd-value-that-is-longer" : "even"));
+    ASSERT_EQ(1, (long long)res.headers_count);
+    ASSERT(res.headers_spilled == NULL);
+    ASSERT_STREQ("odd-value-that-is-longer", cHTTPX_ResHeaderGet(&res, "X-Counter"));
+
+    chttpx_arena_t arena = {0};
+    char buf[] = "GET /many HTTP/1.1\r\nHost: x\r\n\r\n";
+    chttpx_request_t* req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, sizeof(buf) - 1, &arena);
+    ASSERT(req != NULL);
+
+    ASSERT_EQ(CHTTPX_REQ_RESPOND, _process_req(req, &res));
+    /* X-Counter, 60 X-H*, X-Big and the ETag */
+    ASSERT_EQ(63, (long long)res.headers_count);
+    ASSERT(cHTTPX_ResHeaderGet(&res, "ETag") != NULL);
+    ASSERT(res.headers_spilled != NULL);
+    ASSERT_STREQ("last", cHTTPX_ResHeaderGet(&res, "X-Counter"));
+    ASSERT_STREQ("v", cHTTPX_ResHeaderGet(&res, "x-h59"));
+    ASSERT_EQ(4095, (long long)strlen(cHTTPX_ResHeaderGet(&res, "X-Big")));
+
+    /* Spilled headers are sent in the order they were added */
+    static char head[BUFFER_SIZE];
+    _build_response_head(req, &res, 0, head, sizeof(head));
+    const char* counter = strstr(head, "X-Counter: last\r\n");
+    const char* first = strstr(head, "X-H0: v\r\n");
+    const char* last = strstr(head, "X-H59: v\r\n");
+    ASSERT(counter && first && last);
+    ASSERT(counter < first && first < last && last < strstr(head, "X-Big: bbb"));
+
+    _res_release(&res);
+    _free_req(req);
+    _arena_free(&arena);
+    cHTTPX_Shutdown();
+}
+
+/* GET REQuest with the given extra headers */
+static chttpx_request_t* cond_req(const char* headers, char* buf, size_t size, chttpx_arena_t* arena)
+{
+    int n = snprintf(buf, size, "GET /r HTTP/1.1\r\n%s\r\n", headers);
+    return _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, (size_t)n, arena);
+}
+
+TEST(test_res_http_date)
+{
+    char date[CHTTPX_HTTP_DATE_SIZE];
+    _http_date(784111777, date, sizeof(date));
+    ASSERT_STREQ("Sun, 06 Nov 1994 08:49:37 GMT", date);
+
+    time_t t = 0;
+    ASSERT_EQ(0, _http_date_parse(date, &t));
+    ASSERT_EQ(784111777, (long long)t);
+
+    ASSERT_EQ(0, _http_date_parse("Thu, 29 Feb 2024 23:59:59 GMT", &t));
+    ASSERT_EQ(1709251199, (long long)t);
+
+    ASSERT_EQ(-1, _http_date_parse("Sunday, 06-Nov-94 08:49:37 GMT", &t));
+    ASSERT_EQ(-1, _http_date_parse(NULL, &t));
+}
+
+TEST(test_res_if_none_match)
+{
+    chttpx_arena_t arena = {0};
+    char buf[512];
+    const unsigned char body[] = "hello";
+
+    /* The ETag of the body */
+    chttpx_response_t res = {.status = cHTTPX_StatusOK, .content_type = "text/plain", .body = body, .body_size = 5};
+    _res_apply_conditional(cond_req("", buf, sizeof(buf), &arena), &res, 1);
+    ASSERT_EQ(cHTTPX_StatusOK, res.status);
+    const char* etag = cHTTPX_ResHeaderGet(&res, "ETag");
+    ASSERT(etag != NULL);
+
+    /* Matching (weakly, in a list) */
+    char headers[128];
+    snprintf(headers, sizeof(headers), "If-None-Match: \"x\", W/%s\r\n", etag);
+    res = (chttpx_response_t){.status = cHTTPX_StatusOK, .content_type = "text/plain", .body = body, .body_size = 5};
+    _res_apply_conditional(cond_req(headers, buf, sizeof(buf), &arena), &res, 1);
+    ASSERT_EQ(cHTTPX_StatusNotModified, res.status);
+    ASSERT(res.body == NULL);
+    ASSERT_EQ(0, (long long)res.body_size);
+    ASSERT(cHTTPX_ResHeaderGet(&res, "ETag") != NULL);
+
+    /* A 304 head has no Content-Length */
+    char head[512];
+    _build_response_head(NULL, &res, 0, head, sizeof(head));
+    ASSERT(strstr(head, "Content-Length") == NULL);
+
+    /* Mismatch */
+    res = (chttpx_response_t){.status = cHTTPX_StatusOK, .content_type = "text/plain", .body = body, .body_size = 5};
+    _res_apply_conditional(cond_req("If-None-Match: \"other\"\r\n", buf, sizeof(buf), &arena), &res, 1);
+    ASSERT_EQ(cHTTPX_StatusOK, res.status);
+    ASSERT(res.body == body);
+
+    /* Handler-supplied ETag, nothing hashed */
+    res = (chttpx_response_t){.status = cHTTPX_StatusOK, .content_type = "text/plain", .body = body, .body_size = 5};
+    cHTTPX_HeaderAdd(&res, "ETag", "\"v42\"");
+    _res_apply_conditional(cond_req("If-None-Match: \"v42\"\r\n", buf, sizeof(buf), &arena), &res, 1);
+    ASSERT_EQ(cHTTPX_StatusNotModified, res.status);
+    ASSERT_EQ(1, (long long)res.headers_count);
+
+    /* ETag disabled for the route */
+    res = (chttpx_response_t){.status = cHTTPX_StatusOK, .content_type = "text/plain", .body = body, .body_size = 5};
+    _res_apply_conditional(cond_req("If-None-Match: *\r\n", buf, sizeof(buf), &arena), &res, 0);
+    ASSERT_EQ(cHTTPX_StatusOK, res.status);
+    ASSERT(cHTTPX_ResHeaderGet(&res, "ETag") == NULL);
+
+    _arena_free(&arena);
+}
+
+TEST(test_res_if_modified_since)
+{
+    chttpx_arena_t arena = {0};
+    char buf[512];
+
+    chttpx_response_t res = {.status = cHTTPX_StatusOK, .content_type = "text/plain"};
+    cHTTPX_HeaderAdd(&res, "Last-Modified", "Sun, 06 Nov 1994 08:49:37 GMT");
+
+    chttpx_response_t copy = res;
+    _res_apply_conditional(cond_req("If-Modified-Since: Sun, 06 Nov 1994 08:49:37 GMT\r\n", buf, sizeof(buf), &arena), &copy, 1);
+    ASSERT_EQ(cHTTPX_StatusNotModified, copy.status);
+
+    copy = res;
+    _res_apply_conditional(cond_req("If-Modified-Since: Sat, 05 Nov 1994 08:49:37 GMT\r\n", buf, sizeof(buf), &arena), &copy, 1);
+    ASSERT_EQ(cHTTPX_StatusOK, copy.status);
+
+    /* If-None-Match wins */
+    copy = res;
+    _res_apply_conditional(
+        cond_req("If-None-Match: \"x\"\r\nIf-Modified-Since: Sun, 06 Nov 1994 08:49:37 GMT\r\n", buf, sizeof(buf), &arena), &copy, 1);
+    ASSERT_EQ(cHTTPX_StatusOK, copy.status);
+
+    _arena_free(&arena);
+}
+
+#ifndef _WIN32
+TEST(test_hash64_impls_agree)
+{
+    size_t size = 8192 + 77;
+    unsigned char* buf = malloc(size);
+    ASSERT(buf != NULL);
+    for (size_t i = 0; i < size; i++)
+        buf[i] = (unsigned char)(i * 131 + (i >> 7));
+
+    static const size_t lens[] = {0, 1, 3, 4, 7, 8, 16, 17, 64, 127, 128, 129, 191, 192, 193, 1024, 1025, 4096, 8192 + 77};
+    const char* impls[] = {"sse2", "avx2"};
+
+    for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++)
+    {
+        ASSERT_EQ(0, _hash64_select("scalar"));
+        uint64_t want = cHTTPX_Hash64(buf, lens[l]);
+
+        /* Any input byte changes the hash */
+        if (lens[l])
+        {
+            buf[lens[l] - 1] ^= 1;
+            ASSERT(cHTTPX_Hash64(buf, lens[l]) != want);
+            buf[lens[l] - 1] ^= 1;
+        }
+
+        for (size_t i = 0; i < 2; i++)
+        {
+            if (_hash64_select(impls[i]) == 0)
+                ASSERT(cHTTPX_Hash64(buf, lens[l]) == want);
+        }
+    }
+
+    ASSERT_EQ(-1, _hash64_select("none"));
+    ASSERT_EQ(0, _hash64_select(NULL));
+
+    free(buf);
+}
+
+static uint64_t constant_hash(const void* data, size_t len)
+{
+    (void)data;
+    (void)len;
+    return 0xabc;
+}
+
+TEST(test_res_etag_hash)
+{
+    chttpx_arena_t arena = {0};
+    char buf[512];
+    const unsigned char body[] = "hello";
+
+    cHTTPX_ETagHash(constant_hash);
+    chttpx_response_t res = {.status = cHTTPX_StatusOK, .content_type = "text/plain", .body = body, .body_size = 5};
+    _res_apply_conditional(cond_req("", buf, sizeof(buf), &arena), &res, 1);
+    ASSERT_STREQ("\"abc\"", cHTTPX_ResHeaderGet(&res, "ETag"));
+
+    cHTTPX_ETagHash(NULL);
+    res = (chttpx_response_t){.status = cHTTPX_StatusOK, .content_type = "text/plain", .body = body, .body_size = 5};
+    _res_apply_conditional(cond_req("", buf, sizeof(buf), &arena), &res, 1);
+    ASSERT(strcmp("\"abc\"", cHTTPX_ResHeaderGet(&res, "ETag")) != 0);
+
+    _arena_free(&arena);
+}
+
+/* Streams "piece N" count times */
+typedef struct
+{
+    int left;
+    int freed;
+} stream_ctx_t;
+
+static long stream_pieces(void* ctx, char* buf, size_t size)
+{
+    stream_ctx_t* s = ctx;
+    if (s->left == 0)
+        return 0;
+
+    return snprintf(buf, size, "piece %d", s->left--);
+}
+
+static void stream_ctx_free(void* ctx)
+{
+    ((stream_ctx_t*)ctx)->freed++;
+}
+
+/* Everything a stream produces, concatenated */
+static size_t stream_drain(chttpx_response_t* res, char* out, size_t size)
+{
+    char frame[CHTTPX_STREAM_FRAME];
+    const char* data;
+    size_t total = 0;
+    long n;
+
+    while ((n = _res_stream_next(res, frame, &data)) > 0 && total + (size_t)n < size)
+    {
+        memcpy(out + total, data, (size_t)n);
+        total += (size_t)n;
+    }
+
+    out[total] = '\0';
+    return total;
+}
+
+TEST(test_res_stream_chunks)
+{
+    stream_ctx_t ctx = {.left = 2};
+    chttpx_response_t res = cHTTPX_ResStream(cHTTPX_StatusOK, "text/plain", stream_pieces, &ctx, stream_ctx_free);
+
+    char head[512];
+    _build_response_head(NULL, &res, 0, head, sizeof(head));
+    ASSERT(strstr(head, "Transfer-Encoding: chunked\r\n") != NULL);
+    ASSERT(strstr(head, "Content-Length") == NULL);
+
+    char out[256];
+    stream_drain(&res, out, sizeof(out));
+    ASSERT_STREQ("7\r\npiece 2\r\n7\r\npiece 1\r\n0\r\n\r\n", out);
+
+    _res_release(&res);
+    ASSERT_EQ(1, ctx.freed);
+    ASSERT(res.stream == NULL);
+
+    /* HTTP/1.0: the raw body, delimited by closing the connection */
+    ctx = (stream_ctx_t){.left = 2};
+    res = cHTTPX_ResStream(cHTTPX_StatusOK, "text/plain", stream_pieces, &ctx, NULL);
+    res.stream_chunked = false;
+
+    _build_response_head(NULL, &res, 0, head, sizeof(head));
+    ASSERT(strstr(head, "Transfer-Encoding") == NULL);
+
+    stream_drain(&res, out, sizeof(out));
+    ASSERT_STREQ("piece 2piece 1", out);
+
+    _res_release(&res);
+    ASSERT_EQ(0, ctx.freed);
+}
+
+/* Writes rows {"id": i, "name": "row i"}, row 500 carries a string longer than a chunk */
+static int json_rows(void* ctx, chttpx_json_t* json)
+{
+    static char big[CHTTPX_STREAM_CHUNK * 2];
+    int* row = ctx;
+
+    if (*row == 0)
+        cHTTPX_JsonArray(json);
+
+    if (*row == 1000)
+    {
+        cHTTPX_JsonArrayEnd(json);
+        return 0;
+    }
+
+    char name[16];
+    snprintf(name, sizeof(name), "row %d", *row);
+
+    cHTTPX_JsonObject(json);
+    cHTTPX_JsonKey(json, "id");
+    cHTTPX_JsonInt(json, *row);
+    cHTTPX_JsonKey(json, "name");
+    if (*row == 500)
+    {
+        memset(big, 'q', sizeof(big) - 1);
+        cHTTPX_JsonString(json, big);
+    }
+    else
+    {
+        cHTTPX_JsonString(json, name);
+    }
+    cHTTPX_JsonObjectEnd(json);
+
+    (*row)++;
+    return 1;
+}
+
+static int json_unbalanced(void* ctx, chttpx_json_t* json)
+{
+    (void)ctx;
+    cHTTPX_JsonArray(json);
+    return 0;
+}
+
+TEST(test_res_json_stream)
+{
+    static char out[CHTTPX_STREAM_CHUNK * 8];
+
+    /* The same document built in memory */
+    chttpx_json_t whole;
+    int row = 0;
+    cHTTPX_JsonInit(&whole, NULL);
+    while (json_rows(&row, &whole))
+        ;
+
+    row = 0;
+    chttpx_response_t res = cHTTPX_ResJsonStream(cHTTPX_StatusOK, json_rows, &row, NULL);
+    ASSERT_STREQ("application/json", res.content_type);
+    res.stream_chunked = false;
+
+    size_t len = stream_drain(&res, out, sizeof(out));
+    ASSERT_EQ((long long)whole.len, (long long)len);
+    ASSERT(memcmp(whole.buf, out, len) == 0);
+
+    _res_release(&res);
+    cHTTPX_JsonFree(&whole);
+
+    /* An unfinished document aborts the stream */
+    res = cHTTPX_ResJsonStream(cHTTPX_StatusOK, json_unbalanced, NULL, NULL);
+
+    char frame[CHTTPX_STREAM_FRAME];
+    const char* data;
+    ASSERT_EQ(-1, _res_stream_next(&res, frame, &data));
+    _res_release(&res);
+}
+
+TEST(test_send_parts_resumes_short_writes)
+{
+    int sv[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+    fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+
+    const char head[] = "HTTP/1.1 200 OK\r\nContent-Length: 1048576\r\n\r\n";
+    size_t body_len = 1024 * 1024;
+    unsigned char* body = malloc(body_len);
+    ASSERT(body != NULL);
+    for (size_t i = 0; i < body_len; i++)
+        body[i] = (unsigned char)(i * 7);
+
+    chttpx_send_part_t parts[2] = {{.data = head, .len = sizeof(head) - 1}, {.data = body, .len = body_len}};
+    size_t total = sizeof(head) - 1 + body_len;
+    size_t offset = 0, received = 0, would_block = 0;
+    int mismatch = 0;
+
+    unsigned char chunk[65536];
+    int r;
+    while ((r = _send_parts(sv[0], parts, 2, &offset)) != 1)
+    {
+        if (r < 0)
+            break;
+
+        /* The socket buffer is full: drain it like a slow client */
+        would_block++;
+        ssize_t n = read(sv[1], chunk, sizeof(chunk));
+        for (ssize_t i = 0; i < n; i++)
+        {
+            size_t pos = received + (size_t)i;
+            if (pos >= sizeof(head) - 1 && chunk[i] != (unsigned char)((pos - (sizeof(head) - 1)) * 7))
+                mismatch = 1;
+        }
+        received += n > 0 ? (size_t)n : 0;
+    }
+
+    ASSERT_EQ(1, r);
+    ASSERT_EQ(total, offset);
+    ASSERT(would_block > 0);
+    ASSERT(!mismatch);
+
+    close(sv[0]);
+    close(sv[1]);
+    free(body);
+}
+
+TEST(test_res_file_is_sent_from_fd)
+{
+    char path[] = "/tmp/chttpx_res_file_XXXXXX";
+    int tmp = mkstemp(path);
+    ASSERT(tmp >= 0);
+
+    size_t file_len = 512 * 1024;
+    unsigned char* data = malloc(file_len);
+    ASSERT(data != NULL);
+    for (size_t i = 0; i < file_len; i++)
+        data[i] = (unsigned char)(i * 13);
+    ASSERT_EQ((long long)file_len, (long long)write(tmp, data, file_len));
+    close(tmp);
+
+    chttpx_response_t res = cHTTPX_ResFile(cHTTPX_StatusOK, "application/octet-stream", path);
+    unlink(path);
+
+    /* Nothing is read into memory */
+    ASSERT(res.file);
+    ASSERT(res.body == NULL);
+    ASSERT_EQ((long long)file_len, (long long)res.body_size);
+    ASSERT(cHTTPX_ResHeaderGet(&res, "ETag") != NULL);
+
+    int sv[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+    fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+
+    const char head[] = "HTTP/1.1 200 OK\r\n\r\n";
+    chttpx_send_part_t parts[CHTTPX_RES_PARTS];
+    size_t count = _res_parts(&res, head, sizeof(head) - 1, parts);
+    ASSERT_EQ(2, (long long)count);
+
+    unsigned char* received = malloc(sizeof(head) - 1 + file_len);
+    ASSERT(received != NULL);
+    size_t offset = 0, got = 0;
+    int r;
+    while ((r = _send_parts(sv[0], parts, count, &offset)) != 1)
+    {
+        if (r < 0)
+            break;
+
+        ssize_t n = read(sv[1], received + got, sizeof(head) - 1 + file_len - got);
+        got += n > 0 ? (size_t)n : 0;
+    }
+
+    ASSERT_EQ(1, r);
+    ASSERT_EQ(sizeof(head) - 1 + file_len, offset);
+
+    close(sv[0]);
+    while (got < offset)
+    {
+        ssize_t n = read(sv[1], received + got, offset - got);
+        if (n <= 0)
+            break;
+        got += (size_t)n;
+    }
+
+    ASSERT_EQ(offset, got);
+    ASSERT(memcmp(received, head, sizeof(head) - 1) == 0);
+    ASSERT(memcmp(received + sizeof(head) - 1, data, file_len) == 0);
+
+    _res_release(&res);
+    ASSERT(!res.file);
+
+    close(sv[1]);
+    free(received);
+    free(data);
+}
+
+/* Response of a 20-byte file to a REQuest with the given extra headers, body sent through a socket */
+static chttpx_response_t range_get(const char* headers, chttpx_arena_t* arena, char* body, size_t body_size)
+{
+    body[0] = '\0';
+
+    char path[] = "/tmp/chttpx_range_XXXXXX";
+    int tmp = mkstemp(path);
+    if (tmp >= 0)
+    {
+        if (write(tmp, "0123456789abcdefghij", 20) != 20)
+            unlink(path);
+        close(tmp);
+    }
+
+    chttpx_response_t res = cHTTPX_ResFile(cHTTPX_StatusOK, cHTTPX_CTYPE_TEXT, path);
+    unlink(path);
+
+    char buf[512];
+    int n = snprintf(buf, sizeof(buf), "GET /f HTTP/1.1\r\n%s\r\n", headers);
+    chttpx_request_t* req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, (size_t)n, arena);
+    if (req)
+        _res_apply_range(req, &res);
+
+    int sv[2];
+    if (res.body_size < body_size && socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0)
+    {
+        chttpx_send_part_t parts[CHTTPX_RES_PARTS];
+        size_t count = _res_parts(&res, "", 0, parts);
+        size_t offset = 0;
+
+        if (_send_parts(sv[0], parts, count, &offset) == 1)
+        {
+            size_t got = 0;
+            ssize_t r;
+            while (got < offset && (r = read(sv[1], body + got, body_size - 1 - got)) > 0)
+                got += (size_t)r;
+            body[got] = '\0';
+        }
+
+        close(sv[0]);
+        close(sv[1]);
+    }
+
+    return res;
+}
+
+TEST(test_res_file_single_range)
+{
+    chttpx_arena_t arena = {0};
+    char body[512];
+
+    chttpx_response_t res = range_get("Range: bytes=2-5\r\n", &arena, body, sizeof(body));
+    ASSERT_EQ(cHTTPX_StatusPartialContent, res.status);
+    ASSERT_STREQ("bytes 2-5/20", cHTTPX_ResHeaderGet(&res, "Content-Range"));
+    ASSERT_EQ(4, (long long)res.body_size);
+    ASSERT_STREQ("2345", body);
+    _res_release(&res);
+
+    /* Suffix and open-ended ranges */
+    res = range_get("Range: bytes=-3\r\n", &arena, body, sizeof(body));
+    ASSERT_STREQ("hij", body);
+    _res_release(&res);
+
+    res = range_get("Range: bytes=18-\r\n", &arena, body, sizeof(body));
+    ASSERT_STREQ("bytes 18-19/20", cHTTPX_ResHeaderGet(&res, "Content-Range"));
+    ASSERT_STREQ("ij", body);
+    _res_release(&res);
+
+    _arena_free(&arena);
+}
+
+TEST(test_res_file_multi_range)
+{
+    chttpx_arena_t arena = {0};
+    char body[512];
+
+    chttpx_response_t res = range_get("Range: bytes=0-1, 10-11\r\n", &arena, body, sizeof(body));
+    ASSERT_EQ(cHTTPX_StatusPartialContent, res.status);
+    ASSERT(strncmp(res.content_type, "multipart/byteranges; boundary=", 31) == 0);
+
+    const char* boundary = res.content_type + 31;
+    char expected[512];
+    snprintf(expected, sizeof(expected),
+             "\r\n--%s\r\nContent-Type: text/plain\r\nContent-Range: bytes 0-1/20\r\n\r\n01"
+             "\r\n--%s\r\nContent-Type: text/plain\r\nContent-Range: bytes 10-11/20\r\n\r\nab"
+             "\r\n--%s--\r\n",
+             boundary, boundary, boundary);
+
+    ASSERT_EQ((long long)strlen(expected), (long long)res.body_size);
+    ASSERT_STREQ(expected, body);
+    _res_release(&res);
+
+    _arena_free(&arena);
+}
+
+TEST(test_res_file_range_fallbacks)
+{
+    chttpx_arena_t arena = {0};
+    char body[512];
+
+    /* Nothing satisfiable */
+    chttpx_response_t res = range_get("Range: bytes=50-\r\n", &arena, body, sizeof(body));
+    ASSERT_EQ(cHTTPX_StatusRangeNotSatisfiable, res.status);
+    ASSERT(!res.file);
+    ASSERT_STREQ("bytes */20", cHTTPX_ResHeaderGet(&res, "Content-Range"));
+    free((void*)res.body);
+
+    /* Stale If-Range, overlapping or malformed ranges: the whole file */
+    const char* whole[] = {"Range: bytes=0-1\r\nIf-Range: \"other\"\r\n", "Range: bytes=0-5,3-8\r\n", "Range: bytes=x-1\r\n",
+                           "Range: items=0-1\r\n"};
+
+    for (size_t i = 0; i < sizeof(whole) / sizeof(whole[0]); i++)
+    {
+        res = range_get(whole[i], &arena, body, sizeof(body));
+        ASSERT_EQ(cHTTPX_StatusOK, res.status);
+        ASSERT_STREQ("0123456789abcdefghij", body);
+        _res_release(&res);
+    }
+
+    _arena_free(&arena);
+}
+#endif
+
+#ifdef __linux__
+/* Compression configured on a server of its own, the previous one is restored by compress_end */
+static chttpx_serv_t* compress_begin(chttpx_serv_t* s)
+{
+    chttpx_serv_t* saved = serv;
+    *s = (chttpx_serv_t){0};
+    serv = s;
+    cHTTPX_Compress(64, 0, NULL, 0);
+    return saved;
+}
+
+static void compress_end(chttpx_serv_t* saved)
+{
+    _compress_shutdown();
+    serv = saved;
+}
+
+/* Decode a gzip or zlib body, returns the decoded size */
+static size_t inflate_all(const void* in, size_t in_len, char* out, size_t out_size)
+{
+    z_stream z = {0};
+    if (inflateInit2(&z, 15 + 32) != Z_OK)
+        return 0;
+
+    z.next_in = (Bytef*)in;
+    z.avail_in = (uInt)in_len;
+    z.next_out = (Bytef*)out;
+    z.avail_out = (uInt)(out_size - 1);
+
+    int r = inflate(&z, Z_FINISH);
+    size_t len = r == Z_STREAM_END ? out_size - 1 - z.avail_out : 0;
+    out[len] = '\0';
+
+    inflateEnd(&z);
+    return len;
+}
+
+TEST(test_compress_accepts)
+{
+    chttpx_serv_t s;
+    chttpx_serv_t* saved = compress_begin(&s);
+    chttpx_arena_t arena = {0};
+    char buf[512];
+
+    ASSERT_EQ(0, (long long)_compress_accepts(cond_req("", buf, sizeof(buf), &arena)));
+    ASSERT_EQ(CHTTPX_ENC_GZIP | CHTTPX_ENC_DEFLATE | CHTTPX_ENC_BR,
+              (long long)_compress_accepts(cond_req("Accept-Encoding: gzip, deflate, br\r\n", buf, sizeof(buf), &arena)));
+    ASSERT_EQ(CHTTPX_ENC_DEFLATE,
+              (long long)_compress_accepts(cond_req("Accept-Encoding: GZIP;q=0.000, deflate;q=0.5\r\n", buf, sizeof(buf), &arena)));
+    ASSERT_EQ(CHTTPX_ENC_GZIP | CHTTPX_ENC_DEFLATE,
+              (long long)_compress_accepts(cond_req("Accept-Encoding: br;q=0, *\r\n", buf, sizeof(buf), &arena)));
+    ASSERT_EQ(0, (long long)_compress_accepts(cond_req("Accept-Encoding: identity\r\n", buf, sizeof(buf), &arena)));
+
+    ASSERT(_compress_type("application/json; charset=utf-8"));
+    ASSERT(!_compress_type(cHTTPX_CTYPE_PNG));
+
+    /* Disabled */
+    s.compress.enabled = 0;
+    ASSERT_EQ(0, (long long)_compress_accepts(cond_req("Accept-Encoding: gzip\r\n", buf, sizeof(buf), &arena)));
+
+    _arena_free(&arena);
+    compress_end(saved);
+}
+
+TEST(test_res_compress_body)
+{
+    chttpx_serv_t s;
+    chttpx_serv_t* saved = compress_begin(&s);
+    chttpx_arena_t arena = {0};
+    char buf[512];
+
+    static unsigned char body[4096];
+    for (size_t i = 0; i < sizeof(body); i++)
+        body[i] = "{\"id\": 1, \"name\": \"x\"}, "[i % 25];
+
+    chttpx_request_t* req = cond_req("Accept-Encoding: gzip\r\n", buf, sizeof(buf), &arena);
+    chttpx_response_t res = {.status = cHTTPX_StatusOK, .content_type = cHTTPX_CTYPE_JSON, .body = body, .body_size = 4096};
+    _res_apply_conditional(req, &res, 1);
+    char etag[64];
+    snprintf(etag, sizeof(etag), "W/%s", cHTTPX_ResHeaderGet(&res, "ETag"));
+
+    _res_apply_compression(req, &res);
+    ASSERT_STREQ("gzip", cHTTPX_ResHeaderGet(&res, "Content-Encoding"));
+    ASSERT_STREQ("Accept-Encoding", cHTTPX_ResHeaderGet(&res, "Vary"));
+    ASSERT_STREQ(etag, cHTTPX_ResHeaderGet(&res, "ETag"));
+    ASSERT(res.body_size < 200);
+
+    static char out[8192];
+    ASSERT_EQ(4096, (long long)inflate_all(res.body, res.body_size, out, sizeof(out)));
+    ASSERT(memcmp(out, body, 4096) == 0);
+
+    /* The weak ETag still revalidates */
+    char headers[128];
+    snprintf(headers, sizeof(headers), "Accept-Encoding: gzip\r\nIf-None-Match: %s\r\n", etag);
+    req = cond_req(headers, buf, sizeof(buf), &arena);
+    res = (chttpx_response_t){.status = cHTTPX_StatusOK, .content_type = cHTTPX_CTYPE_JSON, .body = body, .body_size = 4096};
+    _res_apply_conditional(req, &res, 1);
+    _res_apply_compression(req, &res);
+    ASSERT_EQ(cHTTPX_StatusNotModified, res.status);
+    ASSERT_STREQ("Accept-Encoding", cHTTPX_ResHeaderGet(&res, "Vary"));
+
+    /* Too small, not compressible, or not accepted: untouched but for Vary */
+    req = cond_req("Accept-Encoding: gzip\r\n", buf, sizeof(buf), &arena);
+    res = (chttpx_response_t){.status = cHTTPX_StatusOK, .content_type = cHTTPX_CTYPE_JSON, .body = body, .body_size = 32};
+    cHTTPX_HeaderAdd(&res, "Vary", "Origin");
+    _res_apply_compression(req, &res);
+    ASSERT(cHTTPX_ResHeaderGet(&res, "Content-Encoding") == NULL);
+    ASSERT_STREQ("Origin, Accept-Encoding", cHTTPX_ResHeaderGet(&res, "Vary"));
+
+    res = (chttpx_response_t){.status = cHTTPX_StatusOK, .content_type = cHTTPX_CTYPE_PNG, .body = body, .body_size = 4096};
+    _res_apply_compression(req, &res);
+    ASSERT(cHTTPX_ResHeaderGet(&res, "Content-Encoding") == NULL);
+    ASSERT(cHTTPX_ResHeaderGet(&res, "Vary") == NULL);
+
+    req = cond_req("Accept-Encoding: gzip;q=0\r\n", buf, sizeof(buf), &arena);
+    res = (chttpx_response_t){.status = cHTTPX_StatusOK, .content_type = cHTTPX_CTYPE_JSON, .body = body, .body_size = 4096};
+    _res_apply_compression(req, &res);
+    ASSERT(res.body == body);
+
+    /* No room for Content-Encoding: sent uncompressed rather than unlabelled */
+    req = cond_req("Accept-Encoding: gzip\r\n", buf, sizeof(buf), &arena);
+    res = (chttpx_response_t){.status = cHTTPX_StatusOK, .content_type = cHTTPX_CTYPE_JSON, .body = body, .body_size = 4096};
+    while (cHTTPX_HeaderAdd(&res, "X-Fill", "1") == 0)
+        ;
+    size_t filled = res.headers_count;
+    _res_apply_compression(req, &res);
+    ASSERT(res.body == body);
+    ASSERT_EQ((long long)filled, (long long)res.headers_count);
+    ASSERT(cHTTPX_ResHeaderGet(&res, "Content-Encoding") == NULL);
+
+    chttpx_compress_stats_t stats;
+    cHTTPX_CompressStats(&stats);
+    ASSERT_EQ(1, (long long)stats.responses);
+    ASSERT_EQ(4096, (long long)stats.bytes_in);
+
+    _arena_free(&arena);
+    compress_end(saved);
+}
+
+TEST(test_res_compress_stream)
+{
+    chttpx_serv_t s;
+    chttpx_serv_t* saved = compress_begin(&s);
+    chttpx_arena_t arena = {0};
+    char buf[512];
+
+    stream_ctx_t ctx = {.left = 3};
+    chttpx_response_t res = cHTTPX_ResStream(cHTTPX_StatusOK, "text/plain", stream_pieces, &ctx, stream_ctx_free);
+    res.stream_chunked = false;
+
+    _res_apply_compression(cond_req("Accept-Encoding: deflate\r\n", buf, sizeof(buf), &arena), &res);
+    ASSERT_STREQ("deflate", cHTTPX_ResHeaderGet(&res, "Content-Encoding"));
+
+    char raw[512], out[512];
+    size_t len = stream_drain(&res, raw, sizeof(raw));
+    ASSERT_EQ(21, (long long)inflate_all(raw, len, out, sizeof(out)));
+    ASSERT_STREQ("piece 3piece 2piece 1", out);
+
+    /* The producer's context goes with the compressor */
+    _res_release(&res);
+    ASSERT_EQ(1, ctx.freed);
+
+    _arena_free(&arena);
+    compress_end(saved);
+}
+
+TEST(test_res_compress_file_cache)
+{
+    chttpx_serv_t s;
+    chttpx_serv_t* saved = compress_begin(&s);
+    chttpx_arena_t arena = {0};
+    char buf[512];
+
+    char path[] = "/tmp/chttpx_compress_XXXXXX";
+    int tmp = mkstemp(path);
+    ASSERT(tmp >= 0);
+
+    static char text[20000];
+    for (size_t i = 0; i < sizeof(text); i++)
+        text[i] = 'a' + (char)(i % 7);
+    ASSERT_EQ((long long)sizeof(text), write(tmp, text, sizeof(text)));
+    close(tmp);
+
+    static char out[32768];
+    for (int round = 0; round < 2; round++)
+    {
+        chttpx_request_t* req = cond_req("Accept-Encoding: gzip\r\n", buf, sizeof(buf), &arena);
+        chttpx_response_t res = cHTTPX_ResFile(cHTTPX_StatusOK, cHTTPX_CTYPE_TEXT, path);
+        _res_apply_compression(req, &res);
+
+        ASSERT(res.file);
+        ASSERT_STREQ("gzip", cHTTPX_ResHeaderGet(&res, "Content-Encoding"));
+        ASSERT(res.body_size < 1000);
+
+        char packed[1000];
+        ASSERT_EQ((long long)res.body_size, pread(res.file_fd, packed, res.body_size, 0));
+        ASSERT_EQ((long long)sizeof(text), (long long)inflate_all(packed, res.body_size, out, sizeof(out)));
+        ASSERT(memcmp(out, text, sizeof(text)) == 0);
+
+        _res_release(&res);
+    }
+
+    /* Compressed once, then served from the cache */
+    chttpx_compress_stats_t stats;
+    cHTTPX_CompressStats(&stats);
+    ASSERT_EQ(1, (long long)stats.cache_misses);
+    ASSERT_EQ(1, (long long)stats.cache_hits);
+    ASSERT_EQ(1, (long long)stats.cache_entries);
+
+    /* Ranges are answered from the file as it is */
+    chttpx_request_t* req = cond_req("Accept-Encoding: gzip\r\nRange: bytes=0-9\r\n", buf, sizeof(buf), &arena);
+    chttpx_response_t res = cHTTPX_ResFile(cHTTPX_StatusOK, cHTTPX_CTYPE_TEXT, path);
+    _res_apply_range(req, &res);
+    _res_apply_compression(req, &res);
+    ASSERT_EQ(cHTTPX_StatusPartialContent, res.status);
+    ASSERT(cHTTPX_ResHeaderGet(&res, "Content-Encoding") == NULL);
+    _res_release(&res);
+
+    /* Revalidating the compressed copy keeps its weak validator */
+    res = cHTTPX_ResFile(cHTTPX_StatusOK, cHTTPX_CTYPE_TEXT, path);
+    _res_apply_conditional(cond_req("", buf, sizeof(buf), &arena), &res, 1);
+    char headers[256];
+    snprintf(headers, sizeof(headers), "Accept-Encoding: gzip\r\nIf-None-Match: W/%s\r\n", cHTTPX_ResHeaderGet(&res, "ETag"));
+    _res_release(&res);
+
+    req = cond_req(headers, buf, sizeof(buf), &arena);
+    res = cHTTPX_ResFile(cHTTPX_StatusOK, cHTTPX_CTYPE_TEXT, path);
+    _res_apply_conditional(req, &res, 1);
+    _res_apply_compression(req, &res);
+    ASSERT_EQ(cHTTPX_StatusNotModified, res.status);
+    ASSERT(strncmp(cHTTPX_ResHeaderGet(&res, "ETag"), "W/\"", 3) == 0);
+    ASSERT_STREQ("Accept-Encoding", cHTTPX_ResHeaderGet(&res, "Vary"));
+
+    unlink(path);
+    _arena_free(&arena);
+    compress_end(saved);
+}
+#endif
+
+TEST(test_res_file_missing)
+{
+    chttpx_response_t res = cHTTPX_ResFile(cHTTPX_StatusOK, "text/plain", "/nonexistent/chttpx/file");
+
+    ASSERT_EQ(cHTTPX_StatusNotFound, res.status);
+    ASSERT(!res.file);
+    free((void*)res.body);
+}
+
 void run_response_tests(void)
 {
     printf("response\n");
     RUN_TEST(test_res_json_body);
     RUN_TEST(test_res_html_body);
     RUN_TEST(test_res_json_not_found);
+    RUN_TEST(test_res_json_large_body);
+    RUN_TEST(test_res_headers_survive_copy);
+    RUN_TEST(test_res_headers_spill_into_arena);
+    RUN_TEST(test_res_file_missing);
+    RUN_TEST(test_res_http_date);
+    RUN_TEST(test_res_if_none_match);
+    RUN_TEST(test_res_if_modified_since);
+    RUN_TEST(test_res_etag_hash);
+    RUN_TEST(test_hash64_impls_agree);
+#ifndef _WIN32
+    RUN_TEST(test_send_parts_resumes_short_writes);
+    RUN_TEST(test_res_stream_chunks);
+    RUN_TEST(test_res_json_stream);
+    RUN_TEST(test_res_file_is_sent_from_fd);
+    RUN_TEST(test_res_file_single_range);
+    RUN_TEST(test_res_file_multi_range);
+    RUN_TEST(test_res_file_range_fallbacks);
+#endif
+#ifdef __linux__
+    RUN_TEST(test_compress_accepts);
+    RUN_TEST(test_res_compress_body);
+    RUN_TEST(test_res_compress_stream);
+    RUN_TEST(test_res_compress_file_cache);
+#endif
 }
@@ -0,0 +1,90 @@
+#include "test_framework.h"
+
+#include "libchttpx.h"
+
+TEST(test_router_static_and_params)
+{
+    chttpx_route_node_t* root = NULL;
+    chttpx_param_t params[MAX_PARAMS] = {0};
+    int count = -1;
+
+    ASSERT_EQ(0, _router_insert(&root, "GET", "/users", 0));
+    ASSERT_EQ(0, _router_insert(&root, "GET", "/users/{id}", 1));
+    ASSERT_EQ(0, _router_insert(&root, "GET", "/users/{id}/posts/{post_id}", 2));
+    ASSERT_EQ(0, _router_insert(&root, "POST", "/users", 3));
+    ASSERT_EQ(0, _router_insert(&root, "GET", "/uploads", 4));
+
+    ASSERT_EQ(0, _router_find(root, "GET", "/users", params, &count));
+    ASSERT_EQ(0, count);
+    ASSERT_EQ(3, _router_find(root, "POST", "/users", params, &count));
+    ASSERT_EQ(4, _router_find(root, "GET", "/uploads", params, &count));
+
+    ASSERT_EQ(2, _router_find(root, "GET", "/users/42/posts/7", params, &count));
+    ASSERT_EQ(2, count);
+    ASSERT_VIEWEQ("id", params[0].name, params[0].name_len);
+    ASSERT_VIEWEQ("42", params[0].value, params[0].value_len);
+    ASSERT_VIEWEQ("post_id", params[1].name, params[1].name_len);
+    ASSERT_VIEWEQ("7", params[1].value, params[1].value_len);
+
+    ASSERT_EQ(-1, _router_find(root, "DELETE", "/users", params, &count));
+    ASSERT_EQ(-1, _router_find(root, "GET", "/users/", params, &count));
+    ASSERT_EQ(-1, _router_find(root, "GET", "/users/42/posts", params, &count));
+
+    _router_free(root);
+}
+
+TEST(test_router_static_over_param_with_backtracking)
+{
+    chttpx_route_node_t* root = NULL;
+    chttpx_param_t params[MAX_PARAMS] = {0};
+    int count = 0;
+
+    ASSERT_EQ(0, _router_insert(&root, "GET", "/files/{name}/raw", 0));
+    ASSERT_EQ(0, _router_insert(&root, "GET", "/files/latest", 1));
+
+    ASSERT_EQ(1, _router_find(root, "GET", "/files/latest", params, &count));
+    ASSERT_EQ(0, count);
+
+    /* "latest" matches the static node, then falls back to {name} */
+    ASSERT_EQ(0, _router_find(root, "GET", "/files/latest/raw", params, &count));
+    ASSERT_EQ(1, count);
+    ASSERT_VIEWEQ("latest", params[0].value, params[0].value_len);
+
+    /* Duplicates keep the first registration */
+    ASSERT_EQ(1, _router_insert(&root, "GET", "/files/latest", 2));
+    ASSERT_EQ(1, _router_find(root, "GET", "/files/latest", params, &count));
+
+    _router_free(root);
+}
+
+TEST(test_router_precedence_and_empty_segments)
+{
+    chttpx_route_node_t* root = NULL;
+    chttpx_param_t params[MAX_PARAMS] = {0};
+    int count = 0;
+
+    /* The static route wins over an overlapping {param} registered before it */
+    ASSERT_EQ(0, _router_insert(&root, "GET", "/users/{id}", 0));
+    ASSERT_EQ(0, _router_insert(&root, "GET", "/users/me", 1));
+    ASSERT_EQ(0, _router_insert(&root, "GET", "/a/{x}/b", 2));
+
+    ASSERT_EQ(1, _router_find(root, "GET", "/users/me", params, &count));
+    ASSERT_EQ(0, count);
+    ASSERT_EQ(0, _router_find(root, "GET", "/users/mee", params, &count));
+    ASSERT_VIEWEQ("mee", params[0].value, params[0].value_len);
+
+    /* An empty segment matches no {param} */
+    ASSERT_EQ(-1, _router_find(root, "GET", "/users/", params, &count));
+    ASSERT_EQ(-1, _router_find(root, "GET", "/a//b", params, &count));
+    ASSERT_EQ(2, _router_find(root, "GET", "/a/1/b", params, &count));
+
+    _router_free(root);
+}
+
+void run_router_tests(void)
+{
+    printf("router\n");
+    RUN_TEST(test_router_static_and_params);
+    RUN_TEST(test_router_static_over_param_with_backtracking);
+    RUN_TEST(test_router_precedence_and_empty_segments);
+}
@@ -3,16 +3,28 @@
 int g_tests_run = 0;
 int g_tests_failed = 0;
 
+void run_json_tests(void);
+void run_multipart_tests(void);
 void run_params_tests(void);
+void run_request_tests(void);
 void run_response_tests(void);
+void run_router_tests(void);
 void run_server_tests(void);
+void run_static_tests(void);
+void run_sse_tests(void);
 void run_websocket_tests(void);
 
 int main(void)
 {
+    run_json_tests();
+    run_multipart_tests();
     run_params_tests();
+    run_request_tests();
     run_response_tests();
+    run_router_tests();
     run_server_tests();
+    run_static_tests();
+    run_sse_tests();
     run_websocket_tests();
 
     printf("\n%d tests, %d failed\n", g_tests_run, g_tests_failed);
@@ -2,14 +2,61 @@
 
 #include "libchttpx.h"
 
+#include <stdlib.h>
 #include <string.h>
 
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#endif
+
 static void ping_handler(chttpx_request_t* req, chttpx_response_t* res)
 {
     (void)req;
     *res = cHTTPX_ResJson(cHTTPX_StatusOK, "{\"pong\":true}");
 }
 
+/* Streams 40000 bytes of 'x', more than one chunk */
+static long stream_x(void* ctx, char* buf, size_t size)
+{
+    size_t* left = ctx;
+    size_t n = *left < size ? *left : size;
+
+    memset(buf, 'x', n);
+    *left -= n;
+    return (long)n;
+}
+
+/* Counts the body as it is read, echoing its last byte */
+static void upload_handler(chttpx_request_t* req, chttpx_response_t* res)
+{
+    char buf[1000];
+    size_t total = 0;
+    char last = '-';
+    long n;
+
+    while ((n = cHTTPX_BodyRead(req, buf, sizeof(buf))) > 0)
+    {
+        total += (size_t)n;
+        last = buf[n - 1];
+    }
+
+    *res = cHTTPX_ResJson(cHTTPX_StatusOK, "{\"len\":%zu,\"last\":\"%c\",\"file\":%d}", total, last, req->filename[0] != 0);
+}
+
+static void stream_handler(chttpx_request_t* req, chttpx_response_t* res)
+{
+    size_t* left = cHTTPX_Alloc(req, sizeof(size_t));
+    *left = 40000;
+    *res = cHTTPX_ResStream(cHTTPX_StatusOK, "text/plain", stream_x, left, NULL);
+}
+
 TEST(test_init_and_shutdown)
 {
     chttpx_serv_t serv = {0};
@@ -55,10 +102,419 @@ TEST(test_middleware_registration)
     cHTTPX_Shutdown();
 }
 
+TEST(test_init_epoll_mode)
+{
+    chttpx_serv_t serv = {.mode = CHTTPX_MODE_EPOLL, .loop_threads = 2};
+
+    ASSERT_EQ(0, cHTTPX_Init(&serv, 18085, NULL));
+#ifdef CHTTPX_PLATFORM_LINUX
+    ASSERT_EQ(CHTTPX_MODE_EPOLL, serv.mode);
+#else
+    ASSERT_EQ(CHTTPX_MODE_THREADS, serv.mode);
+#endif
+    ASSERT_EQ(2, (long long)serv.loop_threads);
+
+    cHTTPX_Shutdown();
+}
+
+TEST(test_reuseport_listeners)
+{
+    chttpx_serv_t serv = {.reuseport = 1, .backlog = 64};
+
+    ASSERT_EQ(0, cHTTPX_Init(&serv, 18088, NULL));
+    ASSERT_EQ(64, serv.backlog);
+
+#ifdef SO_REUSEPORT
+    /* A second listener on the same port */
+    chttpx_socket_t fd = _serv_listen_socket();
+    ASSERT(fd != CHTTPX_INVALID_SOCKET);
+    chttpx_close(fd);
+#else
+    ASSERT_EQ(0, serv.reuseport);
+#endif
+
+    cHTTPX_Shutdown();
+}
+
+TEST(test_admission_limits_clients)
+{
+    chttpx_serv_t serv = {0};
+    size_t max_clients = 2;
+
+    ASSERT_EQ(0, cHTTPX_Init(&serv, 18087, &max_clients));
+
+    ASSERT_EQ(1, _admission_try_acquire());
+    ASSERT_EQ(1, _admission_try_acquire());
+    ASSERT_EQ(0, _admission_try_acquire());
+    ASSERT_EQ(2, (long long)serv.current_clients);
+
+    _admission_release();
+    ASSERT_EQ(1, _admission_try_acquire());
+
+    _admission_release();
+    _admission_release();
+
+    chttpx_admission_stats_t stats;
+    cHTTPX_AdmissionStats(&stats);
+    ASSERT_EQ(0, (long long)stats.current);
+    ASSERT_EQ(2, (long long)stats.max);
+
+    cHTTPX_Shutdown();
+}
+
+#ifndef _WIN32
+TEST(test_admission_reject_sends_503)
+{
+    int sv[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+    _admission_reject(sv[1]);
+
+    char resp[512];
+    ssize_t n = read(sv[0], resp, sizeof(resp) - 1);
+    close(sv[0]);
+
+    ASSERT(n > 0);
+    resp[n] = '\0';
+    ASSERT(strstr(resp, "HTTP/1.1 503") == resp);
+    ASSERT(strstr(resp, "Connection: close\r\n") != NULL);
+}
+
+TEST(test_worker_pool_serves_connection)
+{
+    chttpx_serv_t serv = {0};
+
+    ASSERT_EQ(0, cHTTPX_Init(&serv, 18086, NULL));
+
+    chttpx_router_t r = cHTTPX_RoutePathPrefix("");
+    cHTTPX_RegisterRoute(&r, "GET", "/ping", ping_handler);
+
+    ASSERT_EQ(0, _workers_start(1, 2));
+
+    int sv[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+    /* Two pipelined REQuests on one keep-alive connection */
+    const char* req = "GET /ping HTTP/1.1\r\nHost: test\r\n\r\n"
+                      "GET /missing HTTP/1.1\r\nHost: test\r\nConnection: close\r\n\r\n";
+    ASSERT_EQ((long long)strlen(req), write(sv[0], req, strlen(req)));
+
+    ASSERT_EQ(1, _admission_try_acquire());
+    ASSERT_EQ(0, _workers_submit(sv[1], NULL, 0));
+
+    char resp[1024];
+    size_t total = 0;
+    ssize_t n;
+    while (total < sizeof(resp) - 1 && (n = read(sv[0], resp + total, sizeof(resp) - 1 - total)) > 0)
+        total += (size_t)n;
+    resp[total] = '\0';
+    close(sv[0]);
+
+    ASSERT(strstr(resp, "HTTP/1.1 200") == resp);
+    ASSERT(strstr(resp, "Connection: keep-alive\r\n") != NULL);
+
+    const char* second = strstr(resp, "{\"pong\":true}");
+    ASSERT(second != NULL);
+    ASSERT(strstr(second, "HTTP/1.1 404") != NULL);
+    ASSERT(strstr(second, "Connection: close\r\n") != NULL);
+
+    chttpx_workers_stats_t stats;
+    cHTTPX_WorkersStats(&stats);
+    ASSERT_EQ(1, (long long)stats.threads);
+    ASSERT_EQ(2, (long long)stats.queue_capacity);
+    ASSERT_EQ(1, (long long)stats.submitted);
+
+    _workers_stop();
+    cHTTPX_WorkersStats(&stats);
+    ASSERT_EQ(0, (long long)stats.threads);
+    ASSERT_EQ(0, (long long)serv.current_clients);
+
+    cHTTPX_Shutdown();
+}
+
+TEST(test_stream_response_is_chunked)
+{
+    chttpx_serv_t serv = {0};
+
+    ASSERT_EQ(0, cHTTPX_Init(&serv, 18089, NULL));
+
+    chttpx_router_t r = cHTTPX_RoutePathPrefix("");
+    cHTTPX_RegisterRoute(&r, "GET", "/stream", stream_handler);
+    cHTTPX_RegisterRoute(&r, "GET", "/ping", ping_handler);
+
+    ASSERT_EQ(0, _workers_start(1, 2));
+
+    int sv[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+    /* The connection stays usable after the last chunk */
+    const char* req = "GET /stream HTTP/1.1\r\nHost: test\r\n\r\n"
+                      "GET /ping HTTP/1.1\r\nHost: test\r\nConnection: close\r\n\r\n";
+    ASSERT_EQ((long long)strlen(req), write(sv[0], req, strlen(req)));
+
+    ASSERT_EQ(1, _admission_try_acquire());
+    ASSERT_EQ(0, _workers_submit(sv[1], NULL, 0));
+
+    static char resp[65536];
+    size_t total = 0;
+    ssize_t n;
+    while (total < sizeof(resp) - 1 && (n = read(sv[0], resp + total, sizeof(resp) - 1 - total)) > 0)
+        total += (size_t)n;
+    resp[total] = '\0';
+    close(sv[0]);
+
+    ASSERT(strstr(resp, "HTTP/1.1 200") == resp);
+    ASSERT(strstr(resp, "Transfer-Encoding: chunked\r\n") != NULL);
+
+    /* Decode the chunks */
+    const char* p = strstr(resp, "\r\n\r\n") + 4;
+    size_t body = 0;
+    for (;;)
+    {
+        char* end;
+        size_t len = strtoul(p, &end, 16);
+        ASSERT(strncmp(end, "\r\n", 2) == 0);
+        p = end + 2;
+        if (len == 0)
+            break;
+
+        ASSERT(len <= CHTTPX_STREAM_CHUNK);
+        ASSERT(p[0] == 'x' && p[len - 1] == 'x');
+        ASSERT(strncmp(p + len, "\r\n", 2) == 0);
+        body += len;
+        p += len + 2;
+    }
+    ASSERT_EQ(40000, (long long)body);
+    ASSERT(strncmp(p, "\r\nHTTP/1.1 200", 14) == 0);
+    ASSERT(strstr(p, "{\"pong\":true}") != NULL);
+
+    _workers_stop();
+    cHTTPX_Shutdown();
+}
+
+TEST(test_body_read_streams_chunks)
+{
+    chttpx_serv_t serv = {0};
+
+    ASSERT_EQ(0, cHTTPX_Init(&serv, 18090, NULL));
+
+    chttpx_router_t r = cHTTPX_RoutePathPrefix("");
+    cHTTPX_RegisterRoute(&r, "POST", "/upload", upload_handler);
+    ASSERT_EQ(0, cHTTPX_RouteBodyStream(&r, "POST", "/upload", true));
+    ASSERT_EQ(-1, cHTTPX_RouteBodyStream(&r, "POST", "/missing", true));
+
+    ASSERT_EQ(0, _workers_start(1, 2));
+
+    int sv[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+    /* A chunked upload larger than the receive buffer, then a Content-Length one on the same connection */
+    static char big[40000];
+    memset(big, 'b', sizeof(big));
+    big[sizeof(big) - 1] = 'z';
+
+    const char* head = "POST /upload HTTP/1.1\r\nHost: test\r\nContent-Type: application/octet-stream\r\n"
+                       "Transfer-Encoding: chunked\r\n\r\n";
+    ASSERT_EQ((long long)strlen(head), write(sv[0], head, strlen(head)));
+
+    ASSERT_EQ(1, _admission_try_acquire());
+    ASSERT_EQ(0, _workers_submit(sv[1], NULL, 0));
+
+    char line[32];
+    snprintf(line, sizeof(line), "%zx\r\n", sizeof(big));
+    ASSERT_EQ((long long)strlen(line), write(sv[0], line, strlen(line)));
+    ASSERT_EQ((long long)sizeof(big), write(sv[0], big, sizeof(big)));
+
+    const char* rest = "\r\n3\r\nxyz\r\n0\r\n\r\n"
+                       "POST /upload HTTP/1.1\r\nHost: test\r\nContent-Length: 2\r\nConnection: close\r\n\r\nok";
+    ASSERT_EQ((long long)strlen(rest), write(sv[0], rest, strlen(rest)));
+
+    char resp[2048];
+    size_t total = 0;
+    ssize_t n;
+    while (total < sizeof(resp) - 1 && (n = read(sv[0], resp + total, sizeof(resp) - 1 - total)) > 0)
+        total += (size_t)n;
+    resp[total] = '\0';
+    close(sv[0]);
+
+    /* Nothing spooled to a temp file, the handler saw every byte */
+    const char* first = strstr(resp, "{\"len\":40003,\"last\":\"z\",\"file\":0}");
+    ASSERT(first != NULL);
+    ASSERT(strstr(resp, "Connection: keep-alive\r\n") != NULL);
+    ASSERT(strstr(first, "{\"len\":2,\"last\":\"k\",\"file\":0}") != NULL);
+
+    _workers_stop();
+    cHTTPX_Shutdown();
+}
+
+TEST(test_unframed_request_gets_400)
+{
+    chttpx_serv_t serv = {0};
+
+    ASSERT_EQ(0, cHTTPX_Init(&serv, 18094, NULL));
+
+    chttpx_router_t r = cHTTPX_RoutePathPrefix("");
+    cHTTPX_RegisterRoute(&r, "POST", "/upload", upload_handler);
+
+    ASSERT_EQ(0, _workers_start(1, 2));
+
+    int sv[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+    /* Read as a 5 byte body by a proxy that ignores the name, as no body by one that does not */
+    const char* req = "POST /upload HTTP/1.1\r\nHost: test\r\nContent-Length : 5\r\n\r\n"
+                      "GET /ping HTTP/1.1\r\n\r\n";
+    ASSERT_EQ((long long)strlen(req), write(sv[0], req, strlen(req)));
+
+    ASSERT_EQ(1, _admission_try_acquire());
+    ASSERT_EQ(0, _workers_submit(sv[1], NULL, 0));
+
+    char resp[1024];
+    size_t total = 0;
+    ssize_t n;
+    while (total < sizeof(resp) - 1 && (n = read(sv[0], resp + total, sizeof(resp) - 1 - total)) > 0)
+        total += (size_t)n;
+    resp[total] = '\0';
+    close(sv[0]);
+
+    ASSERT(strstr(resp, "HTTP/1.1 400") == resp);
+    ASSERT(strstr(resp, "Connection: close\r\n") != NULL);
+    ASSERT(strstr(resp + 1, "HTTP/1.1") == NULL);
+
+    _workers_stop();
+    cHTTPX_Shutdown();
+}
+
+TEST(test_head_then_get_keep_alive)
+{
+    chttpx_serv_t serv = {0};
+
+    ASSERT_EQ(0, cHTTPX_Init(&serv, 18095, NULL));
+
+    chttpx_router_t r = cHTTPX_RoutePathPrefix("");
+    cHTTPX_RegisterRoute(&r, "GET", "/ping", ping_handler);
+    cHTTPX_RegisterRoute(&r, "HEAD", "/ping", ping_handler);
+
+    ASSERT_EQ(0, _workers_start(1, 2));
+
+    int sv[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+    /* A body after a HEAD head would be read as the next response */
+    const char* req = "HEAD /ping HTTP/1.1\r\nHost: test\r\n\r\n"
+                      "HEAD /missing HTTP/1.1\r\nHost: test\r\n\r\n"
+                      "GET /ping HTTP/1.1\r\nHost: test\r\nConnection: close\r\n\r\n";
+    ASSERT_EQ((long long)strlen(req), write(sv[0], req, strlen(req)));
+
+    ASSERT_EQ(1, _admission_try_acquire());
+    ASSERT_EQ(0, _workers_submit(sv[1], NULL, 0));
+
+    char resp[2048];
+    size_t total = 0;
+    ssize_t n;
+    while (total < sizeof(resp) - 1 && (n = read(sv[0], resp + total, sizeof(resp) - 1 - total)) > 0)
+        total += (size_t)n;
+    resp[total] = '\0';
+    close(sv[0]);
+
+    ASSERT(strstr(resp, "HTTP/1.1 200") == resp);
+    ASSERT(strstr(resp, "Content-Length: 13\r\n") != NULL);
+
+    const char* second = strstr(resp, "\r\n\r\n") + 4;
+    ASSERT(strncmp(second, "HTTP/1.1 404", 12) == 0);
+
+    const char* third = strstr(second, "\r\n\r\n") + 4;
+    ASSERT(strncmp(third, "HTTP/1.1 200", 12) == 0);
+    ASSERT(strstr(third, "\r\n\r\n{\"pong\":true}") != NULL);
+
+    _workers_stop();
+    cHTTPX_Shutdown();
+}
+
+#ifdef __linux__
+static void* listen_thread(void* arg)
+{
+    (void)arg;
+    cHTTPX_Listen();
+    return NULL;
+}
+
+TEST(test_eventloop_pipelined_large_then_chunked)
+{
+    chttpx_serv_t serv = {.mode = CHTTPX_MODE_EPOLL, .loop_threads = 1};
+
+    ASSERT_EQ(0, cHTTPX_Init(&serv, 18093, NULL));
+
+    chttpx_router_t r = cHTTPX_RoutePathPrefix("");
+    cHTTPX_RegisterRoute(&r, "POST", "/upload", upload_handler);
+    ASSERT_EQ(0, cHTTPX_RouteBodyStream(&r, "POST", "/upload", true));
+
+    pthread_t thread_id;
+    ASSERT_EQ(0, pthread_create(&thread_id, NULL, listen_thread, NULL));
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT(fd >= 0);
+
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(18093)};
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(0, connect(fd, (struct sockaddr*)&addr, sizeof(addr)));
+
+    /* A body larger than the receive buffer grows it, the chunked REQuest behind it is handed off */
+    static char req[24000];
+    int head = snprintf(req, sizeof(req),
+                        "POST /upload HTTP/1.1\r\nHost: test\r\nContent-Type: application/octet-stream\r\n"
+                        "Content-Length: 20000\r\n\r\n");
+    memset(req + head, 'a', 20000);
+    req[head + 19999] = 'y';
+
+    size_t len = (size_t)head + 20000;
+    len += (size_t)snprintf(req + len, sizeof(req) - len,
+                            "POST /upload HTTP/1.1\r\nHost: test\r\nContent-Type: application/octet-stream\r\n"
+                            "Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n3\r\nxyz\r\n0\r\n\r\n");
+    ASSERT_EQ((long long)len, write(fd, req, len));
+
+    char resp[2048];
+    size_t total = 0;
+    ssize_t n;
+    while (total < sizeof(resp) - 1 && (n = read(fd, resp + total, sizeof(resp) - 1 - total)) > 0)
+        total += (size_t)n;
+    resp[total] = '\0';
+    close(fd);
+
+    const char* first = strstr(resp, "{\"len\":20000,\"last\":\"y\",\"file\":0}");
+    ASSERT(first != NULL);
+    ASSERT(strstr(first, "{\"len\":3,\"last\":\"z\",\"file\":0}") != NULL);
+
+    /* The handoff thread releases its slot once the connection is closed */
+    for (int i = 0; i < 100 && serv.current_clients > 0; i++)
+        usleep(10000);
+    ASSERT_EQ(0, (long long)serv.current_clients);
+
+    /* The loop stops at its next tick */
+    cHTTPX_Shutdown();
+    pthread_join(thread_id, NULL);
+}
+#endif
+#endif
+
 void run_server_tests(void)
 {
     printf("server\n");
     RUN_TEST(test_init_and_shutdown);
     RUN_TEST(test_register_http_routes);
     RUN_TEST(test_middleware_registration);
+    RUN_TEST(test_init_epoll_mode);
+    RUN_TEST(test_reuseport_listeners);
+    RUN_TEST(test_admission_limits_clients);
+#ifndef _WIN32
+    RUN_TEST(test_admission_reject_sends_503);
+    RUN_TEST(test_worker_pool_serves_connection);
+    RUN_TEST(test_stream_response_is_chunked);
+    RUN_TEST(test_body_read_streams_chunks);
+    RUN_TEST(test_unframed_request_gets_400);
+    RUN_TEST(test_head_then_get_keep_alive);
+#endif
+#ifdef __linux__
+    RUN_TEST(test_eventloop_pipelined_large_then_chunked);
+#endif
 }
@@ -0,0 +1,168 @@
+#include "test_framework.h"
+
+#include "libchttpx.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static void events_handler(chttpx_request_t* req, chttpx_response_t* res)
+{
+    (void)req;
+    *res = cHTTPX_ResSSE("news");
+}
+
+/* Read from fd until buf contains want, giving up after timeout_ms */
+static size_t read_until(int fd, char* buf, size_t size, size_t len, const char* want, int timeout_ms)
+{
+    buf[len] = '\0';
+    while (!strstr(buf, want) && len < size - 1)
+    {
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        if (poll(&pfd, 1, timeout_ms) <= 0)
+            break;
+
+        ssize_t n = read(fd, buf + len, size - 1 - len);
+        if (n <= 0)
+            break;
+
+        len += (size_t)n;
+        buf[len] = '\0';
+    }
+
+    return len;
+}
+
+/* Subscribe over a socketpair served by the worker pool */
+static int subscribe(const char* req)
+{
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+        return -1;
+
+    if (write(sv[0], req, strlen(req)) != (ssize_t)strlen(req) || _admission_try_acquire() != 1 ||
+        _workers_submit(sv[1], NULL, 0) != 0)
+    {
+        close(sv[0]);
+        close(sv[1]);
+        return -1;
+    }
+
+    return sv[0];
+}
+
+TEST(test_sse_publish_and_replay)
+{
+    chttpx_serv_t serv = {0};
+
+    ASSERT_EQ(0, cHTTPX_Init(&serv, 18091, NULL));
+
+    chttpx_router_t r = cHTTPX_RoutePathPrefix("");
+    cHTTPX_RegisterRoute(&r, "GET", "/events", events_handler);
+
+    ASSERT_EQ(0, _workers_start(1, 2));
+
+    ASSERT_EQ(1, (long long)cHTTPX_SSEPublish("news", NULL, "one"));
+    ASSERT_EQ(2, (long long)cHTTPX_SSEPublish("news", NULL, "two"));
+    ASSERT_EQ(3, (long long)cHTTPX_SSEPublish("news", "update", "three\nlines\r\nhere"));
+    ASSERT_EQ(0, (long long)cHTTPX_SSEPublish("news", "bad\nname", "x"));
+
+    /* Replays what came after event 1 */
+    int fd = subscribe("GET /events HTTP/1.1\r\nHost: test\r\nLast-Event-ID: 1\r\n\r\n");
+    ASSERT(fd >= 0);
+
+    static char buf[8192];
+    size_t len = read_until(fd, buf, sizeof(buf), 0, "here\n\n", 2000);
+
+    ASSERT(strstr(buf, "HTTP/1.1 200") == buf);
+    ASSERT(strstr(buf, "Content-Type: text/event-stream\r\n") != NULL);
+    ASSERT(strstr(buf, "Cache-Control: no-cache\r\n") != NULL);
+    ASSERT(strstr(buf, "Content-Length") == NULL);
+
+    const char* body = strstr(buf, "\r\n\r\n") + 4;
+    ASSERT_STREQ("id: 2\ndata: two\n\n"
+                 "id: 3\nevent: update\ndata: three\ndata: lines\ndata: here\n\n",
+                 body);
+
+    /* Live events follow, serialized once for every subscriber */
+    int fd2 = subscribe("GET /events HTTP/1.1\r\nHost: test\r\n\r\n");
+    ASSERT(fd2 >= 0);
+
+    static char buf2[8192];
+    size_t len2 = read_until(fd2, buf2, sizeof(buf2), 0, "\r\n\r\n", 2000);
+    ASSERT(strstr(buf2, "\r\n\r\n") != NULL);
+
+    chttpx_sse_stats_t stats;
+    cHTTPX_SSEStats(&stats);
+    ASSERT_EQ(1, (long long)stats.topics);
+    ASSERT_EQ(2, (long long)stats.subscribers);
+    ASSERT_EQ(3, (long long)stats.published);
+
+    ASSERT_EQ(4, (long long)cHTTPX_SSEPublish("news", NULL, "four"));
+
+    len = read_until(fd, buf, sizeof(buf), len, "four\n\n", 2000);
+    ASSERT(strstr(buf, "id: 4\ndata: four\n\n") != NULL);
+
+    len2 = read_until(fd2, buf2, sizeof(buf2), len2, "four\n\n", 2000);
+    ASSERT_STREQ("id: 4\ndata: four\n\n", strstr(buf2, "\r\n\r\n") + 4);
+
+    /* A closed client leaves the topic */
+    close(fd);
+    for (int i = 0; i < 200 && stats.subscribers != 1; i++)
+    {
+        usleep(10000);
+        cHTTPX_SSEStats(&stats);
+    }
+    ASSERT_EQ(1, (long long)stats.subscribers);
+
+    close(fd2);
+    _workers_stop();
+    cHTTPX_Shutdown();
+
+    cHTTPX_SSEStats(&stats);
+    ASSERT_EQ(0, (long long)stats.topics);
+}
+
+TEST(test_sse_heartbeat)
+{
+    chttpx_serv_t serv = {0};
+
+    ASSERT_EQ(0, cHTTPX_Init(&serv, 18092, NULL));
+
+    chttpx_router_t r = cHTTPX_RoutePathPrefix("");
+    cHTTPX_RegisterRoute(&r, "GET", "/events", events_handler);
+
+    ASSERT_EQ(0, _workers_start(1, 2));
+    cHTTPX_SSEHeartbeat(1);
+
+    int fd = subscribe("GET /events HTTP/1.1\r\nHost: test\r\n\r\n");
+    ASSERT(fd >= 0);
+
+    static char buf[4096];
+    read_until(fd, buf, sizeof(buf), 0, "\r\n\r\n:\n\n", 4000);
+    ASSERT(strstr(buf, "\r\n\r\n:\n\n") != NULL);
+
+    chttpx_sse_stats_t stats;
+    cHTTPX_SSEStats(&stats);
+    ASSERT(stats.heartbeats >= 1);
+
+    close(fd);
+    cHTTPX_SSEHeartbeat(CHTTPX_SSE_HEARTBEAT_SEC);
+    _workers_stop();
+    cHTTPX_Shutdown();
+}
+#endif
+
+void run_sse_tests(void)
+{
+    printf("sse\n");
+#ifdef __linux__
+    RUN_TEST(test_sse_publish_and_replay);
+    RUN_TEST(test_sse_heartbeat);
+#endif
+}
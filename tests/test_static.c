@@ -0,0 +1,266 @@
+#include "test_framework.h"
+
+#include "libchttpx.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+
+static void write_file(const char* path, const char* data)
+{
+    FILE* f = fopen(path, "wb");
+    if (f)
+    {
+        fputs(data, f);
+        fclose(f);
+    }
+}
+
+/* Run a GET with extra headers through the static mounts, -1 if none matches */
+static long static_request(const char* path, const char* headers, chttpx_arena_t* arena, chttpx_response_t* res)
+{
+    char buf[512];
+    int n = snprintf(buf, sizeof(buf), "GET %s HTTP/1.1\r\nHost: localhost\r\n%s\r\n", path, headers);
+
+    chttpx_request_t* req = _parse_req_buffer(CHTTPX_INVALID_SOCKET, buf, (size_t)n, arena);
+    if (!req)
+        return -1;
+
+    long mount = _static_find(req);
+    if (mount >= 0)
+        _static_serve(mount, req, res);
+
+    return mount;
+}
+
+static long static_get(const char* path, chttpx_arena_t* arena, chttpx_response_t* res)
+{
+    return static_request(path, "", arena, res);
+}
+
+TEST(test_static_serves_and_caches)
+{
+    char dir[] = "/tmp/chttpx_static_XXXXXX";
+    ASSERT(mkdtemp(dir) != NULL);
+
+    char app[128], index[128];
+    snprintf(app, sizeof(app), "%s/app.js", dir);
+    snprintf(index, sizeof(index), "%s/index.html", dir);
+    write_file(app, "console.log(1);");
+    write_file(index, "<h1>home</h1>");
+
+    ASSERT_EQ(0, cHTTPX_Static("/assets/", dir));
+
+    chttpx_arena_t arena = {0};
+    chttpx_response_t res = {0};
+    chttpx_static_stats_t stats;
+
+    ASSERT_EQ(0, static_get("/assets/app.js", &arena, &res));
+    ASSERT_EQ(cHTTPX_StatusOK, res.status);
+    ASSERT(res.file);
+    ASSERT_EQ(15, (long long)res.body_size);
+    ASSERT_STREQ(cHTTPX_CTYPE_JS, res.content_type);
+    ASSERT(cHTTPX_ResHeaderGet(&res, "ETag") != NULL);
+    _res_release(&res);
+
+    /* Second hit is served from the cache, "." and empty segments name the same file */
+    ASSERT_EQ(0, static_get("/assets//./app.js", &arena, &res));
+    ASSERT(res.file);
+    _res_release(&res);
+
+    cHTTPX_StaticStats(&stats);
+    ASSERT_EQ(1, (long long)stats.misses);
+    ASSERT_EQ(1, (long long)stats.hits);
+    ASSERT_EQ(1, (long long)stats.entries);
+
+    /* Directory index */
+    ASSERT_EQ(0, static_get("/assets/", &arena, &res));
+    ASSERT_EQ(13, (long long)res.body_size);
+    ASSERT_STREQ(cHTTPX_CTYPE_HTML, res.content_type);
+    _res_release(&res);
+
+    /* Traversal and missing files */
+    res = (chttpx_response_t){0};
+    ASSERT_EQ(0, static_get("/assets/../etc/passwd", &arena, &res));
+    ASSERT_EQ(cHTTPX_StatusNotFound, res.status);
+    ASSERT(!res.file);
+    free((void*)res.body);
+
+    res = (chttpx_response_t){0};
+    ASSERT_EQ(0, static_get("/assets/missing.css", &arena, &res));
+    ASSERT_EQ(cHTTPX_StatusNotFound, res.status);
+    free((void*)res.body);
+
+    /* HEAD is served like GET, other methods are not */
+    char head[] = "HEAD /assets/app.js HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    ASSERT_EQ(0, _static_find(_parse_req_buffer(CHTTPX_INVALID_SOCKET, head, sizeof(head) - 1, &arena)));
+
+    char post[] = "POST /assets/app.js HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    ASSERT_EQ(-1, _static_find(_parse_req_buffer(CHTTPX_INVALID_SOCKET, post, sizeof(post) - 1, &arena)));
+
+    /* Prefix ends on a segment boundary */
+    ASSERT_EQ(-1, static_get("/assetsx/app.js", &arena, &res));
+
+    _static_shutdown();
+    _arena_free(&arena);
+
+    unlink(app);
+    unlink(index);
+    rmdir(dir);
+}
+
+#ifdef __linux__
+TEST(test_static_invalidated_on_change)
+{
+    char dir[] = "/tmp/chttpx_static_XXXXXX";
+    ASSERT(mkdtemp(dir) != NULL);
+
+    char file[128];
+    snprintf(file, sizeof(file), "%s/data.txt", dir);
+    write_file(file, "v1");
+
+    ASSERT_EQ(0, cHTTPX_Static("", dir));
+
+    chttpx_arena_t arena = {0};
+    chttpx_response_t res = {0};
+    chttpx_static_stats_t stats;
+
+    ASSERT_EQ(0, static_get("/data.txt", &arena, &res));
+    ASSERT_EQ(2, (long long)res.body_size);
+    _res_release(&res);
+
+    write_file(file, "version 2");
+
+    /* The watcher thread drops the entry */
+    for (int i = 0; i < 200; i++)
+    {
+        cHTTPX_StaticStats(&stats);
+        if (stats.invalidations > 0)
+            break;
+        usleep(10000);
+    }
+
+    ASSERT(stats.invalidations > 0);
+    ASSERT_EQ(0, (long long)stats.entries);
+
+    ASSERT_EQ(0, static_get("/data.txt", &arena, &res));
+    ASSERT_EQ(9, (long long)res.body_size);
+    _res_release(&res);
+
+    cHTTPX_StaticStats(&stats);
+    ASSERT_EQ(2, (long long)stats.misses);
+
+    _static_shutdown();
+    _arena_free(&arena);
+
+    unlink(file);
+    rmdir(dir);
+}
+
+TEST(test_static_precompressed_sibling)
+{
+    char dir[] = "/tmp/chttpx_static_XXXXXX";
+    ASSERT(mkdtemp(dir) != NULL);
+
+    char app[128], app_gz[128], style[128];
+    snprintf(app, sizeof(app), "%s/app.js", dir);
+    snprintf(app_gz, sizeof(app_gz), "%s/app.js.gz", dir);
+    snprintf(style, sizeof(style), "%s/style.css", dir);
+    write_file(app, "console.log('uncompressed');");
+    write_file(app_gz, "GZ");
+    write_file(style, "body{}");
+
+    chttpx_serv_t s = {0};
+    chttpx_serv_t* saved = serv;
+    serv = &s;
+    cHTTPX_Compress(0, 0, NULL, 0);
+    ASSERT_EQ(0, cHTTPX_Static("", dir));
+
+    chttpx_arena_t arena = {0};
+    chttpx_response_t res = {0};
+
+    /* The sibling's bytes with the original's type */
+    ASSERT_EQ(0, static_request("/app.js", "Accept-Encoding: gzip, br\r\n", &arena, &res));
+    ASSERT_EQ(2, (long long)res.body_size);
+    ASSERT_STREQ(cHTTPX_CTYPE_JS, res.content_type);
+    ASSERT_STREQ("gzip", cHTTPX_ResHeaderGet(&res, "Content-Encoding"));
+    _res_release(&res);
+
+    /* Clients without gzip get the file */
+    ASSERT_EQ(0, static_request("/app.js", "Accept-Encoding: br\r\n", &arena, &res));
+    ASSERT_EQ(28, (long long)res.body_size);
+    ASSERT(cHTTPX_ResHeaderGet(&res, "Content-Encoding") == NULL);
+    _res_release(&res);
+
+    /* No sibling: remembered as missing, not looked up again */
+    ASSERT_EQ(0, static_request("/style.css", "Accept-Encoding: gzip\r\n", &arena, &res));
+    ASSERT_EQ(6, (long long)res.body_size);
+    _res_release(&res);
+
+    chttpx_static_stats_t stats;
+    cHTTPX_StaticStats(&stats);
+    size_t entries = stats.entries;
+    uint64_t misses = stats.misses;
+
+    ASSERT_EQ(0, static_request("/style.css", "Accept-Encoding: gzip\r\n", &arena, &res));
+    ASSERT_EQ(6, (long long)res.body_size);
+    _res_release(&res);
+
+    cHTTPX_StaticStats(&stats);
+    ASSERT_EQ((long long)entries, (long long)stats.entries);
+    ASSERT_EQ((long long)misses, (long long)stats.misses);
+
+    /* Asked for directly, the remembered sibling is a miss, not a hit */
+    uint64_t hits = stats.hits;
+    res = (chttpx_response_t){0};
+    ASSERT_EQ(0, static_get("/style.css.gz", &arena, &res));
+    ASSERT_EQ(cHTTPX_StatusNotFound, res.status);
+    free((void*)res.body);
+
+    cHTTPX_StaticStats(&stats);
+    ASSERT_EQ((long long)hits, (long long)stats.hits);
+    ASSERT_EQ((long long)misses + 1, (long long)stats.misses);
+
+    /* Until the sibling shows up */
+    char style_gz[128];
+    snprintf(style_gz, sizeof(style_gz), "%s/style.css.gz", dir);
+    write_file(style_gz, "CSSGZ");
+
+    for (int i = 0; i < 200 && stats.invalidations == 0; i++)
+    {
+        usleep(10000);
+        cHTTPX_StaticStats(&stats);
+    }
+
+    ASSERT_EQ(0, static_request("/style.css", "Accept-Encoding: gzip\r\n", &arena, &res));
+    ASSERT_EQ(5, (long long)res.body_size);
+    ASSERT_STREQ("gzip", cHTTPX_ResHeaderGet(&res, "Content-Encoding"));
+    _res_release(&res);
+
+    _static_shutdown();
+    _arena_free(&arena);
+    serv = saved;
+
+    unlink(app);
+    unlink(app_gz);
+    unlink(style);
+    unlink(style_gz);
+    rmdir(dir);
+}
+#endif
+#endif
+
+void run_static_tests(void)
+{
+    printf("static\n");
+#ifndef _WIN32
+    RUN_TEST(test_static_serves_and_caches);
+#ifdef __linux__
+    RUN_TEST(test_static_invalidated_on_change);
+    RUN_TEST(test_static_precompressed_sibling);
+#endif
+#endif
+}
@@ -2,6 +2,14 @@
 
 #include "libchttpx.h"
 
+#ifdef __linux__
+#include <poll.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
 static void ws_open(chttpx_wsocket_t* ws, void* userdata)
 {
     (void)ws;
@@ -64,9 +72,85 @@ TEST(test_websocket_shutdown_without_connections)
     cHTTPX_Shutdown();
 }
 
+#ifdef __linux__
+static void ws_echo(chttpx_wsocket_t* ws, const unsigned char* data, size_t len, int opcode, void* userdata)
+{
+    (void)opcode;
+    (void)userdata;
+
+    char text[64];
+    snprintf(text, sizeof(text), "echo %.*s", (int)len, (const char*)data);
+    cHTTPX_WSocketSend(ws, text);
+}
+
+TEST(test_websocket_on_high_fd)
+{
+    chttpx_serv_t serv = {0};
+    static chttpx_wsocket_callbacks_t callbacks = {
+        .on_open = ws_open,
+        .on_message = ws_echo,
+        .on_close = ws_close,
+    };
+
+    ASSERT_EQ(0, cHTTPX_Init(&serv, 18097, NULL));
+
+    chttpx_router_t r = cHTTPX_RoutePathPrefix("");
+    cHTTPX_WSocketRegisterRoute(&r, "/ws", &callbacks);
+
+    /* Event loop connections, then upgraded, are numbered past FD_SETSIZE */
+    struct rlimit lim;
+    ASSERT_EQ(0, getrlimit(RLIMIT_NOFILE, &lim));
+    if (lim.rlim_cur < 2048 && lim.rlim_max >= 2048)
+    {
+        lim.rlim_cur = 2048;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+
+    int sv[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+    ASSERT_EQ(2000, dup2(sv[1], 2000));
+    close(sv[1]);
+
+    chttpx_arena_t arena = {0};
+    char buf[] = "GET /ws HTTP/1.1\r\nHost: x\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                 "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    chttpx_request_t* req = _parse_req_buffer(2000, buf, sizeof(buf) - 1, &arena);
+    ASSERT(req != NULL);
+    ASSERT_EQ(1, cHTTPX_WSocketTryHandle(req));
+    _free_req(req);
+    _arena_free(&arena);
+
+    char resp[512];
+    ssize_t n = read(sv[0], resp, sizeof(resp) - 1);
+    ASSERT(n > 0);
+    resp[n] = '\0';
+    ASSERT(strstr(resp, "HTTP/1.1 101") == resp);
+
+    /* Masked text frame (zero mask) */
+    const unsigned char frame[] = {0x81, 0x82, 0, 0, 0, 0, 'h', 'i'};
+    ASSERT_EQ((long long)sizeof(frame), write(sv[0], frame, sizeof(frame)));
+
+    struct pollfd pfd = {.fd = sv[0], .events = POLLIN};
+    ASSERT_EQ(1, poll(&pfd, 1, 2000));
+
+    unsigned char echo[64];
+    n = read(sv[0], echo, sizeof(echo));
+    ASSERT_EQ(9, (long long)n);
+    ASSERT_EQ(0x81, echo[0]);
+    ASSERT_EQ(7, echo[1]);
+    ASSERT(memcmp(echo + 2, "echo hi", 7) == 0);
+
+    close(sv[0]);
+    cHTTPX_Shutdown();
+}
+#endif
+
 void run_websocket_tests(void)
 {
     printf("websocket\n");
     RUN_TEST(test_register_websocket_route);
     RUN_TEST(test_websocket_shutdown_without_connections);
+#ifdef __linux__
+    RUN_TEST(test_websocket_on_high_fd);
+#endif
 }